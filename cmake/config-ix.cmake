@@ -111,6 +111,8 @@ check_symbol_exists(malloc_zone_statistics malloc/malloc.h
 check_symbol_exists(mkdtemp "stdlib.h;unistd.h" HAVE_MKDTEMP)
 check_symbol_exists(mkstemp "stdlib.h;unistd.h" HAVE_MKSTEMP)
 check_symbol_exists(mktemp "stdlib.h;unistd.h" HAVE_MKTEMP)
+check_symbol_exists(posix_spawn spawn.h HAVE_POSIX_SPAWN)
+check_symbol_exists(vfork unistd.h HAVE_VFORK)
 check_symbol_exists(closedir "sys/types.h;dirent.h" HAVE_CLOSEDIR)
 check_symbol_exists(opendir "sys/types.h;dirent.h" HAVE_OPENDIR)
 check_symbol_exists(readdir "sys/types.h;dirent.h" HAVE_READDIR)
@@ -21,6 +21,12 @@
 #include <cstdlib>
 #include <cstring>
 
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LLVM_BITVECTOR_SSE2 1
+#endif
+
 namespace llvm {
 
 class BitVector {
@@ -32,6 +38,35 @@ class BitVector {
   unsigned Size;         // Size of bitvector in bits.
   unsigned Capacity;     // Size of allocated memory in BitWord.
 
+  // Word operations for the bulk set operations below.  Each one combines a
+  // word of this bitvector (L) with a word of the other one (R).
+  struct OrOp {
+    static BitWord apply(BitWord L, BitWord R) { return L | R; }
+#ifdef LLVM_BITVECTOR_SSE2
+    static __m128i apply(__m128i L, __m128i R) { return _mm_or_si128(L, R); }
+#endif
+  };
+  struct AndOp {
+    static BitWord apply(BitWord L, BitWord R) { return L & R; }
+#ifdef LLVM_BITVECTOR_SSE2
+    static __m128i apply(__m128i L, __m128i R) { return _mm_and_si128(L, R); }
+#endif
+  };
+  struct XorOp {
+    static BitWord apply(BitWord L, BitWord R) { return L ^ R; }
+#ifdef LLVM_BITVECTOR_SSE2
+    static __m128i apply(__m128i L, __m128i R) { return _mm_xor_si128(L, R); }
+#endif
+  };
+  struct AndNotOp {
+    static BitWord apply(BitWord L, BitWord R) { return L & ~R; }
+#ifdef LLVM_BITVECTOR_SSE2
+    static __m128i apply(__m128i L, __m128i R) {
+      return _mm_andnot_si128(R, L);
+    }
+#endif
+  };
+
 public:
   // Encapsulation of a single bit.
   class reference {
@@ -109,6 +144,11 @@ public:
 
   /// count - Returns the number of bits which are set.
   unsigned count() const {
+#ifndef __POPCNT__
+    // Unless the compiler may use the popcnt instruction, count out of line,
+    // where the host is checked for it at runtime.
+    return count_words(Bits, NumBitWords(size()));
+#else
     unsigned NumBits = 0;
     for (unsigned i = 0; i < NumBitWords(size()); ++i)
       if (sizeof(BitWord) == 4)
@@ -118,6 +158,7 @@ public:
       else
         assert(0 && "Unsupported!");
     return NumBits;
+#endif
   }
 
   /// any - Returns true if any bit is set.
@@ -242,6 +283,15 @@ public:
     return *this;
   }
 
+  /// reset - Reset the bits that are set in RHS.  This is "*this &= ~RHS"
+  /// without the temporary.
+  BitVector &reset(const BitVector &RHS) {
+    apply_words<AndNotOp>(Bits, RHS.Bits,
+                          std::min(NumBitWords(size()),
+                                   NumBitWords(RHS.size())));
+    return *this;
+  }
+
   BitVector &flip() {
     for (unsigned i = 0; i < NumBitWords(size()); ++i)
       Bits[i] = ~Bits[i];
@@ -301,13 +351,75 @@ public:
     return !(*this == RHS);
   }
 
+  /// anyCommon - Returns true if any bit is set in both this bitvector and
+  /// RHS.  This is "(*this & RHS).any()" without the temporary.
+  bool anyCommon(const BitVector &RHS) const {
+    unsigned NumWords = std::min(NumBitWords(size()), NumBitWords(RHS.size()));
+    unsigned i = 0;
+#ifdef LLVM_BITVECTOR_SSE2
+    for (; i + WORDS_PER_VECTOR <= NumWords; i += WORDS_PER_VECTOR) {
+      __m128i Common = _mm_and_si128(load_vector(Bits + i),
+                                     load_vector(RHS.Bits + i));
+      if (_mm_movemask_epi8(_mm_cmpeq_epi8(Common, _mm_setzero_si128())) !=
+          0xFFFF)
+        return true;
+    }
+#endif
+    for (; i != NumWords; ++i)
+      if (Bits[i] & RHS.Bits[i])
+        return true;
+    return false;
+  }
+
+  /// unionWith - Set the bits that are set in RHS, growing this bitvector if
+  /// RHS is larger.  Returns true if any bit changed, which is the test that
+  /// iterative dataflow problems need after each union.
+  bool unionWith(const BitVector &RHS) {
+    if (size() < RHS.size())
+      resize(RHS.size());
+    return apply_words<OrOp>(Bits, RHS.Bits, NumBitWords(RHS.size()));
+  }
+
+  /// unionWithDifference - Set the bits that are set in A but not in B, that
+  /// is "*this |= A & ~B", and return true if any bit changed.  This is the
+  /// liveness transfer function LiveIn |= LiveOut - Defs in one pass.
+  bool unionWithDifference(const BitVector &A, const BitVector &B) {
+    if (size() < A.size())
+      resize(A.size());
+    unsigned AWords = NumBitWords(A.size());
+    unsigned BWords = std::min(AWords, NumBitWords(B.size()));
+    unsigned i = 0;
+    bool Changed = false;
+#ifdef LLVM_BITVECTOR_SSE2
+    __m128i Diff = _mm_setzero_si128();
+    for (; i + WORDS_PER_VECTOR <= BWords; i += WORDS_PER_VECTOR) {
+      __m128i Old = load_vector(Bits + i);
+      __m128i New = _mm_or_si128(Old,
+                                 _mm_andnot_si128(load_vector(B.Bits + i),
+                                                  load_vector(A.Bits + i)));
+      Diff = _mm_or_si128(Diff, _mm_xor_si128(Old, New));
+      store_vector(Bits + i, New);
+    }
+    Changed = !is_zero_vector(Diff);
+#endif
+    BitWord WordDiff = 0;
+    for (; i != BWords; ++i) {
+      BitWord New = Bits[i] | (A.Bits[i] & ~B.Bits[i]);
+      WordDiff |= Bits[i] ^ New;
+      Bits[i] = New;
+    }
+    Changed |= WordDiff != 0;
+    if (i != AWords)
+      Changed |= apply_words<OrOp>(Bits + i, A.Bits + i, AWords - i);
+    return Changed;
+  }
+
   // Intersection, union, disjoint union.
   BitVector &operator&=(const BitVector &RHS) {
     unsigned ThisWords = NumBitWords(size());
     unsigned RHSWords  = NumBitWords(RHS.size());
-    unsigned i;
-    for (i = 0; i != std::min(ThisWords, RHSWords); ++i)
-      Bits[i] &= RHS.Bits[i];
+    unsigned i = std::min(ThisWords, RHSWords);
+    apply_words<AndOp>(Bits, RHS.Bits, i);
 
     // Any bits that are just in this bitvector become zero, because they aren't
     // in the RHS bit vector.  Any words only in RHS are ignored because they
@@ -321,16 +433,14 @@ public:
   BitVector &operator|=(const BitVector &RHS) {
     if (size() < RHS.size())
       resize(RHS.size());
-    for (size_t i = 0, e = NumBitWords(RHS.size()); i != e; ++i)
-      Bits[i] |= RHS.Bits[i];
+    apply_words<OrOp>(Bits, RHS.Bits, NumBitWords(RHS.size()));
     return *this;
   }
 
   BitVector &operator^=(const BitVector &RHS) {
     if (size() < RHS.size())
       resize(RHS.size());
-    for (size_t i = 0, e = NumBitWords(RHS.size()); i != e; ++i)
-      Bits[i] ^= RHS.Bits[i];
+    apply_words<XorOp>(Bits, RHS.Bits, NumBitWords(RHS.size()));
     return *this;
   }
 
@@ -370,6 +480,51 @@ private:
     return (S + BITWORD_SIZE-1) / BITWORD_SIZE;
   }
 
+#ifdef LLVM_BITVECTOR_SSE2
+  enum { WORDS_PER_VECTOR = 16 / sizeof(BitWord) };
+
+  static __m128i load_vector(const BitWord *P) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(P));
+  }
+  static void store_vector(BitWord *P, __m128i V) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(P), V);
+  }
+  static bool is_zero_vector(__m128i V) {
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(V, _mm_setzero_si128())) == 0xFFFF;
+  }
+#endif
+
+  // Combine the first NumWords words of Dst and Src with Op, storing the
+  // result in Dst, and return true if any word of Dst changed.
+  template <typename Op>
+  static bool apply_words(BitWord *Dst, const BitWord *Src,
+                          unsigned NumWords) {
+    unsigned i = 0;
+    bool Changed = false;
+#ifdef LLVM_BITVECTOR_SSE2
+    __m128i Diff = _mm_setzero_si128();
+    for (; i + WORDS_PER_VECTOR <= NumWords; i += WORDS_PER_VECTOR) {
+      __m128i Old = load_vector(Dst + i);
+      __m128i New = Op::apply(Old, load_vector(Src + i));
+      Diff = _mm_or_si128(Diff, _mm_xor_si128(Old, New));
+      store_vector(Dst + i, New);
+    }
+    Changed = !is_zero_vector(Diff);
+#endif
+    BitWord WordDiff = 0;
+    for (; i != NumWords; ++i) {
+      BitWord New = Op::apply(Dst[i], Src[i]);
+      WordDiff |= Dst[i] ^ New;
+      Dst[i] = New;
+    }
+    return Changed || WordDiff != 0;
+  }
+
+  // Count the bits set in the first NumWords words of Words.  This is
+  // implemented in lib/Support/BitVector.cpp so that it can use the popcnt
+  // instruction when the host has it.
+  static unsigned count_words(const BitWord *Words, unsigned NumWords);
+
   // Set the unused bits in the high words.
   void set_unused_bits(bool t = true) {
     //  Set high words first.
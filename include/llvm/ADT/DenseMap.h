@@ -230,6 +230,11 @@ public:
   /// determine whether an insertion caused the DenseMap to reallocate.
   const void *getPointerIntoBucketsArray() const { return Buckets; }
 
+  /// getMemorySize - Return the number of bytes allocated by the map.
+  size_t getMemorySize() const {
+    return NumBuckets * sizeof(BucketT);
+  }
+
 private:
   void CopyFrom(const DenseMap& other) {
     if (NumBuckets != 0 &&
@@ -0,0 +1,549 @@
+//===- llvm/ADT/FlatHashMap.h - Tag-probed open addressing map --*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the FlatHashMap class, an open addressing hash table with
+// the same interface as DenseMap.
+//
+// Next to the bucket array, FlatHashMap keeps one control byte per bucket.  A
+// control byte is either "empty", "deleted", or holds seven bits of the key's
+// hash.  Buckets are probed sixteen at a time: the control bytes of a group are
+// compared against the tag of the key being looked up (with SSE2 when it is
+// available), and only the buckets whose tag matches have their keys compared.
+// Unlike DenseMap, the keys do not need reserved empty and tombstone values,
+// and empty buckets are never constructed.
+//
+// The hash returned by KeyInfoT is scrambled before use, so the weak pointer
+// hash of DenseMapInfo<T*> does not lead to clustering.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_ADT_FLATHASHMAP_H
+#define LLVM_ADT_FLATHASHMAP_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Support/DataTypes.h"
+#include "llvm/Support/MathExtras.h"
+#include <algorithm>
+#include <iterator>
+#include <new>
+#include <utility>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LLVM_FLATHASHMAP_SSE2 1
+#endif
+
+namespace llvm {
+
+namespace flathashmap {
+
+/// GroupSize - Buckets are probed in aligned groups of this many.
+enum { GroupSize = 16 };
+
+/// Control byte values.  Full buckets hold a 7-bit tag, so the high bit is
+/// only set for empty and deleted buckets.
+enum {
+  CtrlEmpty = 0x80,
+  CtrlDeleted = 0xFE
+};
+
+/// Group - The control bytes of one probe group, with bit masks for the
+/// buckets matching a given state.
+class Group {
+#ifdef LLVM_FLATHASHMAP_SSE2
+  __m128i Ctrl;
+public:
+  explicit Group(const unsigned char *Pos)
+    : Ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i*>(Pos))) {}
+
+  /// match - Return a mask of the buckets whose tag is Tag.
+  unsigned match(unsigned char Tag) const {
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8((char)Tag), Ctrl));
+  }
+  /// matchEmpty - Return a mask of the empty buckets.
+  unsigned matchEmpty() const { return match(CtrlEmpty); }
+  /// matchAvailable - Return a mask of the empty or deleted buckets.
+  unsigned matchAvailable() const { return _mm_movemask_epi8(Ctrl); }
+#else
+  const unsigned char *Ctrl;
+public:
+  explicit Group(const unsigned char *Pos) : Ctrl(Pos) {}
+
+  unsigned match(unsigned char Tag) const {
+    unsigned Mask = 0;
+    for (unsigned i = 0; i != GroupSize; ++i)
+      if (Ctrl[i] == Tag)
+        Mask |= 1U << i;
+    return Mask;
+  }
+  unsigned matchEmpty() const { return match(CtrlEmpty); }
+  unsigned matchAvailable() const {
+    unsigned Mask = 0;
+    for (unsigned i = 0; i != GroupSize; ++i)
+      if (Ctrl[i] & 0x80)
+        Mask |= 1U << i;
+    return Mask;
+  }
+#endif
+};
+
+/// mixHash - Spread the bits of a KeyInfoT hash over 64 bits.
+static inline uint64_t mixHash(unsigned Hash) {
+  return (uint64_t)Hash * 0x9E3779B97F4A7C15ULL;
+}
+
+/// getTag - The 7-bit tag stored in the control byte of a full bucket.
+static inline unsigned char getTag(uint64_t Mixed) {
+  return (unsigned char)(Mixed >> 57);
+}
+
+/// getGroupIndex - The first group probed for a key.
+static inline unsigned getGroupIndex(uint64_t Mixed) {
+  return (unsigned)(Mixed >> 25);
+}
+
+} // end namespace flathashmap
+
+template<typename KeyT, typename ValueT,
+         typename KeyInfoT = DenseMapInfo<KeyT>,
+         typename ValueInfoT = DenseMapInfo<ValueT>, bool IsConst = false>
+class FlatHashMapIterator;
+
+template<typename KeyT, typename ValueT,
+         typename KeyInfoT = DenseMapInfo<KeyT>,
+         typename ValueInfoT = DenseMapInfo<ValueT> >
+class FlatHashMap {
+  typedef std::pair<KeyT, ValueT> BucketT;
+  unsigned NumBuckets;
+  BucketT *Buckets;
+  unsigned char *Ctrl;
+
+  unsigned NumEntries;
+  unsigned NumTombstones;
+public:
+  typedef KeyT key_type;
+  typedef ValueT mapped_type;
+  typedef BucketT value_type;
+
+  FlatHashMap(const FlatHashMap &other) {
+    init(other.NumBuckets);
+    CopyFrom(other);
+  }
+
+  explicit FlatHashMap(unsigned NumInitBuckets = 64) {
+    init(NumInitBuckets);
+  }
+
+  template<typename InputIt>
+  FlatHashMap(const InputIt &I, const InputIt &E) {
+    init(64);
+    insert(I, E);
+  }
+
+  ~FlatHashMap() {
+    destroyAll();
+    operator delete(Buckets);
+    delete[] Ctrl;
+  }
+
+  typedef FlatHashMapIterator<KeyT, ValueT, KeyInfoT> iterator;
+  typedef FlatHashMapIterator<KeyT, ValueT,
+                              KeyInfoT, ValueInfoT, true> const_iterator;
+  inline iterator begin() {
+    // When the map is empty, avoid the overhead of AdvancePastEmptyBuckets().
+    return empty() ? end() : iterator(Buckets, Buckets+NumBuckets, Ctrl);
+  }
+  inline iterator end() {
+    return iterator(Buckets+NumBuckets, Buckets+NumBuckets, Ctrl+NumBuckets);
+  }
+  inline const_iterator begin() const {
+    return empty() ? end() : const_iterator(Buckets, Buckets+NumBuckets, Ctrl);
+  }
+  inline const_iterator end() const {
+    return const_iterator(Buckets+NumBuckets, Buckets+NumBuckets,
+                          Ctrl+NumBuckets);
+  }
+
+  bool empty() const { return NumEntries == 0; }
+  unsigned size() const { return NumEntries; }
+
+  /// Grow the map so that it has at least Size buckets. Does not shrink
+  void resize(size_t Size) {
+    if (Size > NumBuckets)
+      grow(Size);
+  }
+
+  void clear() {
+    if (NumEntries == 0 && NumTombstones == 0) return;
+
+    // If the capacity of the array is huge, and the # elements used is small,
+    // shrink the array.
+    if (NumEntries * 4 < NumBuckets && NumBuckets > 64) {
+      destroyAll();
+      operator delete(Buckets);
+      delete[] Ctrl;
+      init(NumEntries > 32 ? 1 << (Log2_32_Ceil(NumEntries) + 1) : 64);
+      return;
+    }
+
+    destroyAll();
+    memset(Ctrl, flathashmap::CtrlEmpty, NumBuckets);
+    NumEntries = 0;
+    NumTombstones = 0;
+  }
+
+  /// count - Return true if the specified key is in the map.
+  bool count(const KeyT &Val) const {
+    BucketT *TheBucket;
+    return LookupBucketFor(Val, TheBucket);
+  }
+
+  iterator find(const KeyT &Val) {
+    BucketT *TheBucket;
+    if (LookupBucketFor(Val, TheBucket))
+      return iterator(TheBucket, Buckets+NumBuckets,
+                      Ctrl + (TheBucket-Buckets));
+    return end();
+  }
+  const_iterator find(const KeyT &Val) const {
+    BucketT *TheBucket;
+    if (LookupBucketFor(Val, TheBucket))
+      return const_iterator(TheBucket, Buckets+NumBuckets,
+                            Ctrl + (TheBucket-Buckets));
+    return end();
+  }
+
+  /// lookup - Return the entry for the specified key, or a default
+  /// constructed value if no such entry exists.
+  ValueT lookup(const KeyT &Val) const {
+    BucketT *TheBucket;
+    if (LookupBucketFor(Val, TheBucket))
+      return TheBucket->second;
+    return ValueT();
+  }
+
+  // Inserts key,value pair into the map if the key isn't already in the map.
+  // If the key is already in the map, it returns false and doesn't update the
+  // value.
+  std::pair<iterator, bool> insert(const std::pair<KeyT, ValueT> &KV) {
+    BucketT *TheBucket;
+    if (LookupBucketFor(KV.first, TheBucket))
+      return std::make_pair(iterator(TheBucket, Buckets+NumBuckets,
+                                     Ctrl + (TheBucket-Buckets)),
+                            false); // Already in map.
+
+    // Otherwise, insert the new element.
+    TheBucket = InsertIntoBucket(KV.first, KV.second, TheBucket);
+    return std::make_pair(iterator(TheBucket, Buckets+NumBuckets,
+                                   Ctrl + (TheBucket-Buckets)),
+                          true);
+  }
+
+  /// insert - Range insertion of pairs.
+  template<typename InputIt>
+  void insert(InputIt I, InputIt E) {
+    for (; I != E; ++I)
+      insert(*I);
+  }
+
+  bool erase(const KeyT &Val) {
+    BucketT *TheBucket;
+    if (!LookupBucketFor(Val, TheBucket))
+      return false; // not in map.
+
+    EraseBucket(TheBucket);
+    return true;
+  }
+  void erase(iterator I) {
+    EraseBucket(&*I);
+  }
+
+  void swap(FlatHashMap& RHS) {
+    std::swap(NumBuckets, RHS.NumBuckets);
+    std::swap(Buckets, RHS.Buckets);
+    std::swap(Ctrl, RHS.Ctrl);
+    std::swap(NumEntries, RHS.NumEntries);
+    std::swap(NumTombstones, RHS.NumTombstones);
+  }
+
+  value_type& FindAndConstruct(const KeyT &Key) {
+    BucketT *TheBucket;
+    if (LookupBucketFor(Key, TheBucket))
+      return *TheBucket;
+
+    return *InsertIntoBucket(Key, ValueT(), TheBucket);
+  }
+
+  ValueT &operator[](const KeyT &Key) {
+    return FindAndConstruct(Key).second;
+  }
+
+  FlatHashMap& operator=(const FlatHashMap& other) {
+    if (&other != this) {
+      clear();
+      CopyFrom(other);
+    }
+    return *this;
+  }
+
+  /// isPointerIntoBucketsArray - Return true if the specified pointer points
+  /// somewhere into the map's array of buckets (i.e. either to a key or
+  /// value in the map).
+  bool isPointerIntoBucketsArray(const void *Ptr) const {
+    return Ptr >= Buckets && Ptr < Buckets+NumBuckets;
+  }
+
+  /// getPointerIntoBucketsArray() - Return an opaque pointer into the buckets
+  /// array.  In conjunction with the previous method, this can be used to
+  /// determine whether an insertion caused the map to reallocate.
+  const void *getPointerIntoBucketsArray() const { return Buckets; }
+
+  /// getMemorySize - Return the number of bytes allocated by the map.
+  size_t getMemorySize() const {
+    return NumBuckets * (sizeof(BucketT) + 1);
+  }
+
+private:
+  bool isFull(unsigned BucketNo) const {
+    return (Ctrl[BucketNo] & 0x80) == 0;
+  }
+
+  void destroyAll() {
+    for (unsigned i = 0; i != NumBuckets; ++i)
+      if (isFull(i)) {
+        Buckets[i].second.~ValueT();
+        Buckets[i].first.~KeyT();
+      }
+  }
+
+  void CopyFrom(const FlatHashMap& other) {
+    // The hash of a key does not depend on the table, so the entries can be
+    // reinserted one at a time without recomputing the table layout.
+    if (NumBuckets < other.NumBuckets)
+      grow(other.NumBuckets);
+    for (const_iterator I = other.begin(), E = other.end(); I != E; ++I)
+      insert(*I);
+  }
+
+  void EraseBucket(BucketT *TheBucket) {
+    TheBucket->second.~ValueT();
+    TheBucket->first.~KeyT();
+    Ctrl[TheBucket - Buckets] = flathashmap::CtrlDeleted;
+    --NumEntries;
+    ++NumTombstones;
+  }
+
+  BucketT *InsertIntoBucket(const KeyT &Key, const ValueT &Value,
+                            BucketT *TheBucket) {
+    // Keep at least 1/8 of the buckets empty so that failing lookups always
+    // terminate quickly.  If the table is mostly tombstones, rehashing at the
+    // same size is enough to reclaim them.
+    if (Ctrl[TheBucket - Buckets] == flathashmap::CtrlEmpty &&
+        (NumEntries + NumTombstones + 1) * 8 > NumBuckets * 7) {
+      grow((NumEntries + 1) * 4 >= NumBuckets * 3 ? NumBuckets * 2
+                                                  : NumBuckets);
+      LookupBucketFor(Key, TheBucket);
+    }
+    ++NumEntries;
+
+    // If we are writing over a tombstone, remember this.
+    unsigned BucketNo = TheBucket - Buckets;
+    if (Ctrl[BucketNo] == flathashmap::CtrlDeleted)
+      --NumTombstones;
+
+    new (&TheBucket->first) KeyT(Key);
+    new (&TheBucket->second) ValueT(Value);
+    Ctrl[BucketNo] =
+      flathashmap::getTag(flathashmap::mixHash(KeyInfoT::getHashValue(Key)));
+    return TheBucket;
+  }
+
+  /// LookupBucketFor - Lookup the appropriate bucket for Val, returning it in
+  /// FoundBucket.  If the bucket contains the key and a value, this returns
+  /// true, otherwise it returns an empty or deleted bucket to insert Val into
+  /// and returns false.
+  bool LookupBucketFor(const KeyT &Val, BucketT *&FoundBucket) const {
+    uint64_t Mixed = flathashmap::mixHash(KeyInfoT::getHashValue(Val));
+    unsigned char Tag = flathashmap::getTag(Mixed);
+    unsigned GroupMask = NumBuckets / flathashmap::GroupSize - 1;
+    unsigned GroupNo = flathashmap::getGroupIndex(Mixed) & GroupMask;
+    unsigned ProbeAmt = 1;
+
+    // FoundAvailable - The first empty or deleted bucket seen while probing.
+    BucketT *FoundAvailable = 0;
+
+    while (1) {
+      unsigned Base = GroupNo * flathashmap::GroupSize;
+      flathashmap::Group G(Ctrl + Base);
+
+      // Only compare the keys of the buckets whose tag matches.
+      for (unsigned Mask = G.match(Tag); Mask; Mask &= Mask - 1) {
+        BucketT *ThisBucket = Buckets + Base + CountTrailingZeros_32(Mask);
+        if (KeyInfoT::isEqual(ThisBucket->first, Val)) {
+          FoundBucket = ThisBucket;
+          return true;
+        }
+      }
+
+      if (!FoundAvailable)
+        if (unsigned Mask = G.matchAvailable())
+          FoundAvailable = Buckets + Base + CountTrailingZeros_32(Mask);
+
+      // An empty bucket in this group means the key was never displaced past
+      // it, so it is not in the map.
+      if (G.matchEmpty()) {
+        FoundBucket = FoundAvailable;
+        return false;
+      }
+
+      // Otherwise, continue quadratic probing over the groups.
+      GroupNo = (GroupNo + ProbeAmt++) & GroupMask;
+    }
+  }
+
+  void init(unsigned InitBuckets) {
+    NumEntries = 0;
+    NumTombstones = 0;
+    NumBuckets = std::max(InitBuckets, (unsigned)flathashmap::GroupSize);
+    assert((NumBuckets & (NumBuckets-1)) == 0 &&
+           "# initial buckets must be a power of two!");
+    Buckets = static_cast<BucketT*>(operator new(sizeof(BucketT)*NumBuckets));
+    Ctrl = new unsigned char[NumBuckets];
+    memset(Ctrl, flathashmap::CtrlEmpty, NumBuckets);
+  }
+
+  void grow(unsigned AtLeast) {
+    unsigned OldNumBuckets = NumBuckets;
+    BucketT *OldBuckets = Buckets;
+    unsigned char *OldCtrl = Ctrl;
+
+    // Double the number of buckets.
+    unsigned NewNumBuckets = NumBuckets;
+    while (NewNumBuckets < AtLeast)
+      NewNumBuckets <<= 1;
+    init(NewNumBuckets);
+
+    // Insert all the old elements.
+    for (unsigned i = 0; i != OldNumBuckets; ++i) {
+      if (OldCtrl[i] & 0x80)
+        continue;
+      BucketT *B = OldBuckets + i;
+
+      // Insert the key/value into the new table.
+      BucketT *DestBucket;
+      bool FoundVal = LookupBucketFor(B->first, DestBucket);
+      (void)FoundVal; // silence warning.
+      assert(!FoundVal && "Key already in new map?");
+      new (&DestBucket->first) KeyT(B->first);
+      new (&DestBucket->second) ValueT(B->second);
+      Ctrl[DestBucket - Buckets] = OldCtrl[i];
+      ++NumEntries;
+
+      // Free the old bucket.
+      B->second.~ValueT();
+      B->first.~KeyT();
+    }
+
+#ifndef NDEBUG
+    memset(OldBuckets, 0x5a, sizeof(BucketT)*OldNumBuckets);
+#endif
+    // Free the old table.
+    operator delete(OldBuckets);
+    delete[] OldCtrl;
+  }
+};
+
+template<typename KeyT, typename ValueT,
+         typename KeyInfoT, typename ValueInfoT, bool IsConst>
+class FlatHashMapIterator {
+  typedef std::pair<KeyT, ValueT> Bucket;
+  typedef FlatHashMapIterator<KeyT, ValueT,
+                              KeyInfoT, ValueInfoT, true> ConstIterator;
+  friend class FlatHashMapIterator<KeyT, ValueT, KeyInfoT, ValueInfoT, true>;
+public:
+  typedef ptrdiff_t difference_type;
+  typedef typename conditional<IsConst, const Bucket, Bucket>::type value_type;
+  typedef value_type *pointer;
+  typedef value_type &reference;
+  typedef std::forward_iterator_tag iterator_category;
+private:
+  pointer Ptr, End;
+  const unsigned char *Ctrl;
+public:
+  FlatHashMapIterator() : Ptr(0), End(0), Ctrl(0) {}
+
+  FlatHashMapIterator(pointer Pos, pointer E, const unsigned char *C)
+    : Ptr(Pos), End(E), Ctrl(C) {
+    AdvancePastEmptyBuckets();
+  }
+
+  // If IsConst is true this is a converting constructor from iterator to
+  // const_iterator and the default copy constructor is used.
+  // Otherwise this is a copy constructor for iterator.
+  FlatHashMapIterator(const FlatHashMapIterator<KeyT, ValueT,
+                                                KeyInfoT, ValueInfoT,
+                                                false>& I)
+    : Ptr(I.Ptr), End(I.End), Ctrl(I.Ctrl) {}
+
+  reference operator*() const {
+    return *Ptr;
+  }
+  pointer operator->() const {
+    return Ptr;
+  }
+
+  bool operator==(const ConstIterator &RHS) const {
+    return Ptr == RHS.operator->();
+  }
+  bool operator!=(const ConstIterator &RHS) const {
+    return Ptr != RHS.operator->();
+  }
+
+  inline FlatHashMapIterator& operator++() {  // Preincrement
+    ++Ptr;
+    ++Ctrl;
+    AdvancePastEmptyBuckets();
+    return *this;
+  }
+  FlatHashMapIterator operator++(int) {  // Postincrement
+    FlatHashMapIterator tmp = *this; ++*this; return tmp;
+  }
+
+private:
+  void AdvancePastEmptyBuckets() {
+    while (Ptr != End && (*Ctrl & 0x80)) {
+      ++Ptr;
+      ++Ctrl;
+    }
+  }
+};
+
+/// HotDenseMap - Selects the hash table used by maps that sit on hot lookup
+/// paths.  This is a DenseMap unless LLVM is configured with
+/// LLVM_USE_FLAT_HASH_MAP, in which case it is a FlatHashMap.  Both have the
+/// same interface, so users only need to spell the map type as
+/// HotDenseMap<K, V>::type.
+template<typename KeyT, typename ValueT,
+         typename KeyInfoT = DenseMapInfo<KeyT>,
+         typename ValueInfoT = DenseMapInfo<ValueT> >
+struct HotDenseMap {
+#if LLVM_USE_FLAT_HASH_MAP
+  typedef FlatHashMap<KeyT, ValueT, KeyInfoT, ValueInfoT> type;
+#else
+  typedef DenseMap<KeyT, ValueT, KeyInfoT, ValueInfoT> type;
+#endif
+};
+
+} // end namespace llvm
+
+#endif
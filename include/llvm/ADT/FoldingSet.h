@@ -106,7 +106,10 @@ class FoldingSetNodeID;
 /// structure is an array of buckets.  Each bucket is indexed by the hash of
 /// the nodes it contains.  The bucket itself points to the nodes contained
 /// in the bucket via a singly linked list.  The last node in the list points
-/// back to the bucket to facilitate node removal.
+/// back to the bucket to facilitate node removal.  Each node also caches its
+/// hash the first time it is computed, so that walking a bucket only has to
+/// profile the nodes whose hash matches the one being looked up, and growing
+/// the table does not have to profile any node twice.
 ///
 class FoldingSetImpl {
 protected:
@@ -135,13 +138,19 @@ public:
     // NextInFoldingSetBucket - next link in the bucket list.
     void *NextInFoldingSetBucket;
 
+    // CachedHash - The hash of this node with the high bit set, or zero if it
+    // has not been computed since the node was inserted.
+    unsigned CachedHash;
+
   public:
 
-    Node() : NextInFoldingSetBucket(0) {}
+    Node() : NextInFoldingSetBucket(0), CachedHash(0) {}
 
     // Accessors
     void *getNextInBucket() const { return NextInFoldingSetBucket; }
     void SetNextInBucket(void *N) { NextInFoldingSetBucket = N; }
+    unsigned getCachedHash() const { return CachedHash; }
+    void SetCachedHash(unsigned H) { CachedHash = H; }
   };
 
   /// clear - Remove all nodes from the folding set.
@@ -186,6 +195,10 @@ private:
   ///
   void GrowHashTable();
 
+  /// GetNodeHash - Return the cached hash of the specified node, computing and
+  /// caching it first if necessary.
+  unsigned GetNodeHash(Node *N, FoldingSetNodeID &TempID) const;
+
 protected:
 
   /// GetNodeProfile - Instantiations of the FoldingSet template implement
@@ -309,6 +309,19 @@ public:
     return *this;
   }
 
+  /// reset - Reset the bits that are set in RHS.
+  SmallBitVector &reset(const SmallBitVector &RHS) {
+    if (isSmall() && RHS.isSmall())
+      setSmallBits(getSmallBits() & ~RHS.getSmallBits());
+    else if (!isSmall() && !RHS.isSmall())
+      getPointer()->reset(*RHS.getPointer());
+    else
+      for (int i = RHS.find_first(); i >= 0 && unsigned(i) < size();
+           i = RHS.find_next(i))
+        reset(i);
+    return *this;
+  }
+
   SmallBitVector &flip() {
     if (isSmall())
       setSmallBits(~getSmallBits());
@@ -361,6 +374,33 @@ public:
     return !(*this == RHS);
   }
 
+  /// anyCommon - Returns true if any bit is set in both this bitvector and
+  /// RHS.
+  bool anyCommon(const SmallBitVector &RHS) const {
+    if (isSmall() && RHS.isSmall())
+      return (getSmallBits() & RHS.getSmallBits()) != 0;
+    if (!isSmall() && !RHS.isSmall())
+      return getPointer()->anyCommon(*RHS.getPointer());
+    // One of them is small, so at most SmallNumDataBits bits can be common.
+    const SmallBitVector &Small = isSmall() ? *this : RHS;
+    const SmallBitVector &Large = isSmall() ? RHS : *this;
+    for (int i = Small.find_first(); i >= 0; i = Small.find_next(i))
+      if (unsigned(i) < Large.size() && Large.test(i))
+        return true;
+    return false;
+  }
+
+  /// unionWith - Set the bits that are set in RHS, growing this bitvector if
+  /// RHS is larger.  Returns true if any bit changed.
+  bool unionWith(const SmallBitVector &RHS) {
+    if (!isSmall() && !RHS.isSmall())
+      return getPointer()->unionWith(*RHS.getPointer());
+    // A union only adds bits, so it changed something iff the count grew.
+    unsigned OldCount = count();
+    *this |= RHS;
+    return count() != OldCount;
+  }
+
   // Intersection, union, disjoint union.
   SmallBitVector &operator&=(const SmallBitVector &RHS) {
     resize(std::max(size(), RHS.size()));
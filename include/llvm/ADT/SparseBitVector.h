@@ -15,34 +15,39 @@
 #ifndef LLVM_ADT_SPARSEBITVECTOR_H
 #define LLVM_ADT_SPARSEBITVECTOR_H
 
-#include "llvm/ADT/ilist.h"
-#include "llvm/ADT/ilist_node.h"
 #include "llvm/Support/DataTypes.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
 #include <cassert>
 #include <climits>
 #include <cstring>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LLVM_SPARSEBITVECTOR_SSE2 1
+#endif
 
 namespace llvm {
 
 /// SparseBitVector is an implementation of a bitvector that is sparse by only
-/// storing the elements that have non-zero bits set.  In order to make this
-/// fast for the most common cases, SparseBitVector is implemented as a linked
-/// list of SparseBitVectorElements.  We maintain a pointer to the last
-/// SparseBitVectorElement accessed (in the form of a list iterator), in order
-/// to make multiple in-order test/set constant time after the first one is
-/// executed.  Note that using vectors to store SparseBitVectorElement's does
-/// not work out very well because it causes insertion in the middle to take
-/// enormous amounts of time with a large amount of bits.  Other structures that
-/// have better worst cases for insertion in the middle (various balanced trees,
-/// etc) do not perform as well in practice as a linked list with this iterator
-/// kept up to date.  They are also significantly more memory intensive.
+/// storing the elements that have non-zero bits set.  The elements are kept
+/// sorted by index in a single vector, so the bulk set operations (union,
+/// intersection, difference) stream through contiguous memory instead of
+/// chasing list nodes, and each pair of elements is combined with SIMD
+/// operations where the host has them.  We remember the position of the last
+/// element accessed, which makes in-order test/set constant time, and fall
+/// back to a binary search otherwise.  Inserting an element in the middle
+/// moves the elements after it, but elements are small and the bulk
+/// operations build their result in one pass, so in practice (liveness sets,
+/// points-to sets) this is much faster than a linked list and uses less
+/// memory, since there is no per-element heap node.
 
 
 template <unsigned ElementSize = 128>
-struct SparseBitVectorElement
-  : public ilist_node<SparseBitVectorElement<ElementSize> > {
+struct SparseBitVectorElement {
 public:
   typedef unsigned long BitWord;
   enum {
@@ -55,12 +60,31 @@ private:
   // Index of Element in terms of where first bit starts.
   unsigned ElementIndex;
   BitWord Bits[BITWORDS_PER_ELEMENT];
-  // Needed for sentinels
-  friend struct ilist_sentinel_traits<SparseBitVectorElement>;
-  SparseBitVectorElement() {
-    ElementIndex = ~0U;
-    memset(&Bits[0], 0, sizeof (BitWord) * BITWORDS_PER_ELEMENT);
+
+#ifdef LLVM_SPARSEBITVECTOR_SSE2
+  // The bits are processed 128 bits at a time if they fill whole vectors,
+  // which they do for the default element size.
+  enum {
+    VECTORS_PER_ELEMENT = sizeof(BitWord) * BITWORDS_PER_ELEMENT / 16,
+    VECTORIZABLE = VECTORS_PER_ELEMENT * 16 ==
+                   sizeof(BitWord) * BITWORDS_PER_ELEMENT
+  };
+
+  __m128i loadVector(unsigned i) const {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(Bits) + i);
   }
+  void storeVector(unsigned i, __m128i V) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(Bits) + i, V);
+  }
+  // Return a mask with one bit per byte of V that is zero.
+  static unsigned zeroBytes(__m128i V) {
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(V, _mm_setzero_si128()));
+  }
+  // Return a mask with one bit per byte that is the same in A and B.
+  static unsigned sameBytes(__m128i A, __m128i B) {
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(A, B));
+  }
+#endif
 
 public:
   explicit SparseBitVectorElement(unsigned Idx) {
@@ -186,6 +210,18 @@ public:
 
   // Union this element with RHS and return true if this one changed.
   bool unionWith(const SparseBitVectorElement &RHS) {
+#ifdef LLVM_SPARSEBITVECTOR_SSE2
+    if (VECTORIZABLE) {
+      unsigned Same = 0xFFFF;
+      for (unsigned i = 0; i < VECTORS_PER_ELEMENT; ++i) {
+        __m128i Old = loadVector(i);
+        __m128i New = _mm_or_si128(Old, RHS.loadVector(i));
+        Same &= sameBytes(Old, New);
+        storeVector(i, New);
+      }
+      return Same != 0xFFFF;
+    }
+#endif
     bool changed = false;
     for (unsigned i = 0; i < BITWORDS_PER_ELEMENT; ++i) {
       BitWord old = changed ? 0 : Bits[i];
@@ -199,6 +235,14 @@ public:
 
   // Return true if we have any bits in common with RHS
   bool intersects(const SparseBitVectorElement &RHS) const {
+#ifdef LLVM_SPARSEBITVECTOR_SSE2
+    if (VECTORIZABLE) {
+      unsigned Zero = 0xFFFF;
+      for (unsigned i = 0; i < VECTORS_PER_ELEMENT; ++i)
+        Zero &= zeroBytes(_mm_and_si128(loadVector(i), RHS.loadVector(i)));
+      return Zero != 0xFFFF;
+    }
+#endif
     for (unsigned i = 0; i < BITWORDS_PER_ELEMENT; ++i) {
       if (RHS.Bits[i] & Bits[i])
         return true;
@@ -210,6 +254,20 @@ public:
   // BecameZero is set to true if this element became all-zero bits.
   bool intersectWith(const SparseBitVectorElement &RHS,
                      bool &BecameZero) {
+#ifdef LLVM_SPARSEBITVECTOR_SSE2
+    if (VECTORIZABLE) {
+      unsigned Same = 0xFFFF, Zero = 0xFFFF;
+      for (unsigned i = 0; i < VECTORS_PER_ELEMENT; ++i) {
+        __m128i Old = loadVector(i);
+        __m128i New = _mm_and_si128(Old, RHS.loadVector(i));
+        Same &= sameBytes(Old, New);
+        Zero &= zeroBytes(New);
+        storeVector(i, New);
+      }
+      BecameZero = Zero == 0xFFFF;
+      return Same != 0xFFFF;
+    }
+#endif
     bool changed = false;
     bool allzero = true;
 
@@ -232,6 +290,20 @@ public:
   // bits.
   bool intersectWithComplement(const SparseBitVectorElement &RHS,
                                bool &BecameZero) {
+#ifdef LLVM_SPARSEBITVECTOR_SSE2
+    if (VECTORIZABLE) {
+      unsigned Same = 0xFFFF, Zero = 0xFFFF;
+      for (unsigned i = 0; i < VECTORS_PER_ELEMENT; ++i) {
+        __m128i Old = loadVector(i);
+        __m128i New = _mm_andnot_si128(RHS.loadVector(i), Old);
+        Same &= sameBytes(Old, New);
+        Zero &= zeroBytes(New);
+        storeVector(i, New);
+      }
+      BecameZero = Zero == 0xFFFF;
+      return Same != 0xFFFF;
+    }
+#endif
     bool changed = false;
     bool allzero = true;
 
@@ -254,6 +326,19 @@ public:
   void intersectWithComplement(const SparseBitVectorElement &RHS1,
                                const SparseBitVectorElement &RHS2,
                                bool &BecameZero) {
+#ifdef LLVM_SPARSEBITVECTOR_SSE2
+    if (VECTORIZABLE) {
+      unsigned Zero = 0xFFFF;
+      for (unsigned i = 0; i < VECTORS_PER_ELEMENT; ++i) {
+        __m128i New = _mm_andnot_si128(RHS2.loadVector(i),
+                                       RHS1.loadVector(i));
+        Zero &= zeroBytes(New);
+        storeVector(i, New);
+      }
+      BecameZero = Zero == 0xFFFF;
+      return;
+    }
+#endif
     bool allzero = true;
 
     BecameZero = false;
@@ -277,46 +362,50 @@ public:
 
 template <unsigned ElementSize = 128>
 class SparseBitVector {
-  typedef ilist<SparseBitVectorElement<ElementSize> > ElementList;
+  typedef SparseBitVectorElement<ElementSize> ElementT;
+  typedef std::vector<ElementT> ElementList;
   typedef typename ElementList::iterator ElementListIter;
   typedef typename ElementList::const_iterator ElementListConstIter;
   enum {
     BITWORD_SIZE = SparseBitVectorElement<ElementSize>::BITWORD_SIZE
   };
 
-  // Pointer to our current Element.
-  ElementListIter CurrElementIter;
   ElementList Elements;
+  // Position of our current Element.  Vector iterators are invalidated by
+  // insertion, so we keep an index instead.
+  unsigned CurrElementIdx;
 
-  // This is like std::lower_bound, except we do linear searching from the
-  // current position.
-  ElementListIter FindLowerBound(unsigned ElementIndex) {
-
-    if (Elements.empty()) {
-      CurrElementIter = Elements.begin();
-      return Elements.begin();
+  struct IndexCompare {
+    bool operator()(const ElementT &Element, unsigned Index) const {
+      return Element.index() < Index;
     }
+  };
 
-    // Make sure our current iterator is valid.
-    if (CurrElementIter == Elements.end())
-      --CurrElementIter;
-
-    // Search from our current iterator, either backwards or forwards,
-    // depending on what element we are looking for.
-    ElementListIter ElementIter = CurrElementIter;
-    if (CurrElementIter->index() == ElementIndex) {
-      return ElementIter;
-    } else if (CurrElementIter->index() > ElementIndex) {
-      while (ElementIter != Elements.begin()
-             && ElementIter->index() > ElementIndex)
-        --ElementIter;
-    } else {
-      while (ElementIter != Elements.end() &&
-             ElementIter->index() < ElementIndex)
-        ++ElementIter;
-    }
-    CurrElementIter = ElementIter;
-    return ElementIter;
+  // This is like std::lower_bound, except that we first check the current
+  // position and the one after it, which makes in-order accesses constant
+  // time.  Returns the position of the first element whose index is not less
+  // than ElementIndex.
+  unsigned FindLowerBound(unsigned ElementIndex) {
+    unsigned Size = Elements.size();
+    unsigned Curr = CurrElementIdx;
+    if (Curr < Size && Elements[Curr].index() <= ElementIndex) {
+      if (Elements[Curr].index() == ElementIndex)
+        return Curr;
+      if (Curr + 1 == Size || Elements[Curr + 1].index() >= ElementIndex)
+        return CurrElementIdx = Curr + 1;
+    }
+    CurrElementIdx = std::lower_bound(Elements.begin(), Elements.end(),
+                                      ElementIndex, IndexCompare()) -
+                     Elements.begin();
+    return CurrElementIdx;
+  }
+
+  // Return the element that holds ElementIndex, or null if there is none.
+  ElementT *FindElement(unsigned ElementIndex) {
+    unsigned Pos = FindLowerBound(ElementIndex);
+    if (Pos == Elements.size() || Elements[Pos].index() != ElementIndex)
+      return 0;
+    return &Elements[Pos];
   }
 
   // Iterator to walk set bits in the bitmap.  This iterator is a lot uglier
@@ -444,41 +533,27 @@ class SparseBitVector {
 public:
   typedef SparseBitVectorIterator iterator;
 
-  SparseBitVector () {
-    CurrElementIter = Elements.begin ();
+  SparseBitVector () : CurrElementIdx(0) {
   }
 
   ~SparseBitVector() {
   }
 
   // SparseBitVector copy ctor.
-  SparseBitVector(const SparseBitVector &RHS) {
-    ElementListConstIter ElementIter = RHS.Elements.begin();
-    while (ElementIter != RHS.Elements.end()) {
-      Elements.push_back(SparseBitVectorElement<ElementSize>(*ElementIter));
-      ++ElementIter;
-    }
-
-    CurrElementIter = Elements.begin ();
+  SparseBitVector(const SparseBitVector &RHS)
+    : Elements(RHS.Elements), CurrElementIdx(0) {
   }
 
   // Clear.
   void clear() {
     Elements.clear();
+    CurrElementIdx = 0;
   }
 
   // Assignment
   SparseBitVector& operator=(const SparseBitVector& RHS) {
-    Elements.clear();
-
-    ElementListConstIter ElementIter = RHS.Elements.begin();
-    while (ElementIter != RHS.Elements.end()) {
-      Elements.push_back(SparseBitVectorElement<ElementSize>(*ElementIter));
-      ++ElementIter;
-    }
-
-    CurrElementIter = Elements.begin ();
-
+    Elements = RHS.Elements;
+    CurrElementIdx = 0;
     return *this;
   }
 
@@ -487,65 +562,34 @@ public:
     if (Elements.empty())
       return false;
 
-    unsigned ElementIndex = Idx / ElementSize;
-    ElementListIter ElementIter = FindLowerBound(ElementIndex);
-
     // If we can't find an element that is supposed to contain this bit, there
     // is nothing more to do.
-    if (ElementIter == Elements.end() ||
-        ElementIter->index() != ElementIndex)
-      return false;
-    return ElementIter->test(Idx % ElementSize);
+    ElementT *Element = FindElement(Idx / ElementSize);
+    return Element && Element->test(Idx % ElementSize);
   }
 
   void reset(unsigned Idx) {
     if (Elements.empty())
       return;
 
-    unsigned ElementIndex = Idx / ElementSize;
-    ElementListIter ElementIter = FindLowerBound(ElementIndex);
-
     // If we can't find an element that is supposed to contain this bit, there
     // is nothing more to do.
-    if (ElementIter == Elements.end() ||
-        ElementIter->index() != ElementIndex)
+    ElementT *Element = FindElement(Idx / ElementSize);
+    if (!Element)
       return;
-    ElementIter->reset(Idx % ElementSize);
+    Element->reset(Idx % ElementSize);
 
     // When the element is zeroed out, delete it.
-    if (ElementIter->empty()) {
-      ++CurrElementIter;
-      Elements.erase(ElementIter);
-    }
+    if (Element->empty())
+      Elements.erase(Elements.begin() + CurrElementIdx);
   }
 
   void set(unsigned Idx) {
     unsigned ElementIndex = Idx / ElementSize;
-    SparseBitVectorElement<ElementSize> *Element;
-    ElementListIter ElementIter;
-    if (Elements.empty()) {
-      Element = new SparseBitVectorElement<ElementSize>(ElementIndex);
-      ElementIter = Elements.insert(Elements.end(), Element);
-
-    } else {
-      ElementIter = FindLowerBound(ElementIndex);
-
-      if (ElementIter == Elements.end() ||
-          ElementIter->index() != ElementIndex) {
-        Element = new SparseBitVectorElement<ElementSize>(ElementIndex);
-        // We may have hit the beginning of our SparseBitVector, in which case,
-        // we may need to insert right after this element, which requires moving
-        // the current iterator forward one, because insert does insert before.
-        if (ElementIter != Elements.end() &&
-            ElementIter->index() < ElementIndex)
-          ElementIter = Elements.insert(++ElementIter, Element);
-        else
-          ElementIter = Elements.insert(ElementIter, Element);
-      }
-    }
-    CurrElementIter = ElementIter;
-
-    ElementIter->set(Idx % ElementSize);
+    unsigned Pos = FindLowerBound(ElementIndex);
+    if (Pos == Elements.size() || Elements[Pos].index() != ElementIndex)
+      Elements.insert(Elements.begin() + Pos, ElementT(ElementIndex));
+    Elements[Pos].set(Idx % ElementSize);
   }
 
   bool test_and_set (unsigned Idx) {
@@ -562,83 +606,102 @@ public:
   }
 
   bool operator==(const SparseBitVector &RHS) const {
-    ElementListConstIter Iter1 = Elements.begin();
-    ElementListConstIter Iter2 = RHS.Elements.begin();
-
-    for (; Iter1 != Elements.end() && Iter2 != RHS.Elements.end();
-         ++Iter1, ++Iter2) {
-      if (*Iter1 != *Iter2)
-        return false;
-    }
-    return Iter1 == Elements.end() && Iter2 == RHS.Elements.end();
+    return Elements == RHS.Elements;
   }
 
   // Union our bitmap with the RHS and return true if we changed.
   bool operator|=(const SparseBitVector &RHS) {
-    bool changed = false;
-    ElementListIter Iter1 = Elements.begin();
-    ElementListConstIter Iter2 = RHS.Elements.begin();
-
     // If RHS is empty, we are done
     if (RHS.Elements.empty())
       return false;
 
-    while (Iter2 != RHS.Elements.end()) {
-      if (Iter1 == Elements.end() || Iter1->index() > Iter2->index()) {
-        Elements.insert(Iter1,
-                        new SparseBitVectorElement<ElementSize>(*Iter2));
-        ++Iter2;
-        changed = true;
-      } else if (Iter1->index() == Iter2->index()) {
-        changed |= Iter1->unionWith(*Iter2);
+    // Find out whether RHS has elements we don't.  If it does not, the union
+    // can be done in place.
+    ElementListIter Iter1 = Elements.begin(), End1 = Elements.end();
+    ElementListConstIter Iter2 = RHS.Elements.begin(),
+                         End2 = RHS.Elements.end();
+    unsigned NumNew = 0;
+    while (Iter2 != End2) {
+      if (Iter1 == End1) {
+        NumNew += End2 - Iter2;
+        break;
+      }
+      if (Iter1->index() < Iter2->index()) {
         ++Iter1;
+      } else {
+        if (Iter1->index() > Iter2->index())
+          ++NumNew;
+        else
+          ++Iter1;
         ++Iter2;
+      }
+    }
+
+    bool changed = false;
+    if (NumNew == 0) {
+      Iter1 = Elements.begin();
+      for (Iter2 = RHS.Elements.begin(); Iter2 != End2; ++Iter1) {
+        if (Iter1->index() == Iter2->index()) {
+          changed |= Iter1->unionWith(*Iter2);
+          ++Iter2;
+        }
+      }
+      return changed;
+    }
+
+    // Otherwise merge both into a new vector.
+    ElementList Merged;
+    Merged.reserve(Elements.size() + NumNew);
+    Iter1 = Elements.begin();
+    Iter2 = RHS.Elements.begin();
+    while (Iter1 != End1 || Iter2 != End2) {
+      if (Iter2 == End2 || (Iter1 != End1 && Iter1->index() < Iter2->index())) {
+        Merged.push_back(*Iter1++);
+      } else if (Iter1 == End1 || Iter1->index() > Iter2->index()) {
+        Merged.push_back(*Iter2++);
       } else {
-        ++Iter1;
+        Merged.push_back(*Iter1++);
+        Merged.back().unionWith(*Iter2++);
       }
     }
-    CurrElementIter = Elements.begin();
-    return changed;
+    Elements.swap(Merged);
+    CurrElementIdx = 0;
+    return true;
   }
 
   // Intersect our bitmap with the RHS and return true if ours changed.
   bool operator&=(const SparseBitVector &RHS) {
     bool changed = false;
-    ElementListIter Iter1 = Elements.begin();
-    ElementListConstIter Iter2 = RHS.Elements.begin();
 
     // Check if both bitmaps are empty.
     if (Elements.empty() && RHS.Elements.empty())
       return false;
 
-    // Loop through, intersecting as we go, erasing elements when necessary.
-    while (Iter2 != RHS.Elements.end()) {
-      if (Iter1 == Elements.end()) {
-        CurrElementIter = Elements.begin();
-        return changed;
-      }
-
+    // Loop through, intersecting as we go and compacting the elements that
+    // are left to the front.
+    ElementListIter Out = Elements.begin();
+    ElementListIter Iter1 = Elements.begin(), End1 = Elements.end();
+    ElementListConstIter Iter2 = RHS.Elements.begin(),
+                         End2 = RHS.Elements.end();
+    while (Iter1 != End1 && Iter2 != End2) {
       if (Iter1->index() > Iter2->index()) {
         ++Iter2;
       } else if (Iter1->index() == Iter2->index()) {
         bool BecameZero;
         changed |= Iter1->intersectWith(*Iter2, BecameZero);
-        if (BecameZero) {
-          ElementListIter IterTmp = Iter1;
-          ++Iter1;
-          Elements.erase(IterTmp);
-        } else {
-          ++Iter1;
-        }
+        if (!BecameZero)
+          *Out++ = *Iter1;
+        ++Iter1;
         ++Iter2;
       } else {
-        ElementListIter IterTmp = Iter1;
+        changed = true;
         ++Iter1;
-        Elements.erase(IterTmp);
       }
     }
-    Elements.erase(Iter1, Elements.end());
-    CurrElementIter = Elements.begin();
+    if (Iter1 != End1)
+      changed = true;
+    Elements.erase(Out, End1);
+    CurrElementIdx = 0;
     return changed;
   }
 
@@ -646,38 +709,33 @@ public:
   // if ours changed.
   bool intersectWithComplement(const SparseBitVector &RHS) {
     bool changed = false;
-    ElementListIter Iter1 = Elements.begin();
-    ElementListConstIter Iter2 = RHS.Elements.begin();
 
     // If either our bitmap or RHS is empty, we are done
     if (Elements.empty() || RHS.Elements.empty())
       return false;
 
-    // Loop through, intersecting as we go, erasing elements when necessary.
-    while (Iter2 != RHS.Elements.end()) {
-      if (Iter1 == Elements.end()) {
-        CurrElementIter = Elements.begin();
-        return changed;
-      }
-
-      if (Iter1->index() > Iter2->index()) {
+    // Loop through, intersecting as we go and compacting the elements that
+    // are left to the front.
+    ElementListIter Out = Elements.begin();
+    ElementListIter Iter1 = Elements.begin(), End1 = Elements.end();
+    ElementListConstIter Iter2 = RHS.Elements.begin(),
+                         End2 = RHS.Elements.end();
+    while (Iter1 != End1) {
+      if (Iter2 != End2 && Iter1->index() > Iter2->index()) {
         ++Iter2;
-      } else if (Iter1->index() == Iter2->index()) {
+      } else if (Iter2 != End2 && Iter1->index() == Iter2->index()) {
         bool BecameZero;
         changed |= Iter1->intersectWithComplement(*Iter2, BecameZero);
-        if (BecameZero) {
-          ElementListIter IterTmp = Iter1;
-          ++Iter1;
-          Elements.erase(IterTmp);
-        } else {
-          ++Iter1;
-        }
+        if (!BecameZero)
+          *Out++ = *Iter1;
+        ++Iter1;
         ++Iter2;
       } else {
-        ++Iter1;
+        *Out++ = *Iter1++;
       }
     }
-    CurrElementIter = Elements.begin();
+    Elements.erase(Out, End1);
+    CurrElementIdx = 0;
     return changed;
   }
 
@@ -692,7 +750,7 @@ public:
                                const SparseBitVector<ElementSize> &RHS2)
   {
     Elements.clear();
-    CurrElementIter = Elements.begin();
+    CurrElementIdx = 0;
     ElementListConstIter Iter1 = RHS1.Elements.begin();
     ElementListConstIter Iter2 = RHS2.Elements.begin();
 
@@ -701,7 +759,10 @@ public:
     if (RHS1.Elements.empty())
       return;
 
-    // Loop through, intersecting as we go, erasing elements when necessary.
+    Elements.reserve(RHS1.Elements.size());
+
+    // Loop through, intersecting as we go, dropping elements that become
+    // empty.
     while (Iter2 != RHS2.Elements.end()) {
       if (Iter1 == RHS1.Elements.end())
         return;
@@ -710,33 +771,20 @@ public:
         ++Iter2;
       } else if (Iter1->index() == Iter2->index()) {
         bool BecameZero = false;
-        SparseBitVectorElement<ElementSize> *NewElement =
-          new SparseBitVectorElement<ElementSize>(Iter1->index());
-        NewElement->intersectWithComplement(*Iter1, *Iter2, BecameZero);
-        if (!BecameZero) {
-          Elements.push_back(NewElement);
-        }
-        else
-          delete NewElement;
+        Elements.push_back(ElementT(Iter1->index()));
+        Elements.back().intersectWithComplement(*Iter1, *Iter2, BecameZero);
+        if (BecameZero)
+          Elements.pop_back();
         ++Iter1;
         ++Iter2;
       } else {
-        SparseBitVectorElement<ElementSize> *NewElement =
-          new SparseBitVectorElement<ElementSize>(*Iter1);
-        Elements.push_back(NewElement);
+        Elements.push_back(*Iter1);
         ++Iter1;
       }
     }
 
     // copy the remaining elements
-    while (Iter1 != RHS1.Elements.end()) {
-        SparseBitVectorElement<ElementSize> *NewElement =
-          new SparseBitVectorElement<ElementSize>(*Iter1);
-        Elements.push_back(NewElement);
-        ++Iter1;
-      }
-
-    return;
+    Elements.insert(Elements.end(), Iter1, RHS1.Elements.end());
   }
 
   void intersectWithComplement(const SparseBitVector<ElementSize> *RHS1,
@@ -27,6 +27,7 @@
 #define LLVM_ADT_STATISTIC_H
 
 #include "llvm/Support/Atomic.h"
+#include "llvm/Support/Threading.h"
 
 namespace llvm {
 class raw_ostream;
@@ -38,69 +39,83 @@ public:
   volatile llvm::sys::cas_flag Value;
   bool Initialized;
 
-  llvm::sys::cas_flag getValue() const { return Value; }
+  /// Index - The slot of this statistic in the per-thread counter shards,
+  /// assigned when the statistic is registered.  While LLVM is multithreaded,
+  /// each thread bumps its own shard so that hot counters do not bounce cache
+  /// lines between cores; the shards are summed when the value is read.
+  unsigned Index;
+
+  llvm::sys::cas_flag getValue() const;
   const char *getName() const { return Name; }
   const char *getDesc() const { return Desc; }
 
   /// construct - This should only be called for non-global statistics.
   void construct(const char *name, const char *desc) {
     Name = name; Desc = desc;
-    Value = 0; Initialized = 0;
+    Value = 0; Initialized = 0; Index = 0;
   }
 
   // Allow use of this class as the value itself.
-  operator unsigned() const { return Value; }
+  operator unsigned() const { return getValue(); }
   const Statistic &operator=(unsigned Val) {
-    Value = Val;
-    return init();
+    init();
+    setValue(Val);
+    return *this;
   }
   
   const Statistic &operator++() {
-    // FIXME: This function and all those that follow carefully use an
-    // atomic operation to update the value safely in the presence of
-    // concurrent accesses, but not to read the return value, so the
-    // return value is not thread safe.
-    sys::AtomicIncrement(&Value);
-    return init();
+    // FIXME: This function and all those that follow carefully update the
+    // value safely in the presence of concurrent accesses, but not to read
+    // the return value, so the return value is not thread safe.
+    init();
+    add(1);
+    return *this;
   }
   
   unsigned operator++(int) {
     init();
-    unsigned OldValue = Value;
-    sys::AtomicIncrement(&Value);
+    unsigned OldValue = getValue();
+    add(1);
     return OldValue;
   }
   
   const Statistic &operator--() {
-    sys::AtomicDecrement(&Value);
-    return init();
+    init();
+    add(-1U);
+    return *this;
   }
   
   unsigned operator--(int) {
     init();
-    unsigned OldValue = Value;
-    sys::AtomicDecrement(&Value);
+    unsigned OldValue = getValue();
+    add(-1U);
     return OldValue;
   }
   
   const Statistic &operator+=(const unsigned &V) {
-    sys::AtomicAdd(&Value, V);
-    return init();
+    init();
+    add(V);
+    return *this;
   }
   
   const Statistic &operator-=(const unsigned &V) {
-    sys::AtomicAdd(&Value, -V);
-    return init();
+    init();
+    add(-V);
+    return *this;
   }
   
   const Statistic &operator*=(const unsigned &V) {
+    init();
+    foldShards();
     sys::AtomicMul(&Value, V);
-    return init();
+    return *this;
   }
   
   const Statistic &operator/=(const unsigned &V) {
+    init();
+    foldShards();
     sys::AtomicDiv(&Value, V);
-    return init();
+    return *this;
   }
 
 protected:
@@ -111,12 +126,28 @@ protected:
     return *this;
   }
   void RegisterStatistic();
+
+  /// add - Add V to the value, in the calling thread's shard if LLVM is
+  /// multithreaded.
+  void add(unsigned V) {
+    if (llvm_is_multithreaded())
+      addToShard(V);
+    else
+      sys::AtomicAdd(&Value, V);
+  }
+  void addToShard(unsigned V);
+
+  /// setValue - Set the value, discarding the counts in all shards.
+  void setValue(unsigned V);
+
+  /// foldShards - Move the counts in all shards into Value.
+  void foldShards();
 };
 
 // STATISTIC - A macro to make definition of statistics really simple.  This
 // automatically passes the DEBUG_TYPE of the file into the statistic.
 #define STATISTIC(VARNAME, DESC) \
-  static llvm::Statistic VARNAME = { DEBUG_TYPE, DESC, 0, 0 }
+  static llvm::Statistic VARNAME = { DEBUG_TYPE, DESC, 0, 0, 0 }
 
 /// \brief Enable the collection and printing of statistics.
 void EnableStatistics();
@@ -124,9 +155,17 @@ void EnableStatistics();
 /// \brief Print statistics to the file returned by CreateInfoOutputFile().
 void PrintStatistics();
 
-/// \brief Print statistics to the given output stream.
+/// \brief Print statistics to the given output stream, in the format selected
+/// with -stats-format.
 void PrintStatistics(raw_ostream &OS);
 
+/// \brief Print statistics to the given output stream as a JSON object.
+void PrintStatisticsJSON(raw_ostream &OS);
+
+/// \brief Print statistics to the given output stream as comma separated
+/// values, one statistic per line.
+void PrintStatisticsCSV(raw_ostream &OS);
+
 } // End llvm namespace
 
 #endif
@@ -27,6 +27,7 @@
 #define LLVM_ADT_VALUEMAP_H
 
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/FlatHashMap.h"
 #include "llvm/Support/ValueHandle.h"
 #include "llvm/Support/type_traits.h"
 #include "llvm/Support/Mutex.h"
@@ -77,8 +78,8 @@ template<typename KeyT, typename ValueT, typename Config = ValueMapConfig<KeyT>,
 class ValueMap {
   friend class ValueMapCallbackVH<KeyT, ValueT, Config, ValueInfoT>;
   typedef ValueMapCallbackVH<KeyT, ValueT, Config, ValueInfoT> ValueMapCVH;
-  typedef DenseMap<ValueMapCVH, ValueT, DenseMapInfo<ValueMapCVH>,
-                   ValueInfoT> MapT;
+  typedef typename HotDenseMap<ValueMapCVH, ValueT, DenseMapInfo<ValueMapCVH>,
+                               ValueInfoT>::type MapT;
   typedef typename Config::ExtraData ExtraData;
   MapT Map;
   ExtraData Data;
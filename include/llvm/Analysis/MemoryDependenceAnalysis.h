@@ -19,6 +19,7 @@
 #include "llvm/Support/ValueHandle.h"
 #include "llvm/Analysis/AliasAnalysis.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/FlatHashMap.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/OwningPtr.h"
 #include "llvm/ADT/PointerIntPair.h"
@@ -207,7 +208,7 @@ namespace llvm {
   ///
   class MemoryDependenceAnalysis : public FunctionPass {
     // A map from instructions to their dependency.
-    typedef DenseMap<Instruction*, MemDepResult> LocalDepMapType;
+    typedef HotDenseMap<Instruction*, MemDepResult>::type LocalDepMapType;
     LocalDepMapType LocalDeps;
 
   public:
@@ -243,8 +244,8 @@ namespace llvm {
     /// CachedNonLocalPointerInfo - This map stores the cached results of doing
     /// a pointer lookup at the bottom of a block.  The key of this map is the
     /// pointer+isload bit, the value is a list of <bb->result> mappings.
-    typedef DenseMap<ValueIsLoadPair,
-                     NonLocalPointerInfo> CachedNonLocalPointerInfo;
+    typedef HotDenseMap<ValueIsLoadPair,
+                        NonLocalPointerInfo>::type CachedNonLocalPointerInfo;
     CachedNonLocalPointerInfo NonLocalPointerDeps;
 
     // A map from instructions to their non-local pointer dependencies.
@@ -259,7 +260,7 @@ namespace llvm {
     typedef std::pair<NonLocalDepInfo, bool> PerInstNLInfo;
     
     // A map from instructions to their non-local dependencies.
-    typedef DenseMap<Instruction*, PerInstNLInfo> NonLocalDepMapType;
+    typedef HotDenseMap<Instruction*, PerInstNLInfo>::type NonLocalDepMapType;
       
     NonLocalDepMapType NonLocalDeps;
     
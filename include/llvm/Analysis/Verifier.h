@@ -56,13 +56,23 @@ FunctionPass *createVerifierPass(
 /// the action taken depends on the \p action parameter.
 /// This should only be used for debugging, because it plays games with
 /// PassManagers and stuff.
+///
+/// With more than one thread, the bodies of the functions are checked
+/// concurrently, provided the program has called llvm_start_multithreaded.
+/// If that finds a problem, the module is checked again on one thread to
+/// report it, so the messages do not depend on the number of threads.
 
 bool verifyModule(
   const Module &M,  ///< The module to be verified
   VerifierFailureAction action = AbortProcessAction, ///< Action to take
-  std::string *ErrorInfo = 0      ///< Information about failures.
+  std::string *ErrorInfo = 0,     ///< Information about failures.
+  unsigned NumThreads = 0         ///< Threads to use; 0 means -verify-threads
 );
 
+/// VerifyModuleThreads - The number of threads verifyModule uses when it is
+/// not given one, set by -verify-threads (0: one per processor).
+extern unsigned VerifyModuleThreads;
+
 // verifyFunction - Check a function for errors, useful for use when debugging a
 // pass.
 bool verifyFunction(
@@ -52,6 +52,10 @@ public:
   /// one.  This name will be printed instead of the structural version of the
   /// type in order to make the output more concise.
   void addTypeName(const Type *Ty, const std::string &N);
+
+  /// copyTypeNames - Replace the type names of this printer with those of
+  /// Other, so that both print types the same way.
+  void copyTypeNames(const TypePrinting &Other);
   
 private:
   void CalcTypeName(const Type *Ty, SmallVectorImpl<const Type *> &TypeStack,
@@ -73,6 +77,11 @@ void WriteTypeSymbolic(raw_ostream &, const Type *, const Module *M);
 void WriteAsOperand(raw_ostream &, const Value *, bool PrintTy = true,
                     const Module *Context = 0);
 
+/// PrintModuleThreads - The number of threads Module::print renders function
+/// bodies on, set by -print-threads (0: one per processor).  Bodies are only
+/// rendered concurrently if the program has called llvm_start_multithreaded.
+extern unsigned PrintModuleThreads;
+
 } // End llvm namespace
 
 #endif
@@ -75,6 +75,11 @@ private:
   InstListType InstList;
   Function *Parent;
 
+  /// InstOrderValid - True if the Order field of every instruction in this
+  /// block reflects its current position.  Cleared whenever an instruction is
+  /// added to the block; recomputed lazily by renumberInstructions().
+  mutable bool InstOrderValid;
+
   void setParent(Function *parent);
   friend class SymbolTableListTraits<BasicBlock, Function>;
 
@@ -244,6 +249,19 @@ public:
   ///
   BasicBlock *splitBasicBlock(iterator I, const Twine &BBName = "");
 
+  /// isInstrOrderValid - Return true if the cached instruction numbering used
+  /// by Instruction::comesBefore is up to date.
+  bool isInstrOrderValid() const { return InstOrderValid; }
+
+  /// invalidateOrders - Mark the cached instruction numbering as stale.  This
+  /// is called automatically whenever an instruction is inserted into or
+  /// moved within this block.  Removing instructions keeps it valid.
+  void invalidateOrders() { InstOrderValid = false; }
+
+  /// renumberInstructions - Assign increasing Order values to every
+  /// instruction in this block and mark the numbering as valid.
+  void renumberInstructions() const;
+
   /// hasAddressTaken - returns true if there are any uses of this basic block
   /// other than direct branches, switches, etc. to it.
   bool hasAddressTaken() const { return getSubclassDataFromValue() != 0; }
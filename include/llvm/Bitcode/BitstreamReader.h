@@ -16,7 +16,11 @@
 #define BITSTREAM_READER_H
 
 #include "llvm/Bitcode/BitCodes.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/MathExtras.h"
+#include <algorithm>
 #include <climits>
+#include <cstring>
 #include <string>
 #include <vector>
 
@@ -122,15 +126,20 @@ public:
 class BitstreamCursor {
   friend class Deserializer;
   BitstreamReader *BitStream;
-  const unsigned char *NextChar;
   
-  /// CurWord - This is the current data we have pulled from the stream but have
-  /// not returned to the client.
-  uint32_t CurWord;
-  
-  /// BitsInCurWord - This is the number of bits in CurWord that are valid. This
-  /// is always from [0...31] inclusive.
-  unsigned BitsInCurWord;
+  /// word_t - The unit the stream is read in.  Every read loads the 64 bits
+  /// starting at the byte that holds the current bit, so a field never needs
+  /// a refill, and a multi-chunk VBR can be decoded from a single load.
+  typedef uint64_t word_t;
+
+  /// FirstChar - The start of the stream, cached from BitStream.
+  const unsigned char *FirstChar;
+
+  /// CurBitNo - The bit of the stream that the next read starts at.
+  uint64_t CurBitNo;
+
+  /// EndBitNo - The size of the stream in bits.
+  uint64_t EndBitNo;
   
   // CurCodeSize - This is the declared size of code values used for the current
   // block, in bits.
@@ -149,29 +158,20 @@ class BitstreamCursor {
   SmallVector<Block, 8> BlockScope;
   
 public:
-  BitstreamCursor() : BitStream(0), NextChar(0) {
+  BitstreamCursor() : BitStream(0), FirstChar(0), CurBitNo(0), EndBitNo(0) {
   }
-  BitstreamCursor(const BitstreamCursor &RHS) : BitStream(0), NextChar(0) {
+  BitstreamCursor(const BitstreamCursor &RHS)
+    : BitStream(0), FirstChar(0), CurBitNo(0), EndBitNo(0) {
     operator=(RHS);
   }
   
-  explicit BitstreamCursor(BitstreamReader &R) : BitStream(&R) {
-    NextChar = R.getFirstChar();
-    assert(NextChar && "Bitstream not initialized yet");
-    CurWord = 0;
-    BitsInCurWord = 0;
-    CurCodeSize = 2;
+  explicit BitstreamCursor(BitstreamReader &R) {
+    setStream(R);
   }
   
   void init(BitstreamReader &R) {
     freeState();
-    
-    BitStream = &R;
-    NextChar = R.getFirstChar();
-    assert(NextChar && "Bitstream not initialized yet");
-    CurWord = 0;
-    BitsInCurWord = 0;
-    CurCodeSize = 2;
+    setStream(R);
   }
   
   ~BitstreamCursor() {
@@ -182,9 +182,9 @@ public:
     freeState();
     
     BitStream = RHS.BitStream;
-    NextChar = RHS.NextChar;
-    CurWord = RHS.CurWord;
-    BitsInCurWord = RHS.BitsInCurWord;
+    FirstChar = RHS.FirstChar;
+    CurBitNo = RHS.CurBitNo;
+    EndBitNo = RHS.EndBitNo;
     CurCodeSize = RHS.CurCodeSize;
     
     // Copy abbreviations, and bump ref counts.
@@ -225,12 +225,17 @@ public:
   unsigned GetAbbrevIDWidth() const { return CurCodeSize; }
   
   bool AtEndOfStream() const {
-    return NextChar == BitStream->getLastChar() && BitsInCurWord == 0;
+    return CurBitNo == EndBitNo;
   }
   
   /// GetCurrentBitNo - Return the bit # of the bit we are reading.
   uint64_t GetCurrentBitNo() const {
-    return (NextChar-BitStream->getFirstChar())*CHAR_BIT - BitsInCurWord;
+    return CurBitNo;
+  }
+
+  /// getStreamSizeInBits - Return the size of the whole stream in bits.
+  uint64_t getStreamSizeInBits() const {
+    return EndBitNo;
   }
   
   BitstreamReader *getBitStreamReader() {
@@ -243,60 +248,56 @@ public:
   
   /// JumpToBit - Reset the stream to the specified bit number.
   void JumpToBit(uint64_t BitNo) {
-    uintptr_t ByteNo = uintptr_t(BitNo/8) & ~3;
-    uintptr_t WordBitNo = uintptr_t(BitNo) & 31;
-    assert(ByteNo <= (uintptr_t)(BitStream->getLastChar()-
-                                 BitStream->getFirstChar()) &&
-           "Invalid location");
-    
-    // Move the cursor to the right word.
-    NextChar = BitStream->getFirstChar()+ByteNo;
-    BitsInCurWord = 0;
-    CurWord = 0;
-    
-    // Skip over any bits that are already consumed.
-    if (WordBitNo)
-      Read(static_cast<unsigned>(WordBitNo));
+    assert(BitNo <= EndBitNo && "Invalid location");
+    CurBitNo = BitNo;
   }
-  
-  
-  uint32_t Read(unsigned NumBits) {
-    assert(NumBits <= 32 && "Cannot return more than 32 bits!");
-    // If the field is fully contained by CurWord, return it quickly.
-    if (BitsInCurWord >= NumBits) {
-      uint32_t R = CurWord & ((1U << NumBits)-1);
-      CurWord >>= NumBits;
-      BitsInCurWord -= NumBits;
-      return R;
+
+private:
+  void setStream(BitstreamReader &R) {
+    BitStream = &R;
+    FirstChar = R.getFirstChar();
+    assert(FirstChar && "Bitstream not initialized yet");
+    CurBitNo = 0;
+    EndBitNo = uint64_t(R.getLastChar()-FirstChar)*CHAR_BIT;
+    CurCodeSize = 2;
+  }
+
+  /// PeekWord - Return the bits of the stream from CurBitNo on, in the low
+  /// bits of a word.  Set NumBits to how many of them there are: at least 57
+  /// away from the end of the stream, fewer in its last eight bytes.
+  word_t PeekWord(unsigned &NumBits) const {
+    const unsigned char *P = FirstChar+(CurBitNo >> 3);
+    unsigned Skip = unsigned(CurBitNo & 7);
+    word_t W;
+    if (CurBitNo+64 <= EndBitNo) {
+      // The stream is little endian.  Load all eight bytes at once.
+      memcpy(&W, P, sizeof(W));
+      if (sys::isBigEndianHost())
+        W = ByteSwap_64(W);
+      NumBits = 64-Skip;
+    } else {
+      unsigned NumBytes = unsigned((EndBitNo-CurBitNo+Skip) >> 3);
+      W = 0;
+      for (unsigned i = 0; i != NumBytes; ++i)
+        W |= word_t(P[i]) << i*8;
+      NumBits = NumBytes*8-Skip;
     }
+    return W >> Skip;
+  }
 
+public:
+  uint32_t Read(unsigned NumBits) {
+    assert(NumBits <= 32 && "Cannot return more than 32 bits!");
     // If we run out of data, stop at the end of the stream.
-    if (NextChar == BitStream->getLastChar()) {
-      CurWord = 0;
-      BitsInCurWord = 0;
+    if (CurBitNo+NumBits > EndBitNo) {
+      CurBitNo = EndBitNo;
       return 0;
     }
 
-    unsigned R = CurWord;
-
-    // Read the next word from the stream.
-    CurWord = (NextChar[0] <<  0) | (NextChar[1] << 8) |
-              (NextChar[2] << 16) | (NextChar[3] << 24);
-    NextChar += 4;
-
-    // Extract NumBits-BitsInCurWord from what we just read.
-    unsigned BitsLeft = NumBits-BitsInCurWord;
-
-    // Be careful here, BitsLeft is in the range [1..32] inclusive.
-    R |= (CurWord & (~0U >> (32-BitsLeft))) << BitsInCurWord;
-
-    // BitsLeft bits have just been used up from CurWord.
-    if (BitsLeft != 32)
-      CurWord >>= BitsLeft;
-    else
-      CurWord = 0;
-    BitsInCurWord = 32-BitsLeft;
-    return R;
+    unsigned BitsInWord;
+    word_t W = PeekWord(BitsInWord);
+    CurBitNo += NumBits;
+    return uint32_t(W & ((word_t(1) << NumBits)-1));
   }
 
   uint64_t Read64(unsigned NumBits) {
@@ -307,46 +308,42 @@ public:
   }
 
   uint32_t ReadVBR(unsigned NumBits) {
-    uint32_t Piece = Read(NumBits);
-    if ((Piece & (1U << (NumBits-1))) == 0)
-      return Piece;
-
-    uint32_t Result = 0;
-    unsigned NextBit = 0;
-    while (1) {
-      Result |= (Piece & ((1U << (NumBits-1))-1)) << NextBit;
-
-      if ((Piece & (1U << (NumBits-1))) == 0)
-        return Result;
-
-      NextBit += NumBits-1;
-      Piece = Read(NumBits);
-    }
+    return uint32_t(ReadVBR64(NumBits));
   }
 
   // ReadVBR64 - Read a VBR that may have a value up to 64-bits in size.  The
   // chunk size of the VBR must still be <= 32 bits though.
   uint64_t ReadVBR64(unsigned NumBits) {
-    uint32_t Piece = Read(NumBits);
-    if ((Piece & (1U << (NumBits-1))) == 0)
-      return uint64_t(Piece);
-
+    uint32_t ContinueBit = 1U << (NumBits-1);
     uint64_t Result = 0;
     unsigned NextBit = 0;
-    while (1) {
-      Result |= uint64_t(Piece & ((1U << (NumBits-1))-1)) << NextBit;
 
-      if ((Piece & (1U << (NumBits-1))) == 0)
+    // Decode as many chunks as possible out of a single load.
+    unsigned BitsInWord;
+    word_t W = PeekWord(BitsInWord);
+    for (; BitsInWord >= NumBits; BitsInWord -= NumBits) {
+      uint32_t Piece = uint32_t(W) & ((ContinueBit << 1)-1);
+      W >>= NumBits;
+      CurBitNo += NumBits;
+      Result |= uint64_t(Piece & (ContinueBit-1)) << NextBit;
+      if ((Piece & ContinueBit) == 0)
         return Result;
+      NextBit += NumBits-1;
+    }
 
+    // The value is longer than a word, or runs into the end of the stream.
+    while (1) {
+      uint32_t Piece = Read(NumBits);
+      Result |= uint64_t(Piece & (ContinueBit-1)) << NextBit;
+      if ((Piece & ContinueBit) == 0)
+        return Result;
       NextBit += NumBits-1;
-      Piece = Read(NumBits);
     }
   }
 
+  /// SkipToWord - Skip to the next 32-bit boundary in the stream.
   void SkipToWord() {
-    BitsInCurWord = 0;
-    CurWord = 0;
+    CurBitNo = std::min((CurBitNo+31) & ~uint64_t(31), EndBitNo);
   }
 
   unsigned ReadCode() {
@@ -375,10 +372,11 @@ public:
 
     // Check that the block wasn't partially defined, and that the offset isn't
     // bogus.
-    if (AtEndOfStream() || NextChar+NumWords*4 > BitStream->getLastChar())
+    uint64_t SkipTo = GetCurrentBitNo() + uint64_t(NumWords)*32;
+    if (AtEndOfStream() || SkipTo > getStreamSizeInBits())
       return true;
 
-    NextChar += NumWords*4;
+    JumpToBit(SkipTo);
     return false;
   }
 
@@ -392,11 +390,10 @@ public:
     // Add the abbrevs specific to this block to the CurAbbrevs list.
     if (const BitstreamReader::BlockInfo *Info =
           BitStream->getBlockInfo(BlockID)) {
-      for (unsigned i = 0, e = static_cast<unsigned>(Info->Abbrevs.size());
-           i != e; ++i) {
-        CurAbbrevs.push_back(Info->Abbrevs[i]);
-        CurAbbrevs.back()->addRef();
-      }
+      CurAbbrevs.assign(Info->Abbrevs.begin(), Info->Abbrevs.end());
+      for (unsigned i = 0, e = static_cast<unsigned>(CurAbbrevs.size());
+           i != e; ++i)
+        CurAbbrevs[i]->addRef();
     }
 
     // Get the codesize of this block.
@@ -407,7 +404,7 @@ public:
 
     // Validate that this block is sane.
     if (CurCodeSize == 0 || AtEndOfStream() ||
-        NextChar+NumWords*4 > BitStream->getLastChar())
+        GetCurrentBitNo() + uint64_t(NumWords)*32 > getStreamSizeInBits())
       return true;
 
     return false;
@@ -442,31 +439,82 @@ private:
   //===--------------------------------------------------------------------===//
 
 private:
-  void ReadAbbreviatedLiteral(const BitCodeAbbrevOp &Op,
-                              SmallVectorImpl<uint64_t> &Vals) {
-    assert(Op.isLiteral() && "Not a literal");
-    // If the abbrev specifies the literal value to use, use it.
-    Vals.push_back(Op.getLiteralValue());
-  }
-  
-  void ReadAbbreviatedField(const BitCodeAbbrevOp &Op,
-                            SmallVectorImpl<uint64_t> &Vals) {
-    assert(!Op.isLiteral() && "Use ReadAbbreviatedLiteral for literals!");
+  uint64_t ReadAbbreviatedField(const BitCodeAbbrevOp &Op) {
+    assert(!Op.isLiteral() && "Literals are not read from the stream!");
     
     // Decode the value as we are commanded.
     switch (Op.getEncoding()) {
     default: assert(0 && "Unknown encoding!");
     case BitCodeAbbrevOp::Fixed:
-      Vals.push_back(Read((unsigned)Op.getEncodingData()));
-      break;
+      return Read((unsigned)Op.getEncodingData());
     case BitCodeAbbrevOp::VBR:
-      Vals.push_back(ReadVBR64((unsigned)Op.getEncodingData()));
+      return ReadVBR64((unsigned)Op.getEncodingData());
+    case BitCodeAbbrevOp::Char6:
+      return BitCodeAbbrevOp::DecodeChar6(Read(6));
+    }
+  }
+
+  /// ReadAbbreviatedArray - Read NumElts elements encoded as EltEnc into Vals,
+  /// choosing the decoder once for the whole array.
+  void ReadAbbreviatedArray(const BitCodeAbbrevOp &EltEnc, unsigned NumElts,
+                            SmallVectorImpl<uint64_t> &Vals) {
+    switch (EltEnc.getEncoding()) {
+    case BitCodeAbbrevOp::Fixed: {
+      unsigned NumBits = (unsigned)EltEnc.getEncodingData();
+      for (; NumElts; --NumElts)
+        Vals.push_back(Read(NumBits));
       break;
+    }
+    case BitCodeAbbrevOp::VBR: {
+      unsigned NumBits = (unsigned)EltEnc.getEncodingData();
+      for (; NumElts; --NumElts)
+        Vals.push_back(ReadVBR64(NumBits));
+      break;
+    }
     case BitCodeAbbrevOp::Char6:
-      Vals.push_back(BitCodeAbbrevOp::DecodeChar6(Read(6)));
+      for (; NumElts; --NumElts)
+        Vals.push_back(BitCodeAbbrevOp::DecodeChar6(Read(6)));
+      break;
+    default:
+      for (; NumElts; --NumElts)
+        Vals.push_back(ReadAbbreviatedField(EltEnc));
       break;
     }
   }
+
+  /// ReadAbbreviatedBlob - Read a blob of NumBytes bytes, pointing BlobStart at
+  /// it if the caller wants that, and copying it into Vals otherwise.  Return
+  /// true if the blob runs off the end of the stream.
+  bool ReadAbbreviatedBlob(unsigned NumBytes, SmallVectorImpl<uint64_t> &Vals,
+                           const char **BlobStart, unsigned *BlobLen) {
+    SkipToWord();  // 32-bit alignment
+
+    // Figure out where the end of this blob will be including tail padding.
+    uint64_t Start = GetCurrentBitNo()/8;
+    uint64_t NewEnd = Start + ((uint64_t(NumBytes)+3) & ~3ULL);
+
+    // If this would read off the end of the bitcode file, just set the
+    // record to empty and return.
+    uint64_t Size = getStreamSizeInBits()/8;
+    if (NewEnd > Size) {
+      Vals.append(NumBytes, 0);
+      JumpToBit(Size*8);
+      return true;
+    }
+
+    // Otherwise, read the number of bytes.  If we can return a reference to
+    // the data, do so to avoid copying it.
+    const unsigned char *Data = FirstChar+Start;
+    if (BlobStart) {
+      *BlobStart = (const char*)Data;
+      *BlobLen = NumBytes;
+    } else {
+      Vals.append(Data, Data+NumBytes);
+    }
+    // Skip over tail padding.
+    JumpToBit(NewEnd*8);
+    return false;
+  }
 public:
 
   /// getAbbrev - Return the abbreviation for the specified AbbrevId. 
@@ -487,11 +535,31 @@ public:
     }
 
     const BitCodeAbbrev *Abbv = getAbbrev(AbbrevID);
+    unsigned i = 0, e = Abbv->getNumOperandInfos();
+
+    // The record code is nearly always a literal or a scalar field.  Read it
+    // straight into Code rather than pushing it onto Vals and erasing it again.
+    unsigned Code = 0;
+    const BitCodeAbbrevOp &CodeOp = Abbv->getOperandInfo(0);
+    bool CodeInVals = false;
+    if (CodeOp.isLiteral()) {
+      Code = (unsigned)CodeOp.getLiteralValue();
+      ++i;
+    } else if (CodeOp.getEncoding() != BitCodeAbbrevOp::Array &&
+               CodeOp.getEncoding() != BitCodeAbbrevOp::Blob) {
+      Code = (unsigned)ReadAbbreviatedField(CodeOp);
+      ++i;
+    } else {
+      // The code is the first element of an array or blob.
+      CodeInVals = true;
+    }
+    unsigned FirstOperand = Vals.size();
 
-    for (unsigned i = 0, e = Abbv->getNumOperandInfos(); i != e; ++i) {
+    for (; i != e; ++i) {
       const BitCodeAbbrevOp &Op = Abbv->getOperandInfo(i);
       if (Op.isLiteral()) {
-        ReadAbbreviatedLiteral(Op, Vals); 
+        // If the abbrev specifies the literal value to use, use it.
+        Vals.push_back(Op.getLiteralValue());
       } else if (Op.getEncoding() == BitCodeAbbrevOp::Array) {
         // Array case.  Read the number of elements as a vbr6.
         unsigned NumElts = ReadVBR(6);
@@ -501,42 +569,21 @@ public:
         const BitCodeAbbrevOp &EltEnc = Abbv->getOperandInfo(++i);
 
         // Read all the elements.
-        for (; NumElts; --NumElts)
-          ReadAbbreviatedField(EltEnc, Vals);
+        ReadAbbreviatedArray(EltEnc, NumElts, Vals);
       } else if (Op.getEncoding() == BitCodeAbbrevOp::Blob) {
         // Blob case.  Read the number of bytes as a vbr6.
         unsigned NumElts = ReadVBR(6);
-        SkipToWord();  // 32-bit alignment
-
-        // Figure out where the end of this blob will be including tail padding.
-        const unsigned char *NewEnd = NextChar+((NumElts+3)&~3);
-        
-        // If this would read off the end of the bitcode file, just set the
-        // record to empty and return.
-        if (NewEnd > BitStream->getLastChar()) {
-          Vals.append(NumElts, 0);
-          NextChar = BitStream->getLastChar();
+        if (ReadAbbreviatedBlob(NumElts, Vals, BlobStart, BlobLen))
           break;
-        }
-        
-        // Otherwise, read the number of bytes.  If we can return a reference to
-        // the data, do so to avoid copying it.
-        if (BlobStart) {
-          *BlobStart = (const char*)NextChar;
-          *BlobLen = NumElts;
-        } else {
-          for (; NumElts; ++NextChar, --NumElts)
-            Vals.push_back(*NextChar);
-        }
-        // Skip over tail padding.
-        NextChar = NewEnd;
       } else {
-        ReadAbbreviatedField(Op, Vals);
+        Vals.push_back(ReadAbbreviatedField(Op));
       }
     }
 
-    unsigned Code = (unsigned)Vals[0];
-    Vals.erase(Vals.begin());
+    if (CodeInVals) {
+      Code = (unsigned)Vals[FirstOperand];
+      Vals.erase(Vals.begin()+FirstOperand);
+    }
     return Code;
   }
 
@@ -17,13 +17,33 @@
 
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Bitcode/BitCodes.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
 #include <vector>
 
 namespace llvm {
 
 class BitstreamWriter {
+  /// Out - The bytes of the stream that have not been written to FS yet, or
+  /// the whole stream if there is no FS.  This always holds a whole number of
+  /// 32-bit words.
   std::vector<unsigned char> &Out;
 
+  /// FS - If non-null, completed parts of the stream are written out to this
+  /// file as they are produced, so that Out only has to hold the blocks that
+  /// are still open.
+  raw_fd_ostream *FS;
+
+  /// FSStart - The position in FS at which the stream starts.
+  uint64_t FSStart;
+
+  /// FlushedBytes - The number of bytes of the stream already written to FS.
+  uint64_t FlushedBytes;
+
+  /// FlushThreshold - When writing to FS, Out is written out whenever a block
+  /// is closed with at least this many bytes buffered.
+  unsigned FlushThreshold;
+
   /// CurBit - Always between 0 and 31 inclusive, specifies the next bit to use.
   unsigned CurBit;
 
@@ -43,9 +63,9 @@ class BitstreamWriter {
 
   struct Block {
     unsigned PrevCodeSize;
-    unsigned StartSizeWord;
+    uint64_t StartSizeWord;
     std::vector<BitCodeAbbrev*> PrevAbbrevs;
-    Block(unsigned PCS, unsigned SSW) : PrevCodeSize(PCS), StartSizeWord(SSW) {}
+    Block(unsigned PCS, uint64_t SSW) : PrevCodeSize(PCS), StartSizeWord(SSW) {}
   };
 
   /// BlockScope - This tracks the current blocks that we have entered.
@@ -61,7 +81,45 @@ class BitstreamWriter {
 
 public:
   explicit BitstreamWriter(std::vector<unsigned char> &O)
-    : Out(O), CurBit(0), CurValue(0), CurCodeSize(2) {}
+    : Out(O), FS(0), FSStart(0), FlushedBytes(0), FlushThreshold(0), CurBit(0),
+      CurValue(0), CurCodeSize(2) {}
+
+  /// BitstreamWriter - Write the stream to the current position of the file
+  /// F, using O to hold the data that has not been written out yet.  F must
+  /// support seeking, because the size of a block is only filled in after its
+  /// contents have been written.  Buffered data is written out when a block is
+  /// closed with at least Threshold bytes of it.  Call FlushToFile once the
+  /// stream is complete.
+  BitstreamWriter(std::vector<unsigned char> &O, raw_fd_ostream &F,
+                  unsigned Threshold = 512*1024)
+    : Out(O), FS(&F), FSStart(F.tell()), FlushedBytes(0),
+      FlushThreshold(Threshold), CurBit(0), CurValue(0), CurCodeSize(2) {}
+
+  /// BitstreamWriter - Start a stream that carries on from the current
+  /// position of Parent.  It has Parent's code size and its own copy of
+  /// Parent's BLOCKINFO abbrevs, so blocks written to it are encoded just as
+  /// they would have been in Parent and can be added to Parent with
+  /// AppendWords.  The new writer may be used on a different thread from
+  /// Parent.
+  BitstreamWriter(std::vector<unsigned char> &O, const BitstreamWriter &Parent)
+    : Out(O), FS(0), FSStart(0), FlushedBytes(0), FlushThreshold(0), CurBit(0),
+      CurValue(0), CurCodeSize(Parent.CurCodeSize) {
+    BlockInfoRecords.resize(Parent.BlockInfoRecords.size());
+    for (unsigned i = 0, e = static_cast<unsigned>(BlockInfoRecords.size());
+         i != e; ++i) {
+      const BlockInfo &From = Parent.BlockInfoRecords[i];
+      BlockInfo &To = BlockInfoRecords[i];
+      To.BlockID = From.BlockID;
+      for (unsigned j = 0, je = static_cast<unsigned>(From.Abbrevs.size());
+           j != je; ++j) {
+        BitCodeAbbrev *Abbv = new BitCodeAbbrev();
+        for (unsigned k = 0, ke = From.Abbrevs[j]->getNumOperandInfos();
+             k != ke; ++k)
+          Abbv->Add(From.Abbrevs[j]->getOperandInfo(k));
+        To.Abbrevs.push_back(Abbv);
+      }
+    }
+  }
 
   ~BitstreamWriter() {
     assert(CurBit == 0 && "Unflused data remaining");
@@ -78,10 +136,25 @@ public:
     }
   }
 
+  /// getBuffer - Return the bytes of the stream that have not been written
+  /// to the file yet.  This is the whole stream when not writing to a file.
   std::vector<unsigned char> &getBuffer() { return Out; }
 
   /// \brief Retrieve the current position in the stream, in bits.
-  uint64_t GetCurrentBitNo() const { return Out.size() * 8 + CurBit; }
+  uint64_t GetCurrentBitNo() const {
+    return (FlushedBytes + Out.size()) * 8 + CurBit;
+  }
+
+  /// FlushToFile - Write the buffered part of the stream out to the file.
+  /// Only whole words are written; bits emitted since the last word boundary
+  /// stay pending until the stream is flushed to a word.
+  void FlushToFile() {
+    assert(FS && "Not writing to a file!");
+    if (Out.empty()) return;
+    FS->write((const char*)&Out.front(), Out.size());
+    FlushedBytes += Out.size();
+    Out.clear();
+  }
 
   //===--------------------------------------------------------------------===//
   // Basic Primitives for emitting bits to the stream.
@@ -164,13 +237,34 @@ public:
     Emit(Val, CurCodeSize);
   }
 
+  /// AppendWords - Append the words written to a writer that was started
+  /// from this one.  The stream must be at a word boundary.
+  void AppendWords(const std::vector<unsigned char> &Words) {
+    assert(CurBit == 0 && (Words.size() & 3) == 0 && "Not 32-bit aligned");
+    Out.insert(Out.end(), Words.begin(), Words.end());
+    if (FS && Out.size() >= FlushThreshold)
+      FlushToFile();
+  }
+
   // BackpatchWord - Backpatch a 32-bit word in the output with the specified
-  // value.
-  void BackpatchWord(unsigned ByteNo, unsigned NewWord) {
-    Out[ByteNo++] = (unsigned char)(NewWord >>  0);
-    Out[ByteNo++] = (unsigned char)(NewWord >>  8);
-    Out[ByteNo++] = (unsigned char)(NewWord >> 16);
-    Out[ByteNo  ] = (unsigned char)(NewWord >> 24);
+  // value.  ByteNo must be word aligned.
+  void BackpatchWord(uint64_t ByteNo, unsigned NewWord) {
+    assert((ByteNo & 3) == 0 && "Backpatched word is not aligned!");
+    unsigned char Bytes[4] = {
+      (unsigned char)(NewWord >>  0), (unsigned char)(NewWord >>  8),
+      (unsigned char)(NewWord >> 16), (unsigned char)(NewWord >> 24)
+    };
+
+    if (ByteNo >= FlushedBytes) {
+      std::copy(Bytes, Bytes+4, Out.begin() + (ByteNo - FlushedBytes));
+      return;
+    }
+
+    // The word has already been written to the file, so overwrite it there.
+    uint64_t End = FS->tell();
+    FS->seek(FSStart + ByteNo);
+    FS->write((const char*)Bytes, 4);
+    FS->seek(End);
   }
 
   //===--------------------------------------------------------------------===//
@@ -199,7 +293,7 @@ public:
     EmitVBR(CodeLen, bitc::CodeLenWidth);
     FlushToWord();
 
-    unsigned BlockSizeWordLoc = static_cast<unsigned>(Out.size());
+    uint64_t BlockSizeWordLoc = FlushedBytes + Out.size();
     unsigned OldCodeSize = CurCodeSize;
 
     // Emit a placeholder, which will be replaced when the block is popped.
@@ -239,16 +333,22 @@ public:
     FlushToWord();
 
     // Compute the size of the block, in words, not counting the size field.
-    unsigned SizeInWords= static_cast<unsigned>(Out.size())/4-B.StartSizeWord-1;
-    unsigned ByteNo = B.StartSizeWord*4;
+    uint64_t SizeInWords = (FlushedBytes+Out.size())/4 - B.StartSizeWord - 1;
+    assert(SizeInWords == (unsigned)SizeInWords && "Block too large!");
 
     // Update the block size field in the header of this sub-block.
-    BackpatchWord(ByteNo, SizeInWords);
+    BackpatchWord(B.StartSizeWord*4, (unsigned)SizeInWords);
 
     // Restore the inner block's code size and abbrev table.
     CurCodeSize = B.PrevCodeSize;
     BlockScope.back().PrevAbbrevs.swap(CurAbbrevs);
     BlockScope.pop_back();
+
+    // Now that a block is complete, write out what has built up if there is a
+    // fair amount of it.  The headers of the blocks that are still open are
+    // patched in the file when those blocks are closed.
+    if (FS && Out.size() >= FlushThreshold)
+      FlushToFile();
   }
 
   //===--------------------------------------------------------------------===//
@@ -35,7 +35,8 @@ namespace bitc {
     TYPE_SYMTAB_BLOCK_ID,
     VALUE_SYMTAB_BLOCK_ID,
     METADATA_BLOCK_ID,
-    METADATA_ATTACHMENT_ID
+    METADATA_ATTACHMENT_ID,
+    FUNCTION_INDEX_BLOCK_ID
   };
 
 
@@ -62,7 +63,12 @@ namespace bitc {
     /// MODULE_CODE_PURGEVALS: [numvals]
     MODULE_CODE_PURGEVALS   = 10,
 
-    MODULE_CODE_GCNAME      = 11   // GCNAME: [strchr x N]
+    MODULE_CODE_GCNAME      = 11,  // GCNAME: [strchr x N]
+
+    /// MODULE_CODE_FNINDEX: [offset of the FUNCTION_INDEX block in 32-bit
+    ///                       words from the start of the module block, as a
+    ///                       4 byte little-endian blob]
+    MODULE_CODE_FNINDEX     = 12
   };
 
   /// PARAMATTR blocks have code for defining a parameter attribute set.
@@ -110,6 +116,12 @@ namespace bitc {
     VST_CODE_BBENTRY = 2   // VST_BBENTRY: [bbid, namechar x N]
   };
 
+  // The function index block only has one code (FNINDEX_CODE_ENTRY).  Offsets
+  // are in bits from the start of the module block to the function block.
+  enum FunctionIndexCodes {
+    FNINDEX_CODE_ENTRY = 1  // FNINDEX_ENTRY: [valueid, offset]
+  };
+
   enum MetadataCodes {
     METADATA_STRING        = 1,   // MDSTRING:      [values]
     // FIXME: Remove NODE in favor of NODE2 in LLVM 3.0
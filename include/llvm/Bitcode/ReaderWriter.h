@@ -23,6 +23,7 @@ namespace llvm {
   class BitstreamWriter;
   class LLVMContext;
   class raw_ostream;
+  class raw_fd_ostream;
   
   /// getLazyBitcodeModule - Read the header of the specified bitcode buffer
   /// and prepare for lazy deserialization of function bodies.  If successful,
@@ -53,6 +54,17 @@ namespace llvm {
   /// should be in "binary" mode.
   void WriteBitcodeToFile(const Module *M, raw_ostream &Out);
 
+  /// WriteBitcodeToFile - Write the specified module to the specified file.
+  /// If the file supports seeking, the bitcode is written out as it is
+  /// produced instead of being built up in memory first.
+  void WriteBitcodeToFile(const Module *M, raw_fd_ostream &Out);
+
+  /// BitcodeWriteThreads - The number of threads the bitcode writer encodes
+  /// function bodies on, set by -bitcode-write-threads (0: one per
+  /// processor).  Bodies are only encoded concurrently if the program has
+  /// called llvm_start_multithreaded.
+  extern unsigned BitcodeWriteThreads;
+
   /// WriteBitcodeToStream - Write the specified module to the specified
   /// raw output stream.
   void WriteBitcodeToStream(const Module *M, BitstreamWriter &Stream);
@@ -154,6 +154,12 @@ class SelectionDAG {
                              AlignOf<MostAlignedSDNode>::Alignment>
     NodeAllocatorType;
 
+  /// NodeSlabAllocator - Nodes are allocated from slabs mapped directly from
+  /// the OS, using large pages where possible.  The DAG keeps its node slabs
+  /// until it is destroyed, so this costs one mapping per SelectionDAG and
+  /// saves TLB misses when walking big DAGs.
+  MmapSlabAllocator NodeSlabAllocator;
+
   /// NodeAllocator - Pool allocation for nodes.
   NodeAllocatorType NodeAllocator;
 
@@ -86,6 +86,7 @@ private:
   mutable ArgumentListType ArgumentList;  ///< The formal arguments
   ValueSymbolTable *SymTab;               ///< Symbol table of args/instructions
   AttrListPtr AttributeList;              ///< Parameter attributes
+  unsigned ModificationCount;             ///< See getModificationCount()
 
   // HasLazyArguments is stored in Value::SubclassData.
   /*bool HasLazyArguments;*/
@@ -145,6 +146,15 @@ public:
   ///
   virtual bool isDeclaration() const { return BasicBlocks.empty(); }
 
+  /// getModificationCount - Return a counter that changes whenever the body
+  /// of this function is changed: when an instruction or basic block is
+  /// inserted, removed or moved, and when a pass reports that it modified the
+  /// function.  Analysis results cached across pass manager runs compare it
+  /// to tell whether they are stale.  Code that changes a function by only
+  /// rewriting operands, outside of a pass, must call markModified itself.
+  unsigned getModificationCount() const { return ModificationCount; }
+  void markModified() { ++ModificationCount; }
+
   /// getIntrinsicID - This method returns the ID number of the specified
   /// function, or Intrinsic::not_intrinsic if the function is not an
   /// instrinsic, or if the pointer is null.  This value is always defined to be
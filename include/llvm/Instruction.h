@@ -33,12 +33,19 @@ class Instruction : public User, public ilist_node<Instruction> {
 
   BasicBlock *Parent;
   DebugLoc DbgLoc;                         // 'dbg' Metadata cache.
-  
-  enum {
-    /// HasMetadataBit - This is a bit stored in the SubClassData field which
-    /// indicates whether this instruction has metadata attached to it or not.
-    HasMetadataBit = 1 << 15
-  };
+
+  /// Order - The position of this instruction within its parent block, as
+  /// last computed by BasicBlock::renumberInstructions().  Only meaningful
+  /// while the parent's instruction ordering is valid.
+  mutable unsigned Order;
+  friend class BasicBlock;
+
+  /// MetadataSlot - One more than the index of this instruction's entry in
+  /// the context's MetadataStore, or zero if it has no metadata other than
+  /// its debug location.  It fits in the padding after Order, so attachments
+  /// don't make every instruction bigger.
+  unsigned MetadataSlot;
+
 public:
   // Out of line virtual method, so the vtable, etc has a home.
   ~Instruction();
@@ -74,6 +81,12 @@ public:
   /// MovePos.
   void moveBefore(Instruction *MovePos);
 
+  /// comesBefore - Return true if this instruction is positioned before
+  /// Other in their common parent basic block.  Both instructions must be in
+  /// the same block.  This is amortized O(1): the block lazily numbers its
+  /// instructions and only renumbers after an insertion.
+  bool comesBefore(const Instruction *Other) const;
+
   //===--------------------------------------------------------------------===//
   // Subclass classification.
   //===--------------------------------------------------------------------===//
@@ -125,13 +138,13 @@ public:
   /// hasMetadata() - Return true if this instruction has any metadata attached
   /// to it.
   bool hasMetadata() const {
-    return !DbgLoc.isUnknown() || hasMetadataHashEntry();
+    return !DbgLoc.isUnknown() || MetadataSlot != 0;
   }
   
   /// hasMetadataOtherThanDebugLoc - Return true if this instruction has
   /// metadata attached to it other than a debug location.
   bool hasMetadataOtherThanDebugLoc() const {
-    return hasMetadataHashEntry();
+    return MetadataSlot != 0;
   }
   
   /// getMetadata - Get the metadata of given kind attached to this Instruction.
@@ -177,19 +190,13 @@ public:
   const DebugLoc &getDebugLoc() const { return DbgLoc; }
   
 private:
-  /// hasMetadataHashEntry - Return true if we have an entry in the on-the-side
-  /// metadata hash.
-  bool hasMetadataHashEntry() const {
-    return (getSubclassDataFromValue() & HasMetadataBit) != 0;
-  }
-  
   // These are all implemented in Metadata.cpp.
   MDNode *getMetadataImpl(unsigned KindID) const;
   MDNode *getMetadataImpl(const char *Kind) const;
   void getAllMetadataImpl(SmallVectorImpl<std::pair<unsigned,MDNode*> > &)const;
   void getAllMetadataOtherThanDebugLocImpl(SmallVectorImpl<std::pair<unsigned,
                                            MDNode*> > &) const;
-  void clearMetadataHashEntries();
+  void clearMetadataAttachments();
 public:
   //===--------------------------------------------------------------------===//
   // Predicates and helper methods.
@@ -344,25 +351,17 @@ private:
     return Value::getSubclassDataFromValue();
   }
   
-  void setHasMetadataHashEntry(bool V) {
-    setValueSubclassData((getSubclassDataFromValue() & ~HasMetadataBit) |
-                         (V ? HasMetadataBit : 0));
-  }
-  
   friend class SymbolTableListTraits<Instruction, BasicBlock>;
   void setParent(BasicBlock *P);
 protected:
-  // Instruction subclasses can stick up to 15 bits of stuff into the
+  // Instruction subclasses can stick up to 16 bits of stuff into the
   // SubclassData field of instruction with these members.
-  
-  // Verify that only the low 15 bits are used.
   void setInstructionSubclassData(unsigned short D) {
-    assert((D & HasMetadataBit) == 0 && "Out of range value put into field");
-    setValueSubclassData((getSubclassDataFromValue() & HasMetadataBit) | D);
+    setValueSubclassData(D);
   }
   
   unsigned getSubclassDataFromInstruction() const {
-    return getSubclassDataFromValue() & ~HasMetadataBit;
+    return getSubclassDataFromValue();
   }
   
   Instruction(const Type *Ty, unsigned iType, Use *Ops, unsigned NumOps,
@@ -96,6 +96,20 @@ public:
   /// doFinalization - Run all of the finalizers for the function passes.
   ///
   bool doFinalization();
+
+  /// cacheAnalysis - Keep the results of the function analysis ID, such as
+  /// DominatorTree, LoopInfo or ScalarEvolution, after run returns, one per
+  /// function, and reuse them when the same function is run again and has
+  /// not been modified since (see Function::getModificationCount).  Only
+  /// name analyses whose results depend on nothing but the function itself:
+  /// changes to other functions or to globals don't invalidate the cache.
+  /// An analysis is only cached if everything it requires is immutable or
+  /// cached as well.  The results stay in memory until the function is
+  /// deleted or releaseCachedAnalyses is called.
+  void cacheAnalysis(char &ID);
+
+  /// releaseCachedAnalyses - Free the analysis results kept for F.
+  void releaseCachedAnalyses(Function &F);
   
 private:
   /// addImpl - Add a pass to the queue of passes to run, without
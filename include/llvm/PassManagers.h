@@ -97,6 +97,7 @@ namespace llvm {
   class Value;
   class Timer;
   class PMDataManager;
+  class FunctionAnalysisCache;
 
 // enums for debugging strings
 enum PassDebuggingString {
@@ -227,6 +228,11 @@ public:
   // Active Pass Managers
   PMStack activeStack;
 
+  /// Analysis passes whose last result was taken from a FunctionAnalysisCache
+  /// instead of being computed by the pass itself.  They hold nothing to
+  /// release when they are freed.
+  SmallPtrSet<Pass *, 8> CachedResultPasses;
+
 protected:
   
   /// Collection of pass managers
@@ -324,6 +330,10 @@ public:
   /// implementations it needs.
   void initializeAnalysisImpl(Pass *P);
 
+  /// clearAnalysisImpls - Forget the analyses the contained passes, and those
+  /// of any lower level managers among them, were connected to.
+  void clearAnalysisImpls();
+
   /// Find the pass that implements Analysis AID. If desired pass is not found
   /// then return NULL.
   Pass *findAnalysisPass(AnalysisID AID, bool Direction);
@@ -406,10 +416,24 @@ private:
 /// sequence them to process one function at a time before processing next 
 /// function.
 class FPPassManager : public ModulePass, public PMDataManager {
+  /// AnalysisCache - Where the results of function analyses are kept between
+  /// runs, or null if they are not kept.
+  FunctionAnalysisCache *AnalysisCache;
+
+  /// runCachedAnalysis - Make F's own instance of the analysis AP available,
+  /// recomputing it first if F changed since it was computed.  Return false
+  /// without doing anything if AP's result can't be cached.
+  bool runCachedAnalysis(Pass *AP, Function &F);
+
+  /// preserveCachedAnalyses - A pass changed F, whose modification count was
+  /// OldCount before.  Carry the cached analyses of F that the pass kept up
+  /// to date over to F's new modification count.
+  void preserveCachedAnalyses(Function &F, unsigned OldCount);
+
 public:
   static char ID;
   explicit FPPassManager(int Depth) 
-  : ModulePass(ID), PMDataManager(Depth) { }
+  : ModulePass(ID), PMDataManager(Depth), AnalysisCache(0) { }
   
   /// run - Execute all of the passes scheduled for execution.  Keep track of
   /// whether any of the passes modifies the module, and if so, return true.
@@ -419,6 +443,13 @@ public:
   /// cleanup - After running all passes, clean up pass manager cache.
   void cleanup();
 
+  /// setAnalysisCache - Take the results of function analyses from Cache
+  /// when they are still valid, and keep new ones there.  The cache is not
+  /// owned by the manager.  Null turns caching off.
+  void setAnalysisCache(FunctionAnalysisCache *Cache) {
+    AnalysisCache = Cache;
+  }
+
   /// doInitialization - Run all of the initializers for the function passes.
   ///
   bool doInitialization(Module &M);
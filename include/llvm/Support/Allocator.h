@@ -83,6 +83,27 @@ public:
   virtual void Deallocate(MemSlab *Slab);
 };
 
+/// MmapSlabAllocator - A slab allocator that maps slabs directly from the
+/// operating system with sys::Memory, so that slabs are page aligned and
+/// returned to the system as soon as they are freed.  Slabs of at least
+/// sys::Memory::getLargePageSize() bytes are backed by large pages when
+/// UseLargePages is set and the host allows it, which reduces TLB misses for
+/// allocators that churn through a lot of memory.  If large pages are not
+/// available, regular pages are used instead.
+class MmapSlabAllocator : public SlabAllocator {
+  bool UseLargePages;
+
+public:
+  explicit MmapSlabAllocator(bool useLargePages = true)
+    : UseLargePages(useLargePages) { }
+  virtual ~MmapSlabAllocator();
+  virtual MemSlab *Allocate(size_t Size);
+  virtual void Deallocate(MemSlab *Slab);
+};
+
+struct AllocatorStatistics;
+class ThreadLocalBumpPtrAllocator;
+
 /// BumpPtrAllocator - This allocator is useful for containers that need
 /// very simple memory allocation strategies.  In particular, this just keeps
 /// allocating memory, and never deletes it until the entire block is dead. This
@@ -120,6 +141,28 @@ class BumpPtrAllocator {
   /// that we can compute how much space was wasted.
   size_t BytesAllocated;
 
+  /// BytesReserved - This field tracks the total size of all slabs we've
+  /// allocated, including the ones freed by Reset.
+  size_t BytesReserved;
+
+  /// BytesWasted - The space left unused at the end of the slabs we've moved
+  /// on from.
+  size_t BytesWasted;
+
+  /// Stats - The statistics of this kind of allocator, if any.  The numbers
+  /// are also added to the totals for all bump pointer allocators.
+  AllocatorStatistics *Stats;
+
+  /// ReportedKB - The kilobytes reserved, used and wasted that have already
+  /// been added to the statistics.
+  size_t ReportedKB[3];
+
+  /// UpdateStatistics - Add what this allocator did since the last call to
+  /// the -stats counters.  This is called whenever a slab is allocated, on
+  /// Reset and when the allocator is destroyed, so it stays off the
+  /// allocation fast path.
+  void UpdateStatistics();
+
   /// AlignPtr - Align Ptr to Alignment bytes, rounding up.  Alignment should
   /// be a power of two.  This method rounds up, so AlignPtr(7, 4) == 8 and
   /// AlignPtr(8, 4) == 8.
@@ -136,9 +179,11 @@ class BumpPtrAllocator {
   static MallocSlabAllocator DefaultSlabAllocator;
 
   template<typename T> friend class SpecificBumpPtrAllocator;
+  friend class ThreadLocalBumpPtrAllocator;
 public:
   BumpPtrAllocator(size_t size = 4096, size_t threshold = 4096,
-                   SlabAllocator &allocator = DefaultSlabAllocator);
+                   SlabAllocator &allocator = DefaultSlabAllocator,
+                   AllocatorStatistics *stats = 0);
   ~BumpPtrAllocator();
 
   /// Reset - Deallocate all but the current slab and reset the current pointer
@@ -176,6 +221,13 @@ public:
 
   unsigned GetNumSlabs() const;
 
+  /// getBytesAllocated - Return the number of bytes handed out so far.
+  size_t getBytesAllocated() const { return BytesAllocated; }
+
+  /// getBytesReserved - Return the number of bytes obtained from the slab
+  /// allocator so far.
+  size_t getBytesReserved() const { return BytesReserved; }
+
   void PrintStats() const;
 };
 
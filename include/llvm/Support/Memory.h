@@ -66,6 +66,31 @@ namespace sys {
     /// @brief Release Read/Write/Execute memory.
     static bool ReleaseRWX(MemoryBlock &block, std::string *ErrMsg = 0);
 
+    /// This method allocates a block of Read/Write memory directly from the
+    /// operating system, rounded up to whole pages.  If \p LargePages is true
+    /// and \p NumBytes is at least getLargePageSize(), an attempt is made to
+    /// back the block with large pages; if that is not possible, regular
+    /// pages are used.
+    ///
+    /// On success, this returns a non-null memory block, otherwise it returns
+    /// a null memory block and fills in *ErrMsg.
+    ///
+    /// @brief Allocate Read/Write memory.
+    static MemoryBlock AllocateRW(size_t NumBytes, bool LargePages,
+                                  std::string *ErrMsg = 0);
+
+    /// This method releases a block of memory that was allocated with the
+    /// AllocateRW method.
+    ///
+    /// On success, this returns false, otherwise it returns true and fills
+    /// in *ErrMsg.
+    /// @brief Release Read/Write memory.
+    static bool ReleaseRW(MemoryBlock &block, std::string *ErrMsg = 0);
+
+    /// getLargePageSize - Return the size of the large pages AllocateRW can
+    /// use, or zero if the host does not support them.
+    static size_t getLargePageSize();
+
 
     /// InvalidateInstructionCache - Before the JIT can run a block of code
     /// that has been emitted it must invalidate the instruction cache on some
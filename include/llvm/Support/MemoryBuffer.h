@@ -58,22 +58,50 @@ public:
     return "Unknown buffer";
   }
 
+  /// AccessPattern - How the contents of a file are going to be read.  This
+  /// is passed on to the operating system, so that it reads ahead as much as
+  /// suits the client.
+  enum AccessPattern {
+    /// NormalAccess - No particular pattern.
+    NormalAccess,
+    /// SequentialAccess - The file is read from front to back, like bitcode
+    /// or source being parsed.  The whole file is read ahead.
+    SequentialAccess,
+    /// RandomAccess - The file is read in pieces at scattered offsets, like
+    /// the members of an archive.  Read ahead is turned off.
+    RandomAccess
+  };
+
   /// getFile - Open the specified file as a MemoryBuffer, returning a new
   /// MemoryBuffer if successful, otherwise returning null.  If FileSize is
   /// specified, this means that the client knows that the file exists and that
-  /// it has the specified size.
+  /// it has the specified size.  Access describes how the buffer will be read.
   static error_code getFile(StringRef Filename, OwningPtr<MemoryBuffer> &result,
-                            int64_t FileSize = -1);
+                            int64_t FileSize = -1,
+                            AccessPattern Access = NormalAccess);
   static error_code getFile(const char *Filename,
                             OwningPtr<MemoryBuffer> &result,
-                            int64_t FileSize = -1);
+                            int64_t FileSize = -1,
+                            AccessPattern Access = NormalAccess);
 
   /// getOpenFile - Given an already-open file descriptor, read the file and
   /// return a MemoryBuffer.  This takes ownership of the descriptor,
   /// immediately closing it after reading the file.
   static error_code getOpenFile(int FD, const char *Filename,
                                 OwningPtr<MemoryBuffer> &result,
-                                int64_t FileSize = -1);
+                                int64_t FileSize = -1,
+                                AccessPattern Access = NormalAccess);
+
+  /// setFileCacheEnabled - Turn the process-wide file cache on or off.  While
+  /// it is on, getFile and getOpenFile share the contents of a file between
+  /// all the buffers opened for it, so opening a file again is zero-copy.  The
+  /// cache is keyed on the path and checks the inode, modification time and
+  /// size of the file on every open, so a file that changed is read again.
+  /// The cache keeps the contents of every file opened while it is on; turning
+  /// it off releases them once no buffer refers to them.  Tools that open the
+  /// same inputs several times, like linkers, turn it on at startup.
+  static void setFileCacheEnabled(bool Enabled);
+  static bool isFileCacheEnabled();
 
   /// getMemBuffer - Open the specified memory range as a MemoryBuffer.  Note
   /// that InputData must be null terminated.
@@ -109,10 +137,12 @@ public:
   /// ec.
   static error_code getFileOrSTDIN(StringRef Filename,
                                    OwningPtr<MemoryBuffer> &result,
-                                   int64_t FileSize = -1);
+                                   int64_t FileSize = -1,
+                                   AccessPattern Access = NormalAccess);
   static error_code getFileOrSTDIN(const char *Filename,
                                    OwningPtr<MemoryBuffer> &result,
-                                   int64_t FileSize = -1);
+                                   int64_t FileSize = -1,
+                                   AccessPattern Access = NormalAccess);
 };
 
 } // end namespace llvm
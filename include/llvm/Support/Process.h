@@ -61,6 +61,26 @@ namespace sys {
           ///< Returns the current amount of system time for the process
       );
 
+      /// The hardware performance counters that GetPerfCounters can read.
+      enum PerfCounter {
+        PerfCycles,        ///< CPU cycles
+        PerfInstructions,  ///< Instructions retired
+        PerfCacheMisses,   ///< Last level cache misses
+        PerfBranchMisses,  ///< Mispredicted branches
+        NumPerfCounters
+      };
+
+      /// This static function will set \p Counts to the user mode hardware
+      /// performance counters of the calling thread, indexed by PerfCounter.
+      /// Each thread's counters are opened by its first call and count only
+      /// that thread, so work done on other threads is not included.
+      /// Counters that the host cannot provide read as zero.  If the operating
+      /// system or the host does not support any of them (e.g. perf events
+      /// are disabled or not implemented), false is returned and \p Counts is
+      /// left unmodified.
+      /// @brief Read hardware performance counters.
+      static bool GetPerfCounters(uint64_t Counts[NumPerfCounters]);
+
       /// This static function will return the process' current user id number.
       /// Not all operating systems support this feature. Where it is not
       /// supported, the function should return 65536 as the value.
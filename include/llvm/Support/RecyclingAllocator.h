@@ -35,6 +35,18 @@ private:
   AllocatorType Allocator;
 
 public:
+  RecyclingAllocator() {}
+
+  /// RecyclingAllocator - Forward the constructor arguments to the wrapped
+  /// allocator, e.g. a slab size, size threshold and slab allocator for a
+  /// BumpPtrAllocator.
+  template<typename A1, typename A2, typename A3>
+  RecyclingAllocator(const A1 &a1, const A2 &a2, A3 &a3)
+    : Allocator(a1, a2, a3) {}
+  template<typename A1, typename A2, typename A3, typename A4>
+  RecyclingAllocator(const A1 &a1, const A2 &a2, A3 &a3, const A4 &a4)
+    : Allocator(a1, a2, a3, a4) {}
+
   ~RecyclingAllocator() { Base.clear(Allocator); }
 
   /// Allocate - Return a pointer to storage for an object of type
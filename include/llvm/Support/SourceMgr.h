@@ -113,7 +113,8 @@ public:
   int FindBufferContainingLoc(SMLoc Loc) const;
 
   /// FindLineNumber - Find the line number for the specified location in the
-  /// specified file.  This is not a fast method.
+  /// specified file.  The first query in a file builds an index of its lines,
+  /// which makes later queries in any order cheap.
   unsigned FindLineNumber(SMLoc Loc, int BufferID = -1) const;
 
   /// PrintMessage - Emit a message about the specified location with the
@@ -0,0 +1,118 @@
+//===- ThreadLocalAllocator.h - Per-thread arenas and stats -----*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the AllocatorStatistics that bump pointer allocators
+// report to -stats, and ThreadLocalBumpPtrAllocator, an arena that several
+// threads can allocate from without taking a lock.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_THREADLOCALALLOCATOR_H
+#define LLVM_SUPPORT_THREADLOCALALLOCATOR_H
+
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Support/Allocator.h"
+#include "llvm/Support/Mutex.h"
+#include "llvm/Support/ThreadLocal.h"
+#include <vector>
+
+namespace llvm {
+
+/// AllocatorStatistics - The -stats counters of one kind of bump pointer
+/// allocator, e.g. the SelectionDAG's node allocator.  Define them with
+/// ALLOCATOR_STATISTICS and pass them to the allocators to be accounted for.
+/// Wasted space is the part of each slab left unused when the allocator moves
+/// on to the next one, is Reset or is destroyed.
+struct AllocatorStatistics {
+  Statistic NumSlabs;
+  Statistic KBReserved;
+  Statistic KBUsed;
+  Statistic KBWasted;
+};
+
+// ALLOCATOR_STATISTICS - Define the statistics of the allocators described
+// by DESC, e.g. "SDNodes", in the DEBUG_TYPE of the file.
+#define ALLOCATOR_STATISTICS(VARNAME, DESC) \
+  static llvm::AllocatorStatistics VARNAME = { \
+    { DEBUG_TYPE, "Number of slabs allocated for " DESC, 0, 0, 0 }, \
+    { DEBUG_TYPE, "Kilobytes reserved for " DESC, 0, 0, 0 }, \
+    { DEBUG_TYPE, "Kilobytes handed out for " DESC, 0, 0, 0 }, \
+    { DEBUG_TYPE, "Kilobytes wasted at the end of slabs for " DESC, 0, 0, 0 } \
+  }
+
+/// ThreadLocalBumpPtrAllocator - A bump pointer arena that can be allocated
+/// from by several threads at once.  Each thread allocates from a
+/// BumpPtrAllocator of its own, so allocation does not take a lock, and all
+/// memory stays valid until the arena is Reset or destroyed.  The slab
+/// allocator is shared by all threads and must be thread safe; the malloc
+/// and mmap based ones are.
+class ThreadLocalBumpPtrAllocator {
+  ThreadLocalBumpPtrAllocator(const ThreadLocalBumpPtrAllocator &); // do not
+  void operator=(const ThreadLocalBumpPtrAllocator &);        // implement
+
+  size_t SlabSize;
+  size_t SizeThreshold;
+  SlabAllocator &Allocator;
+  AllocatorStatistics *Stats;
+
+  /// Current - The allocator of the calling thread, if it has one.
+  sys::ThreadLocal<const BumpPtrAllocator> Current;
+
+  /// Allocators - The allocators of all threads, guarded by Lock.
+  std::vector<BumpPtrAllocator*> Allocators;
+  sys::Mutex Lock;
+
+  /// getThreadAllocator - Return the calling thread's allocator, creating it
+  /// on first use.
+  BumpPtrAllocator &getThreadAllocator() {
+    if (const BumpPtrAllocator *A = Current.get())
+      return *const_cast<BumpPtrAllocator*>(A);
+    return createThreadAllocator();
+  }
+  BumpPtrAllocator &createThreadAllocator();
+
+public:
+  ThreadLocalBumpPtrAllocator(size_t size = 4096, size_t threshold = 4096,
+                              SlabAllocator &allocator =
+                                BumpPtrAllocator::DefaultSlabAllocator,
+                              AllocatorStatistics *stats = 0);
+  ~ThreadLocalBumpPtrAllocator();
+
+  /// Reset - Reset the allocators of all threads.  This must not be called
+  /// while another thread is allocating.
+  void Reset();
+
+  /// Allocate - Allocate space at the specified alignment from the calling
+  /// thread's allocator.
+  void *Allocate(size_t Size, size_t Alignment) {
+    return getThreadAllocator().Allocate(Size, Alignment);
+  }
+
+  template <typename T>
+  T *Allocate() {
+    return static_cast<T*>(Allocate(sizeof(T),AlignOf<T>::Alignment));
+  }
+
+  template <typename T>
+  T *Allocate(size_t Num) {
+    return static_cast<T*>(Allocate(Num * sizeof(T), AlignOf<T>::Alignment));
+  }
+
+  void Deallocate(const void * /*Ptr*/) {}
+
+  /// getBytesAllocated - Return the number of bytes handed out so far by the
+  /// allocators of all threads.
+  size_t getBytesAllocated();
+
+  void PrintStats();
+};
+
+}  // end namespace llvm
+
+#endif // LLVM_SUPPORT_THREADLOCALALLOCATOR_H
@@ -0,0 +1,158 @@
+//===-- llvm/Support/ThreadPool.h - Work stealing thread pool ---*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines ThreadPool, a pool of worker threads that run tasks and
+// steal work from each other, and the TaskGroup and TaskFuture classes used
+// to wait for tasks submitted to it.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_THREADPOOL_H
+#define LLVM_SUPPORT_THREADPOOL_H
+
+#include "llvm/Support/Atomic.h"
+
+namespace llvm {
+
+class TaskGroup;
+
+/// ThreadPool - A fixed set of worker threads that execute tasks.  Each
+/// worker has its own queue: tasks spawned by a worker go to the front of its
+/// queue and are run last-in first-out, which keeps nested work cache local,
+/// while idle workers steal the oldest tasks from the back of other queues.
+/// Tasks submitted from outside the pool go to a shared queue.
+///
+/// The pool only synchronizes its own state.  Tasks that call into LLVM APIs
+/// which are not otherwise thread safe need llvm_start_multithreaded() to
+/// have been called first.
+///
+/// Where threads are not supported (LLVM_MULTITHREADED is off or there is no
+/// pthreads), the pool has no workers and runs every task on the submitting
+/// thread before returning from async() or TaskGroup::spawn().
+class ThreadPool {
+public:
+  /// TaskFn - The function type of tasks, which are passed the pointer given
+  /// when they were submitted.
+  typedef void (*TaskFn)(void *);
+
+  /// ThreadPool ctor - Start NumThreads workers, or getDefaultNumThreads()
+  /// if NumThreads is zero.
+  explicit ThreadPool(unsigned NumThreads = 0);
+
+  /// ~ThreadPool - Wait for all submitted tasks to finish, then stop the
+  /// workers.
+  ~ThreadPool();
+
+  /// getNumThreads - Return the number of worker threads in the pool.
+  unsigned getNumThreads() const { return NumWorkers; }
+
+  /// async - Run Fn(Arg) on some worker thread.  Use a TaskGroup to wait for
+  /// specific tasks; wait() waits for all of them.
+  void async(TaskFn Fn, void *Arg) { enqueue(Fn, Arg, 0); }
+
+  /// wait - Wait until every task submitted to the pool has finished.  The
+  /// calling thread runs queued tasks while it waits.
+  void wait();
+
+  /// getDefaultNumThreads - Return the value of -threads, or the number of
+  /// processors the host has online if it was not given.
+  static unsigned getDefaultNumThreads();
+
+  /// getGlobalPool - Return a pool with getDefaultNumThreads() workers that is
+  /// created on first use and destroyed by llvm_shutdown().
+  static ThreadPool &getGlobalPool();
+
+private:
+  friend class TaskGroup;
+  struct Impl;
+
+  unsigned NumWorkers;
+  Impl *P;
+
+  /// enqueue - Queue Fn(Arg) as a task of Group, which may be null.
+  void enqueue(TaskFn Fn, void *Arg, TaskGroup *Group);
+
+  /// waitUntilZero - Run queued tasks until Count drops to zero, then sleep
+  /// until it does.
+  void waitUntilZero(volatile sys::cas_flag &Count);
+
+  ThreadPool(const ThreadPool &);    // DO NOT IMPLEMENT
+  void operator=(const ThreadPool &); // DO NOT IMPLEMENT
+};
+
+/// TaskGroup - A set of tasks submitted to a ThreadPool that are waited for
+/// together.  Groups may be used from inside tasks to spawn and join nested
+/// work; the waiting worker keeps running other tasks meanwhile, so this does
+/// not tie up the pool.  The destructor waits for any remaining tasks.
+class TaskGroup {
+  ThreadPool &Pool;
+  volatile sys::cas_flag Pending;
+  friend class ThreadPool;
+public:
+  explicit TaskGroup(ThreadPool &P = ThreadPool::getGlobalPool())
+    : Pool(P), Pending(0) {}
+  ~TaskGroup() { wait(); }
+
+  ThreadPool &getPool() const { return Pool; }
+
+  /// isDone - Return true if no task spawned in this group is still pending.
+  bool isDone() const { return Pending == 0; }
+
+  /// spawn - Run Fn(Arg) as part of this group.
+  void spawn(ThreadPool::TaskFn Fn, void *Arg) {
+    sys::AtomicIncrement(&Pending);
+    Pool.enqueue(Fn, Arg, this);
+  }
+
+  /// wait - Wait until all tasks spawned in this group have finished.
+  void wait() {
+    if (Pending)
+      Pool.waitUntilZero(Pending);
+  }
+
+private:
+  TaskGroup(const TaskGroup &);     // DO NOT IMPLEMENT
+  void operator=(const TaskGroup &); // DO NOT IMPLEMENT
+};
+
+/// TaskFuture - The result of running Fn(Arg) on a ThreadPool.  get() waits
+/// for the task and returns what it computed.
+template<typename T>
+class TaskFuture {
+  TaskGroup Group;
+  T (*Fn)(void *);
+  void *Arg;
+  T Result;
+
+  static void run(void *F) {
+    TaskFuture *This = static_cast<TaskFuture*>(F);
+    This->Result = This->Fn(This->Arg);
+  }
+
+  TaskFuture(const TaskFuture &);    // DO NOT IMPLEMENT
+  void operator=(const TaskFuture &); // DO NOT IMPLEMENT
+public:
+  TaskFuture(ThreadPool &P, T (*fn)(void *), void *arg)
+    : Group(P), Fn(fn), Arg(arg), Result() {
+    Group.spawn(run, this);
+  }
+
+  /// isReady - Return true if the task has finished.
+  bool isReady() const { return Group.isDone(); }
+
+  /// get - Wait for the task to finish and return its result.
+  const T &get() {
+    Group.wait();
+    return Result;
+  }
+};
+
+} // end namespace llvm
+
+#endif
@@ -29,9 +29,14 @@ namespace llvm {
   /// THIS MUST EXECUTE IN ISOLATION FROM ALL OTHER LLVM API CALLS.
   void llvm_stop_multithreaded();
 
+  /// MultithreadedMode - Set by llvm_start_multithreaded and cleared by
+  /// llvm_stop_multithreaded.  Read it with llvm_is_multithreaded.
+  extern bool MultithreadedMode;
+
   /// llvm_is_multithreaded - Check whether LLVM is executing in thread-safe
-  /// mode or not.
-  bool llvm_is_multithreaded();
+  /// mode or not.  This is inline because hot paths such as SmartMutex and
+  /// Statistic counters check it every time.
+  inline bool llvm_is_multithreaded() { return MultithreadedMode; }
 
   /// acquire_global_lock - Acquire the global lock.  This is a no-op if called
   /// before llvm_start_multithreaded().
@@ -16,6 +16,7 @@
 #define LLVM_SUPPORT_TIMER_H
 
 #include "llvm/Support/DataTypes.h"
+#include "llvm/Support/Process.h"
 #include "llvm/ADT/StringRef.h"
 #include <cassert>
 #include <string>
@@ -33,13 +34,19 @@ class TimeRecord {
   double UserTime;       // User time elapsed
   double SystemTime;     // System time elapsed
   ssize_t MemUsed;       // Memory allocated (in bytes)
+  uint64_t PerfCounts[sys::Process::NumPerfCounters]; // Hardware counters
 public:
-  TimeRecord() : WallTime(0), UserTime(0), SystemTime(0), MemUsed(0) {}
+  TimeRecord() : WallTime(0), UserTime(0), SystemTime(0), MemUsed(0) {
+    for (unsigned i = 0; i != sys::Process::NumPerfCounters; ++i)
+      PerfCounts[i] = 0;
+  }
   
-  /// getCurrentTime - Get the current time and memory usage.  If Start is true
-  /// we get the memory usage before the time, otherwise we get time before
-  /// memory usage.  This matters if the time to get the memory usage is
-  /// significant and shouldn't be counted as part of a duration.
+  /// getCurrentTime - Get the current time and memory usage, and the hardware
+  /// performance counters if -track-perf-counters is given and the host
+  /// supports them.  If Start is true we get the memory usage before the time,
+  /// otherwise we get time before memory usage.  This matters if the time to
+  /// get the memory usage is significant and shouldn't be counted as part of a
+  /// duration.
   static TimeRecord getCurrentTime(bool Start = true);
   
   double getProcessTime() const { return UserTime+SystemTime; }
@@ -47,6 +54,9 @@ public:
   double getSystemTime() const { return SystemTime; }
   double getWallTime() const { return WallTime; }
   ssize_t getMemUsed() const { return MemUsed; }
+  uint64_t getPerfCount(sys::Process::PerfCounter C) const {
+    return PerfCounts[C];
+  }
   
   
   // operator< - Allow sorting.
@@ -60,12 +70,16 @@ public:
     UserTime   += RHS.UserTime;
     SystemTime += RHS.SystemTime;
     MemUsed    += RHS.MemUsed;
+    for (unsigned i = 0; i != sys::Process::NumPerfCounters; ++i)
+      PerfCounts[i] += RHS.PerfCounts[i];
   }
   void operator-=(const TimeRecord &RHS) {
     WallTime   -= RHS.WallTime;
     UserTime   -= RHS.UserTime;
     SystemTime -= RHS.SystemTime;
     MemUsed    -= RHS.MemUsed;
+    for (unsigned i = 0; i != sys::Process::NumPerfCounters; ++i)
+      PerfCounts[i] -= RHS.PerfCounts[i];
   }
   
   /// print - Print the current timer to standard error, and reset the "Started"
@@ -361,6 +361,10 @@ public:
   /// position to the offset specified from the beginning of the file.
   uint64_t seek(uint64_t off);
 
+  /// supportsSeeking - Return true if output already written to this stream
+  /// can be overwritten by seeking back to it.  This flushes the stream.
+  bool supportsSeeking();
+
   virtual raw_ostream &changeColor(enum Colors colors, bool bold=false,
                                    bool bg=false);
   virtual raw_ostream &resetColor();
@@ -63,7 +63,6 @@ class MDNode;
 /// @brief LLVM Value Representation
 class Value {
   const unsigned char SubclassID;   // Subclass identifier (for isa/dyn_cast)
-  unsigned char HasValueHandle : 1; // Has a ValueHandle pointing to this?
 protected:
   /// SubclassOptionalData - This member is similar to SubclassData, however it
   /// is for holding information which may be used to aid optimization, but
@@ -77,6 +76,10 @@ private:
   /// This field is initialized to zero by the ctor.
   unsigned short SubclassData;
 
+  /// HandleListIdx - If there are ValueHandles pointing to this value, the
+  /// index of their list in the context's handle table, otherwise zero.
+  unsigned HandleListIdx;
+
   PATypeHolder VTy;
   Use *UseList;
 
@@ -272,7 +275,7 @@ public:
 
   /// hasValueHandle - Return true if there is a value handle associated with
   /// this value.
-  bool hasValueHandle() const { return HasValueHandle; }
+  bool hasValueHandle() const { return HandleListIdx != 0; }
   
   // Methods for support type inquiry through isa, cast, and dyn_cast:
   static inline bool classof(const Value *) {
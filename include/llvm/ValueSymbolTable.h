@@ -82,6 +82,16 @@ public:
   /// @brief Print out symbol table on stderr
   void dump() const;
 
+  /// @returns the counter that is appended to names that conflict.
+  /// @brief Get the last suffix used to make a name unique.
+  unsigned getLastUnique() const { return LastUnique; }
+
+  /// Restore the counter that is appended to names that conflict, so that a
+  /// table rebuilt from a copy, for instance one read back from bitcode,
+  /// picks the same names as the original would have.
+  /// @brief Set the last suffix used to make a name unique.
+  void setLastUnique(unsigned N) { LastUnique = N; }
+
 /// @}
 /// @name Iteration
 /// @{
@@ -150,7 +150,9 @@ Archive::Archive(const sys::Path& filename, LLVMContext& C)
 bool
 Archive::mapToMemory(std::string* ErrMsg) {
   OwningPtr<MemoryBuffer> File;
-  if (error_code ec = MemoryBuffer::getFile(archPath.c_str(), File)) {
+  // Members are read on demand, wherever they are in the archive.
+  if (error_code ec = MemoryBuffer::getFile(archPath.c_str(), File, -1,
+                                            MemoryBuffer::RandomAccess)) {
     if (ErrMsg)
       *ErrMsg = ec.message();
     return true;
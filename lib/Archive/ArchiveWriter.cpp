@@ -219,7 +219,9 @@ Archive::writeMember(
   MemoryBuffer *mFile = 0;
   if (!data) {
     OwningPtr<MemoryBuffer> File;
-    if (error_code ec = MemoryBuffer::getFile(member.getPath().c_str(), File)) {
+    if (error_code ec = MemoryBuffer::getFile(member.getPath().c_str(), File,
+                                              -1,
+                                              MemoryBuffer::SequentialAccess)) {
       if (ErrMsg)
         *ErrMsg = ec.message();
       return true;
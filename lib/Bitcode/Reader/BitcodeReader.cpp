@@ -20,13 +20,19 @@
 #include "llvm/Module.h"
 #include "llvm/Operator.h"
 #include "llvm/AutoUpgrade.h"
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/OperandTraits.h"
 using namespace llvm;
 
+static cl::opt<bool>
+DisableLazyMetadata("disable-lazy-bitcode-metadata", cl::Hidden,
+  cl::desc("Read all module metadata when a bitcode file is opened lazily"));
+
 void BitcodeReader::FreeState() {
   if (BufferOwned)
     delete Buffer;
@@ -40,6 +46,7 @@ void BitcodeReader::FreeState() {
   std::vector<Function*>().swap(FunctionsWithBodies);
   DeferredFunctionInfo.clear();
   MDKindMap.clear();
+  DeferredMetadataInfo.clear();
 }
 
 //===----------------------------------------------------------------------===//
@@ -803,7 +810,7 @@ bool BitcodeReader::ParseMetadata() {
       unsigned Size = Record.size();
       NamedMDNode *NMD = TheModule->getOrInsertNamedMetadata(Name);
       for (unsigned i = 0; i != Size; ++i) {
-        MDNode *MD = dyn_cast<MDNode>(MDValueList.getValueFwdRef(Record[i]));
+        MDNode *MD = dyn_cast_or_null<MDNode>(getMDValueFwdRef(Record[i]));
         if (MD == 0)
           return Error("Malformed metadata record");
         NMD->addOperand(MD);
@@ -837,9 +844,11 @@ bool BitcodeReader::ParseMetadata() {
       for (unsigned i = 0; i != Size; i += 2) {
         const Type *Ty = getTypeByID(Record[i]);
         if (!Ty) return Error("Invalid METADATA_NODE2 record");
-        if (Ty->isMetadataTy())
-          Elts.push_back(MDValueList.getValueFwdRef(Record[i+1]));
-        else if (!Ty->isVoidTy())
+        if (Ty->isMetadataTy()) {
+          Value *MD = getMDValueFwdRef(Record[i+1]);
+          if (!MD) return true;
+          Elts.push_back(MD);
+        } else if (!Ty->isVoidTy())
           Elts.push_back(ValueList.getValueFwdRef(Record[i+1], Ty));
         else
           Elts.push_back(NULL);
@@ -862,23 +871,202 @@ bool BitcodeReader::ParseMetadata() {
       MDValueList.AssignValue(V, NextMDValueNo++);
       break;
     }
-    case bitc::METADATA_KIND: {
-      unsigned RecordLength = Record.size();
-      if (Record.empty() || RecordLength < 2)
-        return Error("Invalid METADATA_KIND record");
-      SmallString<8> Name;
-      Name.resize(RecordLength-1);
-      unsigned Kind = Record[0];
-      for (unsigned i = 1; i != RecordLength; ++i)
-        Name[i-1] = Record[i];
-      
-      unsigned NewKind = TheModule->getMDKindID(Name.str());
-      if (!MDKindMap.insert(std::make_pair(Kind, NewKind)).second)
-        return Error("Conflicting METADATA_KIND records");
+    case bitc::METADATA_KIND:
+      if (ParseMetadataKind(Record))
+        return true;
+      break;
+    }
+  }
+}
+
+/// ParseMetadataKind - Map the custom metadata kind described by a
+/// METADATA_KIND record to the module's kind ID.
+bool BitcodeReader::ParseMetadataKind(SmallVectorImpl<uint64_t> &Record) {
+  unsigned RecordLength = Record.size();
+  if (Record.empty() || RecordLength < 2)
+    return Error("Invalid METADATA_KIND record");
+  SmallString<8> Name;
+  Name.resize(RecordLength-1);
+  unsigned Kind = Record[0];
+  for (unsigned i = 1; i != RecordLength; ++i)
+    Name[i-1] = Record[i];
+
+  unsigned NewKind = TheModule->getMDKindID(Name.str());
+  if (!MDKindMap.insert(std::make_pair(Kind, NewKind)).second)
+    return Error("Conflicting METADATA_KIND records");
+  return false;
+}
+
+/// DeferMetadata - Instead of creating the metadata described by the
+/// module-level METADATA_BLOCK, remember where the record for each metadata ID
+/// is, so that ParseDeferredMetadata can read just the metadata that is used.
+/// Named metadata is read straight away, along with everything it refers to.
+/// Metadata from LLVM 2.7 is numbered differently, so it is always read in
+/// full by ParseMetadata.
+bool BitcodeReader::DeferMetadata() {
+  uint64_t BlockBit = Stream.GetCurrentBitNo();
+  unsigned NextMDValueNo = MDValueList.size();
+
+  if (Stream.EnterSubBlock(bitc::METADATA_BLOCK_ID))
+    return Error("Malformed block record");
+
+  SmallVector<uint64_t, 64> Record;
+  std::vector<std::pair<std::string, std::vector<unsigned> > > NamedMD;
+  std::vector<SmallVector<uint64_t, 16> > Kinds;
+
+  // Read all the records.
+  while (1) {
+    uint64_t RecordBit = Stream.GetCurrentBitNo();
+    unsigned Code = Stream.ReadCode();
+    if (Code == bitc::END_BLOCK) {
+      MDCursor = Stream;
+      if (Stream.ReadBlockEnd())
+        return Error("Error at end of METADATA block");
+      break;
+    }
+
+    if (Code == bitc::ENTER_SUBBLOCK) {
+      // No known subblocks, always skip them.
+      Stream.ReadSubBlockID();
+      if (Stream.SkipBlock())
+        return Error("Malformed block record");
+      continue;
+    }
+
+    if (Code == bitc::DEFINE_ABBREV) {
+      Stream.ReadAbbrevRecord();
+      continue;
+    }
+
+    Record.clear();
+    switch (Stream.ReadRecord(Code, Record)) {
+    default:  // Default behavior: ignore.
+      break;
+    case bitc::METADATA_STRING:
+    case bitc::METADATA_NODE2:
+      if (DeferredMetadataInfo.size() <= NextMDValueNo)
+        DeferredMetadataInfo.resize(NextMDValueNo+1);
+      DeferredMetadataInfo[NextMDValueNo++] = RecordBit;
+      break;
+    case bitc::METADATA_NAME: {
+      // METADATA_NAME is always followed by METADATA_NAMED_NODE2.
+      NamedMD.push_back(std::make_pair(std::string(Record.begin(),
+                                                   Record.end()),
+                                       std::vector<unsigned>()));
+      Record.clear();
+      Code = Stream.ReadCode();
+      if (Stream.ReadRecord(Code, Record) != bitc::METADATA_NAMED_NODE2) {
+        // FIXME: Remove this in LLVM 3.0, along with METADATA_NAMED_NODE.
+        Stream.ReadBlockEnd();
+        Stream.JumpToBit(BlockBit);
+        DeferredMetadataInfo.clear();
+        return ParseMetadata();
+      }
+      NamedMD.back().second.assign(Record.begin(), Record.end());
       break;
     }
+    case bitc::METADATA_KIND:
+      Kinds.push_back(SmallVector<uint64_t, 16>(Record.begin(), Record.end()));
+      break;
+    // FIXME: Remove in LLVM 3.0.
+    case bitc::METADATA_NODE:
+    case bitc::METADATA_FN_NODE:
+    case bitc::METADATA_FN_NODE2:
+      Stream.ReadBlockEnd();
+      Stream.JumpToBit(BlockBit);
+      DeferredMetadataInfo.clear();
+      return ParseMetadata();
+    }
+  }
+
+  for (unsigned i = 0, e = Kinds.size(); i != e; ++i)
+    if (ParseMetadataKind(Kinds[i]))
+      return true;
+
+  // Function-local metadata is numbered after all of the module's metadata.
+  if (MDValueList.size() < NextMDValueNo)
+    MDValueList.resize(NextMDValueNo);
+
+  for (unsigned i = 0, e = NamedMD.size(); i != e; ++i) {
+    NamedMDNode *NMD = TheModule->getOrInsertNamedMetadata(NamedMD[i].first);
+    const std::vector<unsigned> &Ops = NamedMD[i].second;
+    for (unsigned j = 0, je = Ops.size(); j != je; ++j) {
+      MDNode *MD = dyn_cast_or_null<MDNode>(getMDValueFwdRef(Ops[j]));
+      if (MD == 0)
+        return Error("Malformed metadata record");
+      NMD->addOperand(MD);
+    }
+  }
+  return false;
+}
+
+/// ParseDeferredMetadata - Read the module-level metadata with the specified
+/// ID, and any deferred metadata it refers to.  Operands are read before the
+/// nodes that use them, so forward references are only needed for cycles.
+bool BitcodeReader::ParseDeferredMetadata(unsigned ID) {
+  SmallVector<unsigned, 16> Worklist;
+  DenseSet<unsigned> Visited;
+  SmallVector<uint64_t, 64> Record;
+  SmallVector<Value*, 8> Elts;
+
+  Worklist.push_back(ID);
+  while (!Worklist.empty()) {
+    unsigned NextID = Worklist.back();
+    uint64_t Bit = DeferredMetadataInfo[NextID];
+    if (!Bit) {
+      // Already read.
+      Worklist.pop_back();
+      continue;
+    }
+
+    MDCursor.JumpToBit(Bit);
+    Record.clear();
+    unsigned Code = MDCursor.ReadRecord(MDCursor.ReadCode(), Record);
+    if (Code == bitc::METADATA_STRING) {
+      SmallString<8> String(Record.begin(), Record.end());
+      MDValueList.AssignValue(MDString::get(Context, String.str()), NextID);
+      DeferredMetadataInfo[NextID] = 0;
+      Worklist.pop_back();
+      continue;
     }
+
+    if (Code != bitc::METADATA_NODE2 || Record.size() % 2 == 1)
+      return Error("Invalid METADATA_NODE2 record");
+
+    // The first time a node is seen, read the metadata it refers to first.
+    if (Visited.insert(NextID).second) {
+      bool Pushed = false;
+      for (unsigned i = 0, e = Record.size(); i != e; i += 2) {
+        unsigned OpID = Record[i+1];
+        const Type *Ty = getTypeByID(Record[i]);
+        if (Ty && Ty->isMetadataTy() && OpID < DeferredMetadataInfo.size() &&
+            DeferredMetadataInfo[OpID] && !Visited.count(OpID)) {
+          Worklist.push_back(OpID);
+          Pushed = true;
+        }
+      }
+      if (Pushed)
+        continue;
+    }
+
+    Elts.clear();
+    for (unsigned i = 0, e = Record.size(); i != e; i += 2) {
+      const Type *Ty = getTypeByID(Record[i]);
+      if (!Ty) return Error("Invalid METADATA_NODE2 record");
+      if (Ty->isMetadataTy())
+        Elts.push_back(MDValueList.getValueFwdRef(Record[i+1]));
+      else if (!Ty->isVoidTy())
+        Elts.push_back(ValueList.getValueFwdRef(Record[i+1], Ty));
+      else
+        Elts.push_back(NULL);
+    }
+    Value *V = MDNode::getWhenValsUnresolved(Context, Elts.data(), Elts.size(),
+                                             false);
+    MDValueList.AssignValue(V, NextID);
+    DeferredMetadataInfo[NextID] = 0;
+    Worklist.pop_back();
   }
+  return false;
 }
 
 /// DecodeSignRotatedValue - Decode a signed value stored with the sign bit in
@@ -1272,9 +1460,79 @@ bool BitcodeReader::RememberAndSkipFunctionBody() {
   return false;
 }
 
+/// ParseFunctionIndex - When the module has an index of its function bodies,
+/// read the location of every body from it instead of walking over each of
+/// them.  The index immediately follows the last body, so the stream is left
+/// just past all of them.
+bool BitcodeReader::ParseFunctionIndex() {
+  const BitstreamReader *Reader = Stream.getBitStreamReader();
+  if (FunctionIndexBit/8 >= uint64_t(Reader->getLastChar() -
+                                     Reader->getFirstChar()))
+    return Error("Invalid function index offset");
+
+  // The index records where each FUNCTION_BLOCK starts, but function bodies
+  // are parsed from just after their block ID, as RememberAndSkipFunctionBody
+  // records them.  FUNCTION_BLOCK_ID fits in a single VBR chunk.
+  uint64_t HeaderBits = Stream.GetAbbrevIDWidth() + bitc::BlockIDWidth;
+
+  Stream.JumpToBit(FunctionIndexBit);
+  if (Stream.ReadCode() != bitc::ENTER_SUBBLOCK ||
+      Stream.ReadSubBlockID() != bitc::FUNCTION_INDEX_BLOCK_ID ||
+      Stream.EnterSubBlock(bitc::FUNCTION_INDEX_BLOCK_ID))
+    return Error("Malformed function index");
+
+  SmallVector<uint64_t, 64> Record;
+  while (1) {
+    unsigned Code = Stream.ReadCode();
+    if (Code == bitc::END_BLOCK) {
+      if (Stream.ReadBlockEnd())
+        return Error("Error at end of function index block");
+      break;
+    }
+
+    if (Code == bitc::ENTER_SUBBLOCK) {
+      // No known subblocks, always skip them.
+      Stream.ReadSubBlockID();
+      if (Stream.SkipBlock())
+        return Error("Malformed block record");
+      continue;
+    }
+
+    if (Code == bitc::DEFINE_ABBREV) {
+      Stream.ReadAbbrevRecord();
+      continue;
+    }
+
+    // Read a record.
+    Record.clear();
+    switch (Stream.ReadRecord(Code, Record)) {
+    default: break;  // Default behavior, ignore unknown content.
+    case bitc::FNINDEX_CODE_ENTRY: { // FNINDEX_ENTRY: [valueid, offset]
+      if (Record.size() < 2 || Record[0] >= ValueList.size())
+        return Error("Invalid FNINDEX_ENTRY record");
+      Function *F = dyn_cast_or_null<Function>(ValueList[Record[0]]);
+      uint64_t Bit = ModuleBlockStart + Record[1] + HeaderBits;
+      if (!F || !DeferredFunctionInfo.insert(std::make_pair(F, Bit)).second)
+        return Error("Invalid FNINDEX_ENTRY record");
+      break;
+    }
+    }
+  }
+
+  // Every function with a body must be in the index exactly once.
+  if (DeferredFunctionInfo.size() != FunctionsWithBodies.size())
+    return Error("Function index does not match the function bodies");
+  for (unsigned i = 0, e = FunctionsWithBodies.size(); i != e; ++i)
+    if (!DeferredFunctionInfo.count(FunctionsWithBodies[i]))
+      return Error("Function index does not match the function bodies");
+  FunctionsWithBodies.clear();
+  return false;
+}
+
 bool BitcodeReader::ParseModule() {
   if (Stream.EnterSubBlock(bitc::MODULE_BLOCK_ID))
     return Error("Malformed block record");
+  ModuleBlockStart = Stream.GetCurrentBitNo();
 
   SmallVector<uint64_t, 64> Record;
   std::vector<std::string> SectionTable;
@@ -1347,10 +1605,20 @@ bool BitcodeReader::ParseModule() {
           return true;
         break;
       case bitc::METADATA_BLOCK_ID:
-        if (ParseMetadata())
+        if (LazyMetadata && DeferredMetadataInfo.empty()) {
+          if (DeferMetadata())
+            return true;
+        } else if (ParseMetadata())
           return true;
         break;
       case bitc::FUNCTION_BLOCK_ID:
+        // If the bodies are indexed, skip all of them at once.
+        if (FunctionIndexBit) {
+          if (ParseFunctionIndex())
+            return true;
+          break;
+        }
+
         // If this is the first function body we've seen, reverse the
         // FunctionsWithBodies list.
         if (!HasReversedFunctionsWithBodies) {
@@ -1544,6 +1812,15 @@ bool BitcodeReader::ParseModule() {
         return Error("Invalid MODULE_PURGEVALS record");
       ValueList.shrinkTo(Record[0]);
       break;
+    /// MODULE_CODE_FNINDEX: [blob of the 32-bit word offset]
+    case bitc::MODULE_CODE_FNINDEX: {
+      if (Record.size() != 4)
+        return Error("Invalid MODULE_CODE_FNINDEX record");
+      uint64_t IndexWord = Record[0] | (Record[1] << 8) | (Record[2] << 16) |
+                           (Record[3] << 24);
+      FunctionIndexBit = ModuleBlockStart + IndexWord*32;
+      break;
+    }
     }
     Record.clear();
   }
@@ -1758,8 +2035,10 @@ bool BitcodeReader::ParseMetadataAttachment() {
           MDKindMap.find(Kind);
         if (I == MDKindMap.end())
           return Error("Invalid metadata kind ID");
-        Value *Node = MDValueList.getValueFwdRef(Record[i+1]);
-        Inst->setMetadata(I->second, cast<MDNode>(Node));
+        MDNode *Node = dyn_cast_or_null<MDNode>(getMDValueFwdRef(Record[i+1]));
+        if (!Node)
+          return Error("Invalid METADATA_ATTACHMENT record");
+        Inst->setMetadata(I->second, Node);
       }
       break;
     }
@@ -1877,8 +2156,12 @@ bool BitcodeReader::ParseFunctionBody(Function *F) {
       unsigned ScopeID = Record[2], IAID = Record[3];
       
       MDNode *Scope = 0, *IA = 0;
-      if (ScopeID) Scope = cast<MDNode>(MDValueList.getValueFwdRef(ScopeID-1));
-      if (IAID)    IA = cast<MDNode>(MDValueList.getValueFwdRef(IAID-1));
+      if (ScopeID)
+        Scope = dyn_cast_or_null<MDNode>(getMDValueFwdRef(ScopeID-1));
+      if (IAID)
+        IA = dyn_cast_or_null<MDNode>(getMDValueFwdRef(IAID-1));
+      if ((ScopeID && !Scope) || (IAID && !IA))
+        return Error("Invalid FUNC_CODE_DEBUG_LOC record");
       LastLoc = DebugLoc::get(Line, Col, Scope, IA);
       I->setDebugLoc(LastLoc);
       I = 0;
@@ -2625,13 +2908,13 @@ bool BitcodeReader::MaterializeModule(Module *M, std::string *ErrInfo) {
 // External interface
 //===----------------------------------------------------------------------===//
 
-/// getLazyBitcodeModule - lazy function-at-a-time loading from a file.
-///
-Module *llvm::getLazyBitcodeModule(MemoryBuffer *Buffer,
-                                   LLVMContext& Context,
-                                   std::string *ErrMsg) {
+/// getBitcodeModule - Read the header of the specified bitcode buffer.  If
+/// LazyMetadata is true, module-level metadata is read as it is used, just
+/// like function bodies.
+static Module *getBitcodeModule(MemoryBuffer *Buffer, LLVMContext& Context,
+                                bool LazyMetadata, std::string *ErrMsg) {
   Module *M = new Module(Buffer->getBufferIdentifier(), Context);
-  BitcodeReader *R = new BitcodeReader(Buffer, Context);
+  BitcodeReader *R = new BitcodeReader(Buffer, Context, LazyMetadata);
   M->setMaterializer(R);
   if (R->ParseBitcodeInto(M)) {
     if (ErrMsg)
@@ -2645,11 +2928,20 @@ Module *llvm::getLazyBitcodeModule(MemoryBuffer *Buffer,
   return M;
 }
 
+/// getLazyBitcodeModule - lazy function-at-a-time loading from a file.
+///
+Module *llvm::getLazyBitcodeModule(MemoryBuffer *Buffer,
+                                   LLVMContext& Context,
+                                   std::string *ErrMsg) {
+  return getBitcodeModule(Buffer, Context, !DisableLazyMetadata, ErrMsg);
+}
+
 /// ParseBitcodeFile - Read the specified bitcode file, returning the module.
 /// If an error occurs, return null and fill in *ErrMsg if non-null.
 Module *llvm::ParseBitcodeFile(MemoryBuffer *Buffer, LLVMContext& Context,
                                std::string *ErrMsg){
-  Module *M = getLazyBitcodeModule(Buffer, Context, ErrMsg);
+  // Everything is about to be read, so there is no point deferring metadata.
+  Module *M = getBitcodeModule(Buffer, Context, false, ErrMsg);
   if (!M) return 0;
 
   // Don't let the BitcodeReader dtor delete 'Buffer', regardless of whether
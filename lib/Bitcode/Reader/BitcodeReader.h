@@ -159,6 +159,19 @@ class BitcodeReader : public GVMaterializer {
 
   // Map the bitcode's custom MDKind ID to the Module's MDKind ID.
   DenseMap<unsigned, unsigned> MDKindMap;
+
+  /// LazyMetadata - If true, the records of the module-level METADATA_BLOCK
+  /// are only read when the metadata they describe is first used.
+  bool LazyMetadata;
+
+  /// DeferredMetadataInfo - When module-level metadata is read lazily, this
+  /// holds the bit at which the record for each metadata ID starts, or zero
+  /// once the metadata has been read.
+  std::vector<uint64_t> DeferredMetadataInfo;
+
+  /// MDCursor - The cursor deferred metadata is read with.  It is left in the
+  /// module-level METADATA_BLOCK, so it has all of the block's abbreviations.
+  BitstreamCursor MDCursor;
   
   // After the module header has been read, the FunctionsWithBodies list is 
   // reversed.  This keeps track of whether we've done this yet.
@@ -168,6 +181,14 @@ class BitcodeReader : public GVMaterializer {
   /// map contains info about where to find deferred function body in the
   /// stream.
   DenseMap<Function*, uint64_t> DeferredFunctionInfo;
+
+  /// ModuleBlockStart - The bit at which the contents of the module block
+  /// start.  Offsets in the function index are relative to this.
+  uint64_t ModuleBlockStart;
+
+  /// FunctionIndexBit - The bit at which the FUNCTION_INDEX block starts, or
+  /// zero if the module has no function index.
+  uint64_t FunctionIndexBit;
   
   /// BlockAddrFwdRefs - These are blockaddr references to basic blocks.  These
   /// are resolved lazily when functions are loaded.
@@ -181,9 +202,11 @@ class BitcodeReader : public GVMaterializer {
   bool LLVM2_7MetadataDetected;
   
 public:
-  explicit BitcodeReader(MemoryBuffer *buffer, LLVMContext &C)
+  explicit BitcodeReader(MemoryBuffer *buffer, LLVMContext &C,
+                         bool lazyMetadata = false)
     : Context(C), TheModule(0), Buffer(buffer), BufferOwned(false),
       ErrorString(0), ValueList(C), MDValueList(C),
+      LazyMetadata(lazyMetadata), ModuleBlockStart(0), FunctionIndexBit(0),
       LLVM2_7MetadataDetected(false) {
     HasReversedFunctionsWithBodies = false;
   }
@@ -218,9 +241,15 @@ public:
   bool ParseTriple(std::string &Triple);
 private:
   const Type *getTypeByID(unsigned ID, bool isTypeTable = false);
+  Value *getMDValueFwdRef(unsigned ID) {
+    if (ID < DeferredMetadataInfo.size() && DeferredMetadataInfo[ID] &&
+        ParseDeferredMetadata(ID))
+      return 0;
+    return MDValueList.getValueFwdRef(ID);
+  }
   Value *getFnValueByID(unsigned ID, const Type *Ty) {
     if (Ty == Type::getMetadataTy(Context))
-      return MDValueList.getValueFwdRef(ID);
+      return getMDValueFwdRef(ID);
     else
       return ValueList.getValueFwdRef(ID, Ty);
   }
@@ -270,9 +299,13 @@ private:
   bool ParseValueSymbolTable();
   bool ParseConstants();
   bool RememberAndSkipFunctionBody();
+  bool ParseFunctionIndex();
   bool ParseFunctionBody(Function *F);
   bool ResolveGlobalAndAliasInits();
   bool ParseMetadata();
+  bool ParseMetadataKind(SmallVectorImpl<uint64_t> &Record);
+  bool DeferMetadata();
+  bool ParseDeferredMetadata(unsigned ID);
   bool ParseMetadataAttachment();
   bool ParseModuleTriple(std::string &Triple);
 };
@@ -23,13 +23,39 @@
 #include "llvm/Operator.h"
 #include "llvm/TypeSymbolTable.h"
 #include "llvm/ValueSymbolTable.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/MathExtras.h"
+#include "llvm/Support/Mutex.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/Program.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
+#include <algorithm>
 #include <cctype>
+#include <deque>
 using namespace llvm;
 
+static cl::opt<bool>
+DisableFunctionIndex("disable-bitcode-function-index", cl::Hidden,
+  cl::desc("Do not emit the index of function bodies in bitcode files"));
+
+static cl::opt<bool>
+DisableStreaming("disable-bitcode-streaming", cl::Hidden,
+  cl::desc("Build the whole bitcode file in memory before writing it out"));
+
+static cl::opt<unsigned>
+FlushThreshold("bitcode-flush-threshold", cl::Hidden, cl::init(512*1024),
+  cl::desc("Write bitcode out to the file whenever a block is closed with "
+           "at least this many bytes buffered"));
+
+unsigned llvm::BitcodeWriteThreads = 1;
+static cl::opt<unsigned, true>
+WriteThreads("bitcode-write-threads", cl::Hidden,
+             cl::location(BitcodeWriteThreads),
+             cl::desc("Number of threads the bitcode writer encodes function "
+                      "bodies on (0: one per processor)"));
+
 /// These are manifest constants used by the bitcode writer. They do not need to
 /// be kept in sync with the reader, but need to be consistent within this file.
 enum {
@@ -1277,6 +1303,143 @@ static void WriteFunction(const Function &F, ValueEnumerator &VE,
   Stream.ExitBlock();
 }
 
+namespace {
+/// EnumeratorPool - Copies of the module's ValueEnumerator for the tasks of a
+/// concurrent WriteModule.  Encoding a function body numbers the function's
+/// values in the enumerator, so each task that is running needs its own.
+class EnumeratorPool {
+  const ValueEnumerator &ModuleVE;
+  sys::Mutex Lock;
+  std::vector<ValueEnumerator*> Free;
+public:
+  explicit EnumeratorPool(const ValueEnumerator &VE) : ModuleVE(VE) {}
+  ~EnumeratorPool() {
+    for (unsigned i = 0, e = Free.size(); i != e; ++i)
+      delete Free[i];
+  }
+
+  /// get - Take an enumerator that no other task is using, copying the
+  /// module's if there are none to spare.
+  ValueEnumerator *get() {
+    {
+      sys::ScopedLock Guard(Lock);
+      if (!Free.empty()) {
+        ValueEnumerator *VE = Free.back();
+        Free.pop_back();
+        return VE;
+      }
+    }
+    return new ValueEnumerator(ModuleVE);
+  }
+
+  /// put - Give back an enumerator taken with get.
+  void put(ValueEnumerator *VE) {
+    sys::ScopedLock Guard(Lock);
+    Free.push_back(VE);
+  }
+};
+
+/// FunctionRange - A range of functions that one task of a concurrent
+/// WriteModule encodes into a buffer of its own.
+struct FunctionRange {
+  Module::const_iterator Begin, End;
+  std::vector<unsigned char> Buffer;
+  BitstreamWriter Stream;
+  /// Offsets - The value ID of each function body in the range, and the bit
+  /// of Buffer at which its block starts.
+  std::vector<std::pair<unsigned, uint64_t> > Offsets;
+  EnumeratorPool &Enumerators;
+  TaskGroup Group;
+
+  FunctionRange(Module::const_iterator B, Module::const_iterator E,
+                const BitstreamWriter &Parent, EnumeratorPool &EP,
+                ThreadPool &Pool)
+    : Begin(B), End(E), Stream(Buffer, Parent), Enumerators(EP), Group(Pool) {}
+
+  static void encode(void *Arg) {
+    FunctionRange *R = static_cast<FunctionRange*>(Arg);
+    ValueEnumerator *VE = R->Enumerators.get();
+    for (Module::const_iterator I = R->Begin; I != R->End; ++I)
+      if (!I->isDeclaration()) {
+        R->Offsets.push_back(std::make_pair(VE->getValueID(I),
+                                            R->Stream.GetCurrentBitNo()));
+        WriteFunction(*I, *VE, R->Stream);
+      }
+    R->Enumerators.put(VE);
+  }
+};
+}  // end of anonymous namespace
+
+/// GetFunctionSize - Return the amount of work encoding F takes, counted in
+/// instructions.
+static unsigned GetFunctionSize(const Function &F) {
+  unsigned Size = 1;
+  for (Function::const_iterator BB = F.begin(), E = F.end(); BB != E; ++BB)
+    Size += BB->size();
+  return Size;
+}
+
+/// WriteFunctionsConcurrently - Emit the function bodies of M on NumThreads
+/// threads, adding the value ID and offset from ModuleStart of each to
+/// Offsets.  Return false without emitting anything if that can't be done.
+static bool
+WriteFunctionsConcurrently(const Module *M, const ValueEnumerator &VE,
+                           uint64_t ModuleStart,
+                           std::vector<std::pair<unsigned, uint64_t> > &Offsets,
+                           BitstreamWriter &Stream, unsigned NumThreads) {
+  unsigned NumDefined = 0;
+  uint64_t TotalSize = 0;
+  for (Module::const_iterator I = M->begin(), E = M->end(); I != E; ++I)
+    if (!I->isDeclaration()) {
+      ++NumDefined;
+      TotalSize += GetFunctionSize(*I);
+    }
+  if (NumDefined < 2)
+    return false;
+
+  // Function blocks encoded on their own start at a word boundary, so they
+  // can only be appended to the stream at one.  The stream is at one unless
+  // the function index is disabled and only records precede the bodies.
+  if (Stream.GetCurrentBitNo() % 32)
+    return false;
+  // Turning multithreading on is up to the program, since it changes how
+  // every lock in the libraries behaves.
+  if (!llvm_is_multithreaded())
+    return false;
+
+  // Cut the functions into ranges of about RangeSize instructions and encode
+  // a few ranges per thread ahead of the one being appended to the stream.
+  // That keeps the threads busy while bounding the bitcode held in buffers.
+  unsigned RangeSize =
+    unsigned(std::min(TotalSize / (NumThreads * 4) + 1, uint64_t(8192)));
+  EnumeratorPool Enumerators(VE);
+  ThreadPool Pool(NumThreads - 1);
+  std::deque<FunctionRange*> Ranges;
+  Module::const_iterator I = M->begin(), E = M->end();
+  while (I != E || !Ranges.empty()) {
+    if (I != E && Ranges.size() < NumThreads * 2) {
+      Module::const_iterator Begin = I;
+      for (unsigned Size = 0; I != E && Size < RangeSize; ++I)
+        if (!I->isDeclaration())
+          Size += GetFunctionSize(*I);
+      Ranges.push_back(new FunctionRange(Begin, I, Stream, Enumerators, Pool));
+      Ranges.back()->Group.spawn(FunctionRange::encode, Ranges.back());
+      continue;
+    }
+
+    FunctionRange *R = Ranges.front();
+    Ranges.pop_front();
+    R->Group.wait();
+    uint64_t RangeStart = Stream.GetCurrentBitNo() - ModuleStart;
+    for (unsigned i = 0, e = R->Offsets.size(); i != e; ++i)
+      Offsets.push_back(std::make_pair(R->Offsets[i].first,
+                                       RangeStart + R->Offsets[i].second));
+    Stream.AppendWords(R->Buffer);
+    delete R;
+  }
+  return true;
+}
+
 /// WriteTypeSymbolTable - Emit a block for the specified type symtab.
 static void WriteTypeSymbolTable(const TypeSymbolTable &TST,
                                  const ValueEnumerator &VE,
@@ -1479,9 +1642,61 @@ static void WriteBlockInfo(const ValueEnumerator &VE, BitstreamWriter &Stream) {
 }
 
 
+/// WriteFunctionIndexOffset - Emit a MODULE_CODE_FNINDEX record with a
+/// placeholder offset, and return the byte at which the offset starts so that
+/// it can be filled in once the function index has been written.  The offset
+/// is a blob so that it is word aligned, and can be patched like the size of
+/// a block even after it has been written out to the file.
+static uint64_t WriteFunctionIndexOffset(BitstreamWriter &Stream) {
+  BitCodeAbbrev *Abbv = new BitCodeAbbrev();
+  Abbv->Add(BitCodeAbbrevOp(bitc::MODULE_CODE_FNINDEX));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Blob));
+  unsigned FnIndexAbbrev = Stream.EmitAbbrev(Abbv);
+
+  SmallVector<unsigned, 1> Vals;
+  Vals.push_back(bitc::MODULE_CODE_FNINDEX);
+  Stream.EmitRecordWithBlob(FnIndexAbbrev, Vals, StringRef("\0\0\0\0", 4));
+  return Stream.GetCurrentBitNo()/8 - 4;
+}
+
+/// WriteFunctionIndex - Emit the offset of each function body, relative to
+/// ModuleStart, and patch the location of the index into the record emitted
+/// by WriteFunctionIndexOffset.  This must immediately follow the last
+/// function body, because the reader skips straight from the first body to
+/// the index.
+static void
+WriteFunctionIndex(const std::vector<std::pair<unsigned, uint64_t> > &Offsets,
+                   uint64_t ModuleStart, uint64_t OffsetByte,
+                   BitstreamWriter &Stream) {
+  uint64_t IndexWord = (Stream.GetCurrentBitNo() - ModuleStart) / 32;
+  assert(Stream.GetCurrentBitNo() % 32 == 0 &&
+         "Function index is not word aligned!");
+  assert(IndexWord == (uint32_t)IndexWord && "Module too large to index!");
+  Stream.BackpatchWord(OffsetByte, (unsigned)IndexWord);
+
+  Stream.EnterSubblock(bitc::FUNCTION_INDEX_BLOCK_ID, 3);
+
+  BitCodeAbbrev *Abbv = new BitCodeAbbrev();
+  Abbv->Add(BitCodeAbbrevOp(bitc::FNINDEX_CODE_ENTRY));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 6));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 8));
+  unsigned EntryAbbrev = Stream.EmitAbbrev(Abbv);
+
+  SmallVector<uint64_t, 2> Vals;
+  for (unsigned i = 0, e = Offsets.size(); i != e; ++i) {
+    Vals.push_back(Offsets[i].first);
+    Vals.push_back(Offsets[i].second);
+    Stream.EmitRecord(bitc::FNINDEX_CODE_ENTRY, Vals, EntryAbbrev);
+    Vals.clear();
+  }
+
+  Stream.ExitBlock();
+}
+
 /// WriteModule - Emit the specified module to the bitstream.
 static void WriteModule(const Module *M, BitstreamWriter &Stream) {
   Stream.EnterSubblock(bitc::MODULE_BLOCK_ID, 3);
+  uint64_t ModuleStart = Stream.GetCurrentBitNo();
 
   // Emit the version number if it is non-zero.
   if (CurVersion) {
@@ -1512,10 +1727,32 @@ static void WriteModule(const Module *M, BitstreamWriter &Stream) {
   // Emit metadata.
   WriteModuleMetadata(M, VE, Stream);
 
-  // Emit function bodies.
+  // Emit function bodies, remembering where each one starts so that readers
+  // can find them without walking over all of the others.
+  std::vector<std::pair<unsigned, uint64_t> > FunctionOffsets;
+  uint64_t FnIndexOffsetByte = 0;
   for (Module::const_iterator I = M->begin(), E = M->end(); I != E; ++I)
-    if (!I->isDeclaration())
-      WriteFunction(*I, VE, Stream);
+    if (!I->isDeclaration()) {
+      if (!DisableFunctionIndex)
+        FnIndexOffsetByte = WriteFunctionIndexOffset(Stream);
+      break;
+    }
+
+  unsigned NumThreads = BitcodeWriteThreads;
+  if (NumThreads == 0)
+    NumThreads = ThreadPool::getDefaultNumThreads();
+  if (NumThreads < 2 ||
+      !WriteFunctionsConcurrently(M, VE, ModuleStart, FunctionOffsets, Stream,
+                                  NumThreads))
+    for (Module::const_iterator I = M->begin(), E = M->end(); I != E; ++I)
+      if (!I->isDeclaration()) {
+        FunctionOffsets.push_back(std::make_pair(VE.getValueID(I),
+                                     Stream.GetCurrentBitNo() - ModuleStart));
+        WriteFunction(*I, VE, Stream);
+      }
+
+  if (FnIndexOffsetByte)
+    WriteFunctionIndex(FunctionOffsets, ModuleStart, FnIndexOffsetByte, Stream);
 
   // Emit metadata.
   WriteModuleMetadataStore(M, Stream);
@@ -1618,9 +1855,10 @@ static void EmitDarwinBCHeader(BitstreamWriter &Stream,
 
 /// EmitDarwinBCTrailer - Emit the darwin epilog after the bitcode file and
 /// finalize the header.
-static void EmitDarwinBCTrailer(BitstreamWriter &Stream, unsigned BufferSize) {
+static void EmitDarwinBCTrailer(BitstreamWriter &Stream, uint64_t BufferSize) {
   // Update the size field in the header.
-  Stream.BackpatchWord(DarwinBCSizeFieldOffset, BufferSize-DarwinBCHeaderSize);
+  Stream.BackpatchWord(DarwinBCSizeFieldOffset,
+                       unsigned(BufferSize-DarwinBCHeaderSize));
 
   // If the file is not a multiple of 16 bytes, insert dummy padding.
   while (BufferSize & 15) {
@@ -1644,6 +1882,24 @@ void llvm::WriteBitcodeToFile(const Module *M, raw_ostream &Out) {
   Out.write((char*)&Buffer.front(), Buffer.size());
 }
 
+/// WriteBitcodeToFile - Write the specified module to the specified file.  If
+/// the file supports seeking, the bitcode is written out as it is produced,
+/// so that only the blocks that are still open are held in memory.
+void llvm::WriteBitcodeToFile(const Module *M, raw_fd_ostream &Out) {
+  if (DisableStreaming || !Out.supportsSeeking())
+    return WriteBitcodeToFile(M, static_cast<raw_ostream&>(Out));
+
+  std::vector<unsigned char> Buffer;
+  BitstreamWriter Stream(Buffer, Out, FlushThreshold);
+
+  Buffer.reserve(256*1024);
+
+  WriteBitcodeToStream(M, Stream);
+
+  // Write out whatever is left after the last block was closed.
+  Stream.FlushToFile();
+}
+
 /// WriteBitcodeToStream - Write the specified module to the specified output
 /// stream.
 void llvm::WriteBitcodeToStream(const Module *M, BitstreamWriter &Stream) {
@@ -1667,5 +1923,5 @@ void llvm::WriteBitcodeToStream(const Module *M, BitstreamWriter &Stream) {
   WriteModule(M, Stream);
 
   if (isMacho)
-    EmitDarwinBCTrailer(Stream, Stream.getBuffer().size());
+    EmitDarwinBCTrailer(Stream, Stream.GetCurrentBitNo()/8);
 }
@@ -134,6 +134,18 @@ ValueEnumerator::ValueEnumerator(const Module *M) {
     TypeMap[Types[i].first] = i+1;
 }
 
+ValueEnumerator::ValueEnumerator(const ValueEnumerator &E)
+  : TypeMap(E.TypeMap), Types(E.Types), ValueMap(E.ValueMap),
+    Values(E.Values), MDValues(E.MDValues), MDValueMap(E.MDValueMap),
+    AttributeMap(E.AttributeMap), Attributes(E.Attributes),
+    GlobalBasicBlockIDs(E.GlobalBasicBlockIDs),
+    InstructionMap(E.InstructionMap), InstructionCount(E.InstructionCount),
+    NumModuleValues(E.NumModuleValues), NumModuleMDValues(E.NumModuleMDValues),
+    FirstFuncConstantID(E.FirstFuncConstantID), FirstInstID(E.FirstInstID) {
+  assert(E.BasicBlocks.empty() && E.FunctionLocalMDs.empty() &&
+         "Copying a ValueEnumerator with a function incorporated!");
+}
+
 unsigned ValueEnumerator::getInstructionID(const Instruction *Inst) const {
   InstructionMapType::const_iterator I = InstructionMap.find(Inst);
   assert (I != InstructionMap.end() && "Instruction is not mapped!");
@@ -80,11 +80,15 @@ private:
   unsigned FirstFuncConstantID;
   unsigned FirstInstID;
   
-  ValueEnumerator(const ValueEnumerator &);  // DO NOT IMPLEMENT
   void operator=(const ValueEnumerator &);   // DO NOT IMPLEMENT
 public:
   ValueEnumerator(const Module *M);
 
+  /// ValueEnumerator copy ctor - Copy the numbering of E, which must not have
+  /// a function incorporated.  Function bodies can be encoded on several
+  /// threads at once by giving each thread its own copy.
+  ValueEnumerator(const ValueEnumerator &E);
+
   unsigned getValueID(const Value *V) const;
 
   unsigned getTypeID(const Type *T) const {
@@ -336,7 +336,7 @@ unsigned RegScavenger::scavengeRegister(const TargetRegisterClass *RC,
 
   // Try to find a register that's unused if there is one, as then we won't
   // have to spill.
-  if ((Candidates & RegsAvailable).any())
+  if (Candidates.anyCommon(RegsAvailable))
      Candidates &= RegsAvailable;
 
   // Find the register whose use is furthest away.
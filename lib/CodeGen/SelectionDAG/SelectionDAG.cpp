@@ -11,6 +11,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#define DEBUG_TYPE "selectiondag"
 #include "llvm/CodeGen/SelectionDAG.h"
 #include "SDNodeOrdering.h"
 #include "SDNodeDbgValue.h"
@@ -42,8 +43,10 @@
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/MathExtras.h"
+#include "llvm/Support/Memory.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/Mutex.h"
+#include "llvm/Support/ThreadLocalAllocator.h"
 #include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallSet.h"
@@ -828,11 +831,24 @@ unsigned SelectionDAG::getEVTAlignment(EVT VT) const {
   return TLI.getTargetData()->getABITypeAlignment(Ty);
 }
 
+ALLOCATOR_STATISTICS(NodeAllocatorStats, "SDNodes");
+
+/// getNodeSlabSize - Use slabs of one large page, or 64K if the host does not
+/// have large pages.
+static size_t getNodeSlabSize() {
+  if (size_t LargePageSize = sys::Memory::getLargePageSize())
+    return LargePageSize;
+  return 64 * 1024;
+}
+
 // EntryNode could meaningfully have debug info if we can find it...
 SelectionDAG::SelectionDAG(const TargetMachine &tm)
   : TM(tm), TLI(*tm.getTargetLowering()), TSI(*tm.getSelectionDAGInfo()),
     EntryNode(ISD::EntryToken, DebugLoc(), getVTList(MVT::Other)),
-    Root(getEntryNode()), Ordering(0) {
+    Root(getEntryNode()),
+    NodeAllocator(getNodeSlabSize(), getNodeSlabSize(), NodeSlabAllocator,
+                  &NodeAllocatorStats),
+    Ordering(0) {
   AllNodes.push_back(&EntryNode);
   Ordering = new SDNodeOrdering();
   DbgInfo = new SDDbgInfo();
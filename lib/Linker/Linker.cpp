@@ -100,7 +100,8 @@ Linker::LoadObject(const sys::Path &FN) {
   Module *Result = 0;
 
   OwningPtr<MemoryBuffer> Buffer;
-  if (error_code ec = MemoryBuffer::getFileOrSTDIN(FN.c_str(), Buffer))
+  if (error_code ec = MemoryBuffer::getFileOrSTDIN(FN.c_str(), Buffer, -1,
+                                              MemoryBuffer::SequentialAccess))
     ParseErrorMessage = "Error reading file '" + FN.str() + "'" + ": "
                       + ec.message();
   else
@@ -107,9 +107,8 @@ MCSymbol *MCContext::GetOrCreateSymbol(const Twine &Name) {
 
 MCSymbol *MCContext::CreateTempSymbol() {
   SmallString<128> NameSV;
-  Twine Name = Twine(MAI.getPrivateGlobalPrefix()) + "tmp" +
-    Twine(NextUniqueID++);
-  Name.toVector(NameSV);
+  (Twine(MAI.getPrivateGlobalPrefix()) + "tmp" +
+   Twine(NextUniqueID++)).toVector(NameSV);
   return CreateSymbol(NameSV);
 }
 
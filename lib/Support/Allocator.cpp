@@ -11,24 +11,59 @@
 //
 //===----------------------------------------------------------------------===//
 
+#define DEBUG_TYPE "allocator"
 #include "llvm/Support/Allocator.h"
+#include "llvm/Support/ThreadLocalAllocator.h"
 #include "llvm/Support/DataTypes.h"
+#include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/Recycler.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/Memory.h"
 #include <cstring>
 
+STATISTIC(NumMmapSlabs, "Number of slabs mapped from the operating system");
+STATISTIC(NumLargePageSlabs, "Number of slabs mapped with large pages");
+ALLOCATOR_STATISTICS(TotalStats, "all bump pointer allocators");
+
 namespace llvm {
 
 BumpPtrAllocator::BumpPtrAllocator(size_t size, size_t threshold,
-                                   SlabAllocator &allocator)
+                                   SlabAllocator &allocator,
+                                   AllocatorStatistics *stats)
     : SlabSize(size), SizeThreshold(threshold), Allocator(allocator),
-      CurSlab(0), BytesAllocated(0) { }
+      CurSlab(0), BytesAllocated(0), BytesReserved(0), BytesWasted(0),
+      Stats(stats) {
+  ReportedKB[0] = ReportedKB[1] = ReportedKB[2] = 0;
+}
 
 BumpPtrAllocator::~BumpPtrAllocator() {
+  if (CurSlab) {
+    BytesWasted += End - CurPtr;
+    UpdateStatistics();
+  }
   DeallocateSlabs(CurSlab);
 }
 
+/// UpdateStatistics - Add what this allocator did since the last call to the
+/// -stats counters.
+void BumpPtrAllocator::UpdateStatistics() {
+  size_t KB[3] = {
+    BytesReserved / 1024, BytesAllocated / 1024, BytesWasted / 1024
+  };
+  unsigned Delta[3];
+  for (unsigned i = 0; i != 3; ++i) {
+    Delta[i] = unsigned(KB[i] - ReportedKB[i]);
+    ReportedKB[i] = KB[i];
+  }
+
+  AllocatorStatistics *Targets[2] = { &TotalStats, Stats };
+  for (unsigned i = 0; i != 2 && Targets[i]; ++i) {
+    if (Delta[0]) Targets[i]->KBReserved += Delta[0];
+    if (Delta[1]) Targets[i]->KBUsed += Delta[1];
+    if (Delta[2]) Targets[i]->KBWasted += Delta[2];
+  }
+}
+
 /// AlignPtr - Align Ptr to Alignment bytes, rounding up.  Alignment should
 /// be a power of two.  This method rounds up, so AlignPtr(7, 4) == 8 and
 /// AlignPtr(8, 4) == 8.
@@ -51,6 +86,14 @@ void BumpPtrAllocator::StartNewSlab() {
     SlabSize *= 2;
 
   MemSlab *NewSlab = Allocator.Allocate(SlabSize);
+  if (CurSlab)
+    BytesWasted += End - CurPtr;
+  BytesReserved += NewSlab->Size;
+  ++TotalStats.NumSlabs;
+  if (Stats)
+    ++Stats->NumSlabs;
+  UpdateStatistics();
+
   NewSlab->NextPtr = CurSlab;
   CurSlab = NewSlab;
   CurPtr = (char*)(CurSlab + 1);
@@ -78,6 +121,8 @@ void BumpPtrAllocator::DeallocateSlabs(MemSlab *Slab) {
 void BumpPtrAllocator::Reset() {
   if (!CurSlab)
     return;
+  BytesWasted += End - CurPtr;
+  UpdateStatistics();
   DeallocateSlabs(CurSlab->NextPtr);
   CurSlab->NextPtr = 0;
   CurPtr = (char*)(CurSlab + 1);
@@ -109,6 +154,12 @@ void *BumpPtrAllocator::Allocate(size_t Size, size_t Alignment) {
   size_t PaddedSize = Size + sizeof(MemSlab) + Alignment - 1;
   if (PaddedSize > SizeThreshold) {
     MemSlab *NewSlab = Allocator.Allocate(PaddedSize);
+    BytesReserved += NewSlab->Size;
+    BytesWasted += NewSlab->Size - sizeof(MemSlab) - Size;
+    ++TotalStats.NumSlabs;
+    if (Stats)
+      ++Stats->NumSlabs;
+    UpdateStatistics();
 
     // Put the new slab after the current slab, since we are not allocating
     // into it.
@@ -148,7 +199,8 @@ void BumpPtrAllocator::PrintStats() const {
          << "Bytes used: " << BytesAllocated << '\n'
          << "Bytes allocated: " << TotalMemory << '\n'
          << "Bytes wasted: " << (TotalMemory - BytesAllocated)
-         << " (includes alignment, etc)\n";
+         << " (includes alignment, etc)\n"
+         << "Bytes reserved over lifetime: " << BytesReserved << '\n';
 }
 
 MallocSlabAllocator BumpPtrAllocator::DefaultSlabAllocator =
@@ -169,6 +221,76 @@ void MallocSlabAllocator::Deallocate(MemSlab *Slab) {
   Allocator.Deallocate(Slab);
 }
 
+MmapSlabAllocator::~MmapSlabAllocator() { }
+
+MemSlab *MmapSlabAllocator::Allocate(size_t Size) {
+  bool LargePages = UseLargePages && sys::Memory::getLargePageSize() &&
+                    Size >= sys::Memory::getLargePageSize();
+  std::string ErrMsg;
+  sys::MemoryBlock Block = sys::Memory::AllocateRW(Size, LargePages, &ErrMsg);
+  if (Block.base() == 0)
+    report_fatal_error("Unable to allocate slab: " + ErrMsg);
+  ++NumMmapSlabs;
+  if (LargePages)
+    ++NumLargePageSlabs;
+
+  // The block is rounded up to whole pages; let the bump allocator use all
+  // of it.
+  MemSlab *Slab = (MemSlab*)Block.base();
+  Slab->Size = Block.size();
+  Slab->NextPtr = 0;
+  return Slab;
+}
+
+void MmapSlabAllocator::Deallocate(MemSlab *Slab) {
+  sys::MemoryBlock Block(Slab, Slab->Size);
+  sys::Memory::ReleaseRW(Block);
+}
+
+ThreadLocalBumpPtrAllocator::ThreadLocalBumpPtrAllocator(size_t size,
+                                                         size_t threshold,
+                                                     SlabAllocator &allocator,
+                                                     AllocatorStatistics *stats)
+  : SlabSize(size), SizeThreshold(threshold), Allocator(allocator),
+    Stats(stats) { }
+
+ThreadLocalBumpPtrAllocator::~ThreadLocalBumpPtrAllocator() {
+  for (unsigned i = 0, e = Allocators.size(); i != e; ++i)
+    delete Allocators[i];
+}
+
+BumpPtrAllocator &ThreadLocalBumpPtrAllocator::createThreadAllocator() {
+  BumpPtrAllocator *A = new BumpPtrAllocator(SlabSize, SizeThreshold,
+                                             Allocator, Stats);
+  {
+    sys::ScopedLock Guard(Lock);
+    Allocators.push_back(A);
+  }
+  Current.set(A);
+  return *A;
+}
+
+void ThreadLocalBumpPtrAllocator::Reset() {
+  sys::ScopedLock Guard(Lock);
+  for (unsigned i = 0, e = Allocators.size(); i != e; ++i)
+    Allocators[i]->Reset();
+}
+
+size_t ThreadLocalBumpPtrAllocator::getBytesAllocated() {
+  sys::ScopedLock Guard(Lock);
+  size_t Bytes = 0;
+  for (unsigned i = 0, e = Allocators.size(); i != e; ++i)
+    Bytes += Allocators[i]->getBytesAllocated();
+  return Bytes;
+}
+
+void ThreadLocalBumpPtrAllocator::PrintStats() {
+  sys::ScopedLock Guard(Lock);
+  errs() << "\nNumber of thread allocators: " << Allocators.size() << '\n';
+  for (unsigned i = 0, e = Allocators.size(); i != e; ++i)
+    Allocators[i]->PrintStats();
+}
+
 void PrintRecyclerStats(size_t Size,
                         size_t Align,
                         size_t FreeListSize) {
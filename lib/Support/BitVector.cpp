@@ -0,0 +1,63 @@
+//===- lib/Support/BitVector.cpp - Bit vectors ----------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the out of line parts of the BitVector class.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Host.h"
+using namespace llvm;
+
+typedef unsigned (*CountWordsFn)(const unsigned long *Words,
+                                 unsigned NumWords);
+
+static unsigned CountWordsGeneric(const unsigned long *Words,
+                                  unsigned NumWords) {
+  unsigned NumBits = 0;
+  for (unsigned i = 0; i != NumWords; ++i)
+    if (sizeof(unsigned long) == 4)
+      NumBits += CountPopulation_32((uint32_t)Words[i]);
+    else
+      NumBits += CountPopulation_64(Words[i]);
+  return NumBits;
+}
+
+// Without -mpopcnt, __builtin_popcount is a library call that counts with a
+// table.  GCC can compile a single function for a newer CPU, so build a popcnt
+// version and use it when the host supports the instruction.
+#if defined(__GNUC__) && !defined(__clang__) && \
+    (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 4)) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define LLVM_BITVECTOR_POPCNT_DISPATCH 1
+
+__attribute__((target("popcnt")))
+static unsigned CountWordsPOPCNT(const unsigned long *Words,
+                                 unsigned NumWords) {
+  unsigned NumBits = 0;
+  for (unsigned i = 0; i != NumWords; ++i)
+    NumBits += __builtin_popcountl(Words[i]);
+  return NumBits;
+}
+#endif
+
+static CountWordsFn SelectCountWords() {
+#ifdef LLVM_BITVECTOR_POPCNT_DISPATCH
+  StringMap<bool> Features;
+  if (sys::getHostCPUFeatures(Features) && Features.lookup("popcnt"))
+    return CountWordsPOPCNT;
+#endif
+  return CountWordsGeneric;
+}
+
+unsigned BitVector::count_words(const BitWord *Words, unsigned NumWords) {
+  static const CountWordsFn CountWords = SelectCountWords();
+  return CountWords(Words, NumWords);
+}
@@ -26,10 +26,11 @@
 #include "llvm/Target/TargetRegistry.h"
 #include "llvm/Support/Host.h"
 #include "llvm/Support/Path.h"
+#include "llvm/ADT/FlatHashMap.h"
 #include "llvm/ADT/OwningPtr.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallString.h"
-#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/Twine.h"
 #include "llvm/Config/config.h"
 #include <cerrno>
@@ -94,11 +95,16 @@ void cl::MarkOptionsChanged() {
 /// have statically constructed themselves.
 static Option *RegisteredOptionList = 0;
 
+/// NumRegisteredOptions - The length of RegisteredOptionList, used to size the
+/// option table in one allocation.
+static unsigned NumRegisteredOptions = 0;
+
 void Option::addArgument() {
   assert(NextRegistered == 0 && "argument multiply registered!");
 
   NextRegistered = RegisteredOptionList;
   RegisteredOptionList = this;
+  ++NumRegisteredOptions;
   MarkOptionsChanged();
 }
 
@@ -107,13 +113,62 @@ void Option::addArgument() {
 // Basic, shared command line option processing machinery.
 //
 
-/// GetOptionInfo - Scan the list of registered options, turning them into data
-/// structures that are easier to handle.
-static void GetOptionInfo(SmallVectorImpl<Option*> &PositionalOpts,
-                          SmallVectorImpl<Option*> &SinkOpts,
-                          StringMap<Option*> &OptionsMap) {
+namespace {
+
+/// OptionNameInfo - Hash option names without copying them.  The names are
+/// the ArgStr and enum value strings of the options themselves.
+struct OptionNameInfo {
+  static unsigned getHashValue(StringRef Name) { return HashString(Name); }
+  static bool isEqual(StringRef LHS, StringRef RHS) { return LHS == RHS; }
+};
+
+/// OptionTable - Map from option names to the registered options.  Filling it
+/// visits every registered option, and tools have well over a thousand of
+/// them, so it is only done on the first lookup: a command line with nothing
+/// but positional arguments never builds it.  The table is allocated once,
+/// sized from NumRegisteredOptions, and does not copy the names.
+class OptionTable {
+  typedef FlatHashMap<StringRef, Option*, OptionNameInfo> MapTy;
+  MapTy Map;
+  bool Built;
+
+  void build();
+public:
+  typedef MapTy::const_iterator const_iterator;
+
+  OptionTable() : Map(0), Built(false) {}
+
+  /// invalidate - Forget the table, after options have been registered or
+  /// deregistered.
+  void invalidate() {
+    Map.clear();
+    Built = false;
+  }
+
+  Option *lookup(StringRef Name) {
+    if (!Built)
+      build();
+    return Map.lookup(Name);
+  }
+
+  const_iterator begin() {
+    if (!Built)
+      build();
+    return const_iterator(const_cast<const MapTy&>(Map).begin());
+  }
+  const_iterator end() {
+    return const_cast<const MapTy&>(Map).end();
+  }
+};
+
+} // end anonymous namespace
+
+void OptionTable::build() {
+  Built = true;
+  // Enum options like "-O1 -O2" have several names, so leave some room.
+  Map.resize(NumRegisteredOptions * 2);
+
   SmallVector<const char*, 16> OptionNames;
-  Option *CAOpt = 0;  // The ConsumeAfter option if it exists.
   for (Option *O = RegisteredOptionList; O; O = O->getNextRegisteredOption()) {
     // If this option wants to handle multiple option names, get the full set.
     // This handles enum options like "-O1 -O2" etc.
@@ -124,14 +179,23 @@ static void GetOptionInfo(SmallVectorImpl<Option*> &PositionalOpts,
     // Handle named options.
     for (size_t i = 0, e = OptionNames.size(); i != e; ++i) {
       // Add argument to the argument map!
-      if (OptionsMap.GetOrCreateValue(OptionNames[i], O).second != O) {
+      if (!Map.insert(std::make_pair(StringRef(OptionNames[i]), O)).second) {
         errs() << ProgramName << ": CommandLine Error: Argument '"
              << OptionNames[i] << "' defined more than once!\n";
       }
     }
 
     OptionNames.clear();
+  }
+}
 
+/// GetOptionInfo - Scan the list of registered options for the positional,
+/// sink and consume-after options.  Named options are found through an
+/// OptionTable.
+static void GetOptionInfo(SmallVectorImpl<Option*> &PositionalOpts,
+                          SmallVectorImpl<Option*> &SinkOpts) {
+  Option *CAOpt = 0;  // The ConsumeAfter option if it exists.
+  for (Option *O = RegisteredOptionList; O; O = O->getNextRegisteredOption()) {
     // Remember information about positional options.
     if (O->getFormattingFlag() == cl::Positional)
       PositionalOpts.push_back(O);
@@ -156,7 +220,7 @@ static void GetOptionInfo(SmallVectorImpl<Option*> &PositionalOpts,
 /// command line.  If there is a value specified (after an equal sign) return
 /// that as well.  This assumes that leading dashes have already been stripped.
 static Option *LookupOption(StringRef &Arg, StringRef &Value,
-                            const StringMap<Option*> &OptionsMap) {
+                            OptionTable &OptionsMap) {
   // Reject all dashes.
   if (Arg.empty()) return 0;
 
@@ -165,19 +229,17 @@ static Option *LookupOption(StringRef &Arg, StringRef &Value,
   // If we have an equals sign, remember the value.
   if (EqualPos == StringRef::npos) {
     // Look up the option.
-    StringMap<Option*>::const_iterator I = OptionsMap.find(Arg);
-    return I != OptionsMap.end() ? I->second : 0;
+    return OptionsMap.lookup(Arg);
   }
 
   // If the argument before the = is a valid option name, we match.  If not,
   // return Arg unmolested.
-  StringMap<Option*>::const_iterator I =
-    OptionsMap.find(Arg.substr(0, EqualPos));
-  if (I == OptionsMap.end()) return 0;
+  Option *O = OptionsMap.lookup(Arg.substr(0, EqualPos));
+  if (O == 0) return 0;
 
   Value = Arg.substr(EqualPos+1);
   Arg = Arg.substr(0, EqualPos);
-  return I->second;
+  return O;
 }
 
 /// LookupNearestOption - Lookup the closest match to the option specified by
@@ -185,7 +247,7 @@ static Option *LookupOption(StringRef &Arg, StringRef &Value,
 /// (after an equal sign) return that as well.  This assumes that leading dashes
 /// have already been stripped.
 static Option *LookupNearestOption(StringRef Arg,
-                                   const StringMap<Option*> &OptionsMap,
+                                   OptionTable &OptionsMap,
                                    const char *&NearestString) {
   // Reject all dashes.
   if (Arg.empty()) return 0;
@@ -196,7 +258,7 @@ static Option *LookupNearestOption(StringRef Arg,
   // Find the closest match.
   Option *Best = 0;
   unsigned BestDistance = 0;
-  for (StringMap<Option*>::const_iterator it = OptionsMap.begin(),
+  for (OptionTable::const_iterator it = OptionsMap.begin(),
          ie = OptionsMap.end(); it != ie; ++it) {
     Option *O = it->second;
     SmallVector<const char*, 16> OptionNames;
@@ -338,21 +400,21 @@ static inline bool isPrefixedOrGrouping(const Option *O) {
 //
 static Option *getOptionPred(StringRef Name, size_t &Length,
                              bool (*Pred)(const Option*),
-                             const StringMap<Option*> &OptionsMap) {
+                             OptionTable &OptionsMap) {
 
-  StringMap<Option*>::const_iterator OMI = OptionsMap.find(Name);
+  Option *O = OptionsMap.lookup(Name);
 
   // Loop while we haven't found an option and Name still has at least two
   // characters in it (so that the next iteration will not be the empty
   // string.
-  while (OMI == OptionsMap.end() && Name.size() > 1) {
+  while (O == 0 && Name.size() > 1) {
     Name = Name.substr(0, Name.size()-1);   // Chop off the last character.
-    OMI = OptionsMap.find(Name);
+    O = OptionsMap.lookup(Name);
   }
 
-  if (OMI != OptionsMap.end() && Pred(OMI->second)) {
+  if (O != 0 && Pred(O)) {
     Length = Name.size();
-    return OMI->second;    // Found one!
+    return O;    // Found one!
   }
   return 0;                // No option found!
 }
@@ -363,7 +425,7 @@ static Option *getOptionPred(StringRef Name, size_t &Length,
 /// Arg/Value pair and return the Option to parse it with.
 static Option *HandlePrefixedOrGroupedOption(StringRef &Arg, StringRef &Value,
                                              bool &ErrorParsing,
-                                         const StringMap<Option*> &OptionsMap) {
+                                             OptionTable &OptionsMap) {
   if (Arg.size() == 1) return 0;
 
   // Do the lookup!
@@ -377,7 +439,7 @@ static Option *HandlePrefixedOrGroupedOption(StringRef &Arg, StringRef &Value,
   if (PGOpt->getFormattingFlag() == cl::Prefix) {
     Value = Arg.substr(Length);
     Arg = Arg.substr(0, Length);
-    assert(OptionsMap.count(Arg) && OptionsMap.find(Arg)->second == PGOpt);
+    assert(OptionsMap.lookup(Arg) == PGOpt);
     return PGOpt;
   }
 
@@ -528,11 +590,10 @@ void cl::ParseCommandLineOptions(int argc, char **argv,
   // Process all registered options.
   SmallVector<Option*, 4> PositionalOpts;
   SmallVector<Option*, 4> SinkOpts;
-  StringMap<Option*> Opts;
-  GetOptionInfo(PositionalOpts, SinkOpts, Opts);
+  OptionTable Opts;
+  GetOptionInfo(PositionalOpts, SinkOpts);
 
-  assert((!Opts.empty() || !PositionalOpts.empty()) &&
-         "No options specified!");
+  assert(NumRegisteredOptions != 0 && "No options specified!");
 
   // Expand response files.
   std::vector<char*> newArgv;
@@ -621,8 +682,8 @@ void cl::ParseCommandLineOptions(int argc, char **argv,
     if (OptionListChanged) {
       PositionalOpts.clear();
       SinkOpts.clear();
-      Opts.clear();
-      GetOptionInfo(PositionalOpts, SinkOpts, Opts);
+      Opts.invalidate();
+      GetOptionInfo(PositionalOpts, SinkOpts);
       OptionListChanged = false;
     }
 
@@ -802,17 +863,23 @@ void cl::ParseCommandLineOptions(int argc, char **argv,
                                               PositionalVals[ValNo].second);
   }
 
-  // Loop over args and make sure all required args are specified!
-  for (StringMap<Option*>::iterator I = Opts.begin(),
-         E = Opts.end(); I != E; ++I) {
-    switch (I->second->getNumOccurrencesFlag()) {
+  // Loop over the named options and make sure all required ones are
+  // specified!  Walk the option list rather than the option table, so that it
+  // is not built just for this.
+  SmallVector<const char*, 16> OptionNames;
+  for (Option *O = RegisteredOptionList; O; O = O->getNextRegisteredOption()) {
+    switch (O->getNumOccurrencesFlag()) {
     case Required:
     case OneOrMore:
-      if (I->second->getNumOccurrences() == 0) {
-        I->second->error("must be specified at least once!");
+      if (O->getNumOccurrences() != 0)
+        break;
+      O->getExtraOptionNames(OptionNames);
+      if (O->ArgStr[0] || !OptionNames.empty()) {
+        O->error("must be specified at least once!");
         ErrorParsing = true;
       }
-      // Fall through
+      OptionNames.clear();
+      break;
     default:
       break;
     }
@@ -829,7 +896,7 @@ void cl::ParseCommandLineOptions(int argc, char **argv,
 
   // Free all of the memory allocated to the map.  Command line options may only
   // be processed once!
-  Opts.clear();
+  Opts.invalidate();
   PositionalOpts.clear();
   MoreHelp->clear();
 
@@ -1112,14 +1179,14 @@ public:
     // Get all the options.
     SmallVector<Option*, 4> PositionalOpts;
     SmallVector<Option*, 4> SinkOpts;
-    StringMap<Option*> OptMap;
-    GetOptionInfo(PositionalOpts, SinkOpts, OptMap);
+    OptionTable OptMap;
+    GetOptionInfo(PositionalOpts, SinkOpts);
 
     // Copy Options into a vector so we can sort them as we like.
     SmallVector<std::pair<const char *, Option*>, 128> Opts;
     SmallPtrSet<Option*, 128> OptionSet;  // Duplicate option detection.
 
-    for (StringMap<Option*>::iterator I = OptMap.begin(), E = OptMap.end();
+    for (OptionTable::const_iterator I = OptMap.begin(), E = OptMap.end();
          I != E; ++I) {
       // Ignore really-hidden options.
       if (I->second->getOptionHiddenFlag() == ReallyHidden)
@@ -1133,7 +1200,7 @@ public:
       if (!OptionSet.insert(I->second))
         continue;
 
-      Opts.push_back(std::pair<const char *, Option*>(I->getKey().data(),
+      Opts.push_back(std::pair<const char *, Option*>(I->first.data(),
                                                       I->second));
     }
 
@@ -296,12 +296,29 @@ std::string sys::getHostCPUName() {
   }
   return "generic";
 }
+
+bool sys::getHostCPUFeatures(StringMap<bool> &Features){
+  unsigned EAX = 0, EBX = 0, ECX = 0, EDX = 0;
+  if (GetX86CpuIDAndInfo(0x1, &EAX, &EBX, &ECX, &EDX))
+    return false;
+
+  Features["cmov"]   = (EDX >> 15) & 1;
+  Features["mmx"]    = (EDX >> 23) & 1;
+  Features["sse"]    = (EDX >> 25) & 1;
+  Features["sse2"]   = (EDX >> 26) & 1;
+  Features["sse3"]   = (ECX >>  0) & 1;
+  Features["ssse3"]  = (ECX >>  9) & 1;
+  Features["sse41"]  = (ECX >> 19) & 1;
+  Features["sse42"]  = (ECX >> 20) & 1;
+  Features["popcnt"] = (ECX >> 23) & 1;
+  return true;
+}
 #else
 std::string sys::getHostCPUName() {
   return "generic";
 }
-#endif
 
 bool sys::getHostCPUFeatures(StringMap<bool> &Features){
   return false;
 }
+#endif
@@ -14,8 +14,12 @@
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/ADT/OwningPtr.h"
 #include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Config/config.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/Errno.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/Mutex.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/Process.h"
 #include "llvm/Support/Program.h"
@@ -34,6 +38,9 @@
 #include <io.h>
 #endif
 #include <fcntl.h>
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
 using namespace llvm;
 
 namespace { const llvm::error_code success; }
@@ -148,18 +155,20 @@ MemoryBuffer *MemoryBuffer::getNewMemBuffer(size_t Size, StringRef BufferName) {
 /// returns an empty buffer.
 error_code MemoryBuffer::getFileOrSTDIN(StringRef Filename,
                                         OwningPtr<MemoryBuffer> &result,
-                                        int64_t FileSize) {
+                                        int64_t FileSize,
+                                        AccessPattern Access) {
   if (Filename == "-")
     return getSTDIN(result);
-  return getFile(Filename, result, FileSize);
+  return getFile(Filename, result, FileSize, Access);
 }
 
 error_code MemoryBuffer::getFileOrSTDIN(const char *Filename,
                                         OwningPtr<MemoryBuffer> &result,
-                                        int64_t FileSize) {
+                                        int64_t FileSize,
+                                        AccessPattern Access) {
   if (strcmp(Filename, "-") == 0)
     return getSTDIN(result);
-  return getFile(Filename, result, FileSize);
+  return getFile(Filename, result, FileSize, Access);
 }
 
 //===----------------------------------------------------------------------===//
@@ -189,45 +198,44 @@ public:
 };
 }
 
-error_code MemoryBuffer::getFile(StringRef Filename,
-                                 OwningPtr<MemoryBuffer> &result,
-                                 int64_t FileSize) {
-  // Ensure the path is null terminated.
-  SmallString<256> PathBuf(Filename.begin(), Filename.end());
-  return MemoryBuffer::getFile(PathBuf.c_str(), result, FileSize);
+/// AdviseMappedFile - Tell the kernel how the pages of a mapped file are going
+/// to be read.
+static void AdviseMappedFile(const char *Pages, size_t Size,
+                             MemoryBuffer::AccessPattern Access) {
+#if defined(HAVE_SYS_MMAN_H) && defined(POSIX_MADV_SEQUENTIAL)
+  void *Addr = const_cast<char*>(Pages);
+  switch (Access) {
+  case MemoryBuffer::NormalAccess:
+    posix_madvise(Addr, Size, POSIX_MADV_NORMAL);
+    break;
+  case MemoryBuffer::SequentialAccess:
+    // Read ahead aggressively, and start bringing the file in right away.
+    posix_madvise(Addr, Size, POSIX_MADV_SEQUENTIAL);
+    posix_madvise(Addr, Size, POSIX_MADV_WILLNEED);
+    break;
+  case MemoryBuffer::RandomAccess:
+    posix_madvise(Addr, Size, POSIX_MADV_RANDOM);
+    break;
+  }
+#endif
 }
 
-error_code MemoryBuffer::getFile(const char *Filename,
-                                 OwningPtr<MemoryBuffer> &result,
-                                 int64_t FileSize) {
-  int OpenFlags = O_RDONLY;
-#ifdef O_BINARY
-  OpenFlags |= O_BINARY;  // Open input file in binary mode on win32.
+/// AdviseReadFile - Tell the kernel how a file that is about to be read()
+/// will be accessed.  It is read whole, so only sequential access is worth
+/// mentioning.
+static void AdviseReadFile(int FD, MemoryBuffer::AccessPattern Access) {
+#if defined(POSIX_FADV_SEQUENTIAL) && !defined(__APPLE__)
+  if (Access == MemoryBuffer::SequentialAccess)
+    posix_fadvise(FD, 0, 0, POSIX_FADV_SEQUENTIAL);
 #endif
-  int FD = ::open(Filename, OpenFlags);
-  if (FD == -1) {
-    return error_code(errno, posix_category());
-  }
-
-  return getOpenFile(FD, Filename, result, FileSize);
 }
 
-error_code MemoryBuffer::getOpenFile(int FD, const char *Filename,
-                                     OwningPtr<MemoryBuffer> &result,
-                                     int64_t FileSize) {
-  FileCloser FC(FD); // Close FD on return.
-
-  // If we don't know the file size, use fstat to find out.  fstat on an open
-  // file descriptor is cheaper than stat on a random path.
-  if (FileSize == -1) {
-    struct stat FileInfo;
-    // TODO: This should use fstat64 when available.
-    if (fstat(FD, &FileInfo) == -1) {
-      return error_code(errno, posix_category());
-    }
-    FileSize = FileInfo.st_size;
-  }
-
+/// ReadOpenFile - Read the contents of the file FD, which is FileSize bytes
+/// long, mapping it if that is worthwhile.  Mapped is set if it was mapped.
+static error_code ReadOpenFile(int FD, const char *Filename, int64_t FileSize,
+                               MemoryBuffer::AccessPattern Access,
+                               OwningPtr<MemoryBuffer> &result, bool &Mapped) {
+  Mapped = false;
 
   // If the file is large, try to use mmap to read it in.  We don't use mmap
   // for small files, because this can severely fragment our address space. Also
@@ -238,8 +246,10 @@ error_code MemoryBuffer::getOpenFile(int FD, const char *Filename,
   if (FileSize >= 4096*4 &&
       (FileSize & (sys::Process::GetPageSize()-1)) != 0) {
     if (const char *Pages = sys::Path::MapInFilePages(FD, FileSize)) {
+      AdviseMappedFile(Pages, FileSize, Access);
       result.reset(GetNamedBuffer<MemoryBufferMMapFile>(
         StringRef(Pages, FileSize), Filename));
+      Mapped = true;
       return success;
     }
   }
@@ -254,6 +264,7 @@ error_code MemoryBuffer::getOpenFile(int FD, const char *Filename,
   OwningPtr<MemoryBuffer> SB(Buf);
   char *BufPtr = const_cast<char*>(SB->getBufferStart());
 
+  AdviseReadFile(FD, Access);
   size_t BytesLeft = FileSize;
   while (BytesLeft) {
     ssize_t NumRead = ::read(FD, BufPtr, BytesLeft);
@@ -263,10 +274,10 @@ error_code MemoryBuffer::getOpenFile(int FD, const char *Filename,
       // Error while reading.
       return error_code(errno, posix_category());
     } else if (NumRead == 0) {
-      // We hit EOF early, truncate and terminate buffer.
-      Buf->BufferEnd = BufPtr;
-      *BufPtr = 0;
-      result.swap(SB);
+      // We hit EOF early, keep just what was read.
+      result.reset(MemoryBuffer::getMemBufferCopy(
+        StringRef(SB->getBufferStart(), BufPtr - SB->getBufferStart()),
+        Filename));
       return success;
     }
     BytesLeft -= NumRead;
@@ -277,6 +288,234 @@ error_code MemoryBuffer::getOpenFile(int FD, const char *Filename,
   return success;
 }
 
+//===----------------------------------------------------------------------===//
+// The file cache.
+//===----------------------------------------------------------------------===//
+
+/// getTimeNSec - Return the sub-second parts of the modification and status
+/// change times in Info, or zero where the host does not record them.
+static void getTimeNSec(const struct stat &Info, long &ModNSec,
+                        long &ChangeNSec) {
+#if defined(__APPLE__) || defined(__FreeBSD__) || defined(__NetBSD__)
+  ModNSec = Info.st_mtimespec.tv_nsec;
+  ChangeNSec = Info.st_ctimespec.tv_nsec;
+#elif defined(__linux__) || defined(__sun__) || defined(__OpenBSD__)
+  ModNSec = Info.st_mtim.tv_nsec;
+  ChangeNSec = Info.st_ctim.tv_nsec;
+#else
+  ModNSec = ChangeNSec = 0;
+#endif
+}
+
+namespace {
+/// SharedFile - The contents of a file in the file cache, shared by all the
+/// buffers handed out for it.
+struct SharedFile {
+  /// Contents - The buffer the file was originally read into.
+  OwningPtr<MemoryBuffer> Contents;
+  bool Mapped;
+
+  /// RefCount - The number of buffers referring to the contents, plus one
+  /// while the file is in the cache.
+  unsigned RefCount;
+
+  // The file the contents were read from.  Writing to a file changes its
+  // modification and status change times, and replacing it changes its
+  // inode; the sub-second parts of the times tell apart a same-sized rewrite
+  // in the same second.
+  dev_t Device;
+  ino_t Inode;
+  off_t Size;
+  time_t ModTime, ChangeTime;
+  long ModNSec, ChangeNSec;
+
+  void setFile(const struct stat &Info) {
+    Device = Info.st_dev;
+    Inode = Info.st_ino;
+    Size = Info.st_size;
+    ModTime = Info.st_mtime;
+    ChangeTime = Info.st_ctime;
+    getTimeNSec(Info, ModNSec, ChangeNSec);
+  }
+
+  bool isFile(const struct stat &Info) const {
+    long InfoModNSec, InfoChangeNSec;
+    getTimeNSec(Info, InfoModNSec, InfoChangeNSec);
+    return Device == Info.st_dev && Inode == Info.st_ino &&
+           Size == Info.st_size && ModTime == Info.st_mtime &&
+           ChangeTime == Info.st_ctime && ModNSec == InfoModNSec &&
+           ChangeNSec == InfoChangeNSec;
+  }
+};
+
+/// FileCache - The process-wide table of SharedFiles, by path.
+struct FileCache {
+  sys::SmartMutex<true> Lock;
+  StringMap<SharedFile*> Files;
+  bool Enabled;
+
+  FileCache() : Enabled(false) {}
+  ~FileCache() { setEnabled(false); }
+
+  void setEnabled(bool Enable) {
+    sys::SmartScopedLock<true> Guard(Lock);
+    Enabled = Enable;
+    if (Enable)
+      return;
+    for (StringMap<SharedFile*>::iterator I = Files.begin(), E = Files.end();
+         I != E; ++I)
+      if (--I->second->RefCount == 0)
+        delete I->second;
+    Files.clear();
+  }
+
+  /// release - Drop a buffer's reference to File.
+  void release(SharedFile *File) {
+    sys::SmartScopedLock<true> Guard(Lock);
+    if (--File->RefCount == 0)
+      delete File;
+  }
+};
+
+static ManagedStatic<FileCache> TheFileCache;
+
+/// MemoryBufferShared - A buffer referring to the contents of a SharedFile.
+class MemoryBufferShared : public MemoryBuffer {
+public:
+  SharedFile *File;
+
+  MemoryBufferShared(StringRef Buffer) : File(0) {
+    init(Buffer.begin(), Buffer.end());
+  }
+
+  ~MemoryBufferShared() {
+    TheFileCache->release(File);
+  }
+
+  virtual const char *getBufferIdentifier() const {
+     // The name is stored after the class itself.
+    return reinterpret_cast<const char*>(this + 1);
+  }
+};
+}
+
+/// GetSharedBuffer - Return a new buffer for the contents of File, which the
+/// caller holds a reference to on behalf of the buffer.
+static MemoryBuffer *GetSharedBuffer(SharedFile *File, const char *Filename,
+                                     MemoryBuffer::AccessPattern Access) {
+  if (File->Mapped)
+    AdviseMappedFile(File->Contents->getBufferStart(),
+                     File->Contents->getBufferSize(), Access);
+  MemoryBufferShared *Buf =
+    GetNamedBuffer<MemoryBufferShared>(File->Contents->getBuffer(), Filename);
+  Buf->File = File;
+  return Buf;
+}
+
+void MemoryBuffer::setFileCacheEnabled(bool Enabled) {
+  TheFileCache->setEnabled(Enabled);
+}
+
+bool MemoryBuffer::isFileCacheEnabled() {
+  FileCache &Cache = *TheFileCache;
+  sys::SmartScopedLock<true> Guard(Cache.Lock);
+  return Cache.Enabled;
+}
+
+//===----------------------------------------------------------------------===//
+// MemoryBuffer::getFile implementation.
+//===----------------------------------------------------------------------===//
+
+error_code MemoryBuffer::getFile(StringRef Filename,
+                                 OwningPtr<MemoryBuffer> &result,
+                                 int64_t FileSize, AccessPattern Access) {
+  // Ensure the path is null terminated.
+  SmallString<256> PathBuf(Filename.begin(), Filename.end());
+  return MemoryBuffer::getFile(PathBuf.c_str(), result, FileSize, Access);
+}
+
+error_code MemoryBuffer::getFile(const char *Filename,
+                                 OwningPtr<MemoryBuffer> &result,
+                                 int64_t FileSize, AccessPattern Access) {
+  int OpenFlags = O_RDONLY;
+#ifdef O_BINARY
+  OpenFlags |= O_BINARY;  // Open input file in binary mode on win32.
+#endif
+  int FD = ::open(Filename, OpenFlags);
+  if (FD == -1) {
+    return error_code(errno, posix_category());
+  }
+
+  return getOpenFile(FD, Filename, result, FileSize, Access);
+}
+
+error_code MemoryBuffer::getOpenFile(int FD, const char *Filename,
+                                     OwningPtr<MemoryBuffer> &result,
+                                     int64_t FileSize, AccessPattern Access) {
+  FileCloser FC(FD); // Close FD on return.
+
+  // Files in the cache are identified by path, so they need one.  If the cache
+  // is off, don't take its lock at all.
+  FileCache *Cache = 0;
+  if (Filename && Filename[0] && TheFileCache.isConstructed() &&
+      isFileCacheEnabled())
+    Cache = &*TheFileCache;
+
+  // If we don't know the file size, use fstat to find out.  fstat on an open
+  // file descriptor is cheaper than stat on a random path.  The cache also
+  // needs to know which file this is.
+  struct stat FileInfo;
+  if (FileSize == -1 || Cache) {
+    // TODO: This should use fstat64 when available.
+    if (fstat(FD, &FileInfo) == -1) {
+      return error_code(errno, posix_category());
+    }
+    FileSize = FileInfo.st_size;
+  }
+
+  if (Cache) {
+    sys::SmartScopedLock<true> Guard(Cache->Lock);
+    StringMap<SharedFile*>::iterator I = Cache->Files.find(Filename);
+    if (I != Cache->Files.end() && I->second->isFile(FileInfo)) {
+      ++I->second->RefCount;
+      result.reset(GetSharedBuffer(I->second, Filename, Access));
+      return success;
+    }
+  }
+
+  OwningPtr<MemoryBuffer> Contents;
+  bool Mapped;
+  if (error_code ec = ReadOpenFile(FD, Filename, FileSize, Access, Contents,
+                                   Mapped))
+    return ec;
+
+  if (!Cache) {
+    result.swap(Contents);
+    return success;
+  }
+
+  SharedFile *File = new SharedFile();
+  File->Contents.swap(Contents);
+  File->Mapped = Mapped;
+  File->RefCount = 2; // The cache and the new buffer.
+  File->setFile(FileInfo);
+
+  sys::SmartScopedLock<true> Guard(Cache->Lock);
+  if (!Cache->Enabled) {
+    // The cache was turned off while the file was read.
+    File->RefCount = 1;
+  } else {
+    // Replace an entry for an older version of the file, or one that another
+    // thread read at the same time.  Buffers using it keep it alive.
+    SharedFile *&Entry = Cache->Files[Filename];
+    if (Entry && --Entry->RefCount == 0)
+      delete Entry;
+    Entry = File;
+  }
+  result.reset(GetSharedBuffer(File, Filename, Access));
+  return success;
+}
+
 //===----------------------------------------------------------------------===//
 // MemoryBuffer::getSTDIN implementation.
 //===----------------------------------------------------------------------===//
@@ -19,13 +19,21 @@
 #include "llvm/ADT/OwningPtr.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/system_error.h"
+#include <algorithm>
+#include <cstring>
 using namespace llvm;
 
 namespace {
+  /// LineNoCacheTy - For each buffer, the offsets of all of its newlines.
+  /// The table for a buffer is built the first time a line number in it is
+  /// asked for, after which any query is a binary search.
   struct LineNoCacheTy {
-    int LastQueryBufferID;
-    const char *LastQuery;
-    unsigned LineNoOfQuery;
+    std::vector<std::vector<unsigned>*> LineOffsets;
+
+    ~LineNoCacheTy() {
+      for (unsigned i = 0, e = LineOffsets.size(); i != e; ++i)
+        delete LineOffsets[i];
+    }
   };
 }
 
@@ -33,6 +41,19 @@ static LineNoCacheTy *getCache(void *Ptr) {
   return (LineNoCacheTy*)Ptr;
 }
 
+/// ComputeLineOffsets - Record the offset of every newline in Buff.  memchr
+/// is vectorized by the C library, which makes this much faster than a byte
+/// at a time loop on large files.
+static std::vector<unsigned> *ComputeLineOffsets(const MemoryBuffer *Buff) {
+  assert(Buff->getBufferSize() <= ~0U && "Buffer too large for line table!");
+  std::vector<unsigned> *Offsets = new std::vector<unsigned>();
+  const char *Start = Buff->getBufferStart(), *End = Buff->getBufferEnd();
+  for (const char *Ptr = Start;
+       (Ptr = (const char*)memchr(Ptr, '\n', End - Ptr)); ++Ptr)
+    Offsets->push_back(unsigned(Ptr - Start));
+  return Offsets;
+}
+
 
 SourceMgr::~SourceMgr() {
   // Delete the line # cache if allocated.
@@ -78,45 +99,29 @@ int SourceMgr::FindBufferContainingLoc(SMLoc Loc) const {
 }
 
 /// FindLineNumber - Find the line number for the specified location in the
-/// specified file.  This is not a fast method.
+/// specified file.  The first query in a buffer scans the whole buffer, later
+/// ones take logarithmic time.
 unsigned SourceMgr::FindLineNumber(SMLoc Loc, int BufferID) const {
   if (BufferID == -1) BufferID = FindBufferContainingLoc(Loc);
   assert(BufferID != -1 && "Invalid Location!");
 
-  MemoryBuffer *Buff = getBufferInfo(BufferID).Buffer;
-
-  // Count the number of \n's between the start of the file and the specified
-  // location.
-  unsigned LineNo = 1;
-
-  const char *Ptr = Buff->getBufferStart();
-
-  // If we have a line number cache, and if the query is to a later point in the
-  // same file, start searching from the last query location.  This optimizes
-  // for the case when multiple diagnostics come out of one file in order.
-  if (LineNoCacheTy *Cache = getCache(LineNoCache))
-    if (Cache->LastQueryBufferID == BufferID &&
-        Cache->LastQuery <= Loc.getPointer()) {
-      Ptr = Cache->LastQuery;
-      LineNo = Cache->LineNoOfQuery;
-    }
-
-  // Scan for the location being queried, keeping track of the number of lines
-  // we see.
-  for (; SMLoc::getFromPointer(Ptr) != Loc; ++Ptr)
-    if (*Ptr == '\n') ++LineNo;
-
-
   // Allocate the line number cache if it doesn't exist.
   if (LineNoCache == 0)
     LineNoCache = new LineNoCacheTy();
-
-  // Update the line # cache.
   LineNoCacheTy &Cache = *getCache(LineNoCache);
-  Cache.LastQueryBufferID = BufferID;
-  Cache.LastQuery = Ptr;
-  Cache.LineNoOfQuery = LineNo;
-  return LineNo;
+
+  if (Cache.LineOffsets.size() <= unsigned(BufferID))
+    Cache.LineOffsets.resize(Buffers.size());
+  std::vector<unsigned> *&Offsets = Cache.LineOffsets[BufferID];
+  MemoryBuffer *Buff = getBufferInfo(BufferID).Buffer;
+  if (!Offsets)
+    Offsets = ComputeLineOffsets(Buff);
+
+  // The line number is one more than the number of \n's between the start of
+  // the file and the specified location.
+  unsigned Offset = unsigned(Loc.getPointer() - Buff->getBufferStart());
+  return 1 + unsigned(std::lower_bound(Offsets->begin(), Offsets->end(),
+                                       Offset) - Offsets->begin());
 }
 
 void SourceMgr::PrintIncludeStack(SMLoc IncludeLoc, raw_ostream &OS) const {
@@ -27,6 +27,7 @@
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/Mutex.h"
+#include "llvm/Support/ThreadLocal.h"
 #include "llvm/ADT/StringExtras.h"
 #include <algorithm>
 #include <cstring>
@@ -41,8 +42,32 @@ namespace llvm { extern raw_ostream *CreateInfoOutputFile(); }
 static cl::opt<bool>
 Enabled("stats", cl::desc("Enable statistics output from program"));
 
+namespace {
+enum StatsFormatTy { StatsText, StatsJSON, StatsCSV };
+}
+
+/// -stats-format - Command line option to select how statistics are printed,
+/// so that they can be consumed by tools as well as people.
+///
+static cl::opt<StatsFormatTy>
+StatsFormat("stats-format", cl::desc("Format of the -stats output"),
+            cl::init(StatsText),
+            cl::values(clEnumValN(StatsText, "text", "Human readable table"),
+                       clEnumValN(StatsJSON, "json", "JSON object"),
+                       clEnumValN(StatsCSV,  "csv",  "Comma separated values"),
+                       clEnumValEnd));
+
 
 namespace {
+/// StatisticShard - The counts added by one thread while LLVM is
+/// multithreaded, indexed by Statistic::Index.  Only the owning thread adds
+/// to a shard, and it only takes StatLock to grow it.  Other threads zero
+/// counts under StatLock when they fold them into a statistic's value, so
+/// counts are added and taken atomically to keep increments from being lost.
+struct StatisticShard {
+  std::vector<sys::cas_flag> Counts;
+};
+
 /// StatisticInfo - This class is used in a ManagedStatic so that it is created
 /// on demand (when the first statistic is bumped) and destroyed only when
 /// llvm_shutdown is called.  We print statistics from the destructor.
@@ -50,18 +75,44 @@ class StatisticInfo {
   std::vector<const Statistic*> Stats;
   friend void llvm::PrintStatistics();
   friend void llvm::PrintStatistics(raw_ostream &OS);
+  friend void llvm::PrintStatisticsJSON(raw_ostream &OS);
+  friend void llvm::PrintStatisticsCSV(raw_ostream &OS);
 public:
   ~StatisticInfo();
 
   void addStatistic(const Statistic *S) {
     Stats.push_back(S);
   }
+
+  void sortStatistics();
 };
 }
 
 static ManagedStatic<StatisticInfo> StatInfo;
 static ManagedStatic<sys::SmartMutex<true> > StatLock;
 
+/// CurrentShard - The shard of the calling thread, if it has one.
+static sys::ThreadLocal<const StatisticShard> CurrentShard;
+
+/// Shards - The shards of all threads that have bumped a statistic while LLVM
+/// was multithreaded, guarded by StatLock.  This is null until the first
+/// shard is created, so that reading a statistic only sums shards if there
+/// are some.  Shards are never freed: they outlive their threads so that no
+/// counts are lost, and threads keep pointers to them.
+static std::vector<StatisticShard*> *volatile Shards = 0;
+
+/// NumIndexes - The number of statistic indexes handed out so far.
+static unsigned NumIndexes = 0;
+
+/// takeCount - Atomically zero a shard's count and return what it held.
+static sys::cas_flag takeCount(volatile sys::cas_flag &Count) {
+  sys::cas_flag Old;
+  do
+    Old = Count;
+  while (sys::CompareAndSwap(&Count, 0, Old) != Old);
+  return Old;
+}
+
 /// RegisterStatistic - The first time a statistic is bumped, this method is
 /// called.
 void Statistic::RegisterStatistic() {
@@ -71,6 +122,7 @@ void Statistic::RegisterStatistic() {
   if (!Initialized) {
     if (Enabled)
       StatInfo->addStatistic(this);
+    Index = NumIndexes++;
 
     sys::MemoryFence();
     // Remember we have been registered.
@@ -78,6 +130,62 @@ void Statistic::RegisterStatistic() {
   }
 }
 
+/// addToShard - Add V to this statistic's count in the calling thread's
+/// shard, creating or growing the shard first if needed.
+void Statistic::addToShard(unsigned V) {
+  StatisticShard *Shard = const_cast<StatisticShard*>(CurrentShard.get());
+  if (!Shard || Index >= Shard->Counts.size()) {
+    sys::SmartScopedLock<true> Writer(*StatLock);
+    if (!Shard) {
+      Shard = new StatisticShard();
+      if (!Shards)
+        Shards = new std::vector<StatisticShard*>();
+      Shards->push_back(Shard);
+      CurrentShard.set(Shard);
+    }
+    Shard->Counts.resize(NumIndexes);
+  }
+  sys::AtomicAdd(&Shard->Counts[Index], V);
+}
+
+/// getValue - Return the value of this statistic, including the counts in
+/// all shards.
+sys::cas_flag Statistic::getValue() const {
+  if (!Shards || !Initialized)
+    return Value;
+
+  sys::SmartScopedLock<true> Reader(*StatLock);
+  sys::cas_flag Sum = Value;
+  for (unsigned i = 0, e = Shards->size(); i != e; ++i) {
+    const std::vector<sys::cas_flag> &Counts = (*Shards)[i]->Counts;
+    if (Index < Counts.size())
+      Sum += Counts[Index];
+  }
+  return Sum;
+}
+
+void Statistic::setValue(unsigned V) {
+  sys::SmartScopedLock<true> Writer(*StatLock);
+  if (Shards)
+    for (unsigned i = 0, e = Shards->size(); i != e; ++i) {
+      std::vector<sys::cas_flag> &Counts = (*Shards)[i]->Counts;
+      if (Index < Counts.size())
+        takeCount(Counts[Index]);
+    }
+  Value = V;
+}
+
+void Statistic::foldShards() {
+  if (!Shards)
+    return;
+  sys::SmartScopedLock<true> Writer(*StatLock);
+  for (unsigned i = 0, e = Shards->size(); i != e; ++i) {
+    std::vector<sys::cas_flag> &Counts = (*Shards)[i]->Counts;
+    if (Index < Counts.size())
+      sys::AtomicAdd(&Value, takeCount(Counts[Index]));
+  }
+}
+
 namespace {
 
 struct NameCompare {
@@ -101,7 +209,17 @@ void llvm::EnableStatistics() {
   Enabled.setValue(true);
 }
 
+void StatisticInfo::sortStatistics() {
+  // Sort the fields by name.
+  std::stable_sort(Stats.begin(), Stats.end(), NameCompare());
+}
+
 void llvm::PrintStatistics(raw_ostream &OS) {
+  if (StatsFormat == StatsJSON)
+    return PrintStatisticsJSON(OS);
+  if (StatsFormat == StatsCSV)
+    return PrintStatisticsCSV(OS);
+
   StatisticInfo &Stats = *StatInfo;
 
   // Figure out how long the biggest Value and Name fields are.
@@ -113,8 +231,7 @@ void llvm::PrintStatistics(raw_ostream &OS) {
                           (unsigned)std::strlen(Stats.Stats[i]->getName()));
   }
 
-  // Sort the fields by name.
-  std::stable_sort(Stats.Stats.begin(), Stats.Stats.end(), NameCompare());
+  Stats.sortStatistics();
 
   // Print out the statistics header...
   OS << "===" << std::string(73, '-') << "===\n"
@@ -135,6 +252,55 @@ void llvm::PrintStatistics(raw_ostream &OS) {
 
 }
 
+/// WriteQuoted - Write Str as a JSON string, or as a CSV field if CSV is true.
+static void WriteQuoted(raw_ostream &OS, const char *Str, bool CSV) {
+  OS << '"';
+  for (; *Str; ++Str) {
+    unsigned char C = *Str;
+    if (C == '"')
+      OS << (CSV ? "\"\"" : "\\\"");
+    else if (!CSV && C == '\\')
+      OS << "\\\\";
+    else if (!CSV && C < 0x20)
+      OS << "\\u00" << hexdigit(C >> 4) << hexdigit(C & 15);
+    else
+      OS << C;
+  }
+  OS << '"';
+}
+
+void llvm::PrintStatisticsJSON(raw_ostream &OS) {
+  StatisticInfo &Stats = *StatInfo;
+  Stats.sortStatistics();
+
+  OS << "{\n  \"statistics\": [";
+  for (size_t i = 0, e = Stats.Stats.size(); i != e; ++i) {
+    const Statistic *S = Stats.Stats[i];
+    OS << (i ? ",\n" : "\n") << "    { \"pass\": ";
+    WriteQuoted(OS, S->getName(), false);
+    OS << ", \"desc\": ";
+    WriteQuoted(OS, S->getDesc(), false);
+    OS << ", \"value\": " << S->getValue() << " }";
+  }
+  OS << "\n  ]\n}\n";
+  OS.flush();
+}
+
+void llvm::PrintStatisticsCSV(raw_ostream &OS) {
+  StatisticInfo &Stats = *StatInfo;
+  Stats.sortStatistics();
+
+  OS << "pass,desc,value\n";
+  for (size_t i = 0, e = Stats.Stats.size(); i != e; ++i) {
+    const Statistic *S = Stats.Stats[i];
+    WriteQuoted(OS, S->getName(), true);
+    OS << ',';
+    WriteQuoted(OS, S->getDesc(), true);
+    OS << ',' << S->getValue() << '\n';
+  }
+  OS.flush();
+}
+
 void llvm::PrintStatistics() {
   StatisticInfo &Stats = *StatInfo;
 
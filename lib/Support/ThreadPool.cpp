@@ -0,0 +1,359 @@
+//===-- ThreadPool.cpp - Work stealing thread pool ------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the ThreadPool class.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/Mutex.h"
+#include "llvm/Support/ThreadLocal.h"
+#include "llvm/Config/config.h"
+#include <deque>
+#include <vector>
+using namespace llvm;
+
+static cl::opt<unsigned>
+Threads("threads", cl::desc("Number of worker threads for parallel work "
+                            "(default: number of processors)"),
+        cl::init(0));
+
+static ManagedStatic<ThreadPool> GlobalPool;
+
+ThreadPool &ThreadPool::getGlobalPool() {
+  return *GlobalPool;
+}
+
+#if defined(LLVM_MULTITHREADED) && defined(HAVE_PTHREAD_H)
+#include <pthread.h>
+#include <unistd.h>
+
+struct ThreadPool::Impl {
+  struct Task {
+    TaskFn Fn;
+    void *Arg;
+    TaskGroup *Group;
+  };
+
+  /// WorkQueue - The tasks queued on one worker, or on the shared queue.  The
+  /// owning worker pushes and pops at the front, thieves take from the back.
+  struct WorkQueue {
+    sys::Mutex Lock;
+    std::deque<Task> Tasks;
+
+    WorkQueue() : Lock(false) {}
+  };
+
+  struct Worker {
+    Impl *Pool;
+    unsigned Index;
+  };
+
+  /// CurrentWorker - The Worker running on the calling thread, if any.
+  static sys::ThreadLocal<const Worker> CurrentWorker;
+
+  /// WaitFrame - A waitUntilZero call on the stack of the calling thread.
+  /// Tasks run while waiting nest on the same stack, and a stolen task may
+  /// wait and steal in turn, so past MaxStealDepth nested waits a thread only
+  /// runs tasks from its own queue.  Those were spawned by the tasks it is
+  /// running, so this bounds the stack like a serial run would.
+  struct WaitFrame {
+    unsigned Depth;
+  };
+  static sys::ThreadLocal<const WaitFrame> CurrentWaitFrame;
+  enum { MaxStealDepth = 64 };
+
+  std::vector<WorkQueue*> Queues;   // One per worker.
+  WorkQueue Shared;                 // Tasks submitted from other threads.
+  std::vector<Worker> Workers;
+  std::vector<pthread_t> Threads;
+
+  /// Queued - The number of tasks in any queue.  Idle workers sleep on
+  /// WorkCond while this is zero.
+  volatile sys::cas_flag Queued;
+
+  /// Outstanding - The number of submitted tasks that have not finished.
+  volatile sys::cas_flag Outstanding;
+
+  /// SleepLock - Guards sleeping on WorkCond and DoneCond, NumWaiting and
+  /// Stopping.  Threads waiting for tasks to finish sleep on DoneCond.
+  pthread_mutex_t SleepLock;
+  pthread_cond_t WorkCond, DoneCond;
+  unsigned NumWaiting;
+  bool Stopping;
+
+  explicit Impl(unsigned N) : Workers(N), Queued(0), Outstanding(0),
+                              NumWaiting(0), Stopping(false) {
+    for (unsigned i = 0; i != N; ++i) {
+      Queues.push_back(new WorkQueue());
+      Workers[i].Pool = this;
+      Workers[i].Index = i;
+    }
+    ::pthread_mutex_init(&SleepLock, 0);
+    ::pthread_cond_init(&WorkCond, 0);
+    ::pthread_cond_init(&DoneCond, 0);
+  }
+
+  ~Impl() {
+    ::pthread_cond_destroy(&DoneCond);
+    ::pthread_cond_destroy(&WorkCond);
+    ::pthread_mutex_destroy(&SleepLock);
+    for (unsigned i = 0, e = Queues.size(); i != e; ++i)
+      delete Queues[i];
+  }
+
+  /// getSelf - Return the index of the calling thread's queue, or the number
+  /// of queues if it is not one of our workers.
+  unsigned getSelf() const {
+    const Worker *W = CurrentWorker.get();
+    if (W && W->Pool == this)
+      return W->Index;
+    return Queues.size();
+  }
+
+  void push(const Task &T) {
+    unsigned Self = getSelf();
+    if (Self != Queues.size()) {
+      WorkQueue &Q = *Queues[Self];
+      Q.Lock.acquire();
+      Q.Tasks.push_front(T);
+      Q.Lock.release();
+    } else {
+      Shared.Lock.acquire();
+      Shared.Tasks.push_back(T);
+      Shared.Lock.release();
+    }
+    sys::AtomicIncrement(&Queued);
+
+    ::pthread_mutex_lock(&SleepLock);
+    ::pthread_cond_signal(&WorkCond);
+    if (NumWaiting)
+      ::pthread_cond_broadcast(&DoneCond);
+    ::pthread_mutex_unlock(&SleepLock);
+  }
+
+  static bool popFront(WorkQueue &Q, Task &T) {
+    Q.Lock.acquire();
+    bool Found = !Q.Tasks.empty();
+    if (Found) {
+      T = Q.Tasks.front();
+      Q.Tasks.pop_front();
+    }
+    Q.Lock.release();
+    return Found;
+  }
+
+  static bool popBack(WorkQueue &Q, Task &T) {
+    Q.Lock.acquire();
+    bool Found = !Q.Tasks.empty();
+    if (Found) {
+      T = Q.Tasks.back();
+      Q.Tasks.pop_back();
+    }
+    Q.Lock.release();
+    return Found;
+  }
+
+  /// take - Find a task for queue Self to run: its own newest task, then the
+  /// oldest shared one, then the oldest task of another worker.
+  bool take(unsigned Self, Task &T) {
+    if (!Queued)
+      return false;
+    unsigned N = Queues.size();
+    bool Found = (Self != N && popFront(*Queues[Self], T)) ||
+                 popFront(Shared, T);
+    for (unsigned i = 1; !Found && i <= N; ++i) {
+      unsigned Victim = (Self + i) % (N + 1);
+      if (Victim != N)
+        Found = popBack(*Queues[Victim], T);
+    }
+    if (Found)
+      sys::AtomicDecrement(&Queued);
+    return Found;
+  }
+
+  /// takeOwn - Take the newest task from queue Self, if it is a worker's.
+  bool takeOwn(unsigned Self, Task &T) {
+    if (Self == Queues.size() || !popFront(*Queues[Self], T))
+      return false;
+    sys::AtomicDecrement(&Queued);
+    return true;
+  }
+
+  void run(const Task &T) {
+    T.Fn(T.Arg);
+
+    // The group may be destroyed as soon as its count reaches zero, so it
+    // must not be touched afterwards.
+    bool Wake = T.Group && sys::AtomicDecrement(&T.Group->Pending) == 0;
+    if (sys::AtomicDecrement(&Outstanding) == 0)
+      Wake = true;
+    if (Wake) {
+      ::pthread_mutex_lock(&SleepLock);
+      if (NumWaiting)
+        ::pthread_cond_broadcast(&DoneCond);
+      ::pthread_mutex_unlock(&SleepLock);
+    }
+  }
+
+  void waitUntilZero(volatile sys::cas_flag &Count) {
+    unsigned Self = getSelf();
+    const WaitFrame *Outer = CurrentWaitFrame.get();
+    WaitFrame Frame = { Outer ? Outer->Depth + 1 : 0 };
+    bool Steal = Frame.Depth < MaxStealDepth;
+    CurrentWaitFrame.set(&Frame);
+
+    Task T;
+    while (Count) {
+      if (Steal ? take(Self, T) : takeOwn(Self, T)) {
+        run(T);
+        continue;
+      }
+      // Only this thread pushes to its own queue, so if we cannot steal there
+      // is nothing left to do but sleep.
+      ::pthread_mutex_lock(&SleepLock);
+      if (Count && (!Steal || !Queued)) {
+        ++NumWaiting;
+        ::pthread_cond_wait(&DoneCond, &SleepLock);
+        --NumWaiting;
+      }
+      ::pthread_mutex_unlock(&SleepLock);
+    }
+    CurrentWaitFrame.set(Outer);
+  }
+
+  void workerLoop(unsigned Self) {
+    Task T;
+    while (true) {
+      if (take(Self, T)) {
+        run(T);
+        continue;
+      }
+      ::pthread_mutex_lock(&SleepLock);
+      while (!Queued && !Stopping)
+        ::pthread_cond_wait(&WorkCond, &SleepLock);
+      bool Stop = Stopping && !Queued;
+      ::pthread_mutex_unlock(&SleepLock);
+      if (Stop)
+        return;
+    }
+  }
+
+  static void *WorkerMain(void *Arg) {
+    const Worker *W = static_cast<const Worker*>(Arg);
+    CurrentWorker.set(W);
+    W->Pool->workerLoop(W->Index);
+    CurrentWorker.erase();
+    return 0;
+  }
+};
+
+sys::ThreadLocal<const ThreadPool::Impl::Worker>
+ThreadPool::Impl::CurrentWorker;
+sys::ThreadLocal<const ThreadPool::Impl::WaitFrame>
+ThreadPool::Impl::CurrentWaitFrame;
+
+ThreadPool::ThreadPool(unsigned NumThreads) : NumWorkers(0), P(0) {
+  if (NumThreads == 0)
+    NumThreads = getDefaultNumThreads();
+
+  P = new Impl(NumThreads);
+  for (unsigned i = 0; i != NumThreads; ++i) {
+    pthread_t Thread;
+    if (::pthread_create(&Thread, 0, Impl::WorkerMain, &P->Workers[i]) != 0)
+      break;
+    P->Threads.push_back(Thread);
+  }
+
+  // If no thread could be started, run tasks inline as if threads were not
+  // supported at all.  Otherwise the queues of workers that failed to start
+  // simply stay empty.
+  NumWorkers = P->Threads.size();
+  if (NumWorkers == 0) {
+    delete P;
+    P = 0;
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  if (!P)
+    return;
+  wait();
+
+  ::pthread_mutex_lock(&P->SleepLock);
+  P->Stopping = true;
+  ::pthread_cond_broadcast(&P->WorkCond);
+  ::pthread_mutex_unlock(&P->SleepLock);
+  for (unsigned i = 0, e = P->Threads.size(); i != e; ++i)
+    ::pthread_join(P->Threads[i], 0);
+  delete P;
+}
+
+void ThreadPool::enqueue(TaskFn Fn, void *Arg, TaskGroup *Group) {
+  if (!P) {
+    Fn(Arg);
+    if (Group)
+      sys::AtomicDecrement(&Group->Pending);
+    return;
+  }
+
+  Impl::Task T = { Fn, Arg, Group };
+  sys::AtomicIncrement(&P->Outstanding);
+  P->push(T);
+}
+
+void ThreadPool::waitUntilZero(volatile sys::cas_flag &Count) {
+  if (P)
+    P->waitUntilZero(Count);
+}
+
+void ThreadPool::wait() {
+  if (P)
+    P->waitUntilZero(P->Outstanding);
+}
+
+unsigned ThreadPool::getDefaultNumThreads() {
+  if (Threads)
+    return Threads;
+  long NumCPUs = ::sysconf(_SC_NPROCESSORS_ONLN);
+  return NumCPUs > 0 ? unsigned(NumCPUs) : 1;
+}
+
+#else
+
+// No non-pthread implementation, currently: tasks run on the thread that
+// submits them.
+
+struct ThreadPool::Impl {};
+
+ThreadPool::ThreadPool(unsigned NumThreads) : NumWorkers(0), P(0) {
+  (void) NumThreads;
+}
+
+ThreadPool::~ThreadPool() {}
+
+void ThreadPool::enqueue(TaskFn Fn, void *Arg, TaskGroup *Group) {
+  Fn(Arg);
+  if (Group)
+    sys::AtomicDecrement(&Group->Pending);
+}
+
+void ThreadPool::waitUntilZero(volatile sys::cas_flag &Count) {
+  (void) Count;
+}
+
+void ThreadPool::wait() {}
+
+unsigned ThreadPool::getDefaultNumThreads() {
+  return Threads ? unsigned(Threads) : 1;
+}
+
+#endif
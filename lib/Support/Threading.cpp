@@ -19,14 +19,14 @@
 
 using namespace llvm;
 
-static bool multithreaded_mode = false;
+bool llvm::MultithreadedMode = false;
 
 static sys::Mutex* global_lock = 0;
 
 bool llvm::llvm_start_multithreaded() {
 #ifdef LLVM_MULTITHREADED
-  assert(!multithreaded_mode && "Already multithreaded!");
-  multithreaded_mode = true;
+  assert(!MultithreadedMode && "Already multithreaded!");
+  MultithreadedMode = true;
   global_lock = new sys::Mutex(true);
 
   // We fence here to ensure that all initialization is complete BEFORE we
@@ -40,27 +40,23 @@ bool llvm::llvm_start_multithreaded() {
 
 void llvm::llvm_stop_multithreaded() {
 #ifdef LLVM_MULTITHREADED
-  assert(multithreaded_mode && "Not currently multithreaded!");
+  assert(MultithreadedMode && "Not currently multithreaded!");
 
   // We fence here to insure that all threaded operations are complete BEFORE we
   // return from llvm_stop_multithreaded().
   sys::MemoryFence();
 
-  multithreaded_mode = false;
+  MultithreadedMode = false;
   delete global_lock;
 #endif
 }
 
-bool llvm::llvm_is_multithreaded() {
-  return multithreaded_mode;
-}
-
 void llvm::llvm_acquire_global_lock() {
-  if (multithreaded_mode) global_lock->acquire();
+  if (MultithreadedMode) global_lock->acquire();
 }
 
 void llvm::llvm_release_global_lock() {
-  if (multithreaded_mode) global_lock->release();
+  if (MultithreadedMode) global_lock->release();
 }
 
 #if defined(LLVM_MULTITHREADED) && defined(HAVE_PTHREAD_H)
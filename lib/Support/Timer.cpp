@@ -47,6 +47,13 @@ namespace {
                                       "tracking (this may be slow)"),
              cl::Hidden);
 
+  static cl::opt<bool>
+  TrackPerfCounters("track-perf-counters",
+                    cl::desc("Enable -time-passes hardware performance "
+                             "counter tracking (cycles, instructions, cache "
+                             "and branch misses) where available"),
+                    cl::Hidden);
+
   static cl::opt<std::string, true>
   InfoOutputFilename("info-output-file", cl::value_desc("filename"),
                      cl::desc("File to append -stats and -timer output to"),
@@ -126,6 +133,14 @@ static inline size_t getMemUsage() {
   return sys::Process::GetMallocUsage();
 }
 
+/// getPerfCounts - Read the hardware performance counters into Counts if they
+/// are tracked.  If they are not available, Counts stays zero and the report
+/// simply leaves their columns out.
+static inline void getPerfCounts(uint64_t *Counts) {
+  if (TrackPerfCounters)
+    sys::Process::GetPerfCounters(Counts);
+}
+
 TimeRecord TimeRecord::getCurrentTime(bool Start) {
   TimeRecord Result;
   sys::TimeValue now(0,0), user(0,0), sys(0,0);
@@ -133,7 +148,9 @@ TimeRecord TimeRecord::getCurrentTime(bool Start) {
   if (Start) {
     Result.MemUsed = getMemUsage();
     sys::Process::GetTimeUsage(now, user, sys);
+    getPerfCounts(Result.PerfCounts);
   } else {
+    getPerfCounts(Result.PerfCounts);
     sys::Process::GetTimeUsage(now, user, sys);
     Result.MemUsed = getMemUsage();
   }
@@ -187,6 +204,12 @@ void TimeRecord::print(const TimeRecord &Total, raw_ostream &OS) const {
   
   if (Total.getMemUsed())
     OS << format("%9lld", (long long)getMemUsed()) << "  ";
+
+  for (unsigned i = 0; i != sys::Process::NumPerfCounters; ++i) {
+    sys::Process::PerfCounter C = sys::Process::PerfCounter(i);
+    if (Total.getPerfCount(C))
+      OS << format("%14llu", (unsigned long long)getPerfCount(C)) << "  ";
+  }
 }
 
 
@@ -348,6 +371,13 @@ void TimerGroup::PrintQueuedTimers(raw_ostream &OS) {
   OS << "   ---Wall Time---";
   if (Total.getMemUsed())
     OS << "  ---Mem---";
+  static const char *const PerfHeaders[sys::Process::NumPerfCounters] = {
+    "  ----Cycles----", "  -Instructions-",
+    "  --Cache Miss--", "  --Branch Miss-"
+  };
+  for (unsigned i = 0; i != sys::Process::NumPerfCounters; ++i)
+    if (Total.getPerfCount(sys::Process::PerfCounter(i)))
+      OS << PerfHeaders[i];
   OS << "  --- Name ---\n";
   
   // Loop through all of the timing data, printing it out.
@@ -518,6 +518,25 @@ uint64_t raw_fd_ostream::seek(uint64_t off) {
   return pos;
 }
 
+bool raw_fd_ostream::supportsSeeking() {
+  // Only a regular file can be written over in place, and not one opened for
+  // appending, where every write goes to the end of the file.
+  assert(FD >= 0 && "File already closed.");
+  struct stat statbuf;
+  if (fstat(FD, &statbuf) != 0 || (statbuf.st_mode & S_IFMT) != S_IFREG)
+    return false;
+#if defined(F_GETFL) && defined(O_APPEND)
+  int Flags = fcntl(FD, F_GETFL);
+  if (Flags == -1 || (Flags & O_APPEND))
+    return false;
+#endif
+
+  // The position we report must also agree with the file's, which it does not
+  // when "-" names a file that already had something written to it.
+  flush();
+  return ::lseek(FD, 0, SEEK_CUR) == static_cast<off_t>(pos);
+}
+
 size_t raw_fd_ostream::preferred_buffer_size() const {
 #if !defined(_MSC_VER) && !defined(__MINGW32__) && !defined(__minix)
   // Windows and Minix have no st_blksize.
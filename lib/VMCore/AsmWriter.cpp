@@ -37,11 +37,21 @@
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/FormattedStream.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
 #include <algorithm>
 #include <cctype>
+#include <deque>
 #include <map>
 using namespace llvm;
 
+unsigned llvm::PrintModuleThreads = 1;
+static cl::opt<unsigned, true>
+PrintThreads("print-threads", cl::location(PrintModuleThreads),
+             cl::desc("Number of threads Module::print renders function "
+                      "bodies on (0: one per processor)"));
+
 // Make virtual table appear in this compilation unit.
 AssemblyAnnotationWriter::~AssemblyAnnotationWriter() {}
 
@@ -151,6 +161,10 @@ void TypePrinting::addTypeName(const Type *Ty, const std::string &N) {
   getTypeNamesMap(TypeNames).insert(std::make_pair(Ty, N));
 }
 
+void TypePrinting::copyTypeNames(const TypePrinting &Other) {
+  getTypeNamesMap(TypeNames) = getTypeNamesMap(Other.TypeNames);
+}
+
 
 TypePrinting::TypePrinting() {
   TypeNames = new DenseMap<const Type *, std::string>();
@@ -487,11 +501,19 @@ private:
   /// mdnMap - Map for MDNodes.
   DenseMap<const MDNode*, unsigned> mdnMap;
   unsigned mdnNext;
+
+  /// ModuleSlots - If set, module level and metadata slots are looked up
+  /// there, and only function level slots are kept here.
+  SlotTracker *ModuleSlots;
 public:
   /// Construct from a module
   explicit SlotTracker(const Module *M);
   /// Construct from a function, starting out in incorp state.
   explicit SlotTracker(const Function *F);
+  /// Construct for functions of the module of ModuleSlots, which must have
+  /// incorporated the metadata of every function already.  Several of these
+  /// may share ModuleSlots on different threads.
+  explicit SlotTracker(SlotTracker &ModuleSlots);
 
   /// Return the slot number of the specified value in it's type
   /// plane.  If something is not in the SlotTracker, return -1.
@@ -511,6 +533,10 @@ public:
   /// will reset the state of the machine back to just the module contents.
   void purgeFunction();
 
+  /// incorporateFunctionMetadata - Create slots for the metadata used by F,
+  /// as incorporating and printing F would.
+  void incorporateFunctionMetadata(const Function *F);
+
   /// MDNode map iterators.
   typedef DenseMap<const MDNode*, unsigned>::iterator mdn_iterator;
   mdn_iterator mdn_begin() { return mdnMap.begin(); }
@@ -539,6 +565,9 @@ private:
   /// Add all of the functions arguments, basic blocks, and instructions.
   void processFunction();
 
+  /// Add the metadata used by an instruction.
+  void processInstructionMetadata(const Instruction *I);
+
   SlotTracker(const SlotTracker &);  // DO NOT IMPLEMENT
   void operator=(const SlotTracker &);  // DO NOT IMPLEMENT
 };
@@ -585,14 +614,21 @@ static SlotTracker *createSlotTracker(const Value *V) {
 // to be added to the slot table.
 SlotTracker::SlotTracker(const Module *M)
   : TheModule(M), TheFunction(0), FunctionProcessed(false), 
-    mNext(0), fNext(0),  mdnNext(0) {
+    mNext(0), fNext(0),  mdnNext(0), ModuleSlots(0) {
 }
 
 // Function level constructor. Causes the contents of the Module and the one
 // function provided to be added to the slot table.
 SlotTracker::SlotTracker(const Function *F)
   : TheModule(F ? F->getParent() : 0), TheFunction(F), FunctionProcessed(false),
-    mNext(0), fNext(0), mdnNext(0) {
+    mNext(0), fNext(0), mdnNext(0), ModuleSlots(0) {
+}
+
+// Constructor for a function level table that shares the module level one of
+// another SlotTracker.
+SlotTracker::SlotTracker(SlotTracker &MS)
+  : TheModule(0), TheFunction(0), FunctionProcessed(false),
+    mNext(0), fNext(0), mdnNext(0), ModuleSlots(&MS) {
 }
 
 inline void SlotTracker::initialize() {
@@ -648,8 +684,6 @@ void SlotTracker::processFunction() {
 
   ST_DEBUG("Inserting Instructions:\n");
 
-  SmallVector<std::pair<unsigned, MDNode*>, 4> MDForInst;
-
   // Add all of the basic blocks and instructions with no names.
   for (Function::const_iterator BB = TheFunction->begin(),
        E = TheFunction->end(); BB != E; ++BB) {
@@ -660,23 +694,10 @@ void SlotTracker::processFunction() {
          ++I) {
       if (!I->getType()->isVoidTy() && !I->hasName())
         CreateFunctionSlot(I);
-      
-      // Intrinsics can directly use metadata.  We allow direct calls to any
-      // llvm.foo function here, because the target may not be linked into the
-      // optimizer.
-      if (const CallInst *CI = dyn_cast<CallInst>(I)) {
-        if (Function *F = CI->getCalledFunction())
-          if (F->getName().startswith("llvm."))
-            for (unsigned i = 0, e = I->getNumOperands(); i != e; ++i)
-              if (MDNode *N = dyn_cast_or_null<MDNode>(I->getOperand(i)))
-                CreateMetadataSlot(N);
-      }
 
-      // Process metadata attached with this instruction.
-      I->getAllMetadata(MDForInst);
-      for (unsigned i = 0, e = MDForInst.size(); i != e; ++i)
-        CreateMetadataSlot(MDForInst[i].second);
-      MDForInst.clear();
+      // The metadata of the module is numbered by ModuleSlots.
+      if (!ModuleSlots)
+        processInstructionMetadata(I);
     }
   }
 
@@ -685,6 +706,35 @@ void SlotTracker::processFunction() {
   ST_DEBUG("end processFunction!\n");
 }
 
+void SlotTracker::processInstructionMetadata(const Instruction *I) {
+  // Intrinsics can directly use metadata.  We allow direct calls to any
+  // llvm.foo function here, because the target may not be linked into the
+  // optimizer.
+  if (const CallInst *CI = dyn_cast<CallInst>(I)) {
+    if (Function *F = CI->getCalledFunction())
+      if (F->getName().startswith("llvm."))
+        for (unsigned i = 0, e = I->getNumOperands(); i != e; ++i)
+          if (MDNode *N = dyn_cast_or_null<MDNode>(I->getOperand(i)))
+            CreateMetadataSlot(N);
+  }
+
+  // Process metadata attached with this instruction.
+  SmallVector<std::pair<unsigned, MDNode*>, 4> MDForInst;
+  I->getAllMetadata(MDForInst);
+  for (unsigned i = 0, e = MDForInst.size(); i != e; ++i)
+    CreateMetadataSlot(MDForInst[i].second);
+}
+
+void SlotTracker::incorporateFunctionMetadata(const Function *F) {
+  // Named metadata comes first.
+  initialize();
+
+  for (Function::const_iterator BB = F->begin(), E = F->end(); BB != E; ++BB)
+    for (BasicBlock::const_iterator I = BB->begin(), E = BB->end(); I != E;
+         ++I)
+      processInstructionMetadata(I);
+}
+
 /// Clean up after incorporating a function. This is the only way to get out of
 /// the function incorporation state that affects get*Slot/Create*Slot. Function
 /// incorporation state is indicated by TheFunction != 0.
@@ -701,6 +751,9 @@ int SlotTracker::getGlobalSlot(const GlobalValue *V) {
   // Check for uninitialized state and do lazy initialization.
   initialize();
 
+  if (ModuleSlots)
+    return ModuleSlots->getGlobalSlot(V);
+
   // Find the type plane in the module map
   ValueMap::iterator MI = mMap.find(V);
   return MI == mMap.end() ? -1 : (int)MI->second;
@@ -711,6 +764,9 @@ int SlotTracker::getMetadataSlot(const MDNode *N) {
   // Check for uninitialized state and do lazy initialization.
   initialize();
 
+  if (ModuleSlots)
+    return ModuleSlots->getMetadataSlot(N);
+
   // Find the type plane in the module map
   mdn_iterator MI = mdnMap.find(N);
   return MI == mdnMap.end() ? -1 : (int)MI->second;
@@ -1255,6 +1311,15 @@ public:
     AddModuleTypesToPrinter(TypePrinter, NumberedTypes, M);
   }
 
+  /// AssemblyWriter ctor - Make a writer for functions of the module Parent
+  /// prints, which names types the same way Parent does.
+  AssemblyWriter(formatted_raw_ostream &o, SlotTracker &Mac,
+                 const AssemblyWriter &Parent)
+    : Out(o), Machine(Mac), TheModule(Parent.TheModule),
+      AnnotationWriter(Parent.AnnotationWriter) {
+    TypePrinter.copyTypeNames(Parent.TypePrinter);
+  }
+
   void printMDNodeBody(const MDNode *MD);
   void printNamedMDNode(const NamedMDNode *NMD);
   
@@ -1277,6 +1342,35 @@ private:
   // printInfoComment - Print a little comment after the instruction indicating
   // which slot it occupies.
   void printInfoComment(const Value &V);
+
+  // printFunctionsConcurrently - Print the functions of M on NumThreads
+  // threads.  Return false without printing anything if that can't be done.
+  bool printFunctionsConcurrently(const Module *M, unsigned NumThreads);
+};
+
+/// FunctionRange - A range of functions that one task of a concurrent
+/// printModule prints into a buffer of its own.
+struct FunctionRange {
+  Module::const_iterator Begin, End;
+  SmallString<1024> Buffer;
+  raw_svector_ostream OS;
+  formatted_raw_ostream Out;
+  SlotTracker Machine;
+  AssemblyWriter Writer;
+  TaskGroup Group;
+
+  FunctionRange(Module::const_iterator B, Module::const_iterator E,
+                SlotTracker &ModuleSlots, const AssemblyWriter &Parent,
+                ThreadPool &Pool)
+    : Begin(B), End(E), OS(Buffer), Out(OS), Machine(ModuleSlots),
+      Writer(Out, Machine, Parent), Group(Pool) {}
+
+  static void print(void *Arg) {
+    FunctionRange *R = static_cast<FunctionRange*>(Arg);
+    for (Module::const_iterator I = R->Begin; I != R->End; ++I)
+      R->Writer.printFunction(I);
+    R->Out.flush();
+  }
 };
 }  // end of anonymous namespace
 
@@ -1374,8 +1468,13 @@ void AssemblyWriter::printModule(const Module *M) {
     printAlias(I);
 
   // Output all of the functions.
-  for (Module::const_iterator I = M->begin(), E = M->end(); I != E; ++I)
-    printFunction(I);
+  unsigned NumThreads = PrintModuleThreads;
+  if (NumThreads == 0)
+    NumThreads = ThreadPool::getDefaultNumThreads();
+  if (NumThreads < 2 || AnnotationWriter ||
+      !printFunctionsConcurrently(M, NumThreads))
+    for (Module::const_iterator I = M->begin(), E = M->end(); I != E; ++I)
+      printFunction(I);
 
   // Output named metadata.
   if (!M->named_metadata_empty()) Out << '\n';
@@ -1391,6 +1490,59 @@ void AssemblyWriter::printModule(const Module *M) {
   }
 }
 
+/// functionSize - Return the amount of text printing F takes, counted in
+/// instructions.
+static unsigned functionSize(const Function *F) {
+  unsigned Size = 1;
+  for (Function::const_iterator BB = F->begin(), E = F->end(); BB != E; ++BB)
+    Size += BB->size();
+  return Size;
+}
+
+bool AssemblyWriter::printFunctionsConcurrently(const Module *M,
+                                                unsigned NumThreads) {
+  unsigned NumDefined = 0;
+  for (Module::const_iterator I = M->begin(), E = M->end(); I != E; ++I)
+    if (!I->isDeclaration())
+      ++NumDefined;
+  if (NumDefined < 2 || !llvm_is_multithreaded())
+    return false;
+
+  // Number the metadata of all functions up front, in the order printing
+  // them one by one would, so that the tasks only read the module slots.
+  uint64_t TotalSize = 0;
+  for (Module::const_iterator I = M->begin(), E = M->end(); I != E; ++I) {
+    Machine.incorporateFunctionMetadata(I);
+    TotalSize += functionSize(I);
+  }
+
+  // Cut the functions into ranges of about RangeSize instructions and print
+  // a few ranges per thread ahead of the one being written out.  That keeps
+  // the threads busy while bounding the text held in buffers.
+  unsigned RangeSize =
+    unsigned(std::min(TotalSize / (NumThreads * 4) + 1, uint64_t(8192)));
+  ThreadPool Pool(NumThreads - 1);
+  std::deque<FunctionRange*> Ranges;
+  Module::const_iterator I = M->begin(), E = M->end();
+  while (I != E || !Ranges.empty()) {
+    if (I != E && Ranges.size() < NumThreads * 2) {
+      Module::const_iterator Begin = I;
+      for (unsigned Size = 0; I != E && Size < RangeSize; ++I)
+        Size += functionSize(I);
+      Ranges.push_back(new FunctionRange(Begin, I, Machine, *this, Pool));
+      Ranges.back()->Group.spawn(FunctionRange::print, Ranges.back());
+      continue;
+    }
+
+    FunctionRange *R = Ranges.front();
+    Ranges.pop_front();
+    R->Group.wait();
+    Out << R->OS.str();
+    delete R;
+  }
+  return true;
+}
+
 void AssemblyWriter::printNamedMDNode(const NamedMDNode *NMD) {
   Out << "!" << NMD->getName() << " = !{";
   for (unsigned i = 0, e = NMD->getNumOperands(); i != e; ++i) {
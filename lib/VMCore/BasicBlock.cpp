@@ -41,7 +41,8 @@ template class llvm::SymbolTableListTraits<Instruction, BasicBlock>;
 
 BasicBlock::BasicBlock(LLVMContext &C, const Twine &Name, Function *NewParent,
                        BasicBlock *InsertBefore)
-  : Value(Type::getLabelTy(C), Value::BasicBlockVal), Parent(0) {
+  : Value(Type::getLabelTy(C), Value::BasicBlockVal), Parent(0),
+    InstOrderValid(false) {
 
   // Make sure that we get added to a function
   LeakDetector::addGarbageObject(this);
@@ -308,3 +309,13 @@ BasicBlock *BasicBlock::splitBasicBlock(iterator I, const Twine &BBName) {
   return New;
 }
 
+
+/// renumberInstructions - Assign increasing Order values to every instruction
+/// in this block and mark the numbering as valid.
+///
+void BasicBlock::renumberInstructions() const {
+  unsigned Order = 0;
+  for (const_iterator I = begin(), E = end(); I != E; ++I)
+    I->Order = Order++;
+  InstOrderValid = true;
+}
@@ -2140,7 +2140,11 @@ void ConstantExpr::replaceUsesOfWithOnConstant(Value *From, Value *ToV,
       if (Val == From) Val = To;
       Indices.push_back(Val);
     }
-    Replacement = ConstantExpr::getGetElementPtr(Pointer,
+    if (cast<GEPOperator>(this)->isInBounds())
+      Replacement = ConstantExpr::getInBoundsGetElementPtr(Pointer,
+                                                 &Indices[0], Indices.size());
+    else
+      Replacement = ConstantExpr::getGetElementPtr(Pointer,
                                                  &Indices[0], Indices.size());
   } else if (getOpcode() == Instruction::ExtractValue) {
     Constant *Agg = getOperand(0);
@@ -18,6 +18,9 @@
 #include "llvm/InlineAsm.h"
 #include "llvm/Instructions.h"
 #include "llvm/Operator.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/raw_ostream.h"
@@ -300,9 +303,21 @@ struct OperandTraits<CompareConstantExpr> :
 };
 DEFINE_TRANSPARENT_OPERAND_ACCESSORS(CompareConstantExpr, Value)
 
+/// getConstantOperandsHash - Mix the operand pointers of a constant into a
+/// hash value for the uniquing tables.
+static inline unsigned
+getConstantOperandsHash(const std::vector<Constant*> &Ops) {
+  unsigned Hash = Ops.size();
+  for (unsigned i = 0, e = Ops.size(); i != e; ++i)
+    Hash = Hash * 37 + DenseMapInfo<Constant*>::getHashValue(Ops[i]);
+  return Hash;
+}
+
 struct ExprMapKeyType {
   typedef SmallVector<unsigned, 4> IndexList;
 
+  ExprMapKeyType() : opcode(0), subclassoptionaldata(0), subclassdata(0) {}
+
   ExprMapKeyType(unsigned opc,
       const std::vector<Constant*> &ops,
       unsigned short flags = 0,
@@ -336,9 +351,19 @@ struct ExprMapKeyType {
   bool operator!=(const ExprMapKeyType& that) const {
     return !(*this == that);
   }
+
+  unsigned getHashValue() const {
+    unsigned Hash = getConstantOperandsHash(operands);
+    Hash = Hash * 37 + (opcode | (subclassoptionaldata << 8) |
+                        (subclassdata << 16));
+    for (unsigned i = 0, e = indices.size(); i != e; ++i)
+      Hash = Hash * 37 + indices[i];
+    return Hash;
+  }
 };
 
 struct InlineAsmKeyType {
+  InlineAsmKeyType() : has_side_effects(false), is_align_stack(false) {}
   InlineAsmKeyType(StringRef AsmString,
                    StringRef Constraints, bool hasSideEffects,
                    bool isAlignStack)
@@ -369,6 +394,12 @@ struct InlineAsmKeyType {
   bool operator!=(const InlineAsmKeyType& that) const {
     return !(*this == that);
   }
+
+  unsigned getHashValue() const {
+    unsigned Hash = HashString(asm_string);
+    Hash = Hash * 37 + HashString(constraints);
+    return Hash * 4 + has_side_effects * 2 + is_align_stack;
+  }
 };
 
 // The number of operands for each ConstantCreator::create method is
@@ -570,28 +601,62 @@ struct ConstantKeyData<InlineAsm> {
   }
 };
 
-template<class ValType, class TypeClass, class ConstantClass,
-         bool HasLargeKey = false /*true for arrays and structs*/ >
+/// ConstantMapKeyInfo - DenseMapInfo for the (type, value) keys of a
+/// ConstantUniqueMap.  The empty and tombstone keys are distinguished by the
+/// type pointer alone, so comparing against them never looks at the value.
+template<class TypeClass, class ValType>
+struct ConstantMapKeyInfo {
+  typedef std::pair<const TypeClass*, ValType> KeyTy;
+  typedef DenseMapInfo<const TypeClass*> TypeInfo;
+
+  static inline KeyTy getEmptyKey() {
+    return KeyTy(TypeInfo::getEmptyKey(), ValType());
+  }
+  static inline KeyTy getTombstoneKey() {
+    return KeyTy(TypeInfo::getTombstoneKey(), ValType());
+  }
+  static unsigned getHashValue(const KeyTy &Key) {
+    return DenseMapInfo<std::pair<unsigned, unsigned> >::getHashValue(
+             std::make_pair(TypeInfo::getHashValue(Key.first),
+                            getValTypeHash(Key.second)));
+  }
+  static bool isEqual(const KeyTy &LHS, const KeyTy &RHS) {
+    return LHS.first == RHS.first && LHS.second == RHS.second;
+  }
+
+private:
+  static unsigned getValTypeHash(char) { return 0; }
+  static unsigned getValTypeHash(const std::vector<Constant*> &Ops) {
+    return getConstantOperandsHash(Ops);
+  }
+  static unsigned getValTypeHash(const ExprMapKeyType &Key) {
+    return Key.getHashValue();
+  }
+  static unsigned getValTypeHash(const InlineAsmKeyType &Key) {
+    return Key.getHashValue();
+  }
+};
+
+/// ConstantUniqueMap - The uniquing table for one kind of constant.  Constants
+/// are looked up by hashing their type and their ValType key.  For abstract
+/// types we additionally track which constants use each type, so that they
+/// can be rehashed when the type is refined.
+template<class ValType, class TypeClass, class ConstantClass>
 class ConstantUniqueMap : public AbstractTypeUser {
 public:
   typedef std::pair<const TypeClass*, ValType> MapKey;
-  typedef std::map<MapKey, ConstantClass *> MapTy;
-  typedef std::map<ConstantClass *, typename MapTy::iterator> InverseMapTy;
-  typedef std::map<const DerivedType*, typename MapTy::iterator>
-    AbstractTypeMapTy;
+  typedef ConstantMapKeyInfo<TypeClass, ValType> MapInfo;
+  typedef DenseMap<MapKey, ConstantClass *, MapInfo> MapTy;
+  typedef SmallPtrSet<ConstantClass *, 4> AbstractTypeUsersTy;
+  typedef std::map<const DerivedType*, AbstractTypeUsersTy> AbstractTypeMapTy;
 private:
   /// Map - This is the main map from the element descriptor to the Constants.
   /// This is the primary way we avoid creating two of the same shape
   /// constant.
   MapTy Map;
-    
-  /// InverseMap - If "HasLargeKey" is true, this contains an inverse mapping
-  /// from the constants to their element in Map.  This is important for
-  /// removal of constants from the array, which would otherwise have to scan
-  /// through the map with very large keys.
-  InverseMapTy InverseMap;
 
-  /// AbstractTypeMap - Map for abstract type constants.
+  /// AbstractTypeMap - For each abstract type that we are registered as a
+  /// user of, the set of constants in Map that have that type.
   ///
   AbstractTypeMapTy AbstractTypeMap;
     
@@ -611,7 +676,8 @@ public:
   /// If the element exists in the map, the returned iterator points to the
   /// entry and Exists=true.  If not, the iterator points to the newly
   /// inserted entry and returns Exists=false.  Newly inserted entries have
-  /// I->second == 0, and should be filled in.
+  /// I->second == 0, and should be filled in.  The returned iterator is only
+  /// valid until the next insertion into the map.
   typename MapTy::iterator InsertOrGetItem(std::pair<MapKey, ConstantClass *>
                                  &InsertVal,
                                  bool &Exists) {
@@ -622,14 +688,6 @@ public:
     
 private:
   typename MapTy::iterator FindExistingElement(ConstantClass *CP) {
-    if (HasLargeKey) {
-      typename InverseMapTy::iterator IMI = InverseMap.find(CP);
-      assert(IMI != InverseMap.end() && IMI->second != Map.end() &&
-             IMI->second->second == CP &&
-             "InverseMap corrupt!");
-      return IMI->second;
-    }
-      
     typename MapTy::iterator I =
       Map.find(MapKey(static_cast<const TypeClass*>(CP->getRawType()),
                       ConstantKeyData<ConstantClass>::getValType(CP)));
@@ -642,7 +700,7 @@ private:
     return I;
   }
     
-  void AddAbstractTypeUser(const Type *Ty, typename MapTy::iterator I) {
+  void AddAbstractTypeUser(const Type *Ty, ConstantClass *C) {
     // If the type of the constant is abstract, make sure that an entry
     // exists for it in the AbstractTypeMap.
     if (Ty->isAbstract()) {
@@ -653,23 +711,21 @@ private:
         // Add ourselves to the ATU list of the type.
         cast<DerivedType>(DTy)->addAbstractTypeUser(this);
 
-        AbstractTypeMap.insert(TI, std::make_pair(DTy, I));
+        TI = AbstractTypeMap.insert(TI,
+                      std::make_pair(DTy, AbstractTypeUsersTy()));
       }
+      TI->second.insert(C);
     }
   }
 
-  ConstantClass* Create(const TypeClass *Ty, const ValType &V,
-                        typename MapTy::iterator I) {
+  ConstantClass* Create(const TypeClass *Ty, const ValType &V) {
     ConstantClass* Result =
       ConstantCreator<ConstantClass,TypeClass,ValType>::create(Ty, V);
 
     assert(Result->getType() == Ty && "Type specified is not correct!");
-    I = Map.insert(I, std::make_pair(MapKey(Ty, V), Result));
-
-    if (HasLargeKey)  // Remember the reverse mapping if needed.
-      InverseMap.insert(std::make_pair(Result, I));
+    Map.insert(std::make_pair(MapKey(Ty, V), Result));
 
-    AddAbstractTypeUser(Ty, I);
+    AddAbstractTypeUser(Ty, Result);
       
     return Result;
   }
@@ -678,56 +734,31 @@ public:
   /// getOrCreate - Return the specified constant from the map, creating it if
   /// necessary.
   ConstantClass *getOrCreate(const TypeClass *Ty, const ValType &V) {
-    MapKey Lookup(Ty, V);
-    ConstantClass* Result = 0;
-    
-    typename MapTy::iterator I = Map.find(Lookup);
+    typename MapTy::iterator I = Map.find(MapKey(Ty, V));
     // Is it in the map?  
     if (I != Map.end())
-      Result = I->second;
-        
-    if (!Result) {
-      // If no preexisting value, create one now...
-      Result = Create(Ty, V, I);
-    }
-        
-    return Result;
+      return I->second;
+
+    // If no preexisting value, create one now...
+    return Create(Ty, V);
   }
 
-  void UpdateAbstractTypeMap(const DerivedType *Ty,
-                             typename MapTy::iterator I) {
-    assert(AbstractTypeMap.count(Ty) &&
+  /// UpdateAbstractTypeMap - C, a constant of abstract type Ty, is leaving
+  /// this map or changing its type.  Forget about it, and if it was the last
+  /// constant of that type, stop listening for refinements of Ty.
+  void UpdateAbstractTypeMap(const DerivedType *Ty, ConstantClass *C) {
+    typename AbstractTypeMapTy::iterator ATI = AbstractTypeMap.find(Ty);
+    assert(ATI != AbstractTypeMap.end() &&
            "Abstract type not in AbstractTypeMap?");
-    typename MapTy::iterator &ATMEntryIt = AbstractTypeMap[Ty];
-    if (ATMEntryIt == I) {
-      // Yes, we are removing the representative entry for this type.
-      // See if there are any other entries of the same type.
-      typename MapTy::iterator TmpIt = ATMEntryIt;
-
-      // First check the entry before this one...
-      if (TmpIt != Map.begin()) {
-        --TmpIt;
-        if (TmpIt->first.first != Ty) // Not the same type, move back...
-          ++TmpIt;
-      }
-
-      // If we didn't find the same type, try to move forward...
-      if (TmpIt == ATMEntryIt) {
-        ++TmpIt;
-        if (TmpIt == Map.end() || TmpIt->first.first != Ty)
-          --TmpIt;   // No entry afterwards with the same type
-      }
-
-      // If there is another entry in the map of the same abstract type,
-      // update the AbstractTypeMap entry now.
-      if (TmpIt != ATMEntryIt) {
-        ATMEntryIt = TmpIt;
-      } else {
-        // Otherwise, we are removing the last instance of this type
-        // from the table.  Remove from the ATM, and from user list.
-        cast<DerivedType>(Ty)->removeAbstractTypeUser(this);
-        AbstractTypeMap.erase(Ty);
-      }
+    bool Erased = ATI->second.erase(C);
+    assert(Erased && "Constant not registered with its abstract type!");
+    (void)Erased;
+
+    if (ATI->second.empty()) {
+      // We are removing the last instance of this type from the table.
+      // Remove from the ATM, and from user list.
+      AbstractTypeMap.erase(ATI);
+      cast<DerivedType>(Ty)->removeAbstractTypeUser(this);
     }
   }
 
@@ -736,14 +767,10 @@ public:
     assert(I != Map.end() && "Constant not found in constant table!");
     assert(I->second == CP && "Didn't find correct element?");
 
-    if (HasLargeKey)  // Remember the reverse mapping if needed.
-      InverseMap.erase(CP);
-      
-    // Now that we found the entry, make sure this isn't the entry that
-    // the AbstractTypeMap points to.
+    // Now that we found the entry, make sure the AbstractTypeMap forgets it.
     const TypeClass *Ty = I->first.first;
     if (Ty->isAbstract())
-      UpdateAbstractTypeMap(static_cast<const DerivedType *>(Ty), I);
+      UpdateAbstractTypeMap(static_cast<const DerivedType *>(Ty), CP);
 
     Map.erase(I);
   }
@@ -753,34 +780,14 @@ public:
   /// fact.
   void MoveConstantToNewSlot(ConstantClass *C, typename MapTy::iterator I) {
     // First, remove the old location of the specified constant in the map.
+    // Erasing from a DenseMap does not invalidate the other iterators, so I
+    // stays valid.  The constant keeps its type, so the AbstractTypeMap needs
+    // no update.
     typename MapTy::iterator OldI = FindExistingElement(C);
     assert(OldI != Map.end() && "Constant not found in constant table!");
     assert(OldI->second == C && "Didn't find correct element?");
-      
-    // If this constant is the representative element for its abstract type,
-    // update the AbstractTypeMap so that the representative element is I.
-    //
-    // This must use getRawType() because if the type is under refinement, we
-    // will get the refineAbstractType callback below, and we don't want to
-    // kick union find in on the constant.
-    if (C->getRawType()->isAbstract()) {
-      typename AbstractTypeMapTy::iterator ATI =
-          AbstractTypeMap.find(cast<DerivedType>(C->getRawType()));
-      assert(ATI != AbstractTypeMap.end() &&
-             "Abstract type not in AbstractTypeMap?");
-      if (ATI->second == OldI)
-        ATI->second = I;
-    }
-      
-    // Remove the old entry from the map.
+    assert(I->second == C && "Bad new map entry!");
     Map.erase(OldI);
-    
-    // Update the inverse map so that we know that this constant is now
-    // located at descriptor I.
-    if (HasLargeKey) {
-      assert(I->second == C && "Bad inversemap entry!");
-      InverseMap[C] = I;
-    }
   }
     
   void refineAbstractType(const DerivedType *OldTy, const Type *NewTy) {
@@ -793,7 +800,7 @@ public:
     // leaving will remove() itself, causing the AbstractTypeMapEntry to be
     // eliminated eventually.
     do {
-      ConstantClass *C = I->second->second;
+      ConstantClass *C = *I->second.begin();
       MapKey Key(cast<TypeClass>(NewTy),
                  ConstantKeyData<ConstantClass>::getValType(C));
 
@@ -805,20 +812,15 @@ public:
         
         // Remove the old entry.
         typename MapTy::iterator OldI =
-          Map.find(MapKey(cast<TypeClass>(OldTy), IP.first->first.second));
+          Map.find(MapKey(cast<TypeClass>(OldTy), Key.second));
         assert(OldI != Map.end() && "Constant not in map!");
-        UpdateAbstractTypeMap(OldTy, OldI);
         Map.erase(OldI);
+        UpdateAbstractTypeMap(OldTy, C);
 
         // Set the constant's type. This is done in place!
         setType(C, NewTy);
 
-        // Update the inverse map so that we know that this constant is now
-        // located at descriptor I.
-        if (HasLargeKey)
-          InverseMap[C] = IP.first;
-
-        AddAbstractTypeUser(NewTy, IP.first);
+        AddAbstractTypeUser(NewTy, C);
       } else {
         // The map already had an appropriate constant in the new type, so
         // there's no longer a need for the old constant.
@@ -98,10 +98,10 @@ bool DominatorTree::dominates(const Instruction *A, const Instruction *B) const{
   if (isa<PHINode>(A) && isa<PHINode>(B)) 
     return false;
   
-  // Loop through the basic block until we find A or B.
-  BasicBlock::const_iterator I = BBA->begin();
-  for (; &*I != A && &*I != B; ++I)
-    /*empty*/;
-  
-  return &*I == A;
+  // An invoke is not itself positioned in its normal destination block.
+  if (A->getParent() != BBB)
+    return false;
+
+  // Otherwise A dominates B iff it is B or appears before it in the block.
+  return A == B || A->comesBefore(B);
 }
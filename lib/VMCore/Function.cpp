@@ -154,7 +154,8 @@ void Function::eraseFromParent() {
 Function::Function(const FunctionType *Ty, LinkageTypes Linkage,
                    const Twine &name, Module *ParentModule)
   : GlobalValue(PointerType::getUnqual(Ty), 
-                Value::FunctionVal, 0, 0, Linkage, name) {
+                Value::FunctionVal, 0, 0, Linkage, name),
+    ModificationCount(0) {
   assert(FunctionType::isValidReturnType(getReturnType()) &&
          !getReturnType()->isOpaqueTy() && "invalid return type");
   SymTab = new ValueSymbolTable();
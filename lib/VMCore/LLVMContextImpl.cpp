@@ -52,6 +52,21 @@ struct DropReferences {
 };
 }
 
+ValueHandleTable::~ValueHandleTable() {
+  for (unsigned i = 0, e = Chunks.size(); i != e; ++i)
+    delete[] Chunks[i];
+}
+
+/// grow - Return the index of a list that has never been used, adding a chunk
+/// if they are all taken.
+unsigned ValueHandleTable::grow() {
+  if ((NumSlots & (ChunkSize - 1)) == 0)
+    Chunks.push_back(new ValueHandleBase*[ChunkSize]);
+  unsigned Idx = ++NumSlots;
+  getHead(Idx) = 0;
+  return Idx;
+}
+
 LLVMContextImpl::~LLVMContextImpl() {
   // NOTE: We need to delete the contents of OwnedModules, but we have to
   // duplicate it into a temporary vector, because the destructor of Module
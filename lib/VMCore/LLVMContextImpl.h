@@ -113,6 +113,106 @@ public:
   virtual void allUsesReplacedWith(Value *VNew);
 };
   
+/// ValueHandleTable - The heads of the lists of value handles that are
+/// watching values.  A value with handles holds the index of its list head in
+/// Value::HandleListIdx, so creating, destroying and RAUW'ing handles finds the
+/// list with an array access instead of a hash lookup.  The heads are kept in
+/// fixed-size chunks that never move, because the first handle on each list
+/// points back at its head.
+class ValueHandleTable {
+  enum { ChunkShift = 10, ChunkSize = 1 << ChunkShift };
+
+  std::vector<ValueHandleBase**> Chunks;
+  std::vector<unsigned> FreeSlots;
+  unsigned NumSlots;
+
+  ValueHandleTable(const ValueHandleTable&); // DO NOT IMPLEMENT
+  void operator=(const ValueHandleTable&);   // DO NOT IMPLEMENT
+public:
+  ValueHandleTable() : NumSlots(0) {}
+  ~ValueHandleTable();
+
+  /// getHead - Return the head of list Idx.  Indices start at one.
+  ValueHandleBase *&getHead(unsigned Idx) {
+    --Idx;
+    return Chunks[Idx >> ChunkShift][Idx & (ChunkSize - 1)];
+  }
+
+  /// allocate - Return the index of a new, empty list.
+  unsigned allocate() {
+    if (FreeSlots.empty())
+      return grow();
+    unsigned Idx = FreeSlots.back();
+    FreeSlots.pop_back();
+    return Idx;
+  }
+
+  /// release - Free list Idx, which must be empty.
+  void release(unsigned Idx) {
+    assert(getHead(Idx) == 0 && "Releasing a list that still has handles!");
+    FreeSlots.push_back(Idx);
+  }
+
+  /// size - Return the number of lists in use.
+  unsigned size() const { return NumSlots - FreeSlots.size(); }
+
+private:
+  unsigned grow();
+};
+
+/// MDAttachmentList - The metadata attached to an instruction, other than its
+/// debug location.  Attachments are kept sorted by kind, so the fixed kinds,
+/// which have the lowest IDs, come first: the TBAA tag that alias analysis
+/// asks every load and store for is found with a single compare.
+class MDAttachmentList {
+  typedef std::pair<unsigned, TrackingVH<MDNode> > MDPairTy;
+  SmallVector<MDPairTy, 2> Attachments;
+
+  /// find - Return the first attachment whose kind is not less than KindID.
+  const MDPairTy *find(unsigned KindID) const {
+    const MDPairTy *I = Attachments.begin(), *E = Attachments.end();
+    while (I != E && I->first < KindID)
+      ++I;
+    return I;
+  }
+  MDPairTy *find(unsigned KindID) {
+    return const_cast<MDPairTy*>(
+      static_cast<const MDAttachmentList*>(this)->find(KindID));
+  }
+
+public:
+  bool empty() const { return Attachments.empty(); }
+  void clear() { Attachments.clear(); }
+
+  MDNode *lookup(unsigned KindID) const {
+    const MDPairTy *I = find(KindID);
+    if (I != Attachments.end() && I->first == KindID)
+      return I->second;
+    return 0;
+  }
+
+  void set(unsigned KindID, MDNode *Node) {
+    MDPairTy *I = find(KindID);
+    if (I != Attachments.end() && I->first == KindID)
+      I->second = Node;
+    else
+      Attachments.insert(I, std::make_pair(KindID, TrackingVH<MDNode>(Node)));
+  }
+
+  void erase(unsigned KindID) {
+    MDPairTy *I = find(KindID);
+    if (I != Attachments.end() && I->first == KindID)
+      Attachments.erase(I);
+  }
+
+  /// getAll - Append the attachments to Result, in order of kind.
+  void getAll(SmallVectorImpl<std::pair<unsigned, MDNode*> > &Result) const {
+    for (const MDPairTy *I = Attachments.begin(), *E = Attachments.end();
+         I != E; ++I)
+      Result.push_back(std::make_pair(I->first, (MDNode*)I->second));
+  }
+};
+
 class LLVMContextImpl {
 public:
   /// OwnedModules - The set of modules instantiated in this context, and which
@@ -142,11 +242,11 @@ public:
   ConstantUniqueMap<char, Type, ConstantAggregateZero> AggZeroConstants;
 
   typedef ConstantUniqueMap<std::vector<Constant*>, ArrayType,
-    ConstantArray, true /*largekey*/> ArrayConstantsTy;
+    ConstantArray> ArrayConstantsTy;
   ArrayConstantsTy ArrayConstants;
   
   typedef ConstantUniqueMap<std::vector<Constant*>, StructType,
-    ConstantStruct, true /*largekey*/> StructConstantsTy;
+    ConstantStruct> StructConstantsTy;
   StructConstantsTy StructConstants;
   
   typedef ConstantUniqueMap<std::vector<Constant*>, VectorType,
@@ -204,22 +304,20 @@ public:
   OpaqueType *const AlwaysOpaqueTy;
 
 
-  /// ValueHandles - This map keeps track of all of the value handles that are
-  /// watching a Value*.  The Value::HasValueHandle bit is used to know
-  // whether or not a value has an entry in this map.
-  typedef DenseMap<Value*, ValueHandleBase*> ValueHandlesTy;
-  ValueHandlesTy ValueHandles;
+  /// ValueHandles - The lists of value handles watching each Value*.
+  ValueHandleTable ValueHandles;
   
   /// CustomMDKindNames - Map to hold the metadata string to ID mapping.
   StringMap<unsigned> CustomMDKindNames;
   
-  typedef std::pair<unsigned, TrackingVH<MDNode> > MDPairTy;
-  typedef SmallVector<MDPairTy, 2> MDMapTy;
+  /// MetadataStore - The metadata attached to instructions in this context,
+  /// other than their debug locations, indexed by Instruction::MetadataSlot
+  /// minus one.
+  std::vector<MDAttachmentList> MetadataStore;
+
+  /// FreeMetadataSlots - Slots in MetadataStore that no instruction uses.
+  std::vector<unsigned> FreeMetadataSlots;
 
-  /// MetadataStore - Collection of per-instruction metadata used in this
-  /// context.
-  DenseMap<const Instruction *, MDMapTy> MetadataStore;
-  
   /// ScopeRecordIdx - This is the index in ScopeRecords for an MDNode scope
   /// entry with no "inlined at" element.
   DenseMap<MDNode*, int> ScopeRecordIdx;
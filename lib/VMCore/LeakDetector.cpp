@@ -34,7 +34,11 @@ void LeakDetector::addGarbageObjectImpl(void *Object) {
   Objects->addGarbage(Object);
 }
 
+// Values are tracked by their context, but these still take the lock: the
+// sentinels of every module's global and alias lists live in the global
+// context, whichever context (and thread) the module belongs to.
 void LeakDetector::addGarbageObjectImpl(const Value *Object) {
+  sys::SmartScopedLock<true> Lock(*ObjectsLock);
   LLVMContextImpl *pImpl = Object->getContext().pImpl;
   pImpl->LLVMObjects.addGarbage(Object);
 }
@@ -45,6 +49,7 @@ void LeakDetector::removeGarbageObjectImpl(void *Object) {
 }
 
 void LeakDetector::removeGarbageObjectImpl(const Value *Object) {
+  sys::SmartScopedLock<true> Lock(*ObjectsLock);
   LLVMContextImpl *pImpl = Object->getContext().pImpl;
   pImpl->LLVMObjects.removeGarbage(Object);
 }
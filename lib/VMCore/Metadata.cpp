@@ -440,123 +440,75 @@ MDNode *Instruction::getMetadataImpl(const char *Kind) const {
 void Instruction::setMetadata(unsigned KindID, MDNode *Node) {
   if (Node == 0 && !hasMetadata()) return;
 
-  // Handle 'dbg' as a special case since it is not stored in the hash table.
+  // Handle 'dbg' as a special case since it is not stored in the attachments.
   if (KindID == LLVMContext::MD_dbg) {
     DbgLoc = DebugLoc::getFromDILocation(Node);
     return;
   }
   
+  LLVMContextImpl *pImpl = getContext().pImpl;
+
   // Handle the case when we're adding/updating metadata on an instruction.
   if (Node) {
-    LLVMContextImpl::MDMapTy &Info = getContext().pImpl->MetadataStore[this];
-    assert(!Info.empty() == hasMetadataHashEntry() &&
-           "HasMetadata bit is wonked");
-    if (Info.empty()) {
-      setHasMetadataHashEntry(true);
-    } else {
-      // Handle replacement of an existing value.
-      for (unsigned i = 0, e = Info.size(); i != e; ++i)
-        if (Info[i].first == KindID) {
-          Info[i].second = Node;
-          return;
-        }
+    if (!MetadataSlot) {
+      if (pImpl->FreeMetadataSlots.empty()) {
+        pImpl->MetadataStore.push_back(MDAttachmentList());
+        MetadataSlot = pImpl->MetadataStore.size();
+      } else {
+        MetadataSlot = pImpl->FreeMetadataSlots.back();
+        pImpl->FreeMetadataSlots.pop_back();
+      }
     }
-
-    // No replacement, just add it to the list.
-    Info.push_back(std::make_pair(KindID, Node));
+    pImpl->MetadataStore[MetadataSlot - 1].set(KindID, Node);
     return;
   }
 
-  // Otherwise, we're removing metadata from an instruction.
-  assert(hasMetadataHashEntry() &&
-         getContext().pImpl->MetadataStore.count(this) &&
-         "HasMetadata bit out of date!");
-  LLVMContextImpl::MDMapTy &Info = getContext().pImpl->MetadataStore[this];
-
-  // Common case is removing the only entry.
-  if (Info.size() == 1 && Info[0].first == KindID) {
-    getContext().pImpl->MetadataStore.erase(this);
-    setHasMetadataHashEntry(false);
-    return;
-  }
-
-  // Handle removal of an existing value.
-  for (unsigned i = 0, e = Info.size(); i != e; ++i)
-    if (Info[i].first == KindID) {
-      Info[i] = Info.back();
-      Info.pop_back();
-      assert(!Info.empty() && "Removing last entry should be handled above");
-      return;
-    }
-  // Otherwise, removing an entry that doesn't exist on the instruction.
+  // Otherwise, we're removing metadata from an instruction.  Removing an entry
+  // that doesn't exist on the instruction does nothing.
+  if (!MetadataSlot) return;
+  MDAttachmentList &Attachments = pImpl->MetadataStore[MetadataSlot - 1];
+  Attachments.erase(KindID);
+  if (Attachments.empty())
+    clearMetadataAttachments();
 }
 
 MDNode *Instruction::getMetadataImpl(unsigned KindID) const {
-  // Handle 'dbg' as a special case since it is not stored in the hash table.
+  // Handle 'dbg' as a special case since it is not stored in the attachments.
   if (KindID == LLVMContext::MD_dbg)
     return DbgLoc.getAsMDNode(getContext());
   
-  if (!hasMetadataHashEntry()) return 0;
-  
-  LLVMContextImpl::MDMapTy &Info = getContext().pImpl->MetadataStore[this];
-  assert(!Info.empty() && "bit out of sync with hash table");
-
-  for (LLVMContextImpl::MDMapTy::iterator I = Info.begin(), E = Info.end();
-       I != E; ++I)
-    if (I->first == KindID)
-      return I->second;
-  return 0;
+  if (!MetadataSlot) return 0;
+  return getContext().pImpl->MetadataStore[MetadataSlot - 1].lookup(KindID);
 }
 
 void Instruction::getAllMetadataImpl(SmallVectorImpl<std::pair<unsigned,
                                        MDNode*> > &Result) const {
   Result.clear();
   
-  // Handle 'dbg' as a special case since it is not stored in the hash table.
-  if (!DbgLoc.isUnknown()) {
+  // Handle 'dbg' as a special case since it is not stored in the attachments.
+  // Its kind is zero, so it sorts first.
+  if (!DbgLoc.isUnknown())
     Result.push_back(std::make_pair((unsigned)LLVMContext::MD_dbg,
                                     DbgLoc.getAsMDNode(getContext())));
-    if (!hasMetadataHashEntry()) return;
-  }
-  
-  assert(hasMetadataHashEntry() &&
-         getContext().pImpl->MetadataStore.count(this) &&
-         "Shouldn't have called this");
-  const LLVMContextImpl::MDMapTy &Info =
-    getContext().pImpl->MetadataStore.find(this)->second;
-  assert(!Info.empty() && "Shouldn't have called this");
-
-  Result.append(Info.begin(), Info.end());
-
-  // Sort the resulting array so it is stable.
-  if (Result.size() > 1)
-    array_pod_sort(Result.begin(), Result.end());
+  if (MetadataSlot)
+    getContext().pImpl->MetadataStore[MetadataSlot - 1].getAll(Result);
 }
 
 void Instruction::
 getAllMetadataOtherThanDebugLocImpl(SmallVectorImpl<std::pair<unsigned,
                                     MDNode*> > &Result) const {
   Result.clear();
-  assert(hasMetadataHashEntry() &&
-         getContext().pImpl->MetadataStore.count(this) &&
-         "Shouldn't have called this");
-  const LLVMContextImpl::MDMapTy &Info =
-  getContext().pImpl->MetadataStore.find(this)->second;
-  assert(!Info.empty() && "Shouldn't have called this");
-  
-  Result.append(Info.begin(), Info.end());
-  
-  // Sort the resulting array so it is stable.
-  if (Result.size() > 1)
-    array_pod_sort(Result.begin(), Result.end());
+  assert(MetadataSlot && "Shouldn't have called this");
+  getContext().pImpl->MetadataStore[MetadataSlot - 1].getAll(Result);
 }
 
 
-/// clearMetadataHashEntries - Clear all hashtable-based metadata from
-/// this instruction.
-void Instruction::clearMetadataHashEntries() {
-  assert(hasMetadataHashEntry() && "Caller should check");
-  getContext().pImpl->MetadataStore.erase(this);
-  setHasMetadataHashEntry(false);
+/// clearMetadataAttachments - Clear all metadata other than the debug
+/// location from this instruction, and give its slot back to the context.
+void Instruction::clearMetadataAttachments() {
+  assert(MetadataSlot && "Caller should check");
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  pImpl->MetadataStore[MetadataSlot - 1].clear();
+  pImpl->FreeMetadataSlots.push_back(MetadataSlot);
+  MetadataSlot = 0;
 }
-
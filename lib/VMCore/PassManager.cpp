@@ -25,6 +25,10 @@
 #include "llvm/Support/PassNameParser.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/Mutex.h"
+#include "llvm/Support/ValueHandle.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include <algorithm>
 #include <cstdio>
 #include <map>
@@ -213,6 +217,165 @@ char BBPassManager::ID = 0;
 
 namespace llvm {
 
+//===----------------------------------------------------------------------===//
+// FunctionAnalysisCache
+//
+/// FunctionAnalysisCache keeps the results of function analyses between runs
+/// of a FunctionPassManager.  Every function gets its own instance of each
+/// cached analysis, tagged with the function's modification count at the
+/// time the result was last known to be up to date.
+class FunctionAnalysisCache {
+  /// CachedIDs - The analyses whose results are kept.  A function's
+  /// modification count says nothing about other functions or globals, so
+  /// only analyses that depend on the function alone may be in here.
+  SmallPtrSet<AnalysisID, 4> CachedIDs;
+
+public:
+  struct Entry {
+    /// Analysis - The analysis pass scheduled in the manager.  Result is the
+    /// function's own instance of it.
+    Pass *Analysis;
+    Pass *Result;
+
+    /// ModificationCount - The function's modification count when Result
+    /// was last known to be up to date.
+    unsigned ModificationCount;
+
+    /// Generation - Bumped every time Result is recomputed.
+    unsigned Generation;
+
+    /// Uses - The cached analyses Result was computed from, with their
+    /// generation at that time.
+    SmallVector<std::pair<Entry *, unsigned>, 2> Uses;
+
+    explicit Entry(Pass *A)
+      : Analysis(A), Result(0), ModificationCount(0), Generation(0) {}
+  };
+
+private:
+  /// FunctionResults - The entries of one function, freed with it.
+  class FunctionResults : public CallbackVH {
+    FunctionAnalysisCache *Cache;
+  public:
+    std::vector<Entry *> Entries;
+
+    FunctionResults(Function *F, FunctionAnalysisCache *C)
+      : CallbackVH(F), Cache(C) {}
+
+    virtual void deleted() {
+      Cache->release(*cast<Function>(getValPtr()));
+    }
+  };
+
+  DenseMap<const Function *, FunctionResults *> Functions;
+
+  /// Spares - Instances of each analysis whose results were out of date and
+  /// have been released, for reuse on the next function instead of creating
+  /// new ones.
+  DenseMap<const Pass *, std::vector<Pass *> > Spares;
+
+public:
+  ~FunctionAnalysisCache() {
+    while (!Functions.empty())
+      release(*Functions.begin()->first);
+    for (DenseMap<const Pass *, std::vector<Pass *> >::iterator
+           I = Spares.begin(), E = Spares.end(); I != E; ++I)
+      for (unsigned i = 0, e = I->second.size(); i != e; ++i)
+        delete I->second[i];
+  }
+
+  /// addAnalysis - Keep the results of the analysis ID.
+  void addAnalysis(AnalysisID ID) { CachedIDs.insert(ID); }
+
+  /// isCached - Return true if the results of the analysis ID are kept.
+  bool isCached(AnalysisID ID) const { return CachedIDs.count(ID); }
+
+  /// takeSpare - Return a released instance of the analysis pass Analysis,
+  /// or null if there is none.
+  Pass *takeSpare(const Pass *Analysis) {
+    DenseMap<const Pass *, std::vector<Pass *> >::iterator I =
+      Spares.find(Analysis);
+    if (I == Spares.end() || I->second.empty())
+      return 0;
+    Pass *P = I->second.back();
+    I->second.pop_back();
+    return P;
+  }
+
+  /// getEntry - Return F's entry for the analysis pass Analysis, creating an
+  /// empty one if there is none yet.
+  Entry *getEntry(Function &F, Pass *Analysis) {
+    FunctionResults *&FR = Functions[&F];
+    if (!FR)
+      FR = new FunctionResults(&F, this);
+    for (unsigned i = 0, e = FR->Entries.size(); i != e; ++i)
+      if (FR->Entries[i]->Analysis == Analysis)
+        return FR->Entries[i];
+    FR->Entries.push_back(new Entry(Analysis));
+    return FR->Entries.back();
+  }
+
+  /// findResult - Return F's entry whose result is the pass P, or null if P
+  /// is not one of F's cached results.
+  Entry *findResult(const Function &F, const Pass *P) const {
+    if (const std::vector<Entry *> *Entries = getEntries(F))
+      for (unsigned i = 0, e = Entries->size(); i != e; ++i)
+        if ((*Entries)[i]->Result == P)
+          return (*Entries)[i];
+    return 0;
+  }
+
+  /// getEntries - Return F's entries, or null if it has none.
+  const std::vector<Entry *> *getEntries(const Function &F) const {
+    DenseMap<const Function *, FunctionResults *>::const_iterator I =
+      Functions.find(&F);
+    return I == Functions.end() ? 0 : &I->second->Entries;
+  }
+
+  /// releaseStale - Release the results of F that are out of date, along
+  /// with the results computed from them, so that results which have to be
+  /// recomputed anyway don't pile up.  The entries themselves are kept.
+  void releaseStale(const Function &F) {
+    const std::vector<Entry *> *Entries = getEntries(F);
+    if (!Entries)
+      return;
+    // An entry is never created before the entries it uses.
+    for (unsigned i = 0, e = Entries->size(); i != e; ++i) {
+      Entry *E = (*Entries)[i];
+      if (!E->Result)
+        continue;
+      bool Stale = E->ModificationCount != F.getModificationCount();
+      for (unsigned j = 0, je = E->Uses.size(); j != je && !Stale; ++j)
+        Stale = !E->Uses[j].first->Result ||
+                E->Uses[j].first->Generation != E->Uses[j].second;
+      if (Stale) {
+        E->Result->releaseMemory();
+        Spares[E->Analysis].push_back(E->Result);
+        E->Result = 0;
+      }
+    }
+  }
+
+  /// release - Free all of the results cached for F.
+  void release(const Function &F) {
+    DenseMap<const Function *, FunctionResults *>::iterator I =
+      Functions.find(&F);
+    if (I == Functions.end())
+      return;
+    FunctionResults *FR = I->second;
+    Functions.erase(I);
+    for (unsigned i = 0, e = FR->Entries.size(); i != e; ++i) {
+      Entry *E = FR->Entries[i];
+      if (E->Result) {
+        E->Result->releaseMemory();
+        delete E->Result;
+      }
+      delete E;
+    }
+    delete FR;
+  }
+};
+
 //===----------------------------------------------------------------------===//
 // FunctionPassManagerImpl
 //
@@ -222,6 +385,7 @@ class FunctionPassManagerImpl : public Pass,
                                 public PMTopLevelManager {
 private:
   bool wasRun;
+  OwningPtr<FunctionAnalysisCache> AnalysisCache;
 public:
   static char ID;
   explicit FunctionPassManagerImpl(int Depth) :
@@ -245,6 +409,19 @@ public:
   // from a previous run.
   void releaseMemoryOnTheFly();
 
+  /// cacheAnalysis - Keep the results of the analysis ID between runs.
+  void cacheAnalysis(AnalysisID ID) {
+    if (!AnalysisCache)
+      AnalysisCache.reset(new FunctionAnalysisCache());
+    AnalysisCache->addAnalysis(ID);
+  }
+
+  /// releaseCachedAnalyses - Free the analysis results kept for F.
+  void releaseCachedAnalyses(Function &F) {
+    if (AnalysisCache)
+      AnalysisCache->release(F);
+  }
+
   /// run - Execute all of the passes scheduled for execution.  Keep track of
   /// whether any of the passes modifies the module, and if so, return true.
   bool run(Function &F);
@@ -895,7 +1072,7 @@ void PMDataManager::freePass(Pass *P, StringRef Msg,
                              enum PassDebuggingString DBG_STR) {
   dumpPassInfo(P, FREEING_MSG, DBG_STR, Msg);
 
-  {
+  if (!TPM->CachedResultPasses.count(P)) {
     // If the pass crashes releasing memory, remember this.
     PassManagerPrettyStackEntry X(P);
     TimeRegion PassTimer(getPassTimer(P));
@@ -1047,6 +1224,19 @@ void PMDataManager::initializeAnalysisImpl(Pass *P) {
   }
 }
 
+/// clearAnalysisImpls - Forget the analyses the contained passes, and those of
+/// any lower level managers among them, were connected to.
+void PMDataManager::clearAnalysisImpls() {
+  for (SmallVector<Pass *, 16>::iterator I = PassVector.begin(),
+         E = PassVector.end(); I != E; ++I) {
+    AnalysisResolver *AR = (*I)->getResolver();
+    assert(AR && "Analysis Resolver is not set");
+    AR->clearAnalysisImpls();
+    if (PMDataManager *PM = (*I)->getAsPMDataManager())
+      PM->clearAnalysisImpls();
+  }
+}
+
 /// Find the pass that implements Analysis AID. If desired pass is not found
 /// then return NULL.
 Pass *PMDataManager::findAnalysisPass(AnalysisID AID, bool SearchParent) {
@@ -1377,6 +1567,14 @@ bool FunctionPassManager::doFinalization() {
   return FPM->doFinalization(*M);
 }
 
+void FunctionPassManager::cacheAnalysis(char &ID) {
+  FPM->cacheAnalysis(&ID);
+}
+
+void FunctionPassManager::releaseCachedAnalyses(Function &F) {
+  FPM->releaseCachedAnalyses(F);
+}
+
 //===----------------------------------------------------------------------===//
 // FunctionPassManagerImpl implementation
 //
@@ -1408,6 +1606,10 @@ void FPPassManager::cleanup() {
     AnalysisResolver *AR = FP->getResolver();
     assert(AR && "Analysis Resolver is not set");
     AR->clearAnalysisImpls();
+    // The passes of lower level managers hold on to the analyses of the
+    // function they ran on last too, which may be cached results for it.
+    if (PMDataManager *PM = FP->getAsPMDataManager())
+      PM->clearAnalysisImpls();
  }
 }
 
@@ -1430,8 +1632,10 @@ bool FunctionPassManagerImpl::run(Function &F) {
   TimingInfo::createTheTimeInfo();
 
   initializeAllAnalysisInfo();
-  for (unsigned Index = 0; Index < getNumContainedManagers(); ++Index)
+  for (unsigned Index = 0; Index < getNumContainedManagers(); ++Index) {
+    getContainedManager(Index)->setAnalysisCache(AnalysisCache.get());
     Changed |= getContainedManager(Index)->runOnFunction(F);
+  }
 
   for (unsigned Index = 0; Index < getNumContainedManagers(); ++Index)
     getContainedManager(Index)->cleanup();
@@ -1471,11 +1675,19 @@ bool FPPassManager::runOnFunction(Function &F) {
     FunctionPass *FP = getContainedPass(Index);
     bool LocalChanged = false;
 
+    if (AnalysisCache && runCachedAnalysis(FP, F)) {
+      TPM->CachedResultPasses.insert(FP);
+      removeDeadPasses(FP, F.getName(), ON_FUNCTION_MSG);
+      continue;
+    }
+    TPM->CachedResultPasses.erase(FP);
+
     dumpPassInfo(FP, EXECUTION_MSG, ON_FUNCTION_MSG, F.getName());
     dumpRequiredSet(FP);
 
     initializeAnalysisImpl(FP);
 
+    unsigned ModificationCount = F.getModificationCount();
     {
       PassManagerPrettyStackEntry X(FP, F);
       TimeRegion PassTimer(getPassTimer(FP));
@@ -1484,18 +1696,109 @@ bool FPPassManager::runOnFunction(Function &F) {
     }
 
     Changed |= LocalChanged;
-    if (LocalChanged)
+    if (LocalChanged) {
+      F.markModified();
       dumpPassInfo(FP, MODIFICATION_MSG, ON_FUNCTION_MSG, F.getName());
+    }
     dumpPreservedSet(FP);
 
     verifyPreservedAnalysis(FP);
     removeNotPreservedAnalysis(FP);
+    if (AnalysisCache && F.getModificationCount() != ModificationCount)
+      preserveCachedAnalyses(F, ModificationCount);
     recordAvailableAnalysis(FP);
     removeDeadPasses(FP, F.getName(), ON_FUNCTION_MSG);
   }
+
+  if (AnalysisCache)
+    AnalysisCache->releaseStale(F);
   return Changed;
 }
 
+bool FPPassManager::runCachedAnalysis(Pass *AP, Function &F) {
+  if (!AnalysisCache->isCached(AP->getPassID()) ||
+      AP->getPassKind() != PT_Function || AP->getAsPMDataManager())
+    return false;
+  const PassInfo *PI =
+    PassRegistry::getPassRegistry()->getPassInfo(AP->getPassID());
+  if (!PI || !PI->isAnalysis() || !PI->getNormalCtor())
+    return false;
+
+  // The result may only depend on F itself, so everything AP requires has to
+  // be an immutable pass or one of F's cached analyses.
+  SmallVector<std::pair<FunctionAnalysisCache::Entry *, unsigned>, 2> Uses;
+  const AnalysisUsage::VectorType &RequiredSet =
+    TPM->findAnalysisUsage(AP)->getRequiredSet();
+  for (AnalysisUsage::VectorType::const_iterator I = RequiredSet.begin(),
+         E = RequiredSet.end(); I != E; ++I) {
+    Pass *Impl = findAnalysisPass(*I, true);
+    if (Impl && Impl->getAsImmutablePass())
+      continue;
+    FunctionAnalysisCache::Entry *Used =
+      Impl ? AnalysisCache->findResult(F, Impl) : 0;
+    if (!Used)
+      return false;
+    Uses.push_back(std::make_pair(Used, Used->Generation));
+  }
+
+  // Reuse the result if neither F nor anything it was computed from changed.
+  FunctionAnalysisCache::Entry *Cached = AnalysisCache->getEntry(F, AP);
+  if (!Cached->Result ||
+      Cached->ModificationCount != F.getModificationCount() ||
+      Cached->Uses != Uses) {
+    dumpPassInfo(AP, EXECUTION_MSG, ON_FUNCTION_MSG, F.getName());
+    dumpRequiredSet(AP);
+
+    FunctionPass *Result = static_cast<FunctionPass *>(Cached->Result);
+    if (Result) {
+      Result->releaseMemory();
+    } else if ((Result = static_cast<FunctionPass *>(
+                  AnalysisCache->takeSpare(AP))) == 0) {
+      Result = static_cast<FunctionPass *>(PI->createPass());
+      Result->setResolver(new AnalysisResolver(*this));
+      Result->doInitialization(*F.getParent());
+    }
+    Cached->Result = Result;
+
+    AnalysisResolver *AR = Result->getResolver();
+    for (AnalysisUsage::VectorType::const_iterator I = RequiredSet.begin(),
+           E = RequiredSet.end(); I != E; ++I)
+      AR->addAnalysisImplsPair(*I, findAnalysisPass(*I, true));
+    {
+      PassManagerPrettyStackEntry X(AP, F);
+      TimeRegion PassTimer(getPassTimer(AP));
+
+      Result->runOnFunction(F);
+    }
+    AR->clearAnalysisImpls();
+
+    Cached->ModificationCount = F.getModificationCount();
+    ++Cached->Generation;
+    Cached->Uses = Uses;
+  }
+
+  recordAvailableAnalysis(Cached->Result);
+  return true;
+}
+
+void FPPassManager::preserveCachedAnalyses(Function &F, unsigned OldCount) {
+  const std::vector<FunctionAnalysisCache::Entry *> *Entries =
+    AnalysisCache->getEntries(F);
+  if (!Entries)
+    return;
+
+  // Only results that are still available were kept up to date.  Passes
+  // that declare an analysis preserved only update it if it is available,
+  // and a manager of lower level passes claims to preserve everything and
+  // leaves it to the passes it runs to drop what they invalidate.
+  for (unsigned i = 0, e = Entries->size(); i != e; ++i) {
+    FunctionAnalysisCache::Entry *E = (*Entries)[i];
+    if (E->ModificationCount == OldCount &&
+        findAnalysisPass(E->Analysis->getPassID(), false) == E->Result)
+      E->ModificationCount = F.getModificationCount();
+  }
+}
+
 bool FPPassManager::runOnModule(Module &M) {
   bool Changed = doInitialization(M);
 
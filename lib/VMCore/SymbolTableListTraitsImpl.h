@@ -17,10 +17,37 @@
 #define LLVM_SYMBOLTABLELISTTRAITS_IMPL_H
 
 #include "llvm/SymbolTableListTraits.h"
+#include "llvm/Function.h"
 #include "llvm/ValueSymbolTable.h"
 
 namespace llvm {
 
+/// invalidateParentIListOrdering - Notify the owner of a list that the
+/// relative order of its elements may have changed.  Only basic blocks cache
+/// an ordering of their contents; every other owner ignores this.
+template<typename ItemParentClass>
+inline void invalidateParentIListOrdering(ItemParentClass *) {}
+
+inline void invalidateParentIListOrdering(BasicBlock *BB) {
+  BB->invalidateOrders();
+}
+
+/// noteFunctionBodyChanged - Notify the function containing a list that an
+/// element was added to, removed from or moved within it.  Only instruction
+/// and basic block lists are part of a function body; the argument list is
+/// built lazily and does not count as a change.
+template<typename ValueSubClass, typename ItemParentClass>
+inline void noteFunctionBodyChanged(ValueSubClass *, ItemParentClass *) {}
+
+inline void noteFunctionBodyChanged(Instruction *, BasicBlock *BB) {
+  if (Function *F = BB->getParent())
+    F->markModified();
+}
+
+inline void noteFunctionBodyChanged(BasicBlock *, Function *F) {
+  F->markModified();
+}
+
 /// setSymTabObject - This is called when (f.e.) the parent of a basic block
 /// changes.  This requires us to remove all the instruction symtab entries from
 /// the current function and reinsert them into the new function.
@@ -68,6 +95,8 @@ void SymbolTableListTraits<ValueSubClass,ItemParentClass>
   assert(V->getParent() == 0 && "Value already in a container!!");
   ItemParentClass *Owner = getListOwner();
   V->setParent(Owner);
+  invalidateParentIListOrdering(Owner);
+  noteFunctionBodyChanged(V, Owner);
   if (V->hasName())
     if (ValueSymbolTable *ST = TraitsClass::getSymTab(Owner))
       ST->reinsertValue(V);
@@ -76,6 +105,7 @@ void SymbolTableListTraits<ValueSubClass,ItemParentClass>
 template<typename ValueSubClass, typename ItemParentClass>
 void SymbolTableListTraits<ValueSubClass,ItemParentClass>
 ::removeNodeFromList(ValueSubClass *V) {
+  noteFunctionBodyChanged(V, getListOwner());
   V->setParent(0);
   if (V->hasName())
     if (ValueSymbolTable *ST = TraitsClass::getSymTab(getListOwner()))
@@ -87,9 +117,15 @@ void SymbolTableListTraits<ValueSubClass,ItemParentClass>
 ::transferNodesFromList(ilist_traits<ValueSubClass> &L2,
                         ilist_iterator<ValueSubClass> first,
                         ilist_iterator<ValueSubClass> last) {
-  // We only have to do work here if transferring instructions between BBs
+  // The transferred nodes land at a new position, even when they are only
+  // being moved around within the same list.
   ItemParentClass *NewIP = getListOwner(), *OldIP = L2.getListOwner();
+  invalidateParentIListOrdering(NewIP);
+  noteFunctionBodyChanged(&*first, NewIP);
+
+  // We only have to do work here if transferring instructions between BBs
   if (NewIP == OldIP) return;  // No work to do at all...
+  noteFunctionBodyChanged(&*first, OldIP);
 
   // We only have to update symbol table entries if we are transferring the
   // instructions to a different symtab object...
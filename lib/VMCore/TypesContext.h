@@ -15,6 +15,7 @@
 #ifndef LLVM_TYPESCONTEXT_H
 #define LLVM_TYPESCONTEXT_H
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/STLExtras.h"
 #include <map>
 
@@ -24,6 +25,15 @@
 //===----------------------------------------------------------------------===//
 namespace llvm {
 
+/// getTypeListHash - Mix a list of contained types into a hash value for the
+/// TypeMap tables.
+static inline unsigned getTypeListHash(const std::vector<const Type*> &Tys) {
+  unsigned Hash = Tys.size();
+  for (unsigned i = 0, e = Tys.size(); i != e; ++i)
+    Hash = Hash * 37 + DenseMapInfo<const Type*>::getHashValue(Tys[i]);
+  return Hash;
+}
+
 /// getSubElementHash - Generate a hash value for all of the SubType's of this
 /// type.  The hash value is guaranteed to be zero if any of the subtypes are 
 /// an opaque type.  Otherwise we try to mix them in as well as possible, but do
@@ -78,9 +88,12 @@ public:
     return (unsigned)Ty->getBitWidth();
   }
 
-  inline bool operator<(const IntegerValType &IVT) const {
-    return bits < IVT.bits;
-  }
+  // Bit widths are limited to MAX_INT_BITS, so these can never collide with a
+  // real key.
+  static IntegerValType getEmptyKey() { return IntegerValType(~0U); }
+  static IntegerValType getTombstoneKey() { return IntegerValType(~0U - 1); }
+  unsigned getHashValue() const { return bits * 37U; }
+  bool operator==(const IntegerValType &IVT) const { return bits == IVT.bits; }
 };
 
 // PointerValType - Define a class to hold the key that goes into the TypeMap
@@ -99,9 +112,17 @@ public:
     return getSubElementHash(PT);
   }
 
-  bool operator<(const PointerValType &MTV) const {
-    if (AddressSpace < MTV.AddressSpace) return true;
-    return AddressSpace == MTV.AddressSpace && ValTy < MTV.ValTy;
+  static PointerValType getEmptyKey() {
+    return PointerValType(DenseMapInfo<const Type*>::getEmptyKey(), 0);
+  }
+  static PointerValType getTombstoneKey() {
+    return PointerValType(DenseMapInfo<const Type*>::getTombstoneKey(), 0);
+  }
+  unsigned getHashValue() const {
+    return DenseMapInfo<const Type*>::getHashValue(ValTy) ^ AddressSpace;
+  }
+  bool operator==(const PointerValType &MTV) const {
+    return ValTy == MTV.ValTy && AddressSpace == MTV.AddressSpace;
   }
 };
 
@@ -122,9 +143,18 @@ public:
     return (unsigned)AT->getNumElements();
   }
 
-  inline bool operator<(const ArrayValType &MTV) const {
-    if (Size < MTV.Size) return true;
-    return Size == MTV.Size && ValTy < MTV.ValTy;
+  static ArrayValType getEmptyKey() {
+    return ArrayValType(DenseMapInfo<const Type*>::getEmptyKey(), 0);
+  }
+  static ArrayValType getTombstoneKey() {
+    return ArrayValType(DenseMapInfo<const Type*>::getTombstoneKey(), 0);
+  }
+  unsigned getHashValue() const {
+    return DenseMapInfo<const Type*>::getHashValue(ValTy) ^
+           (unsigned)(Size * 37U);
+  }
+  bool operator==(const ArrayValType &MTV) const {
+    return ValTy == MTV.ValTy && Size == MTV.Size;
   }
 };
 
@@ -145,9 +175,17 @@ public:
     return PT->getNumElements();
   }
 
-  inline bool operator<(const VectorValType &MTV) const {
-    if (Size < MTV.Size) return true;
-    return Size == MTV.Size && ValTy < MTV.ValTy;
+  static VectorValType getEmptyKey() {
+    return VectorValType(DenseMapInfo<const Type*>::getEmptyKey(), 0);
+  }
+  static VectorValType getTombstoneKey() {
+    return VectorValType(DenseMapInfo<const Type*>::getTombstoneKey(), 0);
+  }
+  unsigned getHashValue() const {
+    return DenseMapInfo<const Type*>::getHashValue(ValTy) ^ (Size * 37U);
+  }
+  bool operator==(const VectorValType &MTV) const {
+    return ValTy == MTV.ValTy && Size == MTV.Size;
   }
 };
 
@@ -155,7 +193,9 @@ public:
 //
 class StructValType {
   std::vector<const Type*> ElTypes;
-  bool packed;
+  // packed is 0 or 1 for real keys; the DenseMap sentinel keys use 2 and 3.
+  unsigned char packed;
+  explicit StructValType(unsigned char Sentinel) : packed(Sentinel) {}
 public:
   StructValType(const std::vector<const Type*> &args, bool isPacked)
     : ElTypes(args), packed(isPacked) {}
@@ -173,10 +213,13 @@ public:
     return ST->getNumElements();
   }
 
-  inline bool operator<(const StructValType &STV) const {
-    if (ElTypes < STV.ElTypes) return true;
-    else if (ElTypes > STV.ElTypes) return false;
-    else return (int)packed < (int)STV.packed;
+  static StructValType getEmptyKey() { return StructValType(2); }
+  static StructValType getTombstoneKey() { return StructValType(3); }
+  unsigned getHashValue() const {
+    return getTypeListHash(ElTypes) * 4 + packed;
+  }
+  bool operator==(const StructValType &STV) const {
+    return packed == STV.packed && ElTypes == STV.ElTypes;
   }
 };
 
@@ -197,14 +240,35 @@ public:
     return Result;
   }
 
-  inline bool operator<(const FunctionValType &MTV) const {
-    if (RetTy < MTV.RetTy) return true;
-    if (RetTy > MTV.RetTy) return false;
-    if (isVarArg < MTV.isVarArg) return true;
-    if (isVarArg > MTV.isVarArg) return false;
-    if (ArgTypes < MTV.ArgTypes) return true;
-    if (ArgTypes > MTV.ArgTypes) return false;
-    return false;
+  static FunctionValType getEmptyKey() {
+    return FunctionValType(DenseMapInfo<const Type*>::getEmptyKey(),
+                           std::vector<const Type*>(), false);
+  }
+  static FunctionValType getTombstoneKey() {
+    return FunctionValType(DenseMapInfo<const Type*>::getTombstoneKey(),
+                           std::vector<const Type*>(), false);
+  }
+  unsigned getHashValue() const {
+    unsigned Hash = DenseMapInfo<const Type*>::getHashValue(RetTy);
+    return (Hash ^ getTypeListHash(ArgTypes)) * 2 + isVarArg;
+  }
+  bool operator==(const FunctionValType &MTV) const {
+    return RetTy == MTV.RetTy && isVarArg == MTV.isVarArg &&
+           ArgTypes == MTV.ArgTypes;
+  }
+};
+
+/// TypeMapKeyInfo - DenseMapInfo for the ValType keys of a TypeMap.  Each
+/// ValType class provides its own sentinel keys, hash and equality.
+template<class ValType>
+struct TypeMapKeyInfo {
+  static inline ValType getEmptyKey() { return ValType::getEmptyKey(); }
+  static inline ValType getTombstoneKey() { return ValType::getTombstoneKey(); }
+  static unsigned getHashValue(const ValType &Val) {
+    return Val.getHashValue();
+  }
+  static bool isEqual(const ValType &LHS, const ValType &RHS) {
+    return LHS == RHS;
   }
 };
 
@@ -278,9 +342,10 @@ public:
 //
 template<class ValType, class TypeClass>
 class TypeMap : public TypeMapBase {
-  std::map<ValType, PATypeHolder> Map;
+  typedef DenseMap<ValType, PATypeHolder, TypeMapKeyInfo<ValType> > MapTy;
+  MapTy Map;
 public:
-  typedef typename std::map<ValType, PATypeHolder>::iterator iterator;
+  typedef typename MapTy::iterator iterator;
 
   inline TypeClass *get(const ValType &V) {
     iterator I = Map.find(V);
@@ -333,7 +398,7 @@ public:
     // efficient lookup in the map, instead of an inefficient nasty linear
     // lookup.
     if (!TypeHasCycleThroughItself(Ty)) {
-      typename std::map<ValType, PATypeHolder>::iterator I;
+      iterator I;
       bool Inserted;
 
       tie(I, Inserted) = Map.insert(std::make_pair(ValType::get(Ty), Ty));
@@ -411,8 +476,8 @@ public:
 #ifdef DEBUG_MERGE_TYPES
     DEBUG(dbgs() << "TypeMap<>::" << Arg << " table contents:\n");
     unsigned i = 0;
-    for (typename std::map<ValType, PATypeHolder>::const_iterator I
-           = Map.begin(), E = Map.end(); I != E; ++I)
+    for (typename MapTy::const_iterator I = Map.begin(), E = Map.end();
+         I != E; ++I)
       DEBUG(dbgs() << " " << (++i) << ". " << (void*)I->second.get() << " "
                    << *I->second.get() << "\n");
 #endif
@@ -41,8 +41,8 @@ static inline const Type *checkType(const Type *Ty) {
 }
 
 Value::Value(const Type *ty, unsigned scid)
-  : SubclassID(scid), HasValueHandle(0),
-    SubclassOptionalData(0), SubclassData(0), VTy(checkType(ty)),
+  : SubclassID(scid), SubclassOptionalData(0), SubclassData(0),
+    HandleListIdx(0), VTy(checkType(ty)),
     UseList(0), Name(0) {
   if (isa<CallInst>(this) || isa<InvokeInst>(this))
     assert((VTy->isFirstClassType() || VTy->isVoidTy() ||
@@ -56,7 +56,7 @@ Value::Value(const Type *ty, unsigned scid)
 
 Value::~Value() {
   // Notify all ValueHandles (if present) that this value is going away.
-  if (HasValueHandle)
+  if (HandleListIdx)
     ValueHandleBase::ValueIsDeleted(this);
 
 #ifndef NDEBUG      // Only in -g mode...
@@ -289,7 +289,7 @@ void Value::takeName(Value *V) {
 //
 void Value::uncheckedReplaceAllUsesWith(Value *New) {
   // Notify all ValueHandles (if present) that this value is going away.
-  if (HasValueHandle)
+  if (HandleListIdx)
     ValueHandleBase::ValueIsRAUWd(this, New);
 
   while (!use_empty()) {
@@ -451,48 +451,15 @@ void ValueHandleBase::AddToExistingUseListAfter(ValueHandleBase *List) {
 void ValueHandleBase::AddToUseList() {
   assert(VP && "Null pointer doesn't have a use list!");
 
-  LLVMContextImpl *pImpl = VP->getContext().pImpl;
-
-  if (VP->HasValueHandle) {
-    // If this value already has a ValueHandle, then it must be in the
-    // ValueHandles map already.
-    ValueHandleBase *&Entry = pImpl->ValueHandles[VP];
-    assert(Entry != 0 && "Value doesn't have any handles?");
-    AddToExistingUseList(&Entry);
-    return;
-  }
-
-  // Ok, it doesn't have any handles yet, so we must insert it into the
-  // DenseMap.  However, doing this insertion could cause the DenseMap to
-  // reallocate itself, which would invalidate all of the PrevP pointers that
-  // point into the old table.  Handle this by checking for reallocation and
-  // updating the stale pointers only if needed.
-  DenseMap<Value*, ValueHandleBase*> &Handles = pImpl->ValueHandles;
-  const void *OldBucketPtr = Handles.getPointerIntoBucketsArray();
-
-  ValueHandleBase *&Entry = Handles[VP];
-  assert(Entry == 0 && "Value really did already have handles?");
-  AddToExistingUseList(&Entry);
-  VP->HasValueHandle = true;
-
-  // If reallocation didn't happen or if this was the first insertion, don't
-  // walk the table.
-  if (Handles.isPointerIntoBucketsArray(OldBucketPtr) ||
-      Handles.size() == 1) {
-    return;
-  }
-
-  // Okay, reallocation did happen.  Fix the Prev Pointers.
-  for (DenseMap<Value*, ValueHandleBase*>::iterator I = Handles.begin(),
-       E = Handles.end(); I != E; ++I) {
-    assert(I->second && I->first == I->second->VP && "List invariant broken!");
-    I->second->setPrevPtr(&I->second);
-  }
+  ValueHandleTable &Handles = VP->getContext().pImpl->ValueHandles;
+  if (!VP->HandleListIdx)
+    VP->HandleListIdx = Handles.allocate();
+  AddToExistingUseList(&Handles.getHead(VP->HandleListIdx));
 }
 
 /// RemoveFromUseList - Remove this ValueHandle from its current use list.
 void ValueHandleBase::RemoveFromUseList() {
-  assert(VP && VP->HasValueHandle && "Pointer doesn't have a use list!");
+  assert(VP && VP->HandleListIdx && "Pointer doesn't have a use list!");
 
   // Unlink this from its use list.
   ValueHandleBase **PrevPtr = getPrevPtr();
@@ -506,24 +473,22 @@ void ValueHandleBase::RemoveFromUseList() {
   }
 
   // If the Next pointer was null, then it is possible that this was the last
-  // ValueHandle watching VP.  If so, delete its entry from the ValueHandles
-  // map.
-  LLVMContextImpl *pImpl = VP->getContext().pImpl;
-  DenseMap<Value*, ValueHandleBase*> &Handles = pImpl->ValueHandles;
-  if (Handles.isPointerIntoBucketsArray(PrevPtr)) {
-    Handles.erase(VP);
-    VP->HasValueHandle = false;
+  // ValueHandle watching VP.  If so, give its list back to the table.
+  ValueHandleTable &Handles = VP->getContext().pImpl->ValueHandles;
+  if (PrevPtr == &Handles.getHead(VP->HandleListIdx)) {
+    Handles.release(VP->HandleListIdx);
+    VP->HandleListIdx = 0;
   }
 }
 
 
 void ValueHandleBase::ValueIsDeleted(Value *V) {
-  assert(V->HasValueHandle && "Should only be called if ValueHandles present");
+  assert(V->HandleListIdx && "Should only be called if ValueHandles present");
 
   // Get the linked list base, which is guaranteed to exist since the
-  // HasValueHandle flag is set.
+  // value has a list.
   LLVMContextImpl *pImpl = V->getContext().pImpl;
-  ValueHandleBase *Entry = pImpl->ValueHandles[V];
+  ValueHandleBase *Entry = pImpl->ValueHandles.getHead(V->HandleListIdx);
   assert(Entry && "Value bit set but no entries exist");
 
   // We use a local ValueHandleBase as an iterator so that ValueHandles can add
@@ -560,11 +525,11 @@ void ValueHandleBase::ValueIsDeleted(Value *V) {
   }
 
   // All callbacks, weak references, and assertingVHs should be dropped by now.
-  if (V->HasValueHandle) {
+  if (V->HandleListIdx) {
 #ifndef NDEBUG      // Only in +Asserts mode...
     dbgs() << "While deleting: " << *V->getType() << " %" << V->getNameStr()
            << "\n";
-    if (pImpl->ValueHandles[V]->getKind() == Assert)
+    if (pImpl->ValueHandles.getHead(V->HandleListIdx)->getKind() == Assert)
       llvm_unreachable("An asserting value handle still pointed to this"
                        " value!");
 
@@ -575,13 +540,13 @@ void ValueHandleBase::ValueIsDeleted(Value *V) {
 
 
 void ValueHandleBase::ValueIsRAUWd(Value *Old, Value *New) {
-  assert(Old->HasValueHandle &&"Should only be called if ValueHandles present");
+  assert(Old->HandleListIdx &&"Should only be called if ValueHandles present");
   assert(Old != New && "Changing value into itself!");
 
   // Get the linked list base, which is guaranteed to exist since the
-  // HasValueHandle flag is set.
+  // value has a list.
   LLVMContextImpl *pImpl = Old->getContext().pImpl;
-  ValueHandleBase *Entry = pImpl->ValueHandles[Old];
+  ValueHandleBase *Entry = pImpl->ValueHandles.getHead(Old->HandleListIdx);
 
   assert(Entry && "Value bit set but no entries exist");
 
@@ -619,8 +584,9 @@ void ValueHandleBase::ValueIsRAUWd(Value *Old, Value *New) {
 #ifndef NDEBUG
   // If any new tracking or weak value handles were added while processing the
   // list, then complain about it now.
-  if (Old->HasValueHandle)
-    for (Entry = pImpl->ValueHandles[Old]; Entry; Entry = Entry->Next)
+  if (Old->HandleListIdx)
+    for (Entry = pImpl->ValueHandles.getHead(Old->HandleListIdx); Entry;
+         Entry = Entry->Next)
       switch (Entry->getKind()) {
       case Tracking:
       case Weak:
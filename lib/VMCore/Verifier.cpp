@@ -55,8 +55,13 @@
 #include "llvm/CodeGen/ValueTypes.h"
 #include "llvm/Support/CallSite.h"
 #include "llvm/Support/CFG.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/InstVisitor.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/Mutex.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
@@ -68,6 +73,12 @@
 #include <cstdarg>
 using namespace llvm;
 
+unsigned llvm::VerifyModuleThreads = 1;
+static cl::opt<unsigned, true>
+VerifyThreads("verify-threads", cl::location(VerifyModuleThreads),
+              cl::desc("Number of threads verifyModule checks function "
+                       "bodies on (0: one per processor)"));
+
 namespace {  // Anonymous namespace for class
   struct PreVerifier : public FunctionPass {
     static char ID; // Pass ID, replacement for typeid
@@ -111,13 +122,16 @@ static char &PreVerifyID = PreVerifier::ID;
 namespace {
   class TypeSet : public AbstractTypeUser {
   public:
-    TypeSet() {}
+    /// TypeSet ctor - If Listen is false, the set does not register itself
+    /// as a user of the abstract types it holds, which would change them.
+    /// It may then only be used while no type is refined.
+    explicit TypeSet(bool listen = true) : Listen(listen) {}
 
     /// Insert a type into the set of types.
     bool insert(const Type *Ty) {
       if (!Types.insert(Ty))
         return false;
-      if (Ty->isAbstract())
+      if (Listen && Ty->isAbstract())
         Ty->addAbstractTypeUser(this);
       return true;
     }
@@ -125,6 +139,8 @@ namespace {
     // Remove ourselves as abstract type listeners for any types that remain
     // abstract when the TypeSet is destroyed.
     ~TypeSet() {
+      if (!Listen)
+        return;
       for (SmallSetVector<const Type *, 16>::iterator I = Types.begin(),
              E = Types.end(); I != E; ++I) {
         const Type *Ty = *I;
@@ -151,6 +167,7 @@ namespace {
 
   private:
     SmallSetVector<const Type *, 16> Types;
+    bool Listen;
 
     // Disallow copying.
     TypeSet(const TypeSet &);
@@ -195,6 +212,15 @@ namespace {
       MessagesStr(Messages) {
         initializeVerifierPass(*PassRegistry::getPassRegistry());
       }
+    /// Verifier ctor - Make a verifier for one of the threads of a concurrent
+    /// verifyModule.  It is not run by a PassManager, takes the dominator
+    /// tree from dt and does not register as a user of the types it checks.
+    explicit Verifier(DominatorTree &dt)
+      : FunctionPass(ID),
+      Broken(false), RealPass(false), action(ReturnStatusAction), Mod(0),
+      Context(0), DT(&dt), MessagesStr(Messages), Types(false) {
+        initializeVerifierPass(*PassRegistry::getPassRegistry());
+      }
 
     bool doInitialization(Module &M) {
       Mod = &M;
@@ -229,6 +255,14 @@ namespace {
     }
 
     bool doFinalization(Module &M) {
+      verifyGlobals(M);
+
+      // If the module is broken, abort at this time.
+      return abortIfBroken();
+    }
+
+    /// verifyGlobals - Check everything in M but the bodies of its functions.
+    void verifyGlobals(Module &M) {
       // Scan through, checking all of the external function's linkage now...
       for (Module::iterator I = M.begin(), E = M.end(); I != E; ++I) {
         visitGlobalValue(*I);
@@ -248,9 +282,6 @@ namespace {
       for (Module::named_metadata_iterator I = M.named_metadata_begin(),
            E = M.named_metadata_end(); I != E; ++I)
         visitNamedMDNode(*I);
-
-      // If the module is broken, abort at this time.
-      return abortIfBroken();
     }
 
     virtual void getAnalysisUsage(AnalysisUsage &AU) const {
@@ -1610,6 +1641,10 @@ void Verifier::VerifyType(const Type *Ty) {
   }
 }
 
+/// TypeCreationLock - Serializes the creation of types by verifiers that run
+/// concurrently.
+static ManagedStatic<sys::SmartMutex<true> > TypeCreationLock;
+
 // Flags used by TableGen to mark intrinsic parameters with the
 // LLVMExtendedElementVectorType and LLVMTruncatedElementVectorType classes.
 static const unsigned ExtendedElementVectorType = 0x40000000;
@@ -1749,7 +1784,9 @@ bool Verifier::PerformTypeCheck(Intrinsic::ID ID, Function *F, const Type *Ty,
         return false;
       }
       // Adjust the current Ty (in the opposite direction) rather than
-      // the type being matched against.
+      // the type being matched against.  This may create the type, which
+      // concurrent verifiers must not do at the same time.
+      sys::SmartScopedLock<true> Lock(*TypeCreationLock);
       if ((Match & ExtendedElementVectorType) != 0) {
         if ((IEltTy->getBitWidth() & 1) != 0) {
           CheckFailed(IntrinsicParam(ArgNo, NumRetVals) + " vector "
@@ -1978,11 +2015,118 @@ bool llvm::verifyFunction(const Function &f, VerifierFailureAction action) {
   return V->Broken;
 }
 
+namespace {
+  /// VerifierShard - The part of a concurrent verifyModule done by one task:
+  /// the bodies of the functions in [Begin, End), or everything else in the
+  /// module if Globals is set.
+  struct VerifierShard {
+    Module *Globals;
+    Function *const *Begin, *const *End;
+    DominatorTree DT;
+    Verifier V;
+
+    VerifierShard() : Globals(0), Begin(0), End(0), V(DT) {}
+  };
+}
+
+static void verifyShard(void *Arg) {
+  VerifierShard *S = static_cast<VerifierShard*>(Arg);
+  if (S->Globals) {
+    S->V.Mod = S->Globals;
+    S->V.Context = &S->Globals->getContext();
+    S->V.verifyTypeSymbolTable(S->Globals->getTypeSymbolTable());
+    S->V.verifyGlobals(*S->Globals);
+    return;
+  }
+
+  for (Function *const *I = S->Begin; I != S->End && !S->V.Broken; ++I) {
+    Function &F = **I;
+    // A block without a terminator would break the dominator tree.  Leave
+    // it to the serial verifier to report.
+    for (Function::iterator BB = F.begin(), E = F.end(); BB != E; ++BB)
+      if (BB->empty() || !BB->back().isTerminator())
+        S->V.Broken = true;
+    if (S->V.Broken)
+      break;
+
+    S->DT.runOnFunction(F);
+    S->V.runOnFunction(F);
+    S->DT.releaseMemory();
+  }
+}
+
+/// verifyConcurrently - Check M on NumThreads threads, each taking the
+/// bodies of a range of functions.  Return true if M was found to be well
+/// formed.  Otherwise nothing is reported: the serial verifier has to run to
+/// describe the problems the way it always does.
+static bool verifyConcurrently(Module &M, unsigned NumThreads) {
+  std::vector<Function*> Functions;
+  std::vector<unsigned> Sizes;
+  uint64_t TotalSize = 0;
+  for (Module::iterator F = M.begin(), E = M.end(); F != E; ++F) {
+    if (F->isDeclaration())
+      continue;
+    unsigned Size = 0;
+    for (Function::iterator BB = F->begin(), BE = F->end(); BB != BE; ++BB)
+      Size += BB->size();
+    Functions.push_back(F);
+    Sizes.push_back(Size);
+    TotalSize += Size;
+  }
+  if (Functions.size() < 2 || !llvm_is_multithreaded())
+    return false;
+
+  // Cut the function list into ranges of about the same number of
+  // instructions.  Making more ranges than threads lets the pool even out
+  // functions that take longer to check than their size suggests.
+  unsigned NumShards = std::min(NumThreads * 4, unsigned(Functions.size()));
+  std::vector<VerifierShard*> Shards;
+  uint64_t Seen = 0;
+  for (unsigned Begin = 0, End = 0; Begin != Functions.size(); Begin = End) {
+    uint64_t Goal = TotalSize * (Shards.size() + 1) / NumShards;
+    while (End != Functions.size() && (Seen < Goal || End == Begin))
+      Seen += Sizes[End++];
+    if (Shards.size() + 1 == NumShards)
+      End = Functions.size();
+
+    VerifierShard *S = new VerifierShard();
+    S->Begin = &Functions[0] + Begin;
+    S->End = &Functions[0] + End;
+    Shards.push_back(S);
+  }
+  Shards.push_back(new VerifierShard());
+  Shards.back()->Globals = &M;
+
+  // The calling thread runs tasks while it waits, so it is one of the
+  // NumThreads.
+  {
+    ThreadPool Pool(NumThreads - 1);
+    TaskGroup Group(Pool);
+    for (unsigned i = 0, e = Shards.size(); i != e; ++i)
+      Group.spawn(verifyShard, Shards[i]);
+    Group.wait();
+  }
+
+  bool Broken = false;
+  for (unsigned i = 0, e = Shards.size(); i != e; ++i) {
+    Broken |= Shards[i]->V.Broken;
+    delete Shards[i];
+  }
+  return !Broken;
+}
+
 /// verifyModule - Check a module for errors, printing messages on stderr.
 /// Return true if the module is corrupt.
 ///
 bool llvm::verifyModule(const Module &M, VerifierFailureAction action,
-                        std::string *ErrorInfo) {
+                        std::string *ErrorInfo, unsigned NumThreads) {
+  if (NumThreads == 0)
+    NumThreads = VerifyModuleThreads;
+  if (NumThreads == 0)
+    NumThreads = ThreadPool::getDefaultNumThreads();
+  if (NumThreads > 1 && verifyConcurrently(const_cast<Module&>(M), NumThreads))
+    return false;
+
   PassManager PM;
   Verifier *V = new Verifier(action);
   PM.add(V);
@@ -0,0 +1,67 @@
+; Printing function bodies on several threads must give the same text as
+; printing them on one.
+; RUN: llvm-as < %s | llvm-dis > %t.serial
+; RUN: llvm-as < %s | llvm-dis -print-threads=3 > %t.parallel
+; RUN: diff %t.serial %t.parallel
+; RUN: FileCheck %s < %t.parallel
+
+%0 = type { i32, %0* }
+%pair = type { i32, i32 }
+
+@0 = global i32 1
+@named = global %0 zeroinitializer
+
+; Unnamed globals keep their module level numbers inside every function.
+; CHECK: define i32 @first(i32) {
+; CHECK: load i32* @0, !tbaa !1
+define i32 @first(i32) {
+  %2 = load i32* @0, !tbaa !1
+  %3 = add i32 %0, %2
+  br label %4
+
+; <label>:4
+  ret i32 %3, !note !2
+}
+
+declare void @llvm.dbg.value(metadata, i64, metadata) nounwind readnone
+
+; Metadata is numbered in the order the functions use it, even though the
+; functions are printed out of order.
+; CHECK: define void @second(%pair* %p) {
+; CHECK: call void @llvm.dbg.value(metadata !{%pair* %p}, i64 0, metadata !3)
+; CHECK: ret void, !note !4
+define void @second(%pair* %p) {
+entry:
+  call void @llvm.dbg.value(metadata !{%pair* %p}, i64 0, metadata !3)
+  ret void, !note !4
+}
+
+define %0* @third(%0* %l) {
+entry:
+  %next = getelementptr %0* %l, i32 0, i32 1
+  %0 = load %0** %next
+  %1 = icmp eq %0* %0, null
+  br i1 %1, label %done, label %2
+
+; <label>:2                                       ; preds = %entry
+  br label %done
+
+done:                                             ; preds = %2, %entry
+  %r = phi %0* [ %0, %2 ], [ null, %entry ]
+  ret %0* %r, !note !4
+}
+
+define i32 @fourth() {
+  %1 = call i32 @first(i32 2)
+  %2 = load i32* getelementptr (%0* @named, i32 0, i32 0)
+  %3 = add i32 %1, %2
+  ret i32 %3
+}
+
+!named = !{!0}
+
+!0 = metadata !{metadata !"named"}
+!1 = metadata !{metadata !"int", null}
+!2 = metadata !{i32 1, i32 2, null, null}
+!3 = metadata !{metadata !"p"}
+!4 = metadata !{i32 3, i32 4, null, null}
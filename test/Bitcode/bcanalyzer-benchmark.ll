@@ -0,0 +1,19 @@
+; RUN: llvm-as < %s | llvm-bcanalyzer -benchmark=2 |& FileCheck %s
+
+; CHECK: Benchmark of -:
+; CHECK: Total size: {{.*}} MB, {{[0-9]+}} records
+; CHECK: Read (times): 2
+; CHECK: Average time: {{.*}} MB/s
+; CHECK: Best time: {{.*}} MB/s
+
+@names = global [3 x i8] c"ab\00"
+
+define i32 @f(i32 %a, i32 %b) {
+entry:
+  %sum = add i32 %a, %b
+  %big = icmp ugt i32 %sum, 100000
+  br i1 %big, label %done, label %done
+
+done:
+  ret i32 %sum
+}
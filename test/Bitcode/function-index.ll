@@ -0,0 +1,37 @@
+; Function bodies are found through the function index when there is one, and
+; by walking over every body when there is not; both must read the same module.
+; RUN: llvm-as < %s | llvm-bcanalyzer -dump |& FileCheck %s
+; RUN: llvm-as < %s | llvm-dis > %t.indexed
+; RUN: llvm-as -disable-bitcode-function-index < %s | llvm-dis > %t.scanned
+; RUN: diff %t.indexed %t.scanned
+; RUN: llvm-as < %s | llvm-extract -func=c | llvm-dis | FileCheck %s -check-prefix=EXTRACT
+
+; CHECK: <FNINDEX
+; CHECK: <FUNCTION_INDEX_BLOCK
+; CHECK-NEXT: <ENTRY
+; CHECK-NEXT: <ENTRY
+; CHECK-NEXT: <ENTRY
+; CHECK-NEXT: </FUNCTION_INDEX_BLOCK>
+
+@g = global i32 0
+
+declare void @ext()
+
+define i32 @a(i32 %x) {
+  %y = add i32 %x, 1
+  ret i32 %y
+}
+
+define void @b() {
+  call void @ext()
+  ret void
+}
+
+; EXTRACT: define i32 @c() {
+; EXTRACT-NEXT: %v = load i32* @g
+; EXTRACT-NEXT: %w = call i32 @a(i32 %v)
+define i32 @c() {
+  %v = load i32* @g
+  %w = call i32 @a(i32 %v)
+  ret i32 %w
+}
@@ -0,0 +1,41 @@
+; Metadata read on demand when a module is opened lazily must be the same as
+; metadata read up front.
+; RUN: llvm-as < %s > %t.bc
+; RUN: llvm-extract -func=f < %t.bc | llvm-dis > %t.lazy
+; RUN: llvm-extract -disable-lazy-bitcode-metadata -func=f < %t.bc | llvm-dis > %t.eager
+; RUN: diff %t.lazy %t.eager
+; RUN: FileCheck %s < %t.lazy
+; RUN: llvm-extract -func=g < %t.bc | llvm-dis > %t.lazy
+; RUN: llvm-extract -disable-lazy-bitcode-metadata -func=g < %t.bc | llvm-dis > %t.eager
+; RUN: diff %t.lazy %t.eager
+
+; CHECK: define void @f(i32 %x) {
+; CHECK: call void @llvm.dbg.value(metadata !{i32 %x}, i64 0, metadata !1)
+; CHECK: ret void, !dbg !3, !note !4
+; CHECK-NOT: only used by g
+; CHECK: !0 = metadata !{metadata !"named", i32 7, metadata !0}
+; CHECK: !1 = metadata !{metadata !"x", metadata !2}
+; CHECK: !2 = metadata !{metadata !"scope", metadata !2}
+; CHECK-NOT: only used by g
+
+declare void @llvm.dbg.value(metadata, i64, metadata) nounwind readnone
+
+define void @f(i32 %x) {
+  call void @llvm.dbg.value(metadata !{i32 %x}, i64 0, metadata !0)
+  ret void, !dbg !2, !note !5
+}
+
+define void @g() {
+  ret void, !dbg !3, !note !4
+}
+
+!llvm.named = !{!6}
+
+!0 = metadata !{metadata !"x", metadata !1}
+!1 = metadata !{metadata !"scope", metadata !1}
+!2 = metadata !{i32 1, i32 2, metadata !1, null}
+!3 = metadata !{i32 3, i32 4, metadata !7, null}
+!4 = metadata !{metadata !"only used by g", metadata !4}
+!5 = metadata !{metadata !1, metadata !0}
+!6 = metadata !{metadata !"named", i32 7, metadata !6}
+!7 = metadata !{metadata !"scope of g"}
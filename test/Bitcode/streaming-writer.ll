@@ -0,0 +1,31 @@
+; Writing bitcode straight to a file must give the same bytes as building it
+; in memory first, including when block sizes, the function index and the
+; Darwin header are patched after they have been written out.
+; RUN: llvm-as -disable-bitcode-streaming < %s > %t.buffered
+; RUN: llvm-as %s -o %t.streamed
+; RUN: cmp %t.buffered %t.streamed
+; RUN: llvm-as -bitcode-flush-threshold=0 %s -o %t.flushed
+; RUN: cmp %t.buffered %t.flushed
+; RUN: llvm-dis < %t.flushed | FileCheck %s
+
+target triple = "x86_64-apple-darwin10.0.0"
+
+; CHECK: @g = global i32 7
+@g = global i32 7
+
+; CHECK: define i32 @a(i32 %x) {
+define i32 @a(i32 %x) {
+  %y = load i32* @g, !tbaa !0
+  %z = add i32 %x, %y
+  ret i32 %z
+}
+
+; CHECK: define void @b(i32* %p) {
+define void @b(i32* %p) {
+entry:
+  %v = call i32 @a(i32 3)
+  store i32 %v, i32* %p
+  ret void
+}
+
+!0 = metadata !{metadata !"int", null}
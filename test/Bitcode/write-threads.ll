@@ -0,0 +1,55 @@
+; Encoding function bodies on several threads must give the same bitcode as
+; encoding them on one, and the function index must still find every body.
+; RUN: llvm-as < %s > %t.serial
+; RUN: llvm-as -bitcode-write-threads=3 < %s > %t.parallel
+; RUN: cmp %t.serial %t.parallel
+; RUN: llvm-as -bitcode-write-threads=3 -disable-bitcode-function-index %s -o %t.noindex
+; RUN: llvm-as -disable-bitcode-function-index < %s | cmp - %t.noindex
+; RUN: llvm-extract -func=third < %t.parallel | llvm-dis | FileCheck %s
+
+@g = global i32 1
+@table = constant [2 x i8*] [i8* blockaddress(@third, %a), i8* blockaddress(@third, %b)]
+
+declare void @llvm.dbg.value(metadata, i64, metadata) nounwind readnone
+
+define i32 @first(i32 %x) {
+  %v = load i32* @g, !tbaa !0
+  %y = add i32 %x, %v
+  ret i32 %y, !dbg !2
+}
+
+define void @second(i32* %p) {
+entry:
+  call void @llvm.dbg.value(metadata !{i32* %p}, i64 0, metadata !1)
+  store i32 7, i32* %p
+  ret void
+}
+
+; CHECK: define i32 @third(i8* %dest) {
+; CHECK: indirectbr i8* %dest, [label %a, label %b]
+; CHECK: %r = phi i32 [ 1, %a ], [ 2, %b ]
+; CHECK: call i32 @first(i32 %r) nounwind
+define i32 @third(i8* %dest) {
+entry:
+  indirectbr i8* %dest, [label %a, label %b]
+
+a:
+  br label %done
+
+b:
+  br label %done
+
+done:
+  %r = phi i32 [ 1, %a ], [ 2, %b ]
+  %s = call i32 @first(i32 %r) nounwind
+  ret i32 %s
+}
+
+define double @fourth(double %d) {
+  %m = fmul double %d, 2.500000e+00
+  ret double %m
+}
+
+!0 = metadata !{metadata !"int", null}
+!1 = metadata !{metadata !"p"}
+!2 = metadata !{i32 3, i32 4, null, null}
@@ -0,0 +1,8 @@
+; RUN: llvm-link %s %p/inbounds-b.ll -S -o - | FileCheck %s
+; Resolving @f to the definition in the other file rewrites the constant
+; expression that refers to it; the rewritten GEP must stay inbounds.
+
+declare void @f()
+
+@p = global i8* getelementptr inbounds (i8* bitcast (void ()* @f to i8*), i32 1)
+; CHECK: @p = global i8* getelementptr inbounds (i8* bitcast (void ()* @f to i8*), i32 1)
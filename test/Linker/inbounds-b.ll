@@ -0,0 +1,6 @@
+; This file is for use with inbounds-a.ll
+; RUN: true
+
+define void @f() {
+  ret void
+}
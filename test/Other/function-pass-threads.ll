@@ -0,0 +1,85 @@
+; Running function passes on several threads must give the same module as
+; running them on one.
+; RUN: opt < %s -O2 -S > %t.serial
+; RUN: opt < %s -O2 -S -function-pass-threads=3 > %t.parallel
+; RUN: diff %t.serial %t.parallel
+; RUN: opt < %s -instcombine -simplify-libcalls -gvn -simplifycfg -S > %t.serial
+; RUN: opt < %s -instcombine -simplify-libcalls -gvn -simplifycfg -S \
+; RUN:   -function-pass-threads=3 > %t.parallel
+; RUN: diff %t.serial %t.parallel
+; RUN: FileCheck %s < %t.parallel
+; RUN: opt < %s -O2 -disable-output -function-pass-threads=3 -stats \
+; RUN:   -info-output-file - | FileCheck --check-prefix=STATS %s
+; STATS: 3 function-pass-threads - Number of function ranges optimized on a thread
+; STATS-NOT: redone on one thread
+
+target datalayout = "e-p:64:64:64-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:64:64-f32:32:32-f64:64:64-v64:64:64-v128:128:128-a0:0:64-s0:64:64-f80:128:128-n8:16:32:64"
+
+; InstCombine raises the alignment of @G from the first shard.
+; CHECK: @G = internal global [4 x i32] zeroinitializer, align 16
+@G = internal global [4 x i32] zeroinitializer
+@msg.hello = private constant [7 x i8] c"hello\0A\00"
+@msg.world = private constant [7 x i8] c"world\0A\00"
+
+; Both printf calls become calls to puts, which is declared only once.
+; CHECK: @str = internal constant [6 x i8] c"hello\00"
+; CHECK: @str1 = internal constant [6 x i8] c"world\00"
+; CHECK: declare i32 @puts(i8*
+; CHECK-NOT: declare i32 @puts
+
+declare i32 @printf(i8*, ...)
+
+define void @clear(i64 %n) nounwind {
+entry:
+  %p = bitcast [4 x i32]* @G to <4 x i32>*
+  store <4 x i32> zeroinitializer, <4 x i32>* %p, align 1
+  ret void
+}
+
+define i32 @hello(i32 %x) nounwind {
+entry:
+  %call = call i32 (i8*, ...)* @printf(i8* getelementptr ([7 x i8]* @msg.hello, i32 0, i32 0))
+  %a = add i32 %x, %x
+  %b = add i32 %x, %x
+  %c = sub i32 %a, %b
+  %r = add i32 %c, %call
+  ret i32 %r
+}
+
+define i32 @loop(i32* %p, i32 %n) nounwind {
+entry:
+  br label %cond
+
+cond:
+  %i = phi i32 [ 0, %entry ], [ %next, %body ]
+  %sum = phi i32 [ 0, %entry ], [ %s, %body ]
+  %done = icmp sge i32 %i, %n
+  br i1 %done, label %exit, label %body
+
+body:
+  %addr = getelementptr i32* %p, i32 %i
+  %v = load i32* %addr
+  %v2 = load i32* %addr
+  %t = add i32 %v, %v2
+  %s = add i32 %sum, %t
+  %next = add i32 %i, 1
+  br label %cond
+
+exit:
+  ret i32 %sum
+}
+
+define i32 @world(i32 %x) nounwind {
+entry:
+  %call = call i32 (i8*, ...)* @printf(i8* getelementptr ([7 x i8]* @msg.world, i32 0, i32 0))
+  %cmp = icmp eq i32 %x, 0
+  br i1 %cmp, label %then, label %done
+
+then:
+  br label %done
+
+done:
+  %r = phi i32 [ 1, %then ], [ %call, %entry ]
+  %h = call i32 @hello(i32 %r)
+  ret i32 %h
+}
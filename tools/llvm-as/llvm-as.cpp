@@ -27,6 +27,7 @@
 #include "llvm/Support/SystemUtils.h"
 #include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Support/Signals.h"
+#include "llvm/Support/Threading.h"
 #include <memory>
 using namespace llvm;
 
@@ -92,6 +93,10 @@ int main(int argc, char **argv) {
   llvm_shutdown_obj Y;  // Call llvm_shutdown() on exit.
   cl::ParseCommandLineOptions(argc, argv, "llvm .ll -> .bc assembler\n");
 
+  // The verifier and the bitcode writer only use threads if we ask for them.
+  if (VerifyModuleThreads != 1 || BitcodeWriteThreads != 1)
+    llvm_start_multithreaded();
+
   // Parse the file now...
   SMDiagnostic Err;
   std::auto_ptr<Module> M(ParseAssemblyFile(InputFilename, Err, Context));
@@ -14,6 +14,7 @@
 //  Options:
 //      --help      - Output information about command line switches
 //      --dump      - Dump low-level bitcode structure in readable format
+//      --benchmark=N - Time reading every record in the file N times
 //
 // This tool provides analytical information about a bitcode file. It is
 // intended as an aid to developers of bitcode reading and writing software. It
@@ -39,6 +40,7 @@
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/Signals.h"
+#include "llvm/Support/Timer.h"
 #include "llvm/Support/system_error.h"
 #include <cstdio>
 #include <map>
@@ -50,6 +52,11 @@ static cl::opt<std::string>
 
 static cl::opt<bool> Dump("dump", cl::desc("Dump low level bitcode trace"));
 
+static cl::opt<unsigned>
+Benchmark("benchmark", cl::value_desc("N"), cl::init(0),
+          cl::desc("Read every record in the file N times and report the "
+                   "reader's throughput instead of analyzing it"));
+
 //===----------------------------------------------------------------------===//
 // Bitcode specific analysis.
 //===----------------------------------------------------------------------===//
@@ -109,6 +116,7 @@ static const char *GetBlockName(unsigned BlockID,
   case bitc::VALUE_SYMTAB_BLOCK_ID:  return "VALUE_SYMTAB";
   case bitc::METADATA_BLOCK_ID:      return "METADATA_BLOCK";
   case bitc::METADATA_ATTACHMENT_ID: return "METADATA_ATTACHMENT_BLOCK";
+  case bitc::FUNCTION_INDEX_BLOCK_ID: return "FUNCTION_INDEX_BLOCK";
   }
 }
 
@@ -156,6 +164,7 @@ static const char *GetCodeName(unsigned CodeID, unsigned BlockID,
     case bitc::MODULE_CODE_ALIAS:       return "ALIAS";
     case bitc::MODULE_CODE_PURGEVALS:   return "PURGEVALS";
     case bitc::MODULE_CODE_GCNAME:      return "GCNAME";
+    case bitc::MODULE_CODE_FNINDEX:     return "FNINDEX";
     }
   case bitc::PARAMATTR_BLOCK_ID:
     switch (CodeID) {
@@ -279,6 +288,11 @@ static const char *GetCodeName(unsigned CodeID, unsigned BlockID,
     case bitc::METADATA_NAMED_NODE2: return "METADATA_NAMED_NODE2";
     case bitc::METADATA_ATTACHMENT2: return "METADATA_ATTACHMENT2";
     }
+  case bitc::FUNCTION_INDEX_BLOCK_ID:
+    switch(CodeID) {
+    default:return 0;
+    case bitc::FNINDEX_CODE_ENTRY:   return "ENTRY";
+    }
   }
 }
 
@@ -470,6 +484,83 @@ static bool ParseBlock(BitstreamCursor &Stream, unsigned IndentLevel) {
   }
 }
 
+/// ReadBlockRecords - Read a block and everything nested in it without looking
+/// at the records, counting them in NumRecords.  This is what -benchmark times.
+static bool ReadBlockRecords(BitstreamCursor &Stream,
+                             SmallVectorImpl<uint64_t> &Record,
+                             uint64_t &NumRecords) {
+  unsigned BlockID = Stream.ReadSubBlockID();
+  if (BlockID == bitc::BLOCKINFO_BLOCK_ID)
+    return Stream.ReadBlockInfoBlock();
+  if (Stream.EnterSubBlock(BlockID))
+    return true;
+
+  while (1) {
+    if (Stream.AtEndOfStream())
+      return true;
+
+    unsigned AbbrevID = Stream.ReadCode();
+    switch (AbbrevID) {
+    case bitc::END_BLOCK:
+      return Stream.ReadBlockEnd();
+    case bitc::ENTER_SUBBLOCK:
+      if (ReadBlockRecords(Stream, Record, NumRecords))
+        return true;
+      break;
+    case bitc::DEFINE_ABBREV:
+      Stream.ReadAbbrevRecord();
+      break;
+    default: {
+      Record.clear();
+      const char *BlobStart = 0;
+      unsigned BlobLen = 0;
+      Stream.ReadRecord(AbbrevID, Record, BlobStart, BlobLen);
+      ++NumRecords;
+      break;
+    }
+    }
+  }
+}
+
+/// BenchmarkBitcode - Read the stream following its signature Benchmark times
+/// and print how fast the cursor got through it.
+static int BenchmarkBitcode(BitstreamReader &StreamFile, uint64_t StartBit) {
+  SmallVector<uint64_t, 64> Record;
+  uint64_t NumRecords = 0;
+  double Best = 0, Total = 0;
+
+  for (unsigned i = 0; i != Benchmark; ++i) {
+    BitstreamCursor Stream(StreamFile);
+    Stream.JumpToBit(StartBit);
+    NumRecords = 0;
+
+    double Start = TimeRecord::getCurrentTime(true).getWallTime();
+    while (!Stream.AtEndOfStream()) {
+      if (Stream.ReadCode() != bitc::ENTER_SUBBLOCK)
+        return Error("Invalid record at top-level");
+      if (ReadBlockRecords(Stream, Record, NumRecords))
+        return Error("Malformed block");
+    }
+    double Elapsed = TimeRecord::getCurrentTime(false).getWallTime() - Start;
+
+    Total += Elapsed;
+    if (i == 0 || Elapsed < Best)
+      Best = Elapsed;
+  }
+
+  double MB = (StreamFile.getLastChar()-StreamFile.getFirstChar()) /
+              (1024.0*1024.0);
+  errs() << "Benchmark of " << InputFilename << ":\n";
+  errs() << "         Total size: " << format("%.2f", MB) << " MB, "
+         << NumRecords << " records\n";
+  errs() << "       Read (times): " << Benchmark << "\n";
+  errs() << "       Average time: " << format("%.4f", Total/Benchmark)
+         << "s, " << format("%.1f", MB*Benchmark/Total) << " MB/s\n";
+  errs() << "          Best time: " << format("%.4f", Best) << "s, "
+         << format("%.1f", MB/Best) << " MB/s\n";
+  return 0;
+}
+
 static void PrintSize(double Bits) {
   fprintf(stderr, "%.2f/%.2fB/%lluW", Bits, Bits/8,(unsigned long long)Bits/32);
 }
@@ -520,6 +611,9 @@ static int AnalyzeBitcode() {
       Signature[4] == 0xE && Signature[5] == 0xD)
     CurStreamType = LLVMIRBitstream;
 
+  if (Benchmark)
+    return BenchmarkBitcode(StreamFile, Stream.GetCurrentBitNo());
+
   unsigned NumTopBlocks = 0;
 
   // Parse the top-level structure.  We only allow blocks at the top-level.
@@ -21,6 +21,7 @@
 #include "llvm/Type.h"
 #include "llvm/Bitcode/ReaderWriter.h"
 #include "llvm/Assembly/AssemblyAnnotationWriter.h"
+#include "llvm/Assembly/Writer.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/FormattedStream.h"
 #include "llvm/Support/ManagedStatic.h"
@@ -28,6 +29,7 @@
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Support/Signals.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/system_error.h"
 using namespace llvm;
 
@@ -78,6 +80,10 @@ int main(int argc, char **argv) {
 
   cl::ParseCommandLineOptions(argc, argv, "llvm .bc -> .ll disassembler\n");
 
+  // The assembly writer only uses threads if we ask for them.
+  if (PrintModuleThreads != 1)
+    llvm_start_multithreaded();
+
   std::string ErrorMessage;
   std::auto_ptr<Module> M;
 
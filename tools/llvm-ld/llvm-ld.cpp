@@ -531,6 +531,9 @@ int main(int argc, char **argv, char **envp) {
   // Parse the command line options
   cl::ParseCommandLineOptions(argc, argv, "llvm linker\n");
 
+  // Archives and libraries are searched more than once; read each just once.
+  MemoryBuffer::setFileCacheEnabled(true);
+
 #if defined(_WIN32) || defined(__CYGWIN__)
   if (!LinkAsLibrary) {
     // Default to "a.exe" instead of "a.out".
@@ -16,15 +16,18 @@
 #include "llvm/LLVMContext.h"
 #include "llvm/Module.h"
 #include "llvm/Analysis/Verifier.h"
+#include "llvm/Assembly/Writer.h"
 #include "llvm/Bitcode/ReaderWriter.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Support/SystemUtils.h"
 #include "llvm/Support/IRReader.h"
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/Threading.h"
 #include <memory>
 using namespace llvm;
 
@@ -82,6 +85,15 @@ int main(int argc, char **argv) {
   llvm_shutdown_obj Y;  // Call llvm_shutdown() on exit.
   cl::ParseCommandLineOptions(argc, argv, "llvm linker\n");
 
+  // The verifier and the bitcode and assembly writers only use threads if we
+  // ask for them.
+  if (VerifyModuleThreads != 1 || BitcodeWriteThreads != 1 ||
+      PrintModuleThreads != 1)
+    llvm_start_multithreaded();
+
+  // An input named more than once is only read once.
+  MemoryBuffer::setFileCacheEnabled(true);
+
   unsigned BaseArg = 0;
   std::string ErrorMessage;
 
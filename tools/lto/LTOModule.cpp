@@ -80,7 +80,8 @@ LTOModule::LTOModule(Module *m, TargetMachine *t)
 LTOModule *LTOModule::makeLTOModule(const char *path,
                                     std::string &errMsg) {
   OwningPtr<MemoryBuffer> buffer;
-  if (error_code ec = MemoryBuffer::getFile(path, buffer)) {
+  if (error_code ec = MemoryBuffer::getFile(path, buffer, -1,
+                                            MemoryBuffer::SequentialAccess)) {
     errMsg = ec.message();
     return NULL;
   }
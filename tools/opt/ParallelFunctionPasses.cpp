@@ -0,0 +1,508 @@
+//===- ParallelFunctionPasses.cpp - Run function passes on threads --------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// An LLVMContext and everything in it may only be used by one thread at a
+// time, so the functions of a module can't simply be handed to several
+// FPPassManagers.  Instead, the module is written out as bitcode once and
+// every thread lazily reads its own copy into its own context, with only the
+// bodies of a contiguous range of the functions, and runs the passes over
+// them.  The optimized ranges are then read back into the original context,
+// in order, and replace the original functions.  Declarations and globals the
+// passes created (intrinsics, library functions, string constants) are merged
+// into the module the same way, in the order a serial run would have created
+// them.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "function-pass-threads"
+#include "ParallelFunctionPasses.h"
+#include "llvm/DerivedTypes.h"
+#include "llvm/Instructions.h"
+#include "llvm/LLVMContext.h"
+#include "llvm/Module.h"
+#include "llvm/PassManager.h"
+#include "llvm/TypeSymbolTable.h"
+#include "llvm/ValueSymbolTable.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Threading.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <vector>
+using namespace llvm;
+
+STATISTIC(NumShardsRun, "Number of function ranges optimized on a thread");
+STATISTIC(NumUnusable, "Number of parallel runs redone on one thread");
+
+namespace {
+  /// LocalState - What bitcode doesn't keep about a range of functions, but
+  /// passes and the assembly writer can depend on: the order of the use lists
+  /// of their values, and the counters their symbol tables append to names
+  /// that conflict.
+  struct LocalState {
+    std::vector<unsigned> UseListOrder;
+    std::vector<unsigned> LastUnique;
+  };
+
+  /// Shard - A contiguous range of the module's function list that one task
+  /// optimizes, and the bitcode it produced.
+  struct Shard {
+    StringRef Input;
+    unsigned Begin, End;
+    AddFunctionPassesFn AddPasses;
+    void *Arg;
+    LocalState Before, After;
+    std::string Result;
+    bool Failed;
+  };
+}
+
+/// numberLocals - Number the arguments, blocks and instructions of the
+/// NumFunctions functions starting at F, in that order.
+static void numberLocals(Module::iterator F, unsigned NumFunctions,
+                         std::vector<Value*> &Locals,
+                         DenseMap<const Value*, unsigned> *Numbers) {
+  for (; NumFunctions; --NumFunctions, ++F) {
+    for (Function::arg_iterator A = F->arg_begin(), E = F->arg_end();
+         A != E; ++A)
+      Locals.push_back(A);
+    for (Function::iterator BB = F->begin(), BE = F->end(); BB != BE; ++BB) {
+      Locals.push_back(BB);
+      for (BasicBlock::iterator I = BB->begin(), E = BB->end(); I != E; ++I)
+        Locals.push_back(I);
+    }
+  }
+  if (Numbers)
+    for (unsigned i = 0, e = Locals.size(); i != e; ++i)
+      (*Numbers)[Locals[i]] = i;
+}
+
+/// recordUseListOrder - Record the order of the use lists of every value
+/// local to the NumFunctions functions starting at F that has several
+/// uses: the value's number, the number of uses and, in use list order, the
+/// number of the user and the operand of each use.
+static void recordUseListOrder(Module::iterator F, unsigned NumFunctions,
+                               std::vector<unsigned> &Order) {
+  std::vector<Value*> Locals;
+  DenseMap<const Value*, unsigned> Numbers;
+  numberLocals(F, NumFunctions, Locals, &Numbers);
+
+  for (unsigned i = 0, e = Locals.size(); i != e; ++i) {
+    Value *V = Locals[i];
+    if (!V->hasNUsesOrMore(2))
+      continue;
+    unsigned Start = Order.size();
+    Order.push_back(i);
+    Order.push_back(0);
+    for (Value::use_iterator UI = V->use_begin(), UE = V->use_end();
+         UI != UE; ++UI) {
+      DenseMap<const Value*, unsigned>::iterator N = Numbers.find(*UI);
+      if (N == Numbers.end()) {
+        Order.resize(Start);
+        break;
+      }
+      Order.push_back(N->second);
+      Order.push_back(UI.getOperandNo());
+      ++Order[Start + 1];
+    }
+  }
+}
+
+/// applyUseListOrder - Put the use lists of the values local to the
+/// NumFunctions functions starting at F back in the order recordUseListOrder
+/// recorded.
+static void applyUseListOrder(Module::iterator F, unsigned NumFunctions,
+                              const std::vector<unsigned> &Order) {
+  std::vector<Value*> Locals;
+  numberLocals(F, NumFunctions, Locals, 0);
+
+  std::vector<Use*> Uses;
+  for (unsigned i = 0, e = Order.size(); i != e; ) {
+    Value *V = Locals[Order[i]];
+    unsigned NumUses = Order[i + 1];
+    i += 2;
+
+    Uses.clear();
+    for (unsigned u = 0; u != NumUses; ++u, i += 2) {
+      User *U = cast<User>(Locals[Order[i]]);
+      Uses.push_back(&U->getOperandUse(Order[i + 1]));
+    }
+    // Setting a use moves it to the front of the list.
+    if (V->hasNUses(NumUses))
+      for (unsigned u = NumUses; u != 0; --u)
+        Uses[u - 1]->set(V);
+  }
+}
+
+/// recordLocalState - Fill in State for the NumFunctions functions starting
+/// at F.
+static void recordLocalState(Module::iterator F, unsigned NumFunctions,
+                             LocalState &State) {
+  recordUseListOrder(F, NumFunctions, State.UseListOrder);
+  for (; NumFunctions; --NumFunctions, ++F)
+    State.LastUnique.push_back(F->getValueSymbolTable().getLastUnique());
+}
+
+/// applyLocalState - Restore State, recorded from other copies of the
+/// NumFunctions functions starting at F.
+static void applyLocalState(Module::iterator F, unsigned NumFunctions,
+                            const LocalState &State) {
+  applyUseListOrder(F, NumFunctions, State.UseListOrder);
+  for (unsigned i = 0; i != NumFunctions; ++i, ++F)
+    F->getValueSymbolTable().setLastUnique(State.LastUnique[i]);
+}
+
+/// runShard - Read a private copy of the module, run the passes over the
+/// functions of the shard and write out what is left once the other bodies
+/// are deleted.
+static void runShard(void *S) {
+  Shard &Sh = *static_cast<Shard*>(S);
+  Sh.Failed = true;
+
+  LLVMContext Context;
+  MemoryBuffer *Buffer = MemoryBuffer::getMemBuffer(Sh.Input);
+  OwningPtr<Module> M(getLazyBitcodeModule(Buffer, Context));
+  if (!M) {
+    delete Buffer;
+    return;
+  }
+
+  // Only read the bodies of the shard's functions.  The other definitions
+  // get a placeholder body instead, since passes treat calls to definitions
+  // differently from calls to declarations.
+  unsigned NumOriginals = M->size(), Idx = 0;
+  for (Module::iterator I = M->begin(), E = M->end(); I != E; ++I, ++Idx) {
+    if (!I->isMaterializable())
+      continue;
+    if (Idx >= Sh.Begin && Idx < Sh.End) {
+      if (I->Materialize())
+        return;
+    } else {
+      new UnreachableInst(Context, BasicBlock::Create(Context, "", I));
+    }
+  }
+
+  Module::iterator Begin = M->begin();
+  for (unsigned i = 0; i != Sh.Begin; ++i)
+    ++Begin;
+  applyLocalState(Begin, Sh.End - Sh.Begin, Sh.Before);
+
+  {
+    FunctionPassManager FPM(M.get());
+    Sh.AddPasses(FPM, *M, Sh.Arg);
+
+    FPM.doInitialization();
+    Module::iterator I = Begin;
+    for (unsigned i = Sh.Begin; i != Sh.End; ++i, ++I)
+      if (!I->isDeclaration())
+        FPM.run(*I);
+    FPM.doFinalization();
+  }
+  recordLocalState(Begin, Sh.End - Sh.Begin, Sh.After);
+
+  Idx = 0;
+  for (Module::iterator I = M->begin(); Idx != NumOriginals; ++I, ++Idx)
+    if ((Idx < Sh.Begin || Idx >= Sh.End) && !I->isDeclaration())
+      I->deleteBody();
+
+  raw_string_ostream OS(Sh.Result);
+  WriteBitcodeToFile(M.get(), OS);
+  OS.flush();
+  Sh.Failed = false;
+}
+
+/// canSplit - Return true if every type in M survives being written out and
+/// read back into the same context.  Opaque types are recreated as distinct
+/// types, so modules that use them are left alone.
+static bool canSplit(const Module &M) {
+  const TypeSymbolTable &ST = M.getTypeSymbolTable();
+  for (TypeSymbolTable::const_iterator I = ST.begin(), E = ST.end();
+       I != E; ++I)
+    if (I->second->isAbstract())
+      return false;
+
+  for (Module::const_global_iterator I = M.global_begin(),
+       E = M.global_end(); I != E; ++I)
+    if (I->getType()->isAbstract())
+      return false;
+  for (Module::const_alias_iterator I = M.alias_begin(), E = M.alias_end();
+       I != E; ++I)
+    if (I->getType()->isAbstract())
+      return false;
+
+  for (Module::const_iterator F = M.begin(), E = M.end(); F != E; ++F) {
+    if (F->getType()->isAbstract())
+      return false;
+    // blockaddress constants can't be pointed at blocks in another copy.
+    for (Function::const_iterator BB = F->begin(), BE = F->end();
+         BB != BE; ++BB)
+      if (BB->hasAddressTaken())
+        return false;
+  }
+  return true;
+}
+
+namespace {
+  /// Originals - The globals, functions and aliases of the module being
+  /// optimized, in list order, as they were before any shard was merged.
+  struct Originals {
+    std::vector<GlobalValue*> Values;
+    std::vector<Function*> Functions;
+    unsigned NumGlobals;
+  };
+}
+
+/// splitCopies - Sort the globals of W, which was read from a shard's output,
+/// into the copies of the values in Orig, in the same order, and the ones the
+/// passes created.  Those were appended to their lists, so the copies lead
+/// each list.  Return false if they don't match the originals.
+static bool splitCopies(Module &W, const Originals &Orig,
+                        std::vector<GlobalValue*> &Copies,
+                        std::vector<GlobalValue*> &Created) {
+  unsigned NumAliases =
+    Orig.Values.size() - Orig.NumGlobals - Orig.Functions.size();
+  if (W.getGlobalList().size() < Orig.NumGlobals ||
+      W.getFunctionList().size() < Orig.Functions.size() ||
+      W.getAliasList().size() != NumAliases)
+    return false;
+
+  unsigned Idx = 0;
+  for (Module::global_iterator I = W.global_begin(), E = W.global_end();
+       I != E; ++I, ++Idx)
+    (Idx < Orig.NumGlobals ? Copies : Created).push_back(I);
+  Idx = 0;
+  for (Module::iterator I = W.begin(), E = W.end(); I != E; ++I, ++Idx)
+    (Idx < Orig.Functions.size() ? Copies : Created).push_back(I);
+  for (Module::alias_iterator I = W.alias_begin(), E = W.alias_end();
+       I != E; ++I)
+    Copies.push_back(I);
+
+  for (unsigned i = 0, e = Copies.size(); i != e; ++i)
+    if (Copies[i]->getType() != Orig.Values[i]->getType() ||
+        Copies[i]->getName() != Orig.Values[i]->getName())
+      return false;
+  return true;
+}
+
+/// mergeShard - Replace the functions of Sh in M with the optimized ones in
+/// W, move over the globals its passes created and point all uses of W's
+/// copies of M's globals at the originals.  Afterwards nothing in W is used
+/// and it can be deleted.
+static void mergeShard(Module &M, Module &W, const Shard &Sh,
+                       Originals &Orig) {
+  std::vector<GlobalValue*> Copies, Created;
+  bool Matched = splitCopies(W, Orig, Copies, Created);
+  assert(Matched && "Shard was checked before merging!");
+  (void)Matched;
+
+  // Swap whole functions rather than moving bodies, so that arguments and
+  // the function-local metadata that refers to them stay together.
+  for (unsigned i = Sh.Begin; i != Sh.End; ++i) {
+    Function *MF = Orig.Functions[i];
+    if (MF->isDeclaration())
+      continue;
+    unsigned ValueIdx = Orig.NumGlobals + i;
+    Function *WF = cast<Function>(Copies[ValueIdx]);
+    WF->removeFromParent();
+    WF->takeName(MF);
+    M.getFunctionList().insert(MF, WF);
+    MF->replaceAllUsesWith(WF);
+    MF->eraseFromParent();
+    Orig.Functions[i] = WF;
+    Orig.Values[ValueIdx] = WF;
+  }
+  if (Sh.Begin != Sh.End)
+    applyLocalState(Orig.Functions[Sh.Begin], Sh.End - Sh.Begin, Sh.After);
+
+  // Function passes may also raise the alignment of globals they access, and
+  // doInitialization may add attributes to library function declarations.
+  for (unsigned i = 0, e = Copies.size(); i != e; ++i) {
+    GlobalValue *GV = Orig.Values[i];
+    if (Copies[i] == GV)
+      continue;
+    if (Copies[i]->getAlignment() > GV->getAlignment())
+      GV->setAlignment(Copies[i]->getAlignment());
+    if (Function *F = dyn_cast<Function>(GV))
+      if (F->isDeclaration())
+        F->setAttributes(cast<Function>(Copies[i])->getAttributes());
+    Copies[i]->replaceAllUsesWith(GV);
+  }
+
+  // Move over whatever the passes created.  Declarations of something M
+  // already has, like an intrinsic an earlier shard needed too, are folded
+  // into the existing one; everything else is appended, as it would have
+  // been by a serial run.  createdNamesFit made sure only internal globals
+  // can be renamed.
+  for (unsigned i = 0, e = Created.size(); i != e; ++i) {
+    GlobalValue *GV = Created[i];
+    if (GV->isDeclaration() && GV->hasName())
+      if (GlobalValue *Existing = M.getNamedValue(GV->getName()))
+        if (Existing->getType() == GV->getType()) {
+          GV->replaceAllUsesWith(Existing);
+          continue;
+        }
+    GV->removeFromParent();
+    if (GlobalVariable *G = dyn_cast<GlobalVariable>(GV))
+      M.getGlobalList().push_back(G);
+    else
+      M.getFunctionList().push_back(cast<Function>(GV));
+  }
+}
+
+/// createdNamesFit - Check that the globals a shard created can be moved
+/// into M without renaming one that is visible outside the module.  A
+/// declaration can only be folded into a global of the same type, and
+/// anything else needs a name that is still free.  Claimed holds the types of
+/// the names that earlier shards' globals will take.
+static bool createdNamesFit(Module &M, const std::vector<GlobalValue*> &Created,
+                            StringMap<const Type*> &Claimed) {
+  for (unsigned i = 0, e = Created.size(); i != e; ++i) {
+    GlobalValue *GV = Created[i];
+    if (!GV->hasName() || GV->hasLocalLinkage())
+      continue;
+    const Type *Ty = GV->getType();
+    if (GlobalValue *Existing = M.getNamedValue(GV->getName()))
+      if (!GV->isDeclaration() || Existing->getType() != Ty)
+        return false;
+    StringMap<const Type*>::iterator I = Claimed.find(GV->getName());
+    if (I != Claimed.end()) {
+      if (!GV->isDeclaration() || I->second != Ty)
+        return false;
+      continue;
+    }
+    Claimed[GV->getName()] = Ty;
+  }
+  return true;
+}
+
+bool llvm::runFunctionPassesInParallel(Module &M, unsigned NumThreads,
+                                       AddFunctionPassesFn AddPasses,
+                                       void *Arg) {
+  if (NumThreads < 2 || TimePassesIsEnabled)
+    return false;
+
+  Originals Orig;
+  std::vector<Function*> &Functions = Orig.Functions;
+  std::vector<unsigned> Sizes;
+  unsigned NumDefined = 0;
+  uint64_t TotalSize = 0;
+  for (Module::iterator F = M.begin(), E = M.end(); F != E; ++F) {
+    unsigned Size = 0;
+    for (Function::iterator BB = F->begin(), BE = F->end(); BB != BE; ++BB)
+      Size += BB->size();
+    Functions.push_back(F);
+    Sizes.push_back(Size);
+    TotalSize += Size;
+    if (!F->isDeclaration())
+      ++NumDefined;
+  }
+  if (NumDefined < 2 || !canSplit(M))
+    return false;
+  if (!llvm_is_multithreaded())
+    return false;
+
+  // Cut the function list into ranges of about the same number of
+  // instructions.  Keeping the ranges contiguous means the merged module
+  // lists new globals in the same order as a serial run would.
+  unsigned NumShards = std::min(NumThreads, NumDefined);
+  std::vector<Shard> Shards;
+  uint64_t Seen = 0;
+  for (unsigned Begin = 0, End = 0; Begin != Functions.size(); Begin = End) {
+    uint64_t Goal = TotalSize * (Shards.size() + 1) / NumShards;
+    while (End != Functions.size() && (Seen < Goal || End == Begin)) {
+      Seen += Sizes[End];
+      ++End;
+    }
+    if (Shards.size() + 1 == NumShards)
+      End = Functions.size();
+
+    Shard Sh;
+    Sh.Begin = Begin;
+    Sh.End = End;
+    Sh.AddPasses = AddPasses;
+    Sh.Arg = Arg;
+    Sh.Failed = false;
+    Shards.push_back(Sh);
+  }
+
+  std::string Bitcode;
+  {
+    raw_string_ostream OS(Bitcode);
+    WriteBitcodeToFile(&M, OS);
+  }
+  // MemoryBuffer needs the data to be followed by a null.
+  StringRef Input(Bitcode.c_str(), Bitcode.size());
+  for (unsigned i = 0, e = Shards.size(); i != e; ++i)
+    Shards[i].Input = Input;
+
+  for (unsigned i = 0, e = Shards.size(); i != e; ++i)
+    if (Shards[i].Begin != Shards[i].End)
+      recordLocalState(Functions[Shards[i].Begin],
+                       Shards[i].End - Shards[i].Begin, Shards[i].Before);
+
+  // The calling thread runs tasks while it waits, so it is one of the
+  // NumThreads.
+  {
+    ThreadPool Pool(NumThreads - 1);
+    TaskGroup Group(Pool);
+    for (unsigned i = 0, e = Shards.size(); i != e; ++i)
+      Group.spawn(runShard, &Shards[i]);
+    Group.wait();
+  }
+
+  for (Module::global_iterator I = M.global_begin(), E = M.global_end();
+       I != E; ++I)
+    Orig.Values.push_back(I);
+  Orig.NumGlobals = Orig.Values.size();
+  Orig.Values.insert(Orig.Values.end(), Functions.begin(), Functions.end());
+  for (Module::alias_iterator I = M.alias_begin(), E = M.alias_end();
+       I != E; ++I)
+    Orig.Values.push_back(I);
+
+  // Read every result back before changing M, so that M is left untouched
+  // if any of them is not usable.
+  std::vector<Module*> Results;
+  StringMap<const Type*> Claimed;
+  bool Usable = true;
+  for (unsigned i = 0, e = Shards.size(); i != e && Usable; ++i) {
+    Usable = false;
+    if (Shards[i].Failed)
+      break;
+    const std::string &Result = Shards[i].Result;
+    OwningPtr<MemoryBuffer>
+      Buffer(MemoryBuffer::getMemBuffer(StringRef(Result.c_str(),
+                                                  Result.size())));
+    Module *W = ParseBitcodeFile(Buffer.get(), M.getContext());
+    if (!W)
+      break;
+    Results.push_back(W);
+    std::string().swap(Shards[i].Result);
+
+    std::vector<GlobalValue*> Copies, Created;
+    Usable = splitCopies(*W, Orig, Copies, Created) &&
+             createdNamesFit(M, Created, Claimed);
+  }
+
+  if (Usable) {
+    for (unsigned i = 0, e = Results.size(); i != e; ++i)
+      mergeShard(M, *Results[i], Shards[i], Orig);
+    NumShardsRun += Shards.size();
+  } else {
+    ++NumUnusable;
+  }
+
+  for (unsigned i = 0, e = Results.size(); i != e; ++i)
+    delete Results[i];
+  return Usable;
+}
@@ -0,0 +1,42 @@
+//===- ParallelFunctionPasses.h - Run function passes on threads -*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares runFunctionPassesInParallel, which opt uses to spread the
+// functions of a module over several threads when it runs a pipeline made up
+// only of function passes.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef OPT_PARALLELFUNCTIONPASSES_H
+#define OPT_PARALLELFUNCTIONPASSES_H
+
+namespace llvm {
+
+class Module;
+class PassManagerBase;
+
+/// AddFunctionPassesFn - Add the passes to run, which must all be function,
+/// loop, region, basic block or immutable passes, to PM.  This is called once
+/// on each thread, with the copy of the module the thread works on, so the
+/// passes it adds must not refer to anything in the original module.
+typedef void (*AddFunctionPassesFn)(PassManagerBase &PM, Module &M, void *Arg);
+
+/// runFunctionPassesInParallel - Run the passes AddPasses adds over every
+/// function in M, using NumThreads threads.  The result is the same as running
+/// them with a single FPPassManager, except that the defined functions of M
+/// are replaced by new Function objects.  Returns false without touching M if
+/// the module can't be split up, if the results can't be merged back without
+/// renaming a global, or if multithreaded mode has not been started, in which
+/// case the caller should run the passes itself.
+bool runFunctionPassesInParallel(Module &M, unsigned NumThreads,
+                                 AddFunctionPassesFn AddPasses, void *Arg);
+
+} // end namespace llvm
+
+#endif
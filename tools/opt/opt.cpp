@@ -12,12 +12,14 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "ParallelFunctionPasses.h"
 #include "llvm/LLVMContext.h"
 #include "llvm/Module.h"
 #include "llvm/PassManager.h"
 #include "llvm/CallGraphSCCPass.h"
 #include "llvm/Bitcode/ReaderWriter.h"
 #include "llvm/Assembly/PrintModulePass.h"
+#include "llvm/Assembly/Writer.h"
 #include "llvm/Analysis/DebugInfo.h"
 #include "llvm/Analysis/Verifier.h"
 #include "llvm/Analysis/LoopPass.h"
@@ -27,6 +29,7 @@
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/Support/PassNameParser.h"
 #include "llvm/Support/Signals.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/IRReader.h"
 #include "llvm/Support/ManagedStatic.h"
@@ -39,6 +42,7 @@
 #include "llvm/LinkAllVMCore.h"
 #include <memory>
 #include <algorithm>
+#include <vector>
 using namespace llvm;
 
 // The OptimizationList is automatically populated with registered Passes by the
@@ -133,6 +137,11 @@ static cl::opt<bool>
 PrintBreakpoints("print-breakpoints-for-testing", 
                  cl::desc("Print select breakpoints location for testing"));
 
+static cl::opt<unsigned>
+FunctionPassThreads("function-pass-threads",
+                    cl::desc("Run function passes on this many threads"),
+                    cl::value_desc("N"), cl::init(1));
+
 static cl::opt<std::string>
 DefaultDataLayout("default-data-layout", 
           cl::desc("data layout string to use if not specified by module"),
@@ -380,6 +389,10 @@ inline void addPass(PassManagerBase &PM, Pass *P) {
   if (VerifyEach) PM.add(createVerifierPass());
 }
 
+/// FunctionPassLevels - The optimization levels whose function passes have
+/// been added to the function pass manager, in order.
+std::vector<unsigned> FunctionPassLevels;
+
 /// AddOptimizationPasses - This routine adds optimization passes
 /// based on selected optimization level, OptLevel. This routine
 /// duplicates llvm-gcc behaviour.
@@ -388,6 +401,7 @@ inline void addPass(PassManagerBase &PM, Pass *P) {
 void AddOptimizationPasses(PassManagerBase &MPM, PassManagerBase &FPM,
                            unsigned OptLevel) {
   createStandardFunctionPasses(&FPM, OptLevel);
+  FunctionPassLevels.push_back(OptLevel);
 
   llvm::Pass *InliningPass = 0;
   if (DisableInline) {
@@ -446,6 +460,57 @@ void AddStandardLinkPasses(PassManagerBase &PM) {
                           /*VerifyEach=*/ VerifyEach);
 }
 
+/// AddParallelFunctionPasses - Rebuild the function pass pipeline for a
+/// thread of -function-pass-threads.  Arg points to the data layout string;
+/// the passes come from FunctionPassLevels if any were added, and from the
+/// pass list otherwise.
+void AddParallelFunctionPasses(PassManagerBase &PM, Module &M, void *Arg) {
+  const std::string &DataLayout = *static_cast<std::string*>(Arg);
+  if (!DataLayout.empty())
+    PM.add(new TargetData(DataLayout));
+
+  if (!FunctionPassLevels.empty()) {
+    for (unsigned i = 0, e = FunctionPassLevels.size(); i != e; ++i)
+      createStandardFunctionPasses(&PM, FunctionPassLevels[i]);
+    return;
+  }
+
+  for (unsigned i = 0; i < PassList.size(); ++i)
+    addPass(PM, PassList[i]->getNormalCtor()());
+}
+
+/// isFunctionLevelPass - Return true if the pass PI describes can run in a
+/// FunctionPassManager.
+bool isFunctionLevelPass(const PassInfo *PI) {
+  if (!PI->getNormalCtor())
+    return false;
+  Pass *P = PI->getNormalCtor()();
+  PassKind Kind = P->getPassKind();
+  bool Result = Kind == PT_Function || Kind == PT_Loop ||
+                Kind == PT_Region || Kind == PT_BasicBlock ||
+                P->getAsImmutablePass() != 0;
+  delete P;
+  return Result;
+}
+
+/// RunPassListInParallel - If -function-pass-threads was given and the pass
+/// list is made up of nothing but function level passes, run it on that many
+/// threads.  Returns true if the passes have been run.
+bool RunPassListInParallel(Module &M, std::string &DataLayout) {
+  if (FunctionPassThreads < 2 || PassList.empty() || AnalyzeOnly ||
+      PrintEachXForm || PrintBreakpoints || StripDebug ||
+      StandardCompileOpts || StandardLinkOpts ||
+      OptLevelO1 || OptLevelO2 || OptLevelO3)
+    return false;
+
+  for (unsigned i = 0; i < PassList.size(); ++i)
+    if (!isFunctionLevelPass(PassList[i]))
+      return false;
+
+  return runFunctionPassesInParallel(M, FunctionPassThreads,
+                                     AddParallelFunctionPasses, &DataLayout);
+}
+
 } // anonymous namespace
 
 
@@ -477,6 +542,12 @@ int main(int argc, char **argv) {
   cl::ParseCommandLineOptions(argc, argv,
     "llvm .bc -> .bc modular optimizer and analysis printer\n");
 
+  // The function passes and the bitcode and assembly writers only use
+  // threads if we ask for them.
+  if (FunctionPassThreads != 1 || BitcodeWriteThreads != 1 ||
+      PrintModuleThreads != 1)
+    llvm_start_multithreaded();
+
   if (AnalyzeOnly && NoOutput) {
     errs() << argv[0] << ": analyze mode conflicts with no-output mode.\n";
     return 1;
@@ -570,8 +641,15 @@ int main(int argc, char **argv) {
   if (StripDebug && !StandardCompileOpts)
     addPass(Passes, createStripSymbolsPass(true));
 
+  // A pass list of function passes alone may be run on several threads right
+  // away, leaving only the verifier and output passes for below.
+  std::string DataLayout = TD ? TD->getStringRepresentation() : "";
+  unsigned NumListedPasses = PassList.size();
+  if (RunPassListInParallel(*M.get(), DataLayout))
+    NumListedPasses = 0;
+
   // Create a new optimization pass for each one specified on the command line
-  for (unsigned i = 0; i < PassList.size(); ++i) {
+  for (unsigned i = 0; i < NumListedPasses; ++i) {
     // Check to see if -std-compile-opts was specified before this option.  If
     // so, handle it.
     if (StandardCompileOpts &&
@@ -661,7 +739,9 @@ int main(int argc, char **argv) {
     AddOptimizationPasses(Passes, *FPasses, 3);
 
   if (OptLevelO1 || OptLevelO2 || OptLevelO3)
-    FPasses->run(*M.get());
+    if (!runFunctionPassesInParallel(*M.get(), FunctionPassThreads,
+                                     AddParallelFunctionPasses, &DataLayout))
+      FPasses->run(*M.get());
 
   // Check that the module is well formed on completion of optimization
   if (!NoVerify && !VerifyEach)
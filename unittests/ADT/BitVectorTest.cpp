@@ -12,6 +12,7 @@
 
 #include "llvm/ADT/BitVector.h"
 #include "gtest/gtest.h"
+#include <vector>
 
 using namespace llvm;
 
@@ -196,6 +197,108 @@ TEST(BitVectorTest, ProxyIndex) {
   EXPECT_TRUE(Vec.none());
 }
 
+TEST(BitVectorTest, FusedOperations) {
+  // 200 bits is an odd number of words, so the vector loops have a tail.
+  BitVector A(200), B(200), C(130);
+  for (unsigned i = 0; i < 200; i += 3)
+    A.set(i);
+  for (unsigned i = 0; i < 200; i += 5)
+    B.set(i);
+  C.set(128);
+
+  EXPECT_TRUE(A.anyCommon(B));
+  EXPECT_FALSE(A.anyCommon(C));
+  C.set(195 % 130);
+  EXPECT_TRUE(B.anyCommon(C));
+
+  BitVector D(A);
+  D.reset(B);
+  EXPECT_EQ(A.count() - (A & B).count(), D.count());
+  EXPECT_FALSE(D.anyCommon(B));
+  EXPECT_TRUE(D == (A & ~B));
+
+  BitVector E(B);
+  EXPECT_TRUE(E.unionWith(A));
+  EXPECT_TRUE(E == (A | B));
+  EXPECT_FALSE(E.unionWith(A));
+  EXPECT_FALSE(E.unionWith(D));
+
+  // Growing by a union with a larger vector of zeros changes no bits.
+  BitVector F(64);
+  F.set(3);
+  EXPECT_FALSE(F.unionWith(BitVector(300)));
+  EXPECT_EQ(300U, F.size());
+  EXPECT_EQ(1U, F.count());
+
+  BitVector G(100);
+  G.set(0);
+  EXPECT_TRUE(G.unionWithDifference(A, B));
+  EXPECT_EQ(200U, G.size());
+  EXPECT_EQ(D.count() + !D.test(0), G.count());
+  EXPECT_FALSE(G.unionWithDifference(A, B));
+
+  // Bits of A beyond the end of B are all taken.
+  BitVector H;
+  EXPECT_TRUE(H.unionWithDifference(A, C));
+  BitVector WideC(C);
+  WideC.resize(200);
+  EXPECT_TRUE(H == (A & ~WideC));
+}
+
+// Liveness-style updates over register-count-sized vectors, written once
+// with the fused operations and once with the expressions callers had to use
+// before: temporaries for "A & ~B" and "(A & B).any()", and a copy to find
+// out whether a union changed anything.  The results have to agree;
+// "microbench bitvector" times the two.
+TEST(BitVectorTest, BulkOperationsMatchExpressions) {
+  const unsigned NumBits = 1000, NumSets = 64, Rounds = 500;
+
+  std::vector<BitVector> Sets(NumSets, BitVector(NumBits));
+  unsigned Seed = 1;
+  for (unsigned S = 0; S != NumSets; ++S)
+    for (unsigned i = 0; i != NumBits / 8; ++i) {
+      Seed = Seed * 1103515245 + 12345;
+      Sets[S].set((Seed >> 8) % NumBits);
+    }
+
+  unsigned FusedCount = 0, FusedChanges = 0;
+  for (unsigned R = 0; R != Rounds; ++R) {
+    BitVector Live(Sets[R % NumSets]);
+    for (unsigned S = 0; S != 8; ++S) {
+      const BitVector &Out = Sets[(R + S) % NumSets];
+      const BitVector &Def = Sets[(R * 7 + S) % NumSets];
+      const BitVector &Use = Sets[(R * 3 + S) % NumSets];
+      FusedChanges += Live.unionWithDifference(Out, Def);
+      if (Live.anyCommon(Use))
+        Live.reset(Use);
+      FusedChanges += Live.unionWith(Def);
+    }
+    FusedCount += Live.count();
+  }
+
+  unsigned ExprCount = 0, ExprChanges = 0;
+  for (unsigned R = 0; R != Rounds; ++R) {
+    BitVector Live(Sets[R % NumSets]);
+    for (unsigned S = 0; S != 8; ++S) {
+      const BitVector &Out = Sets[(R + S) % NumSets];
+      const BitVector &Def = Sets[(R * 7 + S) % NumSets];
+      const BitVector &Use = Sets[(R * 3 + S) % NumSets];
+      BitVector Old(Live);
+      Live |= Out & ~Def;
+      ExprChanges += Live != Old;
+      if ((Live & Use).any())
+        Live &= ~Use;
+      Old = Live;
+      Live |= Def;
+      ExprChanges += Live != Old;
+    }
+    ExprCount += Live.count();
+  }
+
+  EXPECT_EQ(ExprChanges, FusedChanges);
+  EXPECT_EQ(ExprCount, FusedCount);
+}
+
 }
 
 #endif
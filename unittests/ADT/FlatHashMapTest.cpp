@@ -0,0 +1,186 @@
+//===- llvm/unittest/ADT/FlatHashMapTest.cpp - FlatHashMap unit tests -----===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/FlatHashMap.h"
+#include "llvm/ADT/STLExtras.h"
+#include <string>
+
+using namespace llvm;
+
+namespace {
+
+// Test fixture
+class FlatHashMapTest : public testing::Test {
+protected:
+  FlatHashMap<uint32_t, uint32_t> uintMap;
+  FlatHashMap<uint32_t *, uint32_t *> uintPtrMap;
+  uint32_t dummyInt;
+};
+
+// Empty map tests
+TEST_F(FlatHashMapTest, EmptyIntMapTest) {
+  EXPECT_EQ(0u, uintMap.size());
+  EXPECT_TRUE(uintMap.empty());
+  EXPECT_TRUE(uintMap.begin() == uintMap.end());
+  EXPECT_FALSE(uintMap.count(0u));
+  EXPECT_TRUE(uintMap.find(0u) == uintMap.end());
+  EXPECT_EQ(0u, uintMap.lookup(0u));
+
+  const FlatHashMap<uint32_t, uint32_t> &constUintMap = uintMap;
+  EXPECT_TRUE(constUintMap.begin() == constUintMap.end());
+  EXPECT_TRUE(constUintMap.find(0u) == constUintMap.end());
+}
+
+// A map with a single entry
+TEST_F(FlatHashMapTest, SingleEntryPtrMapTest) {
+  uintPtrMap[&dummyInt] = &dummyInt;
+
+  EXPECT_EQ(1u, uintPtrMap.size());
+  EXPECT_FALSE(uintPtrMap.empty());
+
+  FlatHashMap<uint32_t *, uint32_t *>::iterator it = uintPtrMap.begin();
+  EXPECT_TRUE(&dummyInt == it->first);
+  EXPECT_TRUE(&dummyInt == it->second);
+  ++it;
+  EXPECT_TRUE(it == uintPtrMap.end());
+
+  EXPECT_TRUE(uintPtrMap.count(&dummyInt));
+  EXPECT_TRUE(uintPtrMap.find(&dummyInt) == uintPtrMap.begin());
+  EXPECT_TRUE(&dummyInt == uintPtrMap.lookup(&dummyInt));
+  EXPECT_TRUE(&dummyInt == uintPtrMap[&dummyInt]);
+}
+
+// DenseMap reserves ~0U and ~0U - 1 as its empty and tombstone keys, but
+// FlatHashMap keeps that state in the control bytes and accepts every key.
+TEST_F(FlatHashMapTest, ReservedKeysTest) {
+  uintMap[~0U] = 1;
+  uintMap[~0U - 1] = 2;
+  EXPECT_EQ(2u, uintMap.size());
+  EXPECT_EQ(1u, uintMap.lookup(~0U));
+  EXPECT_EQ(2u, uintMap.lookup(~0U - 1));
+  EXPECT_TRUE(uintMap.erase(~0U));
+  EXPECT_FALSE(uintMap.count(~0U));
+  EXPECT_EQ(2u, uintMap.lookup(~0U - 1));
+}
+
+// Insert, erase and clear
+TEST_F(FlatHashMapTest, InsertEraseClearTest) {
+  EXPECT_TRUE(uintMap.insert(std::make_pair(1u, 2u)).second);
+  EXPECT_FALSE(uintMap.insert(std::make_pair(1u, 3u)).second);
+  EXPECT_EQ(2u, uintMap.lookup(1u));
+
+  EXPECT_FALSE(uintMap.erase(2u));
+  EXPECT_TRUE(uintMap.erase(1u));
+  EXPECT_EQ(0u, uintMap.size());
+  EXPECT_TRUE(uintMap.begin() == uintMap.end());
+
+  uintMap[3u] = 4u;
+  uintMap.erase(uintMap.find(3u));
+  EXPECT_FALSE(uintMap.count(3u));
+
+  for (uint32_t i = 0; i != 1000; ++i)
+    uintMap[i] = i;
+  EXPECT_EQ(1000u, uintMap.size());
+  uintMap.clear();
+  EXPECT_EQ(0u, uintMap.size());
+  EXPECT_FALSE(uintMap.count(10u));
+}
+
+// Copy constructor, assignment and swap
+TEST_F(FlatHashMapTest, CopyAssignSwapTest) {
+  for (uint32_t i = 0; i != 100; ++i)
+    uintMap[i] = i * 2;
+
+  FlatHashMap<uint32_t, uint32_t> copyMap(uintMap);
+  EXPECT_EQ(100u, copyMap.size());
+  EXPECT_EQ(20u, copyMap[10u]);
+
+  FlatHashMap<uint32_t, uint32_t> assignedMap;
+  assignedMap[1000u] = 1u;
+  assignedMap = uintMap;
+  EXPECT_EQ(100u, assignedMap.size());
+  EXPECT_FALSE(assignedMap.count(1000u));
+  EXPECT_EQ(198u, assignedMap[99u]);
+
+  FlatHashMap<uint32_t, uint32_t> otherMap;
+  otherMap[5000u] = 1u;
+  otherMap.swap(uintMap);
+  EXPECT_EQ(1u, uintMap.size());
+  EXPECT_EQ(100u, otherMap.size());
+  EXPECT_EQ(1u, uintMap[5000u]);
+}
+
+// Entries with non-trivial destructors are only constructed for full buckets
+// and are destroyed on erase, clear and destruction.
+TEST_F(FlatHashMapTest, NonPODValueTest) {
+  FlatHashMap<uint32_t, std::string> strMap;
+  for (uint32_t i = 0; i != 200; ++i)
+    strMap[i] = std::string(i % 17 + 1, 'a');
+  for (uint32_t i = 0; i != 200; i += 2)
+    strMap.erase(i);
+  EXPECT_EQ(100u, strMap.size());
+  EXPECT_EQ(std::string(2, 'a'), strMap.lookup(1u));
+  EXPECT_EQ(std::string(), strMap.lookup(2u));
+  strMap.clear();
+  EXPECT_TRUE(strMap.empty());
+}
+
+// Mirror a mixed insert/erase workload into a DenseMap and check that both
+// maps agree.  The erases leave many tombstones, so this also covers the
+// rehash that reclaims them.
+TEST_F(FlatHashMapTest, MatchesDenseMapTest) {
+  DenseMap<uint32_t, uint32_t> refMap;
+  uint32_t Seed = 12345;
+  for (unsigned i = 0; i != 100000; ++i) {
+    Seed = Seed * 1103515245 + 12345;
+    uint32_t Key = (Seed >> 8) % 4096;
+    if (Seed & 0x10) {
+      uintMap[Key] += i;
+      refMap[Key] += i;
+    } else {
+      EXPECT_EQ(refMap.erase(Key), uintMap.erase(Key));
+    }
+  }
+
+  EXPECT_EQ(refMap.size(), uintMap.size());
+  unsigned Visited = 0;
+  for (FlatHashMap<uint32_t, uint32_t>::const_iterator I = uintMap.begin(),
+       E = uintMap.end(); I != E; ++I, ++Visited)
+    EXPECT_EQ(refMap.lookup(I->first), I->second);
+  EXPECT_EQ(uintMap.size(), Visited);
+}
+
+// Pointer keys with the regular stride of heap objects are the pattern that
+// hot users such as ValueMap see.  utils/microbench times this workload
+// against DenseMap.
+TEST_F(FlatHashMapTest, PointerWorkloadTest) {
+  static uint64_t Objects[1 << 16];
+  for (unsigned i = 0; i != array_lengthof(Objects); ++i)
+    uintPtrMap[reinterpret_cast<uint32_t*>(&Objects[i])] =
+      reinterpret_cast<uint32_t*>(&Objects[i ^ 1]);
+  EXPECT_EQ(array_lengthof(Objects), uintPtrMap.size());
+  EXPECT_LE(array_lengthof(Objects) * (2 * sizeof(uint32_t*) + 1),
+            uintPtrMap.getMemorySize());
+
+  unsigned Hits = 0;
+  for (unsigned Round = 0; Round != 4; ++Round)
+    for (unsigned i = 0; i != array_lengthof(Objects); ++i)
+      if (uintPtrMap.lookup(reinterpret_cast<uint32_t*>(&Objects[i])) ==
+          reinterpret_cast<uint32_t*>(&Objects[i ^ 1]))
+        ++Hits;
+  EXPECT_EQ(4 * array_lengthof(Objects), Hits);
+
+  // Misses have to stop at the first group with an empty bucket.
+  uint64_t Missing;
+  EXPECT_FALSE(uintPtrMap.count(reinterpret_cast<uint32_t*>(&Missing)));
+}
+
+}
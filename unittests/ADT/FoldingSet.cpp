@@ -13,7 +13,9 @@
 
 #include "gtest/gtest.h"
 #include "llvm/ADT/FoldingSet.h"
+#include "llvm/Support/Allocator.h"
 #include <string>
+#include <vector>
 
 using namespace llvm;
 
@@ -35,5 +37,74 @@ TEST(FoldingSetTest, UnalignedStringTest) {
   EXPECT_EQ(a.ComputeHash(), b.ComputeHash());
 }
 
+// Odd and even length profiles are both hashed.
+TEST(FoldingSetTest, HashLengthTest) {
+  FoldingSetNodeID a, b, c;
+  a.AddInteger(1U);
+  b.AddInteger(1U);
+  b.AddInteger(0U);
+  c.AddInteger(1U);
+  c.AddInteger(0U);
+  c.AddInteger(0U);
+  EXPECT_NE(a.ComputeHash(), b.ComputeHash());
+  EXPECT_NE(b.ComputeHash(), c.ComputeHash());
+
+  // An interned ID hashes like the ID it was copied from.
+  BumpPtrAllocator Allocator;
+  EXPECT_EQ(b.ComputeHash(), b.Intern(Allocator).ComputeHash());
+}
+
+struct TrivialPair : public FoldingSetNode {
+  unsigned Key, Value;
+  TrivialPair(unsigned K, unsigned V) : Key(K), Value(V) {}
+
+  void Profile(FoldingSetNodeID &ID) const {
+    ID.AddInteger(Key);
+    ID.AddInteger(Value);
+  }
+};
+
+// Nodes cache their hash while they are in the set.  Changing a node while it
+// is out of the set, and growing the set, must not leave a stale hash behind.
+TEST(FoldingSetTest, CachedHashTest) {
+  FoldingSet<TrivialPair> Set;
+  std::vector<TrivialPair*> Nodes;
+  for (unsigned i = 0; i != 1000; ++i) {
+    Nodes.push_back(new TrivialPair(i, i * 3));
+    Set.InsertNode(Nodes.back());
+  }
+  EXPECT_EQ(1000U, Set.size());
+
+  for (unsigned i = 0; i != 1000; ++i) {
+    FoldingSetNodeID ID;
+    ID.AddInteger(i);
+    ID.AddInteger(i * 3);
+    void *InsertPos;
+    EXPECT_EQ(Nodes[i], Set.FindNodeOrInsertPos(ID, InsertPos));
+  }
+
+  // Remove a node, change it and put it back in.
+  TrivialPair *N = Nodes[10];
+  EXPECT_TRUE(Set.RemoveNode(N));
+  N->Value = 7;
+  FoldingSetNodeID ID;
+  ID.AddInteger(10U);
+  ID.AddInteger(7U);
+  void *InsertPos;
+  EXPECT_EQ(0, Set.FindNodeOrInsertPos(ID, InsertPos));
+  Set.InsertNode(N, InsertPos);
+  EXPECT_EQ(N, Set.FindNodeOrInsertPos(ID, InsertPos));
+  TrivialPair Dup(10, 7);
+  EXPECT_EQ(N, Set.GetOrInsertNode(&Dup));
+
+  ID.clear();
+  ID.AddInteger(10U);
+  ID.AddInteger(30U);
+  EXPECT_EQ(0, Set.FindNodeOrInsertPos(ID, InsertPos));
+
+  for (unsigned i = 0; i != 1000; ++i)
+    delete Nodes[i];
+}
+
 }
 
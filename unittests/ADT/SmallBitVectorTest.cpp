@@ -193,4 +193,40 @@ TEST(SmallBitVectorTest, ProxyIndex) {
   EXPECT_TRUE(Vec.none());
 }
 
+TEST(SmallBitVectorTest, FusedOperations) {
+  // Small and large vectors combined in every way.
+  SmallBitVector Small(10), Large(200), Other(150);
+  Small.set(2);
+  Small.set(7);
+  Large.set(7);
+  Large.set(150);
+  Other.set(150);
+
+  EXPECT_TRUE(Small.anyCommon(Large));
+  EXPECT_TRUE(Large.anyCommon(Small));
+  EXPECT_TRUE(Large.anyCommon(Other));
+  EXPECT_FALSE(Small.anyCommon(Other));
+
+  SmallBitVector A(Small);
+  A.reset(Large);
+  EXPECT_TRUE(A.test(2));
+  EXPECT_FALSE(A.test(7));
+  EXPECT_EQ(10U, A.size());
+
+  SmallBitVector B(Large);
+  B.reset(Small);
+  EXPECT_FALSE(B.test(7));
+  EXPECT_TRUE(B.test(150));
+  B.reset(Other);
+  EXPECT_TRUE(B.none());
+
+  SmallBitVector C(Small);
+  EXPECT_FALSE(C.unionWith(Small));
+  EXPECT_TRUE(C.unionWith(Large));
+  EXPECT_EQ(200U, C.size());
+  EXPECT_EQ(3U, C.count());
+  EXPECT_FALSE(C.unionWith(Other));
+  EXPECT_FALSE(C.unionWith(Small));
+}
+
 }
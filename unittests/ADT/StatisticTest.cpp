@@ -0,0 +1,100 @@
+//===- llvm/unittest/ADT/StatisticTest.cpp - Statistic unit tests ---------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "unittest"
+#include "gtest/gtest.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
+#include "llvm/Support/raw_ostream.h"
+#include <string>
+
+using namespace llvm;
+
+STATISTIC(NumBumps, "Number of \"bumps\", counted per thread");
+
+namespace {
+
+static void BumpOnThread(void *) {
+  for (unsigned i = 0; i != 1000; ++i)
+    ++NumBumps;
+  NumBumps += 10;
+}
+
+TEST(StatisticTest, ShardedCount) {
+  EnableStatistics();
+  NumBumps = 5;
+  EXPECT_EQ(5U, NumBumps.getValue());
+
+  // While multithreaded, each thread counts into its own shard; the shards
+  // are summed whenever the statistic is read.
+  bool Threaded = llvm_start_multithreaded();
+  for (unsigned i = 0; i != 4; ++i)
+    llvm_execute_on_thread(BumpOnThread, 0);
+  ++NumBumps;
+  EXPECT_EQ(5U + 4 * 1010 + 1, NumBumps.getValue());
+
+  // Operations that cannot be sharded fold the shards in first.
+  NumBumps *= 2;
+  EXPECT_EQ(2 * (5U + 4 * 1010 + 1), NumBumps.getValue());
+  NumBumps = 7;
+  EXPECT_EQ(7U, NumBumps.getValue());
+  if (Threaded)
+    llvm_stop_multithreaded();
+}
+
+static void BumpManyOnThread(void *) {
+  for (unsigned i = 0; i != 100000; ++i)
+    ++NumBumps;
+}
+
+// Folding the shards into the value while other threads are still counting
+// must not lose any of their increments.
+TEST(StatisticTest, FoldWhileCounting) {
+  bool Threaded = llvm_start_multithreaded();
+  NumBumps = 0;
+  {
+    ThreadPool Pool(2);
+    TaskGroup G(Pool);
+    G.spawn(BumpManyOnThread, 0);
+    G.spawn(BumpManyOnThread, 0);
+    for (unsigned i = 0; i != 10000; ++i)
+      NumBumps *= 1;
+    G.wait();
+  }
+  EXPECT_EQ(200000U, NumBumps.getValue());
+  if (Threaded)
+    llvm_stop_multithreaded();
+}
+
+TEST(StatisticTest, MachineReadableOutput) {
+  EnableStatistics();
+  NumBumps = 3;
+
+  std::string JSON;
+  raw_string_ostream JSONOS(JSON);
+  PrintStatisticsJSON(JSONOS);
+  JSONOS.flush();
+  EXPECT_EQ(0U, JSON.find("{\n  \"statistics\": ["));
+  EXPECT_NE(std::string::npos,
+            JSON.find("{ \"pass\": \"unittest\", "
+                      "\"desc\": \"Number of \\\"bumps\\\", counted per "
+                      "thread\", \"value\": 3 }"));
+
+  std::string CSV;
+  raw_string_ostream CSVOS(CSV);
+  PrintStatisticsCSV(CSVOS);
+  CSVOS.flush();
+  EXPECT_EQ(0U, CSV.find("pass,desc,value\n"));
+  EXPECT_NE(std::string::npos,
+            CSV.find("\"unittest\",\"Number of \"\"bumps\"\", counted per "
+                     "thread\",3\n"));
+}
+
+}
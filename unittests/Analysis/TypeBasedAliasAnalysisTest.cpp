@@ -0,0 +1,134 @@
+//===- TypeBasedAliasAnalysisTest.cpp - TBAA unit tests -------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/Twine.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Analysis/Passes.h"
+#include "llvm/Constants.h"
+#include "llvm/DerivedTypes.h"
+#include "llvm/InitializePasses.h"
+#include "llvm/Instructions.h"
+#include "llvm/LLVMContext.h"
+#include "llvm/Metadata.h"
+#include "llvm/Module.h"
+#include "llvm/PassManager.h"
+#include "gtest/gtest.h"
+#include <vector>
+
+namespace llvm {
+namespace {
+
+static const unsigned NumScalarTypes = 8;
+
+/// TBAAQueries - Ask alias analysis about every pair of memory accesses in
+/// the function and count the answers that TBAA proved.
+struct TBAAQueries : public FunctionPass {
+  static char ID;
+  unsigned Rounds;
+  unsigned NoAliasCount;
+
+  TBAAQueries(unsigned Rounds)
+    : FunctionPass(ID), Rounds(Rounds), NoAliasCount(0) {}
+
+  virtual void getAnalysisUsage(AnalysisUsage &AU) const {
+    AU.addRequired<AliasAnalysis>();
+    AU.setPreservesAll();
+  }
+
+  virtual bool runOnFunction(Function &F) {
+    AliasAnalysis &AA = getAnalysis<AliasAnalysis>();
+    std::vector<Instruction*> Accesses;
+    for (Function::iterator BB = F.begin(), E = F.end(); BB != E; ++BB)
+      for (BasicBlock::iterator I = BB->begin(), IE = BB->end(); I != IE; ++I)
+        if (isa<LoadInst>(I) || isa<StoreInst>(I))
+          Accesses.push_back(I);
+
+    // Look the locations up on every query, the way clients such as
+    // AliasSetTracker and MemoryDependenceAnalysis do.
+    for (unsigned R = 0; R != Rounds; ++R)
+      for (unsigned i = 0, e = Accesses.size(); i != e; ++i)
+        for (unsigned j = 0; j != e; ++j)
+          if (AA.alias(getLocation(AA, Accesses[i]),
+                       getLocation(AA, Accesses[j])) == AliasAnalysis::NoAlias)
+            ++NoAliasCount;
+    return false;
+  }
+
+  static AliasAnalysis::Location getLocation(AliasAnalysis &AA,
+                                             Instruction *I) {
+    if (LoadInst *LI = dyn_cast<LoadInst>(I))
+      return AA.getLocation(LI);
+    return AA.getLocation(cast<StoreInst>(I));
+  }
+};
+
+char TBAAQueries::ID = 0;
+
+// Accesses tagged with different scalar types don't alias, whatever other
+// metadata they carry.  "microbench tbaa" times the same queries.
+TEST(TypeBasedAliasAnalysisTest, DistinctScalarTypes) {
+  LLVMContext Context;
+  Module M("tbaa", Context);
+  initializeAnalysis(*PassRegistry::getPassRegistry());
+
+  // A C-like type tree: scalar types under "omnipotent char" under the root.
+  Value *RootOps[] = { MDString::get(Context, "Simple C/C++ TBAA") };
+  MDNode *Root = MDNode::get(Context, RootOps, 1);
+  Value *CharOps[] = { MDString::get(Context, "omnipotent char"), Root };
+  MDNode *Char = MDNode::get(Context, CharOps, 2);
+  std::vector<MDNode*> Scalars;
+  for (unsigned i = 0; i != NumScalarTypes; ++i) {
+    Value *Ops[] = { MDString::get(Context, ("scalar" + Twine(i)).str()), Char };
+    Scalars.push_back(MDNode::get(Context, Ops, 2));
+  }
+
+  // Accesses also carry other metadata, as they do after optimization.
+  unsigned ProfKind = Context.getMDKindID("bench.prof");
+  unsigned NoteKind = Context.getMDKindID("bench.note");
+  Value *NoteOps[] = { MDString::get(Context, "note") };
+  MDNode *Note = MDNode::get(Context, NoteOps, 1);
+
+  const Type *I32 = Type::getInt32Ty(Context);
+  std::vector<const Type*> Params(1, PointerType::getUnqual(I32));
+  Function *F = cast<Function>(M.getOrInsertFunction("f",
+    FunctionType::get(Type::getVoidTy(Context), Params, false)));
+  BasicBlock *BB = BasicBlock::Create(Context, "entry", F);
+  Value *Ptr = F->arg_begin();
+  const unsigned NumAccesses = 64;
+  for (unsigned i = 0; i != NumAccesses; ++i) {
+    Instruction *I;
+    if (i & 1)
+      I = new StoreInst(ConstantInt::get(I32, i), Ptr, BB);
+    else
+      I = new LoadInst(Ptr, "", BB);
+    I->setMetadata(NoteKind, Note);
+    if (i % 3 == 0)
+      I->setMetadata(ProfKind, Note);
+    I->setMetadata(LLVMContext::MD_tbaa, Scalars[i % NumScalarTypes]);
+  }
+  ReturnInst::Create(Context, 0, BB);
+
+  const unsigned Rounds = 1;
+  TBAAQueries *Queries = new TBAAQueries(Rounds);
+  PassManager PM;
+  PM.add(createTypeBasedAliasAnalysisPass());
+  PM.add(Queries);
+
+  PM.run(M);
+
+  // Accesses with different scalar types don't alias; everything else is
+  // left to the conservative default.
+  unsigned PerType = NumAccesses / NumScalarTypes;
+  unsigned Expected = NumAccesses * NumAccesses - NumScalarTypes * PerType *
+                      PerType;
+  EXPECT_EQ(Rounds * Expected, Queries->NoAliasCount);
+}
+
+}
+}
@@ -7,13 +7,20 @@
 //
 //===----------------------------------------------------------------------===//
 
+#define DEBUG_TYPE "allocator-test"
 #include "llvm/Support/Allocator.h"
+#include "llvm/Support/Memory.h"
+#include "llvm/Support/ThreadLocalAllocator.h"
+#include "llvm/Support/Threading.h"
 
 #include "gtest/gtest.h"
 #include <cstdlib>
+#include <cstring>
 
 using namespace llvm;
 
+ALLOCATOR_STATISTICS(TestStats, "test allocators");
+
 namespace {
 
 TEST(AllocatorTest, Basics) {
@@ -140,4 +147,80 @@ TEST(AllocatorTest, TestBigAlignment) {
   EXPECT_LE(Ptr + 3000, ((uintptr_t)Slab) + Slab->Size);
 }
 
+// Slabs mapped from the OS are page aligned and the allocator gets to use the
+// whole rounded up mapping.
+TEST(AllocatorTest, TestMmapSlabs) {
+  MmapSlabAllocator SlabAlloc;
+  BumpPtrAllocator Alloc(4000, 4000, SlabAlloc);
+  char *a = (char*)Alloc.Allocate(100, 0);
+  memset(a, 1, 100);
+  EXPECT_EQ(1U, Alloc.GetNumSlabs());
+  EXPECT_LE(4000U, Alloc.getBytesReserved());
+  EXPECT_EQ(100U, Alloc.getBytesAllocated());
+
+  // A large page sized slab, backed by large pages if the host allows it.
+  if (size_t LargePageSize = sys::Memory::getLargePageSize()) {
+    char *b = (char*)Alloc.Allocate(LargePageSize, 0);
+    b[0] = 1;
+    b[LargePageSize - 1] = 2;
+    EXPECT_EQ(2U, Alloc.GetNumSlabs());
+    EXPECT_EQ(2, b[LargePageSize - 1]);
+  }
+}
+
+// The statistics of a kind of allocator are brought up to date whenever one
+// of them takes a new slab, not only when it is destroyed.
+TEST(AllocatorTest, TestStatistics) {
+  MallocSlabAllocator SlabAlloc;
+  {
+    BumpPtrAllocator Alloc(4096, 4096, SlabAlloc, &TestStats);
+    Alloc.Allocate(3000, 0);
+    EXPECT_EQ(1U, unsigned(TestStats.NumSlabs));
+    EXPECT_EQ(4U, unsigned(TestStats.KBReserved));
+
+    // This doesn't fit, so the last 1080 bytes of the first slab are wasted.
+    Alloc.Allocate(3000, 0);
+    EXPECT_EQ(2U, unsigned(TestStats.NumSlabs));
+    EXPECT_EQ(8U, unsigned(TestStats.KBReserved));
+    EXPECT_EQ(5U, unsigned(TestStats.KBUsed));
+    EXPECT_EQ(1U, unsigned(TestStats.KBWasted));
+  }
+  // So are the last 1080 bytes of the second one.
+  EXPECT_EQ(8U, unsigned(TestStats.KBReserved));
+  EXPECT_EQ(2U, unsigned(TestStats.KBWasted));
+}
+
+// Reset counts the rest of the current slab as wasted and reports it.
+TEST(AllocatorTest, TestResetStatistics) {
+  MallocSlabAllocator SlabAlloc;
+  unsigned Wasted = TestStats.KBWasted;
+  BumpPtrAllocator Alloc(4096, 4096, SlabAlloc, &TestStats);
+  Alloc.Allocate(1000, 0);
+  Alloc.Reset();
+  EXPECT_EQ(Wasted + 3, unsigned(TestStats.KBWasted));
+}
+
+// Each thread allocates from its own allocator.
+static void AllocateOnThread(void *Arg) {
+  ThreadLocalBumpPtrAllocator *Alloc =
+    static_cast<ThreadLocalBumpPtrAllocator*>(Arg);
+  for (unsigned i = 0; i != 1000; ++i)
+    *Alloc->Allocate<unsigned>() = i;
+}
+
+TEST(AllocatorTest, TestThreadLocal) {
+  ThreadLocalBumpPtrAllocator Alloc;
+  int *a = Alloc.Allocate<int>();
+  *a = 42;
+
+  llvm_execute_on_thread(AllocateOnThread, &Alloc);
+  llvm_execute_on_thread(AllocateOnThread, &Alloc);
+  EXPECT_EQ(42, *a);
+  EXPECT_EQ(sizeof(int) + 2 * 1000 * sizeof(unsigned),
+            Alloc.getBytesAllocated());
+
+  Alloc.Reset();
+  EXPECT_EQ(a, Alloc.Allocate<int>());
+}
+
 }  // anonymous namespace
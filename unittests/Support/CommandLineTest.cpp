@@ -55,6 +55,28 @@ TEST(CommandLineTest, ParseEnvironment) {
   EXPECT_EQ("hello", EnvironmentTestOption);
 }
 
+// Options are found through a table that is only built on demand.  Make sure
+// the names it is built from cover enum values, prefixes and groups.
+enum NamedTestLevel { NamedTestA, NamedTestB };
+cl::opt<NamedTestLevel> NamedTestLevelOpt(
+  cl::desc("Named option test level"),
+  cl::values(clEnumValN(NamedTestA, "named-test-a", "Level A"),
+             clEnumValN(NamedTestB, "named-test-b", "Level B"),
+             clEnumValEnd));
+cl::list<std::string> NamedTestPrefix("named-test-I", cl::Prefix);
+cl::opt<bool> NamedTestGroupQ("Q", cl::Grouping);
+cl::opt<bool> NamedTestGroupZ("Z", cl::Grouping);
+TEST(CommandLineTest, NamedOptionLookup) {
+  const char named_env_var[] = "LLVM_TEST_NAMED_COMMAND_LINE_FLAGS";
+  TempEnvVar TEV(named_env_var, "-named-test-b -named-test-Ifoo --QZ");
+  cl::ParseEnvironmentOptions("CommandLineTest", named_env_var);
+  EXPECT_EQ(NamedTestB, NamedTestLevelOpt);
+  ASSERT_EQ(1U, NamedTestPrefix.size());
+  EXPECT_EQ("foo", NamedTestPrefix[0]);
+  EXPECT_TRUE(NamedTestGroupQ);
+  EXPECT_TRUE(NamedTestGroupZ);
+}
+
 #endif  // SKIP_ENVIRONMENT_TESTS
 
 }  // anonymous namespace
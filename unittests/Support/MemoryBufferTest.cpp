@@ -0,0 +1,136 @@
+//===- llvm/unittest/Support/MemoryBufferTest.cpp - MemoryBuffer tests ----===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/system_error.h"
+#include <string>
+
+using namespace llvm;
+
+namespace {
+
+class MemoryBufferTest : public testing::Test {
+protected:
+  sys::Path TmpDir;
+
+  virtual void SetUp() {
+    std::string ErrMsg;
+    TmpDir = sys::Path::GetTemporaryDirectory(&ErrMsg);
+    ASSERT_FALSE(TmpDir.isEmpty()) << ErrMsg;
+  }
+
+  virtual void TearDown() {
+    MemoryBuffer::setFileCacheEnabled(false);
+    TmpDir.eraseFromDisk(true);
+  }
+
+  std::string writeFile(const char *Name, const std::string &Contents) {
+    sys::Path File(TmpDir);
+    File.appendComponent(Name);
+    std::string ErrMsg;
+    raw_fd_ostream OS(File.c_str(), ErrMsg, raw_fd_ostream::F_Binary);
+    EXPECT_EQ("", ErrMsg);
+    OS << Contents;
+    return File.str();
+  }
+};
+
+// The file was written just now, as the inputs of a compile-then-link run
+// are.
+TEST_F(MemoryBufferTest, FileCacheSharesContents) {
+  std::string File = writeFile("shared.txt", "shared contents\n");
+  MemoryBuffer::setFileCacheEnabled(true);
+  EXPECT_TRUE(MemoryBuffer::isFileCacheEnabled());
+
+  OwningPtr<MemoryBuffer> A, B;
+  ASSERT_FALSE(MemoryBuffer::getFile(File, A));
+  ASSERT_FALSE(MemoryBuffer::getFile(File, B, -1,
+                                     MemoryBuffer::SequentialAccess));
+  EXPECT_EQ("shared contents\n", A->getBuffer());
+  EXPECT_EQ(A->getBufferStart(), B->getBufferStart());
+  EXPECT_EQ(File, B->getBufferIdentifier());
+
+  // The contents outlive the buffers while the file is in the cache.
+  const char *Start = A->getBufferStart();
+  A.reset();
+  B.reset();
+  ASSERT_FALSE(MemoryBuffer::getFile(File, A));
+  EXPECT_EQ(Start, A->getBufferStart());
+
+  // ... and the buffers outlive the cache.
+  MemoryBuffer::setFileCacheEnabled(false);
+  EXPECT_EQ("shared contents\n", A->getBuffer());
+  ASSERT_FALSE(MemoryBuffer::getFile(File, B));
+  EXPECT_NE(A->getBufferStart(), B->getBufferStart());
+}
+
+TEST_F(MemoryBufferTest, FileCacheRereadsChangedFile) {
+  std::string File = writeFile("changed.txt", "old\n");
+  MemoryBuffer::setFileCacheEnabled(true);
+
+  OwningPtr<MemoryBuffer> Old, New;
+  ASSERT_FALSE(MemoryBuffer::getFile(File, Old));
+  writeFile("changed.txt", "new contents\n");
+  ASSERT_FALSE(MemoryBuffer::getFile(File, New));
+  EXPECT_EQ("old\n", Old->getBuffer());
+  EXPECT_EQ("new contents\n", New->getBuffer());
+}
+
+// A file rewritten with the same size within the same second only differs in
+// the sub-second parts of its times.
+TEST_F(MemoryBufferTest, FileCacheRereadsSameSizeRewrite) {
+  std::string File = writeFile("rewritten.txt", "first\n");
+  MemoryBuffer::setFileCacheEnabled(true);
+
+  OwningPtr<MemoryBuffer> First, Second;
+  ASSERT_FALSE(MemoryBuffer::getFile(File, First));
+  writeFile("rewritten.txt", "again\n");
+  ASSERT_FALSE(MemoryBuffer::getFile(File, Second));
+  EXPECT_EQ("first\n", First->getBuffer());
+  EXPECT_EQ("again\n", Second->getBuffer());
+}
+
+TEST_F(MemoryBufferTest, FileCacheDisabled) {
+  std::string File = writeFile("private.txt", "private contents\n");
+  EXPECT_FALSE(MemoryBuffer::isFileCacheEnabled());
+
+  OwningPtr<MemoryBuffer> A, B;
+  ASSERT_FALSE(MemoryBuffer::getFile(File, A));
+  ASSERT_FALSE(MemoryBuffer::getFile(File, B));
+  EXPECT_NE(A->getBufferStart(), B->getBufferStart());
+  EXPECT_EQ(A->getBuffer(), B->getBuffer());
+}
+
+// Files this large are mapped, and the access hints apply to the mapping.
+TEST_F(MemoryBufferTest, MappedFileWithHints) {
+  std::string Contents;
+  for (unsigned i = 0; Contents.size() < 100000; ++i)
+    Contents += char('a' + i % 26);
+  std::string File = writeFile("mapped.txt", Contents);
+
+  const MemoryBuffer::AccessPattern Patterns[] = {
+    MemoryBuffer::NormalAccess, MemoryBuffer::SequentialAccess,
+    MemoryBuffer::RandomAccess
+  };
+  for (unsigned Cached = 0; Cached != 2; ++Cached) {
+    MemoryBuffer::setFileCacheEnabled(Cached);
+    for (unsigned i = 0; i != 3; ++i) {
+      OwningPtr<MemoryBuffer> Buf;
+      ASSERT_FALSE(MemoryBuffer::getFile(File, Buf, -1, Patterns[i]));
+      EXPECT_EQ(Contents, Buf->getBuffer());
+      EXPECT_EQ(0, *Buf->getBufferEnd());
+    }
+  }
+}
+
+}
@@ -0,0 +1,120 @@
+//===- llvm/unittest/Support/ProgramTest.cpp - Program tests --------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+#include "llvm/Config/config.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/Errno.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Program.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/system_error.h"
+#include <cerrno>
+#include <string>
+
+using namespace llvm;
+
+namespace {
+
+#ifdef LLVM_ON_UNIX
+
+// A memory limit forces the fork/vfork path, no memory limit uses
+// posix_spawn where it is available.  Both must behave the same.
+static const unsigned MemoryLimits[] = { 0, 4096 };
+
+static int RunShell(const char *Script, const sys::Path **Redirects,
+                    unsigned MemoryLimit, std::string *ErrMsg) {
+  const char *Args[] = { "sh", "-c", Script, 0 };
+  return sys::Program::ExecuteAndWait(sys::Path("/bin/sh"), Args, 0,
+                                      Redirects, 0, MemoryLimit, ErrMsg);
+}
+
+TEST(ProgramTest, ExitCode) {
+  for (unsigned i = 0; i != array_lengthof(MemoryLimits); ++i) {
+    std::string ErrMsg;
+    EXPECT_EQ(3, RunShell("exit 3", 0, MemoryLimits[i], &ErrMsg));
+    EXPECT_EQ("", ErrMsg);
+  }
+}
+
+TEST(ProgramTest, Redirects) {
+  std::string ErrMsg;
+  sys::Path TmpDir = sys::Path::GetTemporaryDirectory(&ErrMsg);
+  ASSERT_FALSE(TmpDir.isEmpty()) << ErrMsg;
+
+  for (unsigned i = 0; i != array_lengthof(MemoryLimits); ++i) {
+    sys::Path Out(TmpDir);
+    Out.appendComponent(i ? "limited.txt" : "unlimited.txt");
+    sys::Path Empty;
+    const sys::Path *Redirects[] = { &Empty, &Out, &Out };
+    EXPECT_EQ(0, RunShell("echo out; echo err >&2", Redirects,
+                          MemoryLimits[i], &ErrMsg));
+
+    OwningPtr<MemoryBuffer> Buf;
+    ASSERT_FALSE(MemoryBuffer::getFile(Out.c_str(), Buf));
+    EXPECT_EQ("out\nerr\n", Buf->getBuffer());
+  }
+
+  // Failing to set up a redirect is reported to the caller.
+  for (unsigned i = 0; i != array_lengthof(MemoryLimits); ++i) {
+    sys::Path Missing(TmpDir);
+    Missing.appendComponent("missing/input.txt");
+    const sys::Path *Redirects[] = { &Missing, 0, 0 };
+    ErrMsg.clear();
+    int Result = RunShell("exit 0", Redirects, MemoryLimits[i], &ErrMsg);
+    // posix_spawn only notices when the child fails to start.
+    if (MemoryLimits[i]) {
+      EXPECT_EQ(-1, Result);
+      EXPECT_EQ(0U, ErrMsg.find("Cannot open file"));
+    } else {
+      EXPECT_NE(0, Result);
+    }
+  }
+
+  TmpDir.eraseFromDisk(true);
+}
+
+// A program that can't be executed is reported to the caller along with the
+// reason, rather than as an exit code.
+TEST(ProgramTest, ExecFailure) {
+  std::string ErrMsg;
+  sys::Path TmpDir = sys::Path::GetTemporaryDirectory(&ErrMsg);
+  ASSERT_FALSE(TmpDir.isEmpty()) << ErrMsg;
+
+  // An executable file that is neither a binary nor a script.
+  sys::Path Bad(TmpDir);
+  Bad.appendComponent("bad");
+  {
+    std::string Error;
+    raw_fd_ostream OS(Bad.c_str(), Error);
+    ASSERT_EQ("", Error);
+    OS << '\0';
+  }
+  ASSERT_FALSE(Bad.makeExecutableOnDisk(&ErrMsg)) << ErrMsg;
+
+  for (unsigned i = 0; i != array_lengthof(MemoryLimits); ++i) {
+    const char *Args[] = { "bad", 0 };
+    ErrMsg.clear();
+    EXPECT_EQ(-1, sys::Program::ExecuteAndWait(Bad, Args, 0, 0, 0,
+                                               MemoryLimits[i], &ErrMsg));
+    EXPECT_NE("", ErrMsg);
+    if (MemoryLimits[i]) {
+      EXPECT_EQ("Couldn't execute program '" + Bad.str() + "': " +
+                sys::StrError(ENOEXEC), ErrMsg);
+    }
+  }
+
+  TmpDir.eraseFromDisk(true);
+}
+
+#endif
+
+}
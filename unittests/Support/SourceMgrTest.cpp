@@ -0,0 +1,66 @@
+//===- llvm/unittest/Support/SourceMgrTest.cpp - SourceMgr tests ----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/SourceMgr.h"
+#include <cstring>
+#include <string>
+
+using namespace llvm;
+
+namespace {
+
+static unsigned CountLines(const char *Start, const char *Ptr) {
+  unsigned LineNo = 1;
+  for (; Start != Ptr; ++Start)
+    if (*Start == '\n')
+      ++LineNo;
+  return LineNo;
+}
+
+TEST(SourceMgrTest, FindLineNumber) {
+  SourceMgr SM;
+  const char *Text = "a\nbc\n\n\ndef\n";
+  SM.AddNewSourceBuffer(MemoryBuffer::getMemBuffer(Text, "first"), SMLoc());
+  SM.AddNewSourceBuffer(MemoryBuffer::getMemBuffer("x\ny", "second"),
+                        SMLoc());
+
+  // Every position, including the newlines and the end of the buffer, in
+  // reverse order so that no query can rely on an earlier one.
+  for (int i = strlen(Text); i >= 0; --i)
+    EXPECT_EQ(CountLines(Text, Text + i),
+              SM.FindLineNumber(SMLoc::getFromPointer(Text + i)));
+
+  const char *Second = SM.getMemoryBuffer(1)->getBufferStart();
+  EXPECT_EQ(2U, SM.FindLineNumber(SMLoc::getFromPointer(Second + 2), 1));
+  EXPECT_EQ(1U, SM.FindLineNumber(SMLoc::getFromPointer(Second)));
+}
+
+// A generated assembly file with queries in random order, the pattern of
+// diagnostics and .loc handling.  "microbench sourcemgr" times the same
+// workload on a much larger file.
+TEST(SourceMgrTest, RandomQueries) {
+  std::string Asm;
+  for (unsigned i = 0; i != 4000; ++i)
+    Asm += (i % 7) ? "\tmovl\t%eax, 12(%esp)\n" : "\n";
+  SourceMgr SM;
+  SM.AddNewSourceBuffer(MemoryBuffer::getMemBuffer(Asm, "big.s"), SMLoc());
+
+  const char *Start = SM.getMemoryBuffer(0)->getBufferStart();
+  unsigned Seed = 1;
+  for (unsigned i = 0; i != 500; ++i) {
+    Seed = Seed * 1103515245 + 12345;
+    size_t Offset = (Seed >> 4) % Asm.size();
+    EXPECT_EQ(CountLines(Start, Start + Offset),
+              SM.FindLineNumber(SMLoc::getFromPointer(Start + Offset)));
+  }
+}
+
+}
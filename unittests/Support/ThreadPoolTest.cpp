@@ -0,0 +1,139 @@
+//===- llvm/unittest/Support/ThreadPoolTest.cpp - ThreadPool tests --------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+#include "llvm/Support/ThreadPool.h"
+
+using namespace llvm;
+
+namespace {
+
+static void Increment(void *Arg) {
+  sys::AtomicIncrement(static_cast<volatile sys::cas_flag*>(Arg));
+}
+
+TEST(ThreadPoolTest, AsyncAndWait) {
+  ThreadPool Pool(4);
+  volatile sys::cas_flag Count = 0;
+  for (unsigned i = 0; i != 10000; ++i)
+    Pool.async(Increment, const_cast<sys::cas_flag*>(&Count));
+  Pool.wait();
+  EXPECT_EQ(10000U, unsigned(Count));
+
+  // The pool can be reused after waiting.
+  for (unsigned i = 0; i != 100; ++i)
+    Pool.async(Increment, const_cast<sys::cas_flag*>(&Count));
+  Pool.wait();
+  EXPECT_EQ(10100U, unsigned(Count));
+}
+
+// The destructor finishes queued tasks before stopping the workers.
+TEST(ThreadPoolTest, DestroyWithPendingTasks) {
+  volatile sys::cas_flag Count = 0;
+  {
+    ThreadPool Pool(2);
+    for (unsigned i = 0; i != 1000; ++i)
+      Pool.async(Increment, const_cast<sys::cas_flag*>(&Count));
+  }
+  EXPECT_EQ(1000U, unsigned(Count));
+}
+
+// Recursive fork/join: every task spawns its subproblems in a nested group
+// and waits for them, which only works if waiting workers keep running tasks.
+struct FibTask {
+  ThreadPool *Pool;
+  unsigned N;
+  unsigned Result;
+};
+
+static void Fib(void *Arg) {
+  FibTask *T = static_cast<FibTask*>(Arg);
+  if (T->N < 2) {
+    T->Result = T->N;
+    return;
+  }
+  FibTask A = { T->Pool, T->N - 1, 0 };
+  FibTask B = { T->Pool, T->N - 2, 0 };
+  TaskGroup Group(*T->Pool);
+  Group.spawn(Fib, &A);
+  Group.spawn(Fib, &B);
+  Group.wait();
+  T->Result = A.Result + B.Result;
+}
+
+TEST(ThreadPoolTest, NestedGroups) {
+  ThreadPool Pool(4);
+  FibTask T = { &Pool, 20, 0 };
+  TaskGroup Group(Pool);
+  Group.spawn(Fib, &T);
+  Group.wait();
+  EXPECT_EQ(6765U, T.Result);
+}
+
+// Groups waited for independently only wait for their own tasks.
+TEST(ThreadPoolTest, IndependentGroups) {
+  ThreadPool Pool(3);
+  for (unsigned Round = 0; Round != 50; ++Round) {
+    volatile sys::cas_flag A = 0, B = 0;
+    TaskGroup GroupA(Pool), GroupB(Pool);
+    for (unsigned i = 0; i != 64; ++i) {
+      GroupA.spawn(Increment, const_cast<sys::cas_flag*>(&A));
+      GroupB.spawn(Increment, const_cast<sys::cas_flag*>(&B));
+    }
+    GroupA.wait();
+    EXPECT_EQ(64U, unsigned(A));
+    GroupB.wait();
+    EXPECT_EQ(64U, unsigned(B));
+  }
+}
+
+static unsigned SumTo(void *Arg) {
+  unsigned N = *static_cast<unsigned*>(Arg), Sum = 0;
+  for (unsigned i = 1; i <= N; ++i)
+    Sum += i;
+  return Sum;
+}
+
+TEST(ThreadPoolTest, Futures) {
+  ThreadPool Pool(2);
+  unsigned N1 = 100, N2 = 1000;
+  TaskFuture<unsigned> F1(Pool, SumTo, &N1), F2(Pool, SumTo, &N2);
+  EXPECT_EQ(500500U, F2.get());
+  EXPECT_EQ(5050U, F1.get());
+  EXPECT_TRUE(F1.isReady());
+}
+
+// Submitting to one pool from the workers of another exercises the shared
+// queue under contention.
+struct ForwardTask {
+  TaskGroup *Target;
+  volatile sys::cas_flag *Count;
+};
+
+static void Forward(void *Arg) {
+  ForwardTask *T = static_cast<ForwardTask*>(Arg);
+  for (unsigned i = 0; i != 100; ++i)
+    T->Target->spawn(Increment, const_cast<sys::cas_flag*>(T->Count));
+}
+
+TEST(ThreadPoolTest, SubmitFromOtherPool) {
+  ThreadPool Source(4), Target(4);
+  volatile sys::cas_flag Count = 0;
+  TaskGroup TargetGroup(Target);
+  ForwardTask T = { &TargetGroup, &Count };
+  {
+    TaskGroup SourceGroup(Source);
+    for (unsigned i = 0; i != 100; ++i)
+      SourceGroup.spawn(Forward, &T);
+  }
+  TargetGroup.wait();
+  EXPECT_EQ(10000U, unsigned(Count));
+}
+
+}
@@ -0,0 +1,61 @@
+//===- llvm/unittest/Support/TimerTest.cpp - Timer tests ------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/Threading.h"
+#include "llvm/Support/Timer.h"
+
+using namespace llvm;
+
+namespace {
+
+static void ReadPerfCounters(void *Counts) {
+  sys::Process::GetPerfCounters(static_cast<uint64_t*>(Counts));
+}
+
+// Hardware counters are optional: where perf events are unavailable the
+// counters must simply stay zero.
+TEST(TimerTest, PerfCounters) {
+  uint64_t Before[sys::Process::NumPerfCounters] = { 0, 0, 0, 0 };
+  uint64_t After[sys::Process::NumPerfCounters] = { 0, 0, 0, 0 };
+  if (!sys::Process::GetPerfCounters(Before)) {
+    EXPECT_FALSE(sys::Process::GetPerfCounters(After));
+    for (unsigned i = 0; i != sys::Process::NumPerfCounters; ++i)
+      EXPECT_EQ(0U, After[i]);
+    return;
+  }
+
+  volatile unsigned Sum = 0;
+  for (unsigned i = 0; i != 100000; ++i)
+    Sum += i;
+  ASSERT_TRUE(sys::Process::GetPerfCounters(After));
+  for (unsigned i = 0; i != sys::Process::NumPerfCounters; ++i)
+    EXPECT_LE(Before[i], After[i]);
+
+  // Another thread gets counters of its own, which haven't seen the loop.
+  uint64_t Other[sys::Process::NumPerfCounters] = { 0, 0, 0, 0 };
+  llvm_execute_on_thread(ReadPerfCounters, Other);
+  if (After[sys::Process::PerfInstructions]) {
+    EXPECT_LT(Other[sys::Process::PerfInstructions],
+              After[sys::Process::PerfInstructions]);
+  }
+}
+
+TEST(TimerTest, TimeRecordArithmetic) {
+  TimeRecord Start = TimeRecord::getCurrentTime(true);
+  TimeRecord Elapsed;
+  Elapsed -= Start;
+  Elapsed += TimeRecord::getCurrentTime(false);
+  EXPECT_LE(0.0, Elapsed.getWallTime());
+  for (unsigned i = 0; i != sys::Process::NumPerfCounters; ++i)
+    EXPECT_EQ(0U, Elapsed.getPerfCount(sys::Process::PerfCounter(i)));
+}
+
+}
@@ -10,13 +10,17 @@
 #include "llvm/Support/ValueHandle.h"
 
 #include "llvm/Constants.h"
+#include "llvm/DerivedTypes.h"
 #include "llvm/Instructions.h"
 #include "llvm/LLVMContext.h"
+#include "llvm/Module.h"
 #include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/ValueMap.h"
 
 #include "gtest/gtest.h"
 
 #include <memory>
+#include <vector>
 
 using namespace llvm;
 
@@ -408,4 +412,58 @@ TEST_F(ValueHandle, AssertingVHCheckedLast) {
   BitcastV.reset();
 }
 
+// Deleting a function whose values are all watched, the way the JIT's address
+// maps and ScalarEvolution's caches watch them, runs a handle callback for
+// every value.  "microbench valuehandle" times the same at a larger size.
+class CountingVH : public CallbackVH {
+  unsigned *Deleted;
+public:
+  CountingVH(Value *V, unsigned *Deleted) : CallbackVH(V), Deleted(Deleted) {}
+  virtual void deleted() {
+    ++*Deleted;
+    setValPtr(0);
+  }
+};
+
+TEST_F(ValueHandle, DeleteFunctionWithTrackedValues) {
+  LLVMContext Context;
+  Module M("handles", Context);
+  const Type *I32 = Type::getInt32Ty(Context);
+  std::vector<const Type*> Params(1, I32);
+  Function *F = cast<Function>(
+    M.getOrInsertFunction("f", FunctionType::get(I32, Params, false)));
+  BasicBlock *BB = BasicBlock::Create(Context, "entry", F);
+  const unsigned NumValues = 1000;
+  std::vector<Value*> Values;
+  Value *V = F->arg_begin();
+  for (unsigned i = 0; i != NumValues; ++i) {
+    V = BinaryOperator::CreateAdd(V, ConstantInt::get(I32, i), "", BB);
+    Values.push_back(V);
+  }
+  ReturnInst::Create(Context, V, BB);
+
+  ValueMap<Value*, unsigned> Map;
+  std::vector<WeakVH> Weak;
+  std::vector<CountingVH> Callbacks;
+  Weak.reserve(NumValues);
+  Callbacks.reserve(NumValues);
+  unsigned Deleted = 0;
+  for (unsigned i = 0; i != NumValues; ++i) {
+    Map[Values[i]] = i;
+    Weak.push_back(Values[i]);
+    Callbacks.push_back(CountingVH(Values[i], &Deleted));
+  }
+  EXPECT_EQ(NumValues, Map.size());
+
+  F->eraseFromParent();
+
+  EXPECT_EQ(0u, Map.size());
+  EXPECT_EQ(NumValues, Deleted);
+  unsigned Live = 0;
+  for (unsigned i = 0; i != NumValues; ++i)
+    if (Weak[i] != 0)
+      ++Live;
+  EXPECT_EQ(0u, Live);
+}
+
 }
@@ -9,7 +9,10 @@
 
 #include "llvm/Constants.h"
 #include "llvm/DerivedTypes.h"
+#include "llvm/GlobalVariable.h"
 #include "llvm/LLVMContext.h"
+#include "llvm/Module.h"
+#include "llvm/Support/ValueHandle.h"
 #include "gtest/gtest.h"
 
 namespace llvm {
@@ -118,5 +121,58 @@ TEST(ConstantsTest, FP128Test) {
   EXPECT_TRUE(isa<ConstantFP>(X));
 }
 
+TEST(ConstantsTest, UniquingTables) {
+  LLVMContext Context;
+  Module M("ConstantsTest", Context);
+  const IntegerType *Int64Ty = Type::getInt64Ty(Context);
+  const ArrayType *ArrTy = ArrayType::get(Int64Ty, 2);
+  GlobalVariable *GV = new GlobalVariable(M, Int64Ty, false,
+                                          GlobalValue::ExternalLinkage, 0, "g");
+  Constant *GVAddr = ConstantExpr::getPtrToInt(GV, Int64Ty);
+
+  // Fill the array and expression tables, then look everything up again.
+  const unsigned NumConstants = 4096;
+  std::vector<Constant*> Arrays, Exprs;
+  for (unsigned i = 0; i != NumConstants; ++i) {
+    Constant *Elts[] = { ConstantInt::get(Int64Ty, i),
+                         ConstantInt::get(Int64Ty, i + 1) };
+    Arrays.push_back(ConstantArray::get(ArrTy, Elts, 2));
+    Exprs.push_back(ConstantExpr::getAdd(GVAddr, Elts[0]));
+  }
+  for (unsigned i = 0; i != NumConstants; ++i) {
+    Constant *Elts[] = { ConstantInt::get(Int64Ty, i),
+                         ConstantInt::get(Int64Ty, i + 1) };
+    EXPECT_EQ(Arrays[i], ConstantArray::get(ArrTy, Elts, 2));
+    EXPECT_EQ(Exprs[i], ConstantExpr::getAdd(GVAddr, Elts[0]));
+  }
+  EXPECT_NE(Arrays[0], Arrays[1]);
+  EXPECT_NE(Exprs[0], Exprs[1]);
+
+  // Mutating an operand in place moves the array to its new slot.
+  GlobalVariable *GV2 = new GlobalVariable(M, Int64Ty, false,
+                                           GlobalValue::ExternalLinkage, 0,
+                                           "g2");
+  Constant *Elts[] = { GVAddr, GVAddr };
+  Constant *GVArr = ConstantArray::get(ArrTy, Elts, 2);
+  Constant *GV2Addr = ConstantExpr::getPtrToInt(GV2, Int64Ty);
+  GV->replaceAllUsesWith(GV2);
+  Constant *NewElts[] = { GV2Addr, GV2Addr };
+  EXPECT_EQ(GVArr, ConstantArray::get(ArrTy, NewElts, 2));
+
+  // Constants of an abstract type are rehashed when the type is refined, and
+  // merged with an existing constant of the refined type if there is one.
+  const PointerType *Int64PtrTy = PointerType::getUnqual(Int64Ty);
+  Constant *ConcreteNull = ConstantPointerNull::get(Int64PtrTy);
+  OpaqueType *O1 = OpaqueType::get(Context);
+  OpaqueType *O2 = OpaqueType::get(Context);
+  PATypeHolder H1(O1), H2(O2);
+  WeakVH Null1 = ConstantPointerNull::get(PointerType::getUnqual(O1));
+  Constant *Null2 = ConstantPointerNull::get(PointerType::getUnqual(O2));
+  O2->refineAbstractTypeTo(Type::getInt8Ty(Context));
+  EXPECT_EQ(Null2, ConstantPointerNull::get(Type::getInt8PtrTy(Context)));
+  O1->refineAbstractTypeTo(Int64Ty);
+  EXPECT_EQ(ConcreteNull, Null1);
+}
+
 }  // end anonymous namespace
 }  // end namespace llvm
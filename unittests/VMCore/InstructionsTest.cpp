@@ -9,6 +9,7 @@
 
 #include "llvm/Instructions.h"
 #include "llvm/BasicBlock.h"
+#include "llvm/Constants.h"
 #include "llvm/DerivedTypes.h"
 #include "llvm/LLVMContext.h"
 #include "llvm/ADT/STLExtras.h"
@@ -107,5 +108,41 @@ TEST(InstructionsTest, BranchInst) {
   delete bb1;
 }
 
+TEST(InstructionsTest, ComesBefore) {
+  LLVMContext &C(getGlobalContext());
+  const IntegerType *Int32 = IntegerType::get(C, 32);
+  Constant *Zero = ConstantInt::get(Int32, 0);
+
+  BasicBlock *BB = BasicBlock::Create(C);
+  Instruction *I0 = BinaryOperator::CreateAdd(Zero, Zero, "", BB);
+  Instruction *I1 = BinaryOperator::CreateAdd(Zero, Zero, "", BB);
+  Instruction *Ret = ReturnInst::Create(C, BB);
+
+  EXPECT_TRUE(I0->comesBefore(I1));
+  EXPECT_TRUE(I1->comesBefore(Ret));
+  EXPECT_FALSE(Ret->comesBefore(I0));
+  EXPECT_FALSE(I0->comesBefore(I0));
+  EXPECT_TRUE(BB->isInstrOrderValid());
+
+  // Inserting a new instruction invalidates the numbering.
+  Instruction *I2 = BinaryOperator::CreateAdd(Zero, Zero, "", I0);
+  EXPECT_FALSE(BB->isInstrOrderValid());
+  EXPECT_TRUE(I2->comesBefore(I0));
+  EXPECT_TRUE(I2->comesBefore(Ret));
+
+  // Moving an instruction within the block is reflected too.
+  I2->moveBefore(Ret);
+  EXPECT_FALSE(BB->isInstrOrderValid());
+  EXPECT_TRUE(I1->comesBefore(I2));
+  EXPECT_TRUE(I2->comesBefore(Ret));
+
+  // Removing an instruction keeps the remaining numbering valid.
+  I1->eraseFromParent();
+  EXPECT_TRUE(BB->isInstrOrderValid());
+  EXPECT_TRUE(I0->comesBefore(I2));
+
+  delete BB;
+}
+
 }  // end anonymous namespace
 }  // end namespace llvm
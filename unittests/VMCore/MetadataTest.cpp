@@ -120,6 +120,64 @@ TEST_F(MDNodeTest, Delete) {
   delete I;
 }
 
+TEST_F(MetadataTest, InstructionAttachments) {
+  Constant *C = ConstantInt::get(Type::getInt32Ty(Context), 1);
+  Instruction *I = new BitCastInst(C, Type::getInt32Ty(Context));
+  unsigned Custom1 = Context.getMDKindID("custom1");
+  unsigned Custom2 = Context.getMDKindID("custom2");
+
+  Value *const V = C;
+  MDNode *n1 = MDNode::get(Context, &V, 1);
+  Value *const S = MDString::get(Context, "x");
+  MDNode *n2 = MDNode::get(Context, &S, 1);
+
+  EXPECT_FALSE(I->hasMetadata());
+  I->setMetadata(Custom2, n2);
+  I->setMetadata(Custom1, n1);
+  I->setMetadata(LLVMContext::MD_tbaa, n2);
+  EXPECT_TRUE(I->hasMetadataOtherThanDebugLoc());
+  EXPECT_EQ(n1, I->getMetadata(Custom1));
+  EXPECT_EQ(n2, I->getMetadata("custom2"));
+  EXPECT_EQ(n2, I->getMetadata(LLVMContext::MD_tbaa));
+  EXPECT_EQ(0, I->getMetadata("custom3"));
+
+  // Attachments are reported sorted by kind, whatever order they were added.
+  I->setMetadata(LLVMContext::MD_tbaa, n1);
+  SmallVector<std::pair<unsigned, MDNode*>, 4> MDs;
+  I->getAllMetadata(MDs);
+  ASSERT_EQ(3u, MDs.size());
+  EXPECT_EQ((unsigned)LLVMContext::MD_tbaa, MDs[0].first);
+  EXPECT_EQ(n1, MDs[0].second);
+  EXPECT_EQ(Custom1, MDs[1].first);
+  EXPECT_EQ(Custom2, MDs[2].first);
+
+  // Attachments follow the nodes they refer to.
+  MDNode *Temp = MDNode::getTemporary(Context, &V, 1);
+  I->setMetadata(Custom1, Temp);
+  Temp->replaceAllUsesWith(n2);
+  MDNode::deleteTemporary(Temp);
+  EXPECT_EQ(n2, I->getMetadata(Custom1));
+
+  I->setMetadata(Custom1, 0);
+  I->setMetadata(Custom1, 0);
+  I->setMetadata(LLVMContext::MD_tbaa, 0);
+  EXPECT_EQ(0, I->getMetadata(Custom1));
+  EXPECT_EQ(n2, I->getMetadata(Custom2));
+  I->setMetadata(Custom2, 0);
+  EXPECT_FALSE(I->hasMetadata());
+
+  // An instruction that takes over a released slot starts out empty.
+  Instruction *I2 = new BitCastInst(C, Type::getInt32Ty(Context));
+  I2->setMetadata(Custom2, n1);
+  I2->getAllMetadata(MDs);
+  ASSERT_EQ(1u, MDs.size());
+  EXPECT_EQ(n1, MDs[0].second);
+  EXPECT_FALSE(I->hasMetadata());
+
+  delete I2;
+  delete I;
+}
+
 TEST(NamedMDNodeTest, Search) {
   LLVMContext Context;
   Constant *C = ConstantInt::get(Type::getInt32Ty(Context), 1);
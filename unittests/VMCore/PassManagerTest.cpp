@@ -40,6 +40,7 @@ namespace llvm {
   void initializeCGPassPass(PassRegistry&);
   void initializeLPassPass(PassRegistry&);
   void initializeBPassPass(PassRegistry&);
+  void initializeCountedAnalysisPass(PassRegistry&);
   
   namespace {
     // ND = no deps
@@ -356,6 +357,132 @@ namespace llvm {
       delete M;
     }
 
+    // A function analysis that counts how often it is computed.  It requires
+    // LoopInfo, so what it is computed from has to be cached as well.
+    struct CountedAnalysis : public FunctionPass {
+      static char ID;
+      static int runs;
+      static int deleted;
+      CountedAnalysis() : FunctionPass(ID) {
+        initializeCountedAnalysisPass(*PassRegistry::getPassRegistry());
+      }
+      ~CountedAnalysis() { deleted++; }
+      virtual bool runOnFunction(Function &F) {
+        LoopInfo &LI = getAnalysis<LoopInfo>();
+        EXPECT_EQ(2, std::distance(LI.begin(), LI.end()));
+        runs++;
+        return false;
+      }
+      virtual void getAnalysisUsage(AnalysisUsage &AU) const {
+        AU.setPreservesAll();
+        AU.addRequired<LoopInfo>();
+      }
+    };
+    char CountedAnalysis::ID=0;
+    int CountedAnalysis::runs=0;
+    int CountedAnalysis::deleted=0;
+
+    // Uses CountedAnalysis, and says it changed the function if Modify is set.
+    struct CountedAnalysisUser : public FunctionPass {
+      static char ID;
+      bool Modify, PreservesAll;
+      CountedAnalysisUser(bool modify, bool preservesAll)
+        : FunctionPass(ID), Modify(modify), PreservesAll(preservesAll) {
+        initializeCountedAnalysisPass(*PassRegistry::getPassRegistry());
+      }
+      virtual bool runOnFunction(Function &F) {
+        getAnalysis<CountedAnalysis>();
+        return Modify;
+      }
+      virtual void getAnalysisUsage(AnalysisUsage &AU) const {
+        if (PreservesAll)
+          AU.setPreservesAll();
+        AU.addRequired<CountedAnalysis>();
+      }
+    };
+    char CountedAnalysisUser::ID=0;
+
+    // Cache CountedAnalysis and what it is computed from.
+    void cacheCountedAnalysis(FunctionPassManager &FPM) {
+      FPM.cacheAnalysis(DominatorTree::ID);
+      FPM.cacheAnalysis(LoopInfo::ID);
+      FPM.cacheAnalysis(CountedAnalysis::ID);
+    }
+
+    int CachedAnalysisRuns(bool Cache, bool Modify, bool PreservesAll) {
+      OwningPtr<Module> M(makeLLVMModule());
+      CountedAnalysis::runs = 0;
+      FunctionPassManager FPM(M.get());
+      if (Cache)
+        cacheCountedAnalysis(FPM);
+      FPM.add(new CountedAnalysisUser(Modify, PreservesAll));
+      FPM.doInitialization();
+      Function *F = M->getFunction("test4");
+      for (int i = 0; i < 3; ++i)
+        FPM.run(*F);
+      FPM.doFinalization();
+      return CountedAnalysis::runs;
+    }
+
+    TEST(PassManager, CachedAnalyses) {
+      EXPECT_EQ(3, CachedAnalysisRuns(false, false, false));
+      EXPECT_EQ(1, CachedAnalysisRuns(true, false, false));
+      // A pass that changes the function invalidates what it doesn't
+      // preserve, LoopInfo and DominatorTree included.
+      EXPECT_EQ(3, CachedAnalysisRuns(true, true, false));
+      EXPECT_EQ(1, CachedAnalysisRuns(true, true, true));
+    }
+
+    TEST(PassManager, CachedAnalysesOnlyNamed) {
+      OwningPtr<Module> M(makeLLVMModule());
+      CountedAnalysis::runs = 0;
+      FunctionPassManager FPM(M.get());
+      // LoopInfo is kept, but CountedAnalysis itself isn't named.
+      FPM.cacheAnalysis(DominatorTree::ID);
+      FPM.cacheAnalysis(LoopInfo::ID);
+      FPM.add(new CountedAnalysisUser(false, false));
+      FPM.doInitialization();
+      Function *F = M->getFunction("test4");
+      for (int i = 0; i < 3; ++i)
+        FPM.run(*F);
+      FPM.doFinalization();
+      EXPECT_EQ(3, CountedAnalysis::runs);
+    }
+
+    TEST(PassManager, CachedAnalysesInvalidation) {
+      OwningPtr<Module> M(makeLLVMModule());
+      Function *F = M->getFunction("test4");
+      CountedAnalysis::runs = 0;
+      CountedAnalysis::deleted = 0;
+      FunctionPassManager FPM(M.get());
+      cacheCountedAnalysis(FPM);
+      FPM.add(new CountedAnalysisUser(false, false));
+      FPM.doInitialization();
+
+      FPM.run(*F);
+      FPM.run(*F);
+      EXPECT_EQ(1, CountedAnalysis::runs);
+
+      // Changing the function outside of a pass makes the result stale.
+      unsigned Count = F->getModificationCount();
+      Instruction *I = new AllocaInst(Type::getInt32Ty(getGlobalContext()), "",
+                                      F->getEntryBlock().getTerminator());
+      I->eraseFromParent();
+      EXPECT_NE(Count, F->getModificationCount());
+      FPM.run(*F);
+      EXPECT_EQ(2, CountedAnalysis::runs);
+
+      FPM.releaseCachedAnalyses(*F);
+      EXPECT_EQ(1, CountedAnalysis::deleted);
+      FPM.run(*F);
+      EXPECT_EQ(3, CountedAnalysis::runs);
+
+      // Deleting the function frees what was cached for it.
+      F->eraseFromParent();
+      EXPECT_EQ(2, CountedAnalysis::deleted);
+      FPM.doFinalization();
+    }
+
     TEST(PassManager, Memory) {
       // SCC#1: test1->test2->test3->test1
       // SCC#2: test4
@@ -546,3 +673,6 @@ INITIALIZE_PASS_BEGIN(LPass, "lp","lp", false, false)
 INITIALIZE_PASS_DEPENDENCY(LoopInfo)
 INITIALIZE_PASS_END(LPass, "lp","lp", false, false)
 INITIALIZE_PASS(BPass, "bp","bp", false, false)
+INITIALIZE_PASS_BEGIN(CountedAnalysis, "counted", "counted", false, true)
+INITIALIZE_PASS_DEPENDENCY(LoopInfo)
+INITIALIZE_PASS_END(CountedAnalysis, "counted", "counted", false, true)
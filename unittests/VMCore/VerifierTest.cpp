@@ -17,6 +17,7 @@
 #include "llvm/Module.h"
 #include "llvm/ADT/OwningPtr.h"
 #include "llvm/Analysis/Verifier.h"
+#include "llvm/Support/Threading.h"
 #include "gtest/gtest.h"
 
 namespace llvm {
@@ -60,5 +61,41 @@ TEST(VerifierTest, AliasUnnamedAddr) {
   EXPECT_TRUE(verifyModule(M, ReturnStatusAction, &Error));
   EXPECT_TRUE(StringRef(Error).startswith("Alias cannot have unnamed_addr"));
 }
+
+TEST(VerifierTest, Concurrent) {
+  LLVMContext &C = getGlobalContext();
+  Module M("M", C);
+  const Type *I32 = Type::getInt32Ty(C);
+  std::vector<const Type*> Params(1, I32);
+  FunctionType *FTy = FunctionType::get(I32, Params, /*isVarArg=*/false);
+  std::vector<BranchInst*> Branches;
+  for (unsigned i = 0; i != 16; ++i) {
+    Function *F = Function::Create(FTy, GlobalValue::ExternalLinkage,
+                                   "f" + Twine(i), &M);
+    BasicBlock *Entry = BasicBlock::Create(C, "entry", F);
+    BasicBlock *Then = BasicBlock::Create(C, "then", F);
+    BasicBlock *Else = BasicBlock::Create(C, "else", F);
+    Value *Cond = new ICmpInst(*Entry, ICmpInst::ICMP_EQ, F->arg_begin(),
+                               ConstantInt::get(I32, i));
+    Branches.push_back(BranchInst::Create(Then, Else, Cond, Entry));
+    ReturnInst::Create(C, ConstantInt::get(I32, 1), Then);
+    ReturnInst::Create(C, F->arg_begin(), Else);
+  }
+  // verifyModule only uses threads if the program is multithreaded.
+  bool Threaded = llvm_start_multithreaded();
+  EXPECT_FALSE(verifyModule(M, ReturnStatusAction, 0, 1));
+  EXPECT_FALSE(verifyModule(M, ReturnStatusAction, 0, 4));
+
+  // A broken module is reported the same way on any number of threads.
+  Branches[3]->setOperand(0, ConstantInt::get(I32, 0));
+  Branches[11]->setOperand(0, ConstantInt::get(I32, 0));
+  std::string Serial, Concurrent;
+  EXPECT_TRUE(verifyModule(M, ReturnStatusAction, &Serial, 1));
+  EXPECT_TRUE(verifyModule(M, ReturnStatusAction, &Concurrent, 4));
+  EXPECT_TRUE(StringRef(Serial).startswith("Branch condition"));
+  EXPECT_EQ(Serial, Concurrent);
+  if (Threaded)
+    llvm_stop_multithreaded();
+}
 }
 }
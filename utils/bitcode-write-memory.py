@@ -0,0 +1,63 @@
+#!/usr/bin/env python
+
+"""
+Measure the peak memory use and speed of writing bitcode straight to a file,
+compared with building the whole file in memory first.
+
+Runs llvm-link on an existing bitcode file, which reads it and writes it back
+out, with and without -disable-bitcode-streaming, and reports the peak
+resident set size and the rate at which the output was produced.  Both runs
+hold the module itself in memory, so the difference in peak memory is the
+memory saved by not buffering the output.
+
+Example:
+  utils/bitcode-write-memory.py Release/bin/llvm-link big.bc
+"""
+
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+from optparse import OptionParser
+
+def run(args):
+    """Run args, returning the wall time taken and the peak resident set size
+    of the process in kilobytes."""
+    start = time.time()
+    proc = subprocess.Popen(args)
+    pid, status, usage = os.wait4(proc.pid, 0)
+    elapsed = time.time() - start
+    if status != 0:
+        print >>sys.stderr, "error: '%s' failed" % ' '.join(args)
+        sys.exit(1)
+    return elapsed, usage.ru_maxrss
+
+def main():
+    parser = OptionParser("usage: %prog [options] llvm-link input.bc")
+    parser.add_option("-n", dest="count", type="int", default=3,
+                      help="number of runs of each configuration [%default]")
+    opts, args = parser.parse_args()
+    if len(args) != 2:
+        parser.error("expected the path of llvm-link and a bitcode file")
+    llvm_link, input = args
+
+    tmpdir = tempfile.mkdtemp()
+    try:
+        output = os.path.join(tmpdir, "output.bc")
+        configs = [("buffered", ["-disable-bitcode-streaming"]),
+                   ("streamed", [])]
+        for name, flags in configs:
+            cmd = [llvm_link, input, "-o", output] + flags
+            results = [run(cmd) for i in range(opts.count)]
+            best = min([t for t, rss in results])
+            rss = max([rss for t, rss in results])
+            size = os.path.getsize(output) / (1024.0 * 1024.0)
+            print "%-8s  %7.1f MB written  peak RSS %8.1f MB  %7.1f MB/s" % (
+                name, size, rss / 1024.0, size / best)
+    finally:
+        shutil.rmtree(tmpdir)
+
+if __name__ == '__main__':
+    main()
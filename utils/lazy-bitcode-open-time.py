@@ -0,0 +1,188 @@
+#!/usr/bin/env python
+
+"""
+Measure the cost of opening a large bitcode module lazily.
+
+Generates a number of modules with many functions each and links them into one
+large module, written both with and without the index of function bodies.
+Then times llvm-extract pulling a single function out of each, which opens the
+module lazily and materializes only that function, and reports the peak
+resident set size of each run.  With -g every function also gets debug
+information, and the indexed module is opened with its metadata read both up
+front and on demand.
+
+Example:
+  utils/lazy-bitcode-open-time.py Release/bin/llvm-extract -m 64 -f 1000 -g
+"""
+
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+from optparse import OptionParser
+
+FUNCTION = """\
+define i32 @m%(m)d_f%(n)d(i32* %%p, i32 %%n) nounwind {
+entry:
+  br label %%cond
+
+cond:
+  %%iv = phi i32 [ 0, %%entry ], [ %%next, %%latch ]
+  %%sum = phi i32 [ 0, %%entry ], [ %%sum2, %%latch ]
+  %%done = icmp sge i32 %%iv, %%n
+  br i1 %%done, label %%exit, label %%body
+
+body:
+  %%addr = getelementptr i32* %%p, i32 %%iv
+  %%v = load i32* %%addr
+  %%big = icmp sgt i32 %%v, %(n)d
+  br i1 %%big, label %%then, label %%latch
+
+then:
+  %%a = mul i32 %%v, %(m)d
+  %%b = call i32 @m%(m)d_helper(i32 %%a)
+  br label %%latch
+
+latch:
+  %%x = phi i32 [ %%v, %%body ], [ %%b, %%then ]
+  %%sum2 = add i32 %%sum, %%x
+  %%next = add i32 %%iv, 1
+  br label %%cond
+
+exit:
+  ret i32 %%sum
+}
+
+"""
+
+HELPER = """\
+define internal i32 @m%(m)d_helper(i32 %%x) nounwind readnone {
+entry:
+  %%y = xor i32 %%x, %(m)d
+  ret i32 %%y
+}
+
+"""
+
+DEBUG_HEADER = """\
+declare void @llvm.dbg.value(metadata, i64, metadata) nounwind readnone
+
+!0 = metadata !{i32 524305, i32 0, i32 12, metadata !"input%(m)d.c", \
+metadata !"/tmp", metadata !"clang", i1 true, i1 false, metadata !"", i32 0}
+!1 = metadata !{i32 524329, metadata !"input%(m)d.c", metadata !"/tmp", \
+metadata !0}
+!2 = metadata !{i32 524324, metadata !1, metadata !"int", metadata !1, \
+i32 0, i64 32, i64 32, i64 0, i32 0, i32 5}
+"""
+
+DEBUG_FUNCTION = """\
+!%(sp)d = metadata !{i32 524334, i32 0, metadata !1, metadata !"m%(m)d_f%(n)d", \
+metadata !"m%(m)d_f%(n)d", metadata !"_Z%(m)d_f%(n)d", metadata !1, \
+i32 %(n)d, metadata !2, i1 false, i1 true}
+!%(p)d = metadata !{i32 524545, metadata !%(sp)d, metadata !"p%(n)d", \
+metadata !1, i32 %(n)d, metadata !2}
+!%(v)d = metadata !{i32 524544, metadata !%(sp)d, metadata !"v%(n)d", \
+metadata !1, i32 %(n)d, metadata !2}
+"""
+
+def generate(path, module, count, debug):
+    out = open(path, 'w')
+    out.write(HELPER % {'m': module})
+    for n in range(count):
+        function = FUNCTION % {'m': module, 'n': n}
+        if debug:
+            # Give every instruction a location in the function's subprogram,
+            # and describe one argument and one value.
+            sp = 3 + 3 * n
+            lines = []
+            for line in function.split('\n'):
+                if line.startswith('  '):
+                    line += ', !dbg !{i32 %d, i32 %d, metadata !%d, null}' % (
+                        n, len(lines), sp)
+                lines.append(line)
+                if line.startswith('entry:'):
+                    lines.append('  call void @llvm.dbg.value(metadata '
+                                 '!{i32* %%p}, i64 0, metadata !%d)' % (sp + 1))
+                elif line.startswith('  %v = load'):
+                    lines.append('  call void @llvm.dbg.value(metadata '
+                                 '!{i32 %%v}, i64 0, metadata !%d)' % (sp + 2))
+            function = '\n'.join(lines)
+        out.write(function)
+    if debug:
+        out.write(DEBUG_HEADER % {'m': module})
+        for n in range(count):
+            sp = 3 + 3 * n
+            out.write(DEBUG_FUNCTION % {'m': module, 'n': n, 'sp': sp,
+                                        'p': sp + 1, 'v': sp + 2})
+    out.close()
+
+def check(args):
+    if subprocess.call(args) != 0:
+        print >>sys.stderr, "error: '%s' failed" % ' '.join(args)
+        sys.exit(1)
+
+def run(args):
+    """Run args, returning the wall time and the peak RSS in kilobytes."""
+    start = time.time()
+    process = subprocess.Popen(args)
+    pid, status, usage = os.wait4(process.pid, 0)
+    elapsed = time.time() - start
+    if status != 0:
+        print >>sys.stderr, "error: '%s' failed" % ' '.join(args)
+        sys.exit(1)
+    return elapsed, usage.ru_maxrss
+
+def main():
+    parser = OptionParser("usage: %prog [options] llvm-extract")
+    parser.add_option("-m", dest="modules", type="int", default=64,
+                      help="number of modules to link [%default]")
+    parser.add_option("-f", dest="functions", type="int", default=1000,
+                      help="number of functions in each module [%default]")
+    parser.add_option("-n", dest="count", type="int", default=5,
+                      help="number of runs of each configuration [%default]")
+    parser.add_option("-g", dest="debug", action="store_true", default=False,
+                      help="give every function debug information")
+    opts, args = parser.parse_args()
+    if len(args) != 1:
+        parser.error("expected the path of llvm-extract")
+    llvm_extract = args[0]
+    bindir = os.path.dirname(llvm_extract)
+    llvm_as = os.path.join(bindir, "llvm-as")
+    llvm_link = os.path.join(bindir, "llvm-link")
+
+    tmpdir = tempfile.mkdtemp()
+    try:
+        inputs = []
+        for m in range(opts.modules):
+            source = os.path.join(tmpdir, "input%d.ll" % m)
+            generate(source, m, opts.functions, opts.debug)
+            input = os.path.join(tmpdir, "input%d.bc" % m)
+            check([llvm_as, source, "-o", input])
+            inputs.append(input)
+        indexed = os.path.join(tmpdir, "indexed.bc")
+        scanned = os.path.join(tmpdir, "scanned.bc")
+        check([llvm_link] + inputs + ["-o", indexed])
+        check([llvm_link, indexed, "-o", scanned,
+               "-disable-bitcode-function-index"])
+        print "linked module: %d functions, %d bytes of bitcode" % (
+            opts.modules * (opts.functions + 1), os.path.getsize(indexed))
+
+        output = os.path.join(tmpdir, "output.bc")
+        function = "m%d_f%d" % (opts.modules - 1, opts.functions - 1)
+        configs = [("scanned", scanned, []), ("indexed", indexed, [])]
+        if opts.debug:
+            configs = [("scanned", scanned, ["-disable-lazy-bitcode-metadata"]),
+                       ("indexed", indexed, ["-disable-lazy-bitcode-metadata"]),
+                       ("lazy metadata", indexed, [])]
+        for name, input, flags in configs:
+            args = [llvm_extract, input, "-func=" + function, "-o", output]
+            runs = sorted([run(args + flags) for i in range(opts.count)])
+            print "%-13s  min %7.3fs  max rss %7d KB" % (
+                name, runs[0][0], max([r[1] for r in runs]))
+    finally:
+        shutil.rmtree(tmpdir)
+
+if __name__ == '__main__':
+    main()
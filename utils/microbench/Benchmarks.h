@@ -0,0 +1,50 @@
+//===- Benchmarks.h - Benchmarks run by microbench --------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Each benchmark times its workloads with a TimerGroup, which prints its
+// report when the benchmark returns, and prints anything else it measures
+// (sizes, counts) to outs().
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef MICROBENCH_BENCHMARKS_H
+#define MICROBENCH_BENCHMARKS_H
+
+namespace microbench {
+
+/// BitVector fused bulk operations vs. expressions with temporaries.
+void runBitVector();
+
+/// ConstantInt, ConstantExpr and ConstantArray creation and lookup.
+void runConstants();
+
+/// FlatHashMap vs. DenseMap on pointer keys: time and memory.
+void runFlatHashMap();
+
+/// Program::ExecuteAndWait latency, posix_spawn vs. fork/vfork.
+void runProgram();
+
+/// SourceMgr line lookups and diagnostics in a 400k line buffer.
+void runSourceMgr();
+
+/// SparseBitVector vs. BitVector on a liveness problem.
+void runSparseBitVector();
+
+/// Type-based alias analysis queries on accesses with several attachments.
+void runTBAA();
+
+/// ThreadPool fork/join on 1, 2, 4 and 8 threads.
+void runThreadPool();
+
+/// ValueHandle creation, and deletion of a function whose values are watched.
+void runValueHandle();
+
+} // end namespace microbench
+
+#endif
@@ -0,0 +1,93 @@
+//===- BitVectorBench.cpp - BitVector fused bulk operations ---------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Liveness-style updates over register-count-sized vectors, written once
+// with the fused operations (unionWith, unionWithDifference, anyCommon) and
+// once with the expressions callers had to use before: temporaries for
+// "A & ~B" and "(A & B).any()", and a copy to find out whether a union
+// changed anything.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Benchmarks.h"
+#include "llvm/ADT/BitVector.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+#include <vector>
+using namespace llvm;
+
+static const unsigned NumBits = 1000, NumSets = 64, Rounds = 20000;
+
+/// runFused - Run the updates with the fused operations.  Returns the sum of
+/// the final live counts plus the number of updates that changed something.
+static unsigned runFused(const std::vector<BitVector> &Sets) {
+  unsigned Result = 0;
+  for (unsigned R = 0; R != Rounds; ++R) {
+    BitVector Live(Sets[R % NumSets]);
+    for (unsigned S = 0; S != 8; ++S) {
+      const BitVector &Out = Sets[(R + S) % NumSets];
+      const BitVector &Def = Sets[(R * 7 + S) % NumSets];
+      const BitVector &Use = Sets[(R * 3 + S) % NumSets];
+      Result += Live.unionWithDifference(Out, Def);
+      if (Live.anyCommon(Use))
+        Live.reset(Use);
+      Result += Live.unionWith(Def);
+    }
+    Result += Live.count();
+  }
+  return Result;
+}
+
+/// runExpressions - Run the same updates with temporaries.
+static unsigned runExpressions(const std::vector<BitVector> &Sets) {
+  unsigned Result = 0;
+  for (unsigned R = 0; R != Rounds; ++R) {
+    BitVector Live(Sets[R % NumSets]);
+    for (unsigned S = 0; S != 8; ++S) {
+      const BitVector &Out = Sets[(R + S) % NumSets];
+      const BitVector &Def = Sets[(R * 7 + S) % NumSets];
+      const BitVector &Use = Sets[(R * 3 + S) % NumSets];
+      BitVector Old(Live);
+      Live |= Out & ~Def;
+      Result += Live != Old;
+      if ((Live & Use).any())
+        Live &= ~Use;
+      Old = Live;
+      Live |= Def;
+      Result += Live != Old;
+    }
+    Result += Live.count();
+  }
+  return Result;
+}
+
+void microbench::runBitVector() {
+  std::vector<BitVector> Sets(NumSets, BitVector(NumBits));
+  unsigned Seed = 1;
+  for (unsigned S = 0; S != NumSets; ++S)
+    for (unsigned i = 0; i != NumBits / 8; ++i) {
+      Seed = Seed * 1103515245 + 12345;
+      Sets[S].set((Seed >> 8) % NumBits);
+    }
+
+  TimerGroup Group("BitVector bulk operations");
+  Timer FusedTimer("Fused operations", Group);
+  Timer ExprTimer("Expressions with temporaries", Group);
+
+  FusedTimer.startTimer();
+  unsigned Fused = runFused(Sets);
+  FusedTimer.stopTimer();
+
+  ExprTimer.startTimer();
+  unsigned Expr = runExpressions(Sets);
+  ExprTimer.stopTimer();
+
+  if (Fused != Expr)
+    errs() << "error: the fused operations and the expressions disagree\n";
+}
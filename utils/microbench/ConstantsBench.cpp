@@ -0,0 +1,114 @@
+//===- ConstantsBench.cpp - Constant uniquing throughput ------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Creation throughput of uniqued constants.  Each kind of constant is first
+// created, which inserts into the context's uniquing table, and then asked
+// for again, which only looks it up.  Integers, expressions and arrays each
+// go through a different table, so each is reported separately.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Benchmarks.h"
+#include "llvm/Constants.h"
+#include "llvm/DerivedTypes.h"
+#include "llvm/GlobalVariable.h"
+#include "llvm/LLVMContext.h"
+#include "llvm/Module.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+#include <string>
+#include <vector>
+using namespace llvm;
+
+static const unsigned NumConstants = 200000;
+
+namespace {
+/// IntMaker - The i'th integer constant.
+struct IntMaker {
+  const IntegerType *Ty;
+  Constant *operator()(unsigned i) const { return ConstantInt::get(Ty, i); }
+};
+
+/// ExprMaker - A global's address plus the i'th integer.
+struct ExprMaker {
+  const IntegerType *Ty;
+  Constant *Addr;
+  Constant *operator()(unsigned i) const {
+    return ConstantExpr::getAdd(Addr, ConstantInt::get(Ty, i));
+  }
+};
+
+/// ArrayMaker - The array { i, i+1 }.
+struct ArrayMaker {
+  const IntegerType *Ty;
+  const ArrayType *ArrTy;
+  Constant *operator()(unsigned i) const {
+    Constant *Elts[] = { ConstantInt::get(Ty, i), ConstantInt::get(Ty, i + 1) };
+    return ConstantArray::get(ArrTy, Elts, 2);
+  }
+};
+}
+
+/// reportRate - Print how many constants per second were got since Start.
+static void reportRate(const std::string &Name, const TimeRecord &Start) {
+  TimeRecord Elapsed = TimeRecord::getCurrentTime(false);
+  Elapsed -= Start;
+  double Seconds = Elapsed.getWallTime();
+  outs() << format("%-28s %12.0f ops/s\n", Name.c_str(),
+                   Seconds > 0 ? NumConstants / Seconds : 0.0);
+}
+
+/// timeKind - Create NumConstants constants with Make, then get them all
+/// again, charging the two passes to T[0] and T[1].
+template<typename MakerT>
+static void timeKind(const char *Kind, const MakerT &Make, TimerGroup &Group,
+                     Timer *T) {
+  std::vector<Constant*> Created(NumConstants);
+  std::string Names[2] = { std::string(Kind) + " create",
+                           std::string(Kind) + " lookup" };
+  T[0].init(Names[0], Group);
+  T[1].init(Names[1], Group);
+
+  T[0].startTimer();
+  TimeRecord Start = TimeRecord::getCurrentTime(true);
+  for (unsigned i = 0; i != NumConstants; ++i)
+    Created[i] = Make(i);
+  reportRate(Names[0], Start);
+  T[0].stopTimer();
+
+  unsigned Mismatches = 0;
+  T[1].startTimer();
+  Start = TimeRecord::getCurrentTime(true);
+  for (unsigned i = 0; i != NumConstants; ++i)
+    Mismatches += Make(i) != Created[i];
+  reportRate(Names[1], Start);
+  T[1].stopTimer();
+
+  if (Mismatches)
+    errs() << "error: " << Kind << " constants were not uniqued\n";
+}
+
+void microbench::runConstants() {
+  LLVMContext Context;
+  Module M("constants", Context);
+  const IntegerType *Int64Ty = Type::getInt64Ty(Context);
+  GlobalVariable *GV = new GlobalVariable(M, Int64Ty, false,
+                                          GlobalValue::ExternalLinkage, 0, "g");
+
+  IntMaker Ints = { Int64Ty };
+  ExprMaker Exprs = { Int64Ty, ConstantExpr::getPtrToInt(GV, Int64Ty) };
+  ArrayMaker Arrays = { Int64Ty, ArrayType::get(Int64Ty, 2) };
+
+  TimerGroup Group("Constant uniquing");
+  Timer Timers[3][2];
+  timeKind("ConstantInt::get", Ints, Group, Timers[0]);
+  timeKind("ConstantExpr::getAdd", Exprs, Group, Timers[1]);
+  timeKind("ConstantArray::get", Arrays, Group, Timers[2]);
+}
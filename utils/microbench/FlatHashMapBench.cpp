@@ -0,0 +1,102 @@
+//===- FlatHashMapBench.cpp - FlatHashMap vs. DenseMap --------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Pointer keys with the regular stride of heap objects are the pattern that
+// the HotDenseMap users (ValueMap, MemoryDependenceAnalysis, SelectionDAG's
+// NodeMap) see.  Both maps run the same insert, hit, miss and erase workload
+// at a few sizes and report the memory they hold once full.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Benchmarks.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/FlatHashMap.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+#include <vector>
+using namespace llvm;
+
+namespace {
+typedef DenseMap<const uint64_t*, const uint64_t*> DenseMapT;
+typedef FlatHashMap<const uint64_t*, const uint64_t*> FlatHashMapT;
+}
+
+/// timeMap - Run the workload over the first N entries of Objects, whose
+/// second half is only used for misses, charging each phase to T[0..3].
+/// Returns the number of bytes the full map held.
+template<typename MapT>
+static size_t timeMap(const std::vector<uint64_t> &Objects, unsigned N,
+                      Timer *T) {
+  const uint64_t *Base = &Objects[0];
+  unsigned Hits = 0;
+  MapT Map;
+
+  T[0].startTimer();
+  for (unsigned i = 0; i != N; ++i)
+    Map[Base + i] = Base + (i ^ 1);
+  T[0].stopTimer();
+
+  T[1].startTimer();
+  for (unsigned Round = 0; Round != 8; ++Round)
+    for (unsigned i = 0; i != N; ++i)
+      if (Map.lookup(Base + i) == Base + (i ^ 1))
+        ++Hits;
+  T[1].stopTimer();
+
+  T[2].startTimer();
+  for (unsigned Round = 0; Round != 8; ++Round)
+    for (unsigned i = N; i != 2 * N; ++i)
+      Hits += Map.count(Base + i);
+  T[2].stopTimer();
+
+  size_t Bytes = Map.getMemorySize();
+
+  T[3].startTimer();
+  for (unsigned i = 0; i != N; ++i)
+    Hits -= Map.erase(Base + i);
+  T[3].stopTimer();
+
+  if (Hits != 7 * N || !Map.empty())
+    errs() << "error: wrong results for " << T[0].getName() << '\n';
+  return Bytes;
+}
+
+void microbench::runFlatHashMap() {
+  static const unsigned Sizes[] = { 1000, 50000, 1000000 };
+  static const char *const Maps[] = { "DenseMap", "FlatHashMap" };
+  static const char *const Phases[] = { "insert", "lookup", "miss", "erase" };
+  std::vector<uint64_t> Objects(2 * Sizes[2]);
+
+  TimerGroup Group("FlatHashMap vs. DenseMap");
+  Timer Timers[3][2][4];
+  for (unsigned s = 0; s != 3; ++s) {
+    size_t Bytes[2];
+    for (unsigned m = 0; m != 2; ++m)
+      for (unsigned p = 0; p != 4; ++p) {
+        std::string Name;
+        raw_string_ostream(Name) << Maps[m] << ' ' << Phases[p] << ", "
+                                 << Sizes[s] << " keys";
+        Timers[s][m][p].init(Name, Group);
+      }
+
+    // Small maps are too quick to time once; repeat them so every size
+    // does about the same work.
+    for (unsigned r = 0, e = Sizes[2] / Sizes[s]; r != e; ++r) {
+      Bytes[0] = timeMap<DenseMapT>(Objects, Sizes[s], Timers[s][0]);
+      Bytes[1] = timeMap<FlatHashMapT>(Objects, Sizes[s], Timers[s][1]);
+    }
+
+    for (unsigned m = 0; m != 2; ++m)
+      outs() << format("%-12s %8u keys: ", Maps[m], Sizes[s])
+             << format("%9u bytes, %5.1f per key\n", unsigned(Bytes[m]),
+                       double(Bytes[m]) / Sizes[s]);
+  }
+  outs().flush();
+}
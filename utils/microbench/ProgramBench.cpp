@@ -0,0 +1,54 @@
+//===- ProgramBench.cpp - Program spawn latency ---------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Spawn latency as the resident set of the parent grows.  On Unix, a memory
+// limit forces the fork/vfork path and no memory limit uses posix_spawn
+// where it is available.  fork has to copy the page tables, vfork and
+// posix_spawn do not.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Benchmarks.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Program.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+#include <string>
+#include <vector>
+using namespace llvm;
+
+void microbench::runProgram() {
+  static const unsigned MemoryLimits[] = { 0, 4096 };
+  const char *Args[] = { "sh", "-c", "exit 0", 0 };
+  sys::Path Shell("/bin/sh");
+
+  TimerGroup Group("Program spawn latency");
+  std::vector<char> Heap;
+  Timer Timers[3][2];
+  for (unsigned Size = 0; Size != 3; ++Size) {
+    Heap.resize(Size * 64 * 1024 * 1024);
+    for (size_t i = 0; i < Heap.size(); i += 4096)
+      Heap[i] = 1;
+
+    for (unsigned i = 0; i != 2; ++i) {
+      Timer &T = Timers[Size][i];
+      T.init(std::string(i ? "fork/vfork" : "posix_spawn") + ", " +
+             char('0' + Size) + " x 64MB resident", Group);
+      T.startTimer();
+      for (unsigned Run = 0; Run != 10; ++Run) {
+        std::string ErrMsg;
+        if (sys::Program::ExecuteAndWait(Shell, Args, 0, 0, 0,
+                                         MemoryLimits[i], &ErrMsg) != 0)
+          errs() << "error: " << Shell.str() << " failed: " << ErrMsg
+                 << '\n';
+      }
+      T.stopTimer();
+    }
+  }
+}
@@ -0,0 +1,73 @@
+//===- SourceMgrBench.cpp - SourceMgr line lookup in a large file ---------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// A large generated assembly file with line lookups and diagnostics at
+// random locations, the pattern of .loc handling and error reporting in a
+// big file.  The first lookup builds the buffer's line index, so it is timed
+// on its own.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Benchmarks.h"
+#include "llvm/ADT/Twine.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+#include <string>
+using namespace llvm;
+
+static const unsigned NumLines = 400000, NumQueries = 200000,
+                      NumDiagnostics = 20000;
+
+/// nextOffset - Step the generator in Seed and return an offset into a
+/// buffer of Size bytes.
+static size_t nextOffset(unsigned &Seed, size_t Size) {
+  Seed = Seed * 1103515245 + 12345;
+  return (Seed >> 4) % Size;
+}
+
+void microbench::runSourceMgr() {
+  std::string Asm;
+  for (unsigned i = 0; i != NumLines; ++i)
+    Asm += (i % 7) ? "\tmovl\t%eax, 12(%esp)\n" : "\n";
+  SourceMgr SM;
+  SM.AddNewSourceBuffer(MemoryBuffer::getMemBuffer(Asm, "big.s"), SMLoc());
+  const char *Start = SM.getMemoryBuffer(0)->getBufferStart();
+
+  TimerGroup Group("SourceMgr in a large file");
+  Timer IndexTimer("First lookup (builds the line index)", Group);
+  Timer QueryTimer("Line lookups at random locations", Group);
+  Timer DiagTimer("Diagnostics at random locations", Group);
+
+  IndexTimer.startTimer();
+  unsigned LastLine =
+    SM.FindLineNumber(SMLoc::getFromPointer(Start + Asm.size() - 1));
+  IndexTimer.stopTimer();
+
+  unsigned Seed = 1, Sum = 0;
+  QueryTimer.startTimer();
+  for (unsigned i = 0; i != NumQueries; ++i)
+    Sum += SM.FindLineNumber(
+      SMLoc::getFromPointer(Start + nextOffset(Seed, Asm.size())));
+  QueryTimer.stopTimer();
+
+  raw_null_ostream Null;
+  DiagTimer.startTimer();
+  for (unsigned i = 0; i != NumDiagnostics; ++i) {
+    SMLoc Loc = SMLoc::getFromPointer(Start + nextOffset(Seed, Asm.size()));
+    SM.GetMessage(Loc, "invalid operand", "error").Print("microbench", Null);
+  }
+  DiagTimer.stopTimer();
+
+  if (LastLine != NumLines || Sum == 0)
+    errs() << "error: wrong line numbers\n";
+  outs() << NumLines << " lines, " << NumQueries << " lookups, "
+         << NumDiagnostics << " diagnostics\n";
+}
@@ -0,0 +1,147 @@
+//===- SparseBitVectorBench.cpp - SparseBitVector vs. BitVector -----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Backward liveness over a synthetic CFG: blocks use and define registers
+// that are mostly local to a neighbourhood of the function, with a few
+// long-lived values, which is the shape LiveVariables and the register
+// allocators see.  The same dataflow problem is solved with SparseBitVector
+// and with BitVector sets.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Benchmarks.h"
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/SparseBitVector.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+#include <vector>
+using namespace llvm;
+
+namespace {
+const unsigned NumBlocks = 1000, NumRegs = 50000;
+
+/// SyntheticCFG - The blocks of the synthetic function: what each one uses
+/// and defines, and its successors.
+struct SyntheticCFG {
+  std::vector<std::vector<unsigned> > Uses, Defs, Succs;
+  SyntheticCFG();
+};
+}
+
+SyntheticCFG::SyntheticCFG()
+  : Uses(NumBlocks), Defs(NumBlocks), Succs(NumBlocks) {
+  unsigned Seed = 42;
+  for (unsigned B = 0; B != NumBlocks; ++B) {
+    unsigned Base = B * (NumRegs / NumBlocks);
+    for (unsigned i = 0; i != 40; ++i) {
+      Seed = Seed * 1103515245 + 12345;
+      unsigned Reg = (Base + (Seed >> 16) % 2000) % NumRegs;
+      if (Seed & 0x100)
+        Uses[B].push_back(Reg);
+      else
+        Defs[B].push_back(Reg);
+    }
+    Seed = Seed * 1103515245 + 12345;
+    Uses[B].push_back((Seed >> 16) % 64);
+
+    if (B + 1 != NumBlocks)
+      Succs[B].push_back(B + 1);
+    if (B % 13 == 12)
+      Succs[B].push_back(B >= 40 ? B - 40 : 0);
+    if (B % 11 == 3 && B + 20 < NumBlocks)
+      Succs[B].push_back(B + 20);
+  }
+}
+
+/// sparseLiveness - Solve liveness with SparseBitVectors and return the
+/// total number of live-in registers.
+static unsigned sparseLiveness(const SyntheticCFG &F) {
+  std::vector<SparseBitVector<> > Use(NumBlocks), Def(NumBlocks);
+  for (unsigned B = 0; B != NumBlocks; ++B) {
+    for (unsigned i = 0, e = F.Uses[B].size(); i != e; ++i)
+      Use[B].set(F.Uses[B][i]);
+    for (unsigned i = 0, e = F.Defs[B].size(); i != e; ++i)
+      Def[B].set(F.Defs[B][i]);
+  }
+
+  std::vector<SparseBitVector<> > LiveIn(NumBlocks), LiveOut(NumBlocks);
+  for (bool Changed = true; Changed; ) {
+    Changed = false;
+    for (unsigned B = NumBlocks; B-- != 0; ) {
+      for (unsigned i = 0, e = F.Succs[B].size(); i != e; ++i)
+        LiveOut[B] |= LiveIn[F.Succs[B][i]];
+      SparseBitVector<> In = LiveOut[B] - Def[B];
+      In |= Use[B];
+      if (In != LiveIn[B]) {
+        LiveIn[B] = In;
+        Changed = true;
+      }
+    }
+  }
+
+  unsigned Count = 0;
+  for (unsigned B = 0; B != NumBlocks; ++B)
+    Count += LiveIn[B].count();
+  return Count;
+}
+
+/// denseLiveness - Solve liveness with BitVectors and return the total
+/// number of live-in registers.
+static unsigned denseLiveness(const SyntheticCFG &F) {
+  std::vector<BitVector> Use(NumBlocks, BitVector(NumRegs)),
+                         Def(NumBlocks, BitVector(NumRegs));
+  for (unsigned B = 0; B != NumBlocks; ++B) {
+    for (unsigned i = 0, e = F.Uses[B].size(); i != e; ++i)
+      Use[B].set(F.Uses[B][i]);
+    for (unsigned i = 0, e = F.Defs[B].size(); i != e; ++i)
+      Def[B].set(F.Defs[B][i]);
+  }
+
+  std::vector<BitVector> LiveIn(NumBlocks, BitVector(NumRegs)),
+                         LiveOut(NumBlocks, BitVector(NumRegs));
+  for (bool Changed = true; Changed; ) {
+    Changed = false;
+    for (unsigned B = NumBlocks; B-- != 0; ) {
+      for (unsigned i = 0, e = F.Succs[B].size(); i != e; ++i)
+        LiveOut[B] |= LiveIn[F.Succs[B][i]];
+      BitVector In = ~Def[B];
+      In &= LiveOut[B];
+      In |= Use[B];
+      if (In != LiveIn[B]) {
+        LiveIn[B] = In;
+        Changed = true;
+      }
+    }
+  }
+
+  unsigned Count = 0;
+  for (unsigned B = 0; B != NumBlocks; ++B)
+    Count += LiveIn[B].count();
+  return Count;
+}
+
+void microbench::runSparseBitVector() {
+  SyntheticCFG F;
+  TimerGroup Group("SparseBitVector liveness");
+  Timer Sparse("SparseBitVector liveness", Group);
+  Timer Dense("BitVector liveness", Group);
+
+  Sparse.startTimer();
+  unsigned SparseCount = sparseLiveness(F);
+  Sparse.stopTimer();
+
+  Dense.startTimer();
+  unsigned DenseCount = denseLiveness(F);
+  Dense.stopTimer();
+
+  if (SparseCount != DenseCount)
+    errs() << "error: the solutions differ\n";
+  outs() << NumBlocks << " blocks, " << NumRegs << " registers, "
+         << SparseCount << " live-in in total\n";
+}
@@ -0,0 +1,63 @@
+//===- ThreadPoolBench.cpp - ThreadPool fork/join scaling -----------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// The same recursive fork/join workload on pools of increasing size.  Every
+// task spawns its two subproblems in a nested group and waits for them, so
+// this mostly measures the cost of spawning, stealing and waiting.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Benchmarks.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+#include <string>
+using namespace llvm;
+
+namespace {
+struct FibTask {
+  ThreadPool *Pool;
+  unsigned N;
+  unsigned Result;
+};
+}
+
+static void Fib(void *Arg) {
+  FibTask *T = static_cast<FibTask*>(Arg);
+  if (T->N < 2) {
+    T->Result = T->N;
+    return;
+  }
+  FibTask A = { T->Pool, T->N - 1, 0 };
+  FibTask B = { T->Pool, T->N - 2, 0 };
+  TaskGroup Group(*T->Pool);
+  Group.spawn(Fib, &A);
+  Group.spawn(Fib, &B);
+  Group.wait();
+  T->Result = A.Result + B.Result;
+}
+
+void microbench::runThreadPool() {
+  TimerGroup Group("ThreadPool scaling");
+  Timer Timers[4];
+  for (unsigned i = 0, Threads = 1; i != 4; ++i, Threads *= 2) {
+    ThreadPool Pool(Threads);
+    Timer &T = Timers[i];
+    T.init(std::string("fib(24) on ") + char('0' + Threads) + " threads",
+           Group);
+    T.startTimer();
+    FibTask Task = { &Pool, 24, 0 };
+    TaskGroup G(Pool);
+    G.spawn(Fib, &Task);
+    G.wait();
+    T.stopTimer();
+    if (Task.Result != 46368)
+      errs() << "error: wrong result on " << Threads << " threads\n";
+  }
+}
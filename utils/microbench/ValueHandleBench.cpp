@@ -0,0 +1,83 @@
+//===- ValueHandleBench.cpp - Value handle creation and deletion ----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Every instruction of a large function is watched by a ValueMap entry, a
+// WeakVH and a CallbackVH, the way the JIT's address maps and
+// ScalarEvolution's caches watch them, and the function is then deleted,
+// which runs a handle callback for every value.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Benchmarks.h"
+#include "llvm/Constants.h"
+#include "llvm/DerivedTypes.h"
+#include "llvm/Instructions.h"
+#include "llvm/LLVMContext.h"
+#include "llvm/Module.h"
+#include "llvm/ADT/ValueMap.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/ValueHandle.h"
+#include "llvm/Support/raw_ostream.h"
+#include <vector>
+using namespace llvm;
+
+namespace {
+class CountingVH : public CallbackVH {
+  unsigned *Deleted;
+public:
+  CountingVH(Value *V, unsigned *Deleted) : CallbackVH(V), Deleted(Deleted) {}
+  virtual void deleted() {
+    ++*Deleted;
+    setValPtr(0);
+  }
+};
+}
+
+void microbench::runValueHandle() {
+  LLVMContext Context;
+  Module M("handles", Context);
+  const Type *I32 = Type::getInt32Ty(Context);
+  std::vector<const Type*> Params(1, I32);
+  Function *F = cast<Function>(
+    M.getOrInsertFunction("f", FunctionType::get(I32, Params, false)));
+  BasicBlock *BB = BasicBlock::Create(Context, "entry", F);
+  const unsigned NumValues = 100000;
+  std::vector<Value*> Values;
+  Value *V = F->arg_begin();
+  for (unsigned i = 0; i != NumValues; ++i) {
+    V = BinaryOperator::CreateAdd(V, ConstantInt::get(I32, i), "", BB);
+    Values.push_back(V);
+  }
+  ReturnInst::Create(Context, V, BB);
+
+  TimerGroup Group("Value handles");
+  Timer CreateTimer("Create handles", Group);
+  Timer DeleteTimer("Delete function", Group);
+
+  CreateTimer.startTimer();
+  ValueMap<Value*, unsigned> Map;
+  std::vector<WeakVH> Weak;
+  std::vector<CountingVH> Callbacks;
+  Weak.reserve(NumValues);
+  Callbacks.reserve(NumValues);
+  unsigned Deleted = 0;
+  for (unsigned i = 0; i != NumValues; ++i) {
+    Map[Values[i]] = i;
+    Weak.push_back(Values[i]);
+    Callbacks.push_back(CountingVH(Values[i], &Deleted));
+  }
+  CreateTimer.stopTimer();
+
+  DeleteTimer.startTimer();
+  F->eraseFromParent();
+  DeleteTimer.stopTimer();
+
+  if (Map.size() != 0 || Deleted != NumValues)
+    errs() << "error: not every handle saw its value deleted\n";
+}
@@ -0,0 +1,102 @@
+//===- microbench.cpp - Run timing benchmarks of LLVM data structures -----===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// microbench runs the named benchmarks (all of them if none are named) and
+// prints their timer reports.  The unit tests only check behavior; timings
+// belong here so they don't slow down or destabilize the test suite.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Benchmarks.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/PrettyStackTrace.h"
+#include "llvm/Support/Signals.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringRef.h"
+using namespace llvm;
+
+static cl::list<std::string>
+BenchmarkNames(cl::Positional, cl::desc("<benchmark>..."), cl::ZeroOrMore);
+
+static cl::opt<bool>
+ListBenchmarks("list", cl::desc("List the available benchmarks and exit"));
+
+namespace {
+struct Benchmark {
+  const char *Name;
+  const char *Description;
+  void (*Run)();
+};
+}
+
+static const Benchmark Benchmarks[] = {
+  { "bitvector", "BitVector fused bulk operations vs. temporaries",
+    microbench::runBitVector },
+  { "constants", "Uniqued constant creation and lookup throughput",
+    microbench::runConstants },
+  { "flathashmap", "FlatHashMap vs. DenseMap on pointer keys",
+    microbench::runFlatHashMap },
+  { "program", "Program spawn latency as the parent's heap grows",
+    microbench::runProgram },
+  { "sourcemgr", "SourceMgr line lookups and diagnostics in a large file",
+    microbench::runSourceMgr },
+  { "sparsebitvector", "SparseBitVector vs. BitVector liveness",
+    microbench::runSparseBitVector },
+  { "tbaa", "Type-based alias analysis queries",
+    microbench::runTBAA },
+  { "threadpool", "ThreadPool fork/join scaling",
+    microbench::runThreadPool },
+  { "valuehandle", "Value handles on every instruction of a large function",
+    microbench::runValueHandle }
+};
+
+static const Benchmark *findBenchmark(StringRef Name) {
+  for (unsigned i = 0; i != array_lengthof(Benchmarks); ++i)
+    if (Name == Benchmarks[i].Name)
+      return &Benchmarks[i];
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  sys::PrintStackTraceOnErrorSignal();
+  PrettyStackTraceProgram X(argc, argv);
+  llvm_shutdown_obj Y;  // Call llvm_shutdown() on exit.
+  cl::ParseCommandLineOptions(argc, argv, "LLVM data structure benchmarks\n");
+
+  if (ListBenchmarks) {
+    for (unsigned i = 0; i != array_lengthof(Benchmarks); ++i)
+      outs() << "  " << Benchmarks[i].Name << " - "
+             << Benchmarks[i].Description << '\n';
+    return 0;
+  }
+
+  // Look every name up first so a typo doesn't waste a long run.
+  std::vector<const Benchmark*> ToRun;
+  for (unsigned i = 0, e = BenchmarkNames.size(); i != e; ++i) {
+    const Benchmark *B = findBenchmark(BenchmarkNames[i]);
+    if (!B) {
+      errs() << argv[0] << ": unknown benchmark '" << BenchmarkNames[i]
+             << "' (see -list)\n";
+      return 1;
+    }
+    ToRun.push_back(B);
+  }
+  if (ToRun.empty())
+    for (unsigned i = 0; i != array_lengthof(Benchmarks); ++i)
+      ToRun.push_back(&Benchmarks[i]);
+
+  for (unsigned i = 0, e = ToRun.size(); i != e; ++i) {
+    outs() << "=== " << ToRun[i]->Name << " ===\n";
+    outs().flush();
+    ToRun[i]->Run();
+  }
+  return 0;
+}
@@ -0,0 +1,145 @@
+#!/usr/bin/env python
+
+"""
+Measure how opt scales with -function-pass-threads.
+
+Generates a module with many functions, then times opt on it with a range of
+thread counts and checks that the output of every run is identical to the
+serial one.  Two pipelines are timed:
+
+  O2        - "opt -O2"; only the function passes -O2 runs before the module
+              passes (the ones that are spread over threads) get faster.
+  function  - a pipeline made up only of function passes, which runs on the
+              threads from start to finish.
+
+Example:
+  utils/parallel-opt-time.py Release/bin/opt -f 4000 -t 1,2,4,8
+"""
+
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+from optparse import OptionParser
+
+FUNCTION_PASSES = ["-scalarrepl", "-instcombine", "-simplifycfg", "-gvn",
+                   "-licm", "-loop-unswitch", "-indvars", "-instcombine",
+                   "-jump-threading", "-dse", "-simplifycfg"]
+
+FUNCTION = """\
+define i32 @f%(n)d(i32* %%p, i32 %%n, i32 %%k) nounwind {
+entry:
+  %%sum = alloca i32
+  %%i = alloca i32
+  store i32 0, i32* %%sum
+  store i32 0, i32* %%i
+  br label %%cond
+
+cond:
+  %%iv = load i32* %%i
+  %%done = icmp sge i32 %%iv, %%n
+  br i1 %%done, label %%exit, label %%body
+
+body:
+  %%addr = getelementptr i32* %%p, i32 %%iv
+  %%v = load i32* %%addr
+  %%kk = mul i32 %%k, %(n)d
+  %%kk2 = mul i32 %%k, %(n)d
+  %%big = icmp sgt i32 %%k, %(n)d
+  br i1 %%big, label %%then, label %%else
+
+then:
+  %%a = add i32 %%v, %%kk
+  %%s1 = load i32* %%sum
+  %%t1 = add i32 %%s1, %%a
+  store i32 %%t1, i32* %%sum
+  br label %%latch
+
+else:
+  %%b = sub i32 %%v, %%kk2
+  %%s2 = load i32* %%sum
+  %%t2 = add i32 %%s2, %%b
+  store i32 %%t2, i32* %%sum
+  br label %%latch
+
+latch:
+  %%v2 = load i32* %%addr
+  %%x = xor i32 %%v2, %%v2
+  %%s3 = load i32* %%sum
+  %%t3 = add i32 %%s3, %%x
+  store i32 %%t3, i32* %%sum
+  %%next = add i32 %%iv, 1
+  store i32 %%next, i32* %%i
+  br label %%cond
+
+exit:
+  %%r = load i32* %%sum
+  %%len = call i64 @strlen(i8* getelementptr ([6 x i8]* @str, i32 0, i32 0))
+  %%len32 = trunc i64 %%len to i32
+  %%r2 = add i32 %%r, %%len32
+  ret i32 %%r2
+}
+
+"""
+
+def generate(path, count):
+    out = open(path, 'w')
+    out.write('@str = internal constant [6 x i8] c"hello\\00"\n')
+    out.write('declare i64 @strlen(i8*)\n\n')
+    # The functions are external and don't call each other, so -O2 neither
+    # deletes nor inlines them.
+    for n in range(count):
+        out.write(FUNCTION % {'n': n})
+    out.close()
+
+def run(args, output):
+    start = time.time()
+    if subprocess.call(args + ["-S", "-o", output]) != 0:
+        print >>sys.stderr, "error: '%s' failed" % ' '.join(args)
+        sys.exit(1)
+    return time.time() - start
+
+def main():
+    parser = OptionParser("usage: %prog [options] opt")
+    parser.add_option("-f", dest="functions", type="int", default=2000,
+                      help="number of functions in the module [%default]")
+    parser.add_option("-t", dest="threads", default="1,2,4,8",
+                      help="thread counts to time [%default]")
+    parser.add_option("-n", dest="count", type="int", default=3,
+                      help="number of runs of each configuration [%default]")
+    opts, args = parser.parse_args()
+    if len(args) != 1:
+        parser.error("expected the path of opt")
+    opt = args[0]
+    threads = [int(t) for t in opts.threads.split(',')]
+
+    tmpdir = tempfile.mkdtemp()
+    try:
+        source = os.path.join(tmpdir, "input.ll")
+        generate(source, opts.functions)
+        # Time optimization, not parsing assembly.
+        input = os.path.join(tmpdir, "input.bc")
+        llvm_as = os.path.join(os.path.dirname(opt), "llvm-as")
+        if subprocess.call([llvm_as, source, "-o", input]) != 0:
+            print >>sys.stderr, "error: could not assemble the input"
+            sys.exit(1)
+
+        for name, passes in (("O2", ["-O2"]), ("function", FUNCTION_PASSES)):
+            serial = None
+            for t in threads:
+                output = os.path.join(tmpdir, "%s-%d.ll" % (name, t))
+                args = [opt, input] + passes + ["-function-pass-threads=%d" % t]
+                times = sorted([run(args, output) for i in range(opts.count)])
+                if serial is None:
+                    serial = (output, times[0])
+                same = open(output).read() == open(serial[0]).read()
+                print "%-8s  %2d threads  min %7.3fs  speedup %5.2fx  %s" % (
+                    name, t, times[0], serial[1] / times[0],
+                    same and "same output" or "OUTPUT DIFFERS")
+    finally:
+        shutil.rmtree(tmpdir)
+
+if __name__ == '__main__':
+    main()
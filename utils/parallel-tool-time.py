@@ -0,0 +1,160 @@
+#!/usr/bin/env python
+
+"""
+Measure how an LLVM tool scales with one of its thread count options.
+
+Generates a number of modules with many functions each and links them into
+one large module with llvm-link.  Then times the tool on that module (as
+bitcode, or as text with --text) with a range of values of the thread option.
+Each run's output is compared against the single threaded output, which must
+be byte for byte the same.
+
+The options that spread work over threads, and tools that exercise them:
+
+  -verify-threads         llvm-as --text, llvm-link (verifyModule)
+  -print-threads          llvm-dis (Module::print)
+  -bitcode-write-threads  llvm-as --text, opt (the bitcode writer)
+
+Examples:
+  utils/parallel-tool-time.py Release/bin/llvm-dis -print-threads
+  utils/parallel-tool-time.py --text Release/bin/llvm-as -verify-threads
+  utils/parallel-tool-time.py -m 16 -f 1000 -t 1,2,4,8 \\
+      Release/bin/opt -bitcode-write-threads
+"""
+
+import filecmp
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+from optparse import OptionParser
+
+FUNCTION = """\
+define i32 @m%(m)d_f%(n)d(i32* %%p, i32 %%n) nounwind {
+entry:
+  br label %%cond
+
+cond:
+  %%iv = phi i32 [ 0, %%entry ], [ %%next, %%latch ]
+  %%sum = phi i32 [ 0, %%entry ], [ %%sum2, %%latch ]
+  %%done = icmp sge i32 %%iv, %%n
+  br i1 %%done, label %%exit, label %%body
+
+body:
+  %%addr = getelementptr i32* %%p, i32 %%iv
+  %%v = load i32* %%addr
+  %%big = icmp sgt i32 %%v, %(n)d
+  br i1 %%big, label %%then, label %%latch
+
+then:
+  %%a = mul i32 %%v, %(m)d
+  %%b = call i32 @m%(m)d_helper(i32 %%a)
+  br label %%latch
+
+latch:
+  %%x = phi i32 [ %%v, %%body ], [ %%b, %%then ]
+  %%sum2 = add i32 %%sum, %%x
+  %%next = add i32 %%iv, 1
+  br label %%cond
+
+exit:
+  ret i32 %%sum
+}
+
+"""
+
+HELPER = """\
+define internal i32 @m%(m)d_helper(i32 %%x) nounwind readnone {
+entry:
+  %%y = xor i32 %%x, %(m)d
+  ret i32 %%y
+}
+
+"""
+
+def generate(path, module, count):
+    out = open(path, 'w')
+    out.write(HELPER % {'m': module})
+    for n in range(count):
+        out.write(FUNCTION % {'m': module, 'n': n})
+    out.close()
+
+def check_call(args, what):
+    if subprocess.call(args) != 0:
+        print >>sys.stderr, "error: could not %s" % what
+        sys.exit(1)
+
+def run(args):
+    start = time.time()
+    if subprocess.call(args) != 0:
+        print >>sys.stderr, "error: '%s' failed" % ' '.join(args)
+        sys.exit(1)
+    return time.time() - start
+
+def main():
+    parser = OptionParser("usage: %prog [options] tool thread-option")
+    parser.add_option("-m", dest="modules", type="int", default=16,
+                      help="number of modules to link [%default]")
+    parser.add_option("-f", dest="functions", type="int", default=1000,
+                      help="number of functions in each module [%default]")
+    parser.add_option("-t", dest="threads", default="1,2,4,8",
+                      help="thread counts to time [%default]")
+    parser.add_option("-n", dest="count", type="int", default=3,
+                      help="number of runs of each configuration [%default]")
+    parser.add_option("--text", dest="text", action="store_true",
+                      default=False,
+                      help="give the tool the module as text, not bitcode")
+    # The thread option starts with a dash, so stop at the tool.
+    parser.disable_interspersed_args()
+    opts, args = parser.parse_args()
+    if len(args) != 2:
+        parser.error("expected the path of the tool and its thread option")
+    tool, option = args
+    bindir = os.path.dirname(tool)
+    llvm_as = os.path.join(bindir, "llvm-as")
+    llvm_dis = os.path.join(bindir, "llvm-dis")
+    llvm_link = os.path.join(bindir, "llvm-link")
+    threads = [int(t) for t in opts.threads.split(',')]
+
+    tmpdir = tempfile.mkdtemp()
+    try:
+        inputs = []
+        for m in range(opts.modules):
+            source = os.path.join(tmpdir, "input%d.ll" % m)
+            generate(source, m, opts.functions)
+            input = os.path.join(tmpdir, "input%d.bc" % m)
+            check_call([llvm_as, source, "-o", input], "assemble the input")
+            inputs.append(input)
+        linked = os.path.join(tmpdir, "linked.bc")
+        check_call([llvm_link] + inputs + ["-o", linked], "link the inputs")
+        print "linked module: %d functions, %d bytes of bitcode" % (
+            opts.modules * (opts.functions + 1), os.path.getsize(linked))
+        if opts.text:
+            text = os.path.join(tmpdir, "linked.ll")
+            check_call([llvm_dis, linked, "-o", text],
+                       "disassemble the module")
+            linked = text
+
+        serial = None
+        reference = os.path.join(tmpdir, "reference.out")
+        output = os.path.join(tmpdir, "output.out")
+        print "%s %s:" % (os.path.basename(tool), option)
+        for t in threads:
+            args = [tool, linked, "-o", output, "%s=%d" % (option, t)]
+            times = sorted([run(args) for i in range(opts.count)])
+            if serial is None:
+                serial = times[0]
+                shutil.copyfile(output, reference)
+                size = os.path.getsize(output)
+            elif not filecmp.cmp(reference, output, shallow=False):
+                print >>sys.stderr, "error: output with %d threads differs" % t
+                sys.exit(1)
+            print "%2d threads  min %7.3fs  %7.1f MB/s  speedup %5.2fx" % (
+                t, times[0], size / times[0] / 1e6, serial / times[0])
+    finally:
+        shutil.rmtree(tmpdir)
+
+if __name__ == '__main__':
+    main()
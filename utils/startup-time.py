@@ -0,0 +1,73 @@
+#!/usr/bin/env python
+
+"""
+Measure the startup time of an LLVM tool.
+
+Runs the tool many times on work that takes almost no time, so that what is
+left is process startup: static constructors (including the registration of
+every cl::opt), command line parsing and teardown.  Two workloads are timed:
+
+  version  - "<tool> -version"
+  compile  - "<tool> <trivial .ll> -o /dev/null" (for llc and opt)
+
+Example:
+  utils/startup-time.py Release/bin/llc -n 500
+"""
+
+import os
+import subprocess
+import sys
+import tempfile
+import time
+from optparse import OptionParser
+
+TRIVIAL_LL = """\
+define i32 @main() nounwind {
+entry:
+  ret i32 0
+}
+"""
+
+def time_runs(args, count, check_status=True):
+    devnull = open(os.devnull, 'w')
+    times = []
+    for i in range(count):
+        start = time.time()
+        result = subprocess.call(args, stdout=devnull, stderr=devnull)
+        times.append(time.time() - start)
+        if check_status and result != 0:
+            print >>sys.stderr, "error: '%s' failed" % ' '.join(args)
+            sys.exit(1)
+    devnull.close()
+    times.sort()
+    return times
+
+def report(name, times):
+    print "%-8s  min %7.2fms  median %7.2fms  total %7.2fs" % (
+        name, times[0] * 1000, times[len(times) // 2] * 1000, sum(times))
+
+def main():
+    parser = OptionParser("usage: %prog [options] tool")
+    parser.add_option("-n", dest="count", type="int", default=200,
+                      help="number of runs of each workload [%default]")
+    opts, args = parser.parse_args()
+    if len(args) != 1:
+        parser.error("expected the path of one tool")
+    tool = args[0]
+
+    # -version exits with a non-zero status once it has printed.
+    report("version", time_runs([tool, "-version"], opts.count,
+                                check_status=False))
+
+    if os.path.basename(tool) in ("llc", "opt"):
+        fd, path = tempfile.mkstemp(suffix=".ll")
+        os.write(fd, TRIVIAL_LL)
+        os.close(fd)
+        try:
+            report("compile", time_runs([tool, path, "-o", os.devnull],
+                                        opts.count))
+        finally:
+            os.remove(path)
+
+if __name__ == '__main__':
+    main()